@@ -245,6 +245,7 @@ _
 \fB-E\fR	just expand macros and "include" files and write result to standard output
 \fB-f \fIoutfile	\fRput output into \fIoutfile\fR
 \fB-F\fR	put output into file, deriving output file name from input file name
+\fB-j \fInum	\fRprint using up to \fInum\fR processes at once
 \fB-l\fR	print the Mup license and exit
 \fB-m \fImidifile	\fRgenerate MIDI output into \fImidifile\fR
 \fB-M	\fRgenerate MIDI output, derive file name\fR
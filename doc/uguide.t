@@ -1602,6 +1602,28 @@ If none are specified (input is read from standard input),
 the name "stdin.ps" will be used for the output file.
 .Co
 .Hi
+\fB-j\fP \fIN\fP
+.He
+.ig
+.Hm joption
+<B>-j</B> <I>N</I>
+..
+.Mo
+Option not needed.
+.Op
+Use up to \fIN\fP processes to generate the PostScript output.
+The pages are divided into contiguous groups, each done by a separate
+process, and the results are put together in order, so the output is
+the same as without this option. On a machine with several processors,
+this can make printing a large score faster.
+Splitting up the pages only happens when printing all pages,
+or a single range of pages given with the \fB-o\fP option.
+Placing things above and below each staff is also split up,
+with each process doing some of the staffs on every score.
+This option only has an effect on systems that support multiple processes.
+\fIN\fP can be from 1 to 64.
+.Co
+.Hi
 \fB-l\fP
 .He
 .ig
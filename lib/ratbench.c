@@ -0,0 +1,177 @@
+/*
+ Copyright (c) 1995-2024  by Arkkra Enterprises.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms,
+ with or without modification, are permitted provided that
+ the following conditions are met:
+
+ 1. Redistributions of source code must retain
+ the above copyright notice, this list of conditions
+ and the following DISCLAIMER.
+
+ 2. Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and
+ the following DISCLAIMER in the documentation and/or
+ other materials provided with the distribution.
+
+ 3. Any additions, deletions, or changes to the original files
+ must be clearly indicated in accompanying documentation,
+ including the reasons for the changes,
+ and the names of those who made the modifications.
+
+	DISCLAIMER
+
+ THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS
+ OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*
+ *	ratbench.c	microbenchmark for the rational number routines
+ *
+ *	This program times radd(), rmul(), and the GT comparison on arrays of
+ *	random rational numbers, both as normally compiled and using the
+ *	emulated 64-bit arithmetic (ratold.c), for "small" numbers (which
+ *	take the shortcut that needs no 64-bit arithmetic) and for large ones.
+ *
+ *	Usage:	ratbench [passes]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "rational.h"
+
+extern RATIONAL old_radd(RATIONAL x, RATIONAL y);
+extern RATIONAL old_rmul(RATIONAL x, RATIONAL y);
+extern void old_rred(RATIONAL *ap);
+extern int old_gtrat(RATIONAL x, RATIONAL y);
+extern void (*old_raterrfuncp)(int);
+
+#define NUMRATS	(4096)
+
+static RATIONAL Small[NUMRATS];	/* numbers that fit in 15 bits */
+static RATIONAL Large[NUMRATS];	/* numbers that need 64-bit arithmetic */
+static volatile long Sink;	/* so the work can't be optimized away */
+
+/* error handler, so that overflows don't print anything */
+static void
+quiet(int code)
+{
+}
+
+/* fill in an array with random rationals, with values up to max */
+static void
+fill(RATIONAL *r, long max)
+{
+	int i;
+
+	for (i = 0; i < NUMRATS; i++) {
+		r[i].n = (INT32B)(rand() % max) - (INT32B)(max / 2);
+		r[i].d = (INT32B)(rand() % max) + 1;
+		old_rred(&r[i]);
+	}
+}
+
+/* print how long one test took */
+static void
+report(char *name, char *which, clock_t start, long ops)
+{
+	double secs;
+
+	secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+	(void)printf("%-6s %-6s %8.2f ns/op\n", name, which,
+			secs * 1.0e9 / ops);
+}
+
+/* time all the operations on one array */
+static void
+bench(char *which, RATIONAL *r, int passes)
+{
+	clock_t start;
+	long sum;
+	int p, i;
+
+	start = clock();
+	for (sum = 0, p = 0; p < passes; p++) {
+		for (i = 1; i < NUMRATS; i++) {
+			sum += radd(r[i - 1], r[i]).n;
+		}
+	}
+	Sink = sum;
+	report("radd", which, start, (long)passes * (NUMRATS - 1));
+
+	start = clock();
+	for (sum = 0, p = 0; p < passes; p++) {
+		for (i = 1; i < NUMRATS; i++) {
+			sum += old_radd(r[i - 1], r[i]).n;
+		}
+	}
+	Sink = sum;
+	report("radd", "(old)", start, (long)passes * (NUMRATS - 1));
+
+	start = clock();
+	for (sum = 0, p = 0; p < passes; p++) {
+		for (i = 1; i < NUMRATS; i++) {
+			sum += rmul(r[i - 1], r[i]).n;
+		}
+	}
+	Sink = sum;
+	report("rmul", which, start, (long)passes * (NUMRATS - 1));
+
+	start = clock();
+	for (sum = 0, p = 0; p < passes; p++) {
+		for (i = 1; i < NUMRATS; i++) {
+			sum += old_rmul(r[i - 1], r[i]).n;
+		}
+	}
+	Sink = sum;
+	report("rmul", "(old)", start, (long)passes * (NUMRATS - 1));
+
+	start = clock();
+	for (sum = 0, p = 0; p < passes; p++) {
+		for (i = 1; i < NUMRATS; i++) {
+			sum += GT(r[i - 1], r[i]);
+		}
+	}
+	Sink = sum;
+	report("GT", which, start, (long)passes * (NUMRATS - 1));
+
+	start = clock();
+	for (sum = 0, p = 0; p < passes; p++) {
+		for (i = 1; i < NUMRATS; i++) {
+			sum += old_gtrat(r[i - 1], r[i]);
+		}
+	}
+	Sink = sum;
+	report("GT", "(old)", start, (long)passes * (NUMRATS - 1));
+}
+
+int
+main(int argc, char **argv)
+{
+	int passes;
+
+	passes = (argc > 1 ? atoi(argv[1]) : 500);
+	raterrfuncp = quiet;
+	old_raterrfuncp = quiet;
+
+	srand(1);
+	fill(Small, 0x7fffL);
+	fill(Large, 0x7fffffffL);
+
+	bench("small", Small, passes);
+	bench("large", Large, passes);
+	return (0);
+}
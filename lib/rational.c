@@ -45,7 +45,8 @@
  *		radd(), rsub(), rmul(), rdiv(), rneg(), rinv(), rrai(), rred(),
  *		ator(), rtoa(); also gtrat(), called by macros GT,GE,LT,LE
  *
- *		ratmsg(), add64_64(), mul32_64(), divmod64(), red64_64()
+ *		ratmsg(), add64_64(), mul32_64(), divmod64(), red64_64(),
+ *		red64(), gcd64()
  *
  *		The first group of functions are for the user.	The second
  *		are for internal use only.
@@ -85,6 +86,13 @@
  *		order bits and the 1 subscript contains the high order bits.
  *		The numbers are usually used as two's complement signed
  *		integers, so the high bit of the 1 subscript is a sign bit.
+ *
+ *		But if the compiler is C99 or later, stdint.h gives us a
+ *		native 64-bit type, int64_t, and that is used instead (see
+ *		RAT_NATIVE64 below).  Since numerators and denominators are
+ *		limited to MAXLONG, any a*b + c*d of them fits in 63 bits, so
+ *		nothing wider is ever needed.  The results, including overflow
+ *		and raterrno, are the same either way.
  */
 
 #ifndef stderr
@@ -99,6 +107,14 @@
 #	include "rational.h"
 #endif
 
+/*
+ * Use native 64-bit arithmetic if we can.  Defining RAT_NO_NATIVE64 forces
+ * the emulated 64-bit arithmetic to be used anyway, so that the two can be
+ * compared (see rattest.c).
+ */
+#if __STDC_VERSION__ >= 199901L && ! defined(RAT_NO_NATIVE64)
+#define RAT_NATIVE64
+#endif
 
 
 /*
@@ -202,10 +218,15 @@
 /* declare as static the functions that are only used internally */
 #ifdef __STDC__
 static void ratmsg(int code);
+#ifdef RAT_NATIVE64
+static RATIONAL red64(int64_t num, int64_t den);
+static uint64_t gcd64(uint64_t u, uint64_t v);
+#else
 static void add64_64(INT32B a[], INT32B x[], INT32B y[]);
 static void mul32_64(INT32B a[], INT32B x, INT32B y);
 static void divmod64(INT32B x[], INT32B y[], INT32B q[], INT32B r[]);
 static void red64_64(INT32B num[], INT32B den[]);
+#endif
 #else
 static void ratmsg(), add64_64(), mul32_64(), divmod64(), red64_64();
 #endif
@@ -242,9 +263,11 @@ RATIONAL x, y;
 
 {
 	RATIONAL a;			/* the answer */
+#ifndef RAT_NATIVE64
 	INT32B bign[2];			/* 64-bit numerator */
 	INT32B bigd[2];			/* 64-bit denominator */
 	INT32B bigt[2];			/* temp storage */
+#endif
 
 
 	raterrno = RATNOERR;		/* no error yet */
@@ -260,6 +283,10 @@ RATIONAL x, y;
 		return(a);
 	}
 
+#ifdef RAT_NATIVE64
+	return(red64((int64_t)x.n * y.d + (int64_t)x.d * y.n,
+			(int64_t)x.d * y.d));
+#else
 	/*
 	 * To avoid overflow during the calculations, use two INT32B to
 	 * hold numbers.
@@ -280,6 +307,7 @@ RATIONAL x, y;
 	a.d = bigd[0];
 
 	return(a);
+#endif
 }
 
 /*
@@ -341,8 +369,10 @@ RATIONAL x, y;
 
 {
 	RATIONAL a;			/* the answer */
+#ifndef RAT_NATIVE64
 	INT32B bign[2];			/* 64-bit numerator */
 	INT32B bigd[2];			/* 64-bit denominator */
+#endif
 
 
 	raterrno = RATNOERR;		/* no error yet */
@@ -358,6 +388,9 @@ RATIONAL x, y;
 		return(a);
 	}
 
+#ifdef RAT_NATIVE64
+	return(red64((int64_t)x.n * y.n, (int64_t)x.d * y.d));
+#else
 	/*
 	 * To avoid overflow during the calculations, use two INT32B to
 	 * hold numbers.
@@ -376,6 +409,7 @@ RATIONAL x, y;
 	a.d = bigd[0];
 
 	return(a);
+#endif
 }
 
 /*
@@ -833,6 +867,11 @@ gtrat(x, y)
 RATIONAL x, y;
 
 {
+#ifdef RAT_NATIVE64
+	/* cross-multiply; can't overflow 64 bits */
+	/* note:  this depends on positive denominators */
+	return((int64_t)x.n * y.d > (int64_t)x.d * y.n);
+#else
 	INT32B a[2];		/* temp holding areas for 64-bit numbers */
 	INT32B b[2];
 
@@ -851,6 +890,7 @@ RATIONAL x, y;
 	mul32_64(b, x.d, y.n);
 
 	return(GT64(a, b));
+#endif
 }
 
 /*
@@ -901,6 +941,144 @@ int code;
 	}
 }
 
+#ifdef RAT_NATIVE64
+/*
+ *	red64()		reduce a 64 bit over 64 bit rational into a RATIONAL
+ *
+ *	This function takes two 64-bit numbers as numerator and denominator
+ *	of a rational number, and reduces them to lowest terms, with the
+ *	denominator positive.  If the result fits in a RATIONAL, it is
+ *	returned; otherwise it is an overflow.  It is the native equivalent
+ *	of calling red64_64() and then checking the result with INT32().
+ *	As there, a zero denominator can only come from an invalid number
+ *	passed by the user, and is reported as RATPARM.
+ *
+ *	Parameters:	num	numerator
+ *			den	denominator
+ *
+ *	Return value:	The result, or 0/1 on error.
+ *
+ *	Side effects:	On error, raterrno is set to RATPARM or RATOVER, and
+ *			either a message is printed or a user-supplied error
+ *			handler is called.
+ */
+
+static RATIONAL
+red64(num, den)
+
+int64_t num;
+int64_t den;
+
+{
+	RATIONAL a;		/* the answer */
+	uint64_t un, ud;	/* absolute values of num and den */
+	uint64_t g;		/* their greatest common divisor */
+	int sign;		/* answer is pos (1) or neg (-1) */
+
+
+	if (den == 0) {
+		ratmsg(RATPARM);	/* set raterrno, report error */
+		return(zero);
+	}
+
+	if (num == 0) {			/* answer is 0/1 */
+		return(zero);
+	}
+
+	/* figure out sign of answer, and make num & den positive */
+	sign = 1;
+	un = (uint64_t)num;
+	if (num < 0) {
+		sign = -sign;
+		un = -un;
+	}
+	ud = (uint64_t)den;
+	if (den < 0) {
+		sign = -sign;
+		ud = -ud;
+	}
+
+	/* divide out the greatest common divisor */
+	g = gcd64(un, ud);
+	un /= g;
+	ud /= g;
+
+	/* overflow if the result can't fit in a RATIONAL */
+	if (un > MAXLONG || ud > MAXLONG) {
+		ratmsg(RATOVER);	/* set raterrno, report error */
+		return(zero);
+	}
+
+	a.n = sign < 0 ? -(INT32B)un : (INT32B)un;
+	a.d = (INT32B)ud;
+
+	return(a);
+}
+
+/*
+ *	gcd64()		find the greatest common divisor of 64-bit numbers
+ *
+ *	This function finds the greatest common divisor of two positive
+ *	64-bit numbers, using the binary GCD algorithm, which needs only
+ *	shifts and subtraction instead of 64-bit division.
+ *
+ *	Parameters:	u	the first number
+ *			v	the second number
+ *
+ *	Return value:	the greatest common divisor
+ *
+ *	Side effects:	none
+ */
+
+/* count trailing zero bits in a nonzero 64-bit number */
+#ifdef __GNUC__
+#define CTZ64(x)	__builtin_ctzll(x)
+#else
+static int
+ctz64(x)
+
+uint64_t x;
+
+{
+	int n;
+
+
+	for (n = 0; (x & 1) == 0; n++) {
+		x >>= 1;
+	}
+	return(n);
+}
+#define CTZ64(x)	ctz64(x)
+#endif
+
+static uint64_t
+gcd64(u, v)
+
+uint64_t u;
+uint64_t v;
+
+{
+	int shift;		/* power of 2 common to u and v */
+	uint64_t t;		/* for swapping */
+
+
+	shift = CTZ64(u | v);
+	u >>= CTZ64(u);
+
+	do {
+		v >>= CTZ64(v);
+		if (u > v) {
+			t = u;
+			u = v;
+			v = t;
+		}
+		v -= u;
+	} while (v != 0);
+
+	return(u << shift);
+}
+
+#else
 /*
  *	add64_64()	add 64-bit numbers to get a 64-bit number
  *
@@ -1193,3 +1371,4 @@ INT32B den[2];
 
 	return;
 }
+#endif
@@ -0,0 +1,76 @@
+/*
+ Copyright (c) 1995-2024  by Arkkra Enterprises.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms,
+ with or without modification, are permitted provided that
+ the following conditions are met:
+
+ 1. Redistributions of source code must retain
+ the above copyright notice, this list of conditions
+ and the following DISCLAIMER.
+
+ 2. Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and
+ the following DISCLAIMER in the documentation and/or
+ other materials provided with the distribution.
+
+ 3. Any additions, deletions, or changes to the original files
+ must be clearly indicated in accompanying documentation,
+ including the reasons for the changes,
+ and the names of those who made the modifications.
+
+	DISCLAIMER
+
+ THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS
+ OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*
+ *	ratold.c	the rational number routines, using emulated 64-bit
+ *			arithmetic, with all the external names prefixed by
+ *			"old_", so that they can be linked into a program
+ *			along with the normal ones and compared to them.
+ *			See rattest.c and ratbench.c.
+ */
+
+#define RAT_NO_NATIVE64
+
+/*
+ * The emulated arithmetic depends on INT32B wrapping around in two's
+ * complement form when it overflows (see rational.c).  Modern optimizing
+ * compilers assume signed overflow can't happen, and then get wrong answers
+ * from it, so don't let them optimize this copy.
+ */
+#if defined(__clang__)
+#pragma clang optimize off
+#elif defined(__GNUC__)
+#pragma GCC optimize ("wrapv")
+#endif
+
+#define radd		old_radd
+#define rsub		old_rsub
+#define rmul		old_rmul
+#define rdiv		old_rdiv
+#define rneg		old_rneg
+#define rinv		old_rinv
+#define rrai		old_rrai
+#define rred		old_rred
+#define ator		old_ator
+#define rtoa		old_rtoa
+#define gtrat		old_gtrat
+#define raterrno	old_raterrno
+#define raterrfuncp	old_raterrfuncp
+
+#include "rational.c"
@@ -0,0 +1,262 @@
+/*
+ Copyright (c) 1995-2024  by Arkkra Enterprises.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms,
+ with or without modification, are permitted provided that
+ the following conditions are met:
+
+ 1. Redistributions of source code must retain
+ the above copyright notice, this list of conditions
+ and the following DISCLAIMER.
+
+ 2. Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and
+ the following DISCLAIMER in the documentation and/or
+ other materials provided with the distribution.
+
+ 3. Any additions, deletions, or changes to the original files
+ must be clearly indicated in accompanying documentation,
+ including the reasons for the changes,
+ and the names of those who made the modifications.
+
+	DISCLAIMER
+
+ THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS
+ OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*
+ *	rattest.c	randomized differential test of the rational number
+ *			routines
+ *
+ *	This program compares the rational number routines as normally
+ *	compiled (using native 64-bit arithmetic if the compiler has it)
+ *	against the same routines forced to use the emulated 64-bit arithmetic
+ *	(ratold.c).  For each operation, it checks that both the answer and
+ *	raterrno are the same.  Operands are chosen at random from several
+ *	ranges, so that the small number shortcuts, the 64-bit paths, and
+ *	overflow all get exercised, along with some fixed edge cases.
+ *
+ *	Usage:	rattest [iterations [seed]]
+ *
+ *	Exits with 0 if everything matched, 1 otherwise.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "rational.h"
+
+extern RATIONAL old_radd(RATIONAL x, RATIONAL y);
+extern RATIONAL old_rsub(RATIONAL x, RATIONAL y);
+extern RATIONAL old_rmul(RATIONAL x, RATIONAL y);
+extern RATIONAL old_rdiv(RATIONAL x, RATIONAL y);
+extern RATIONAL old_rrai(RATIONAL x, int n);
+extern void old_rred(RATIONAL *ap);
+extern int old_gtrat(RATIONAL x, RATIONAL y);
+extern int old_raterrno;
+extern void (*old_raterrfuncp)(int);
+
+static unsigned long Seed = 1;	/* state of the random number generator */
+static long Failures;		/* number of mismatches found */
+static long Errors;		/* number of rational errors reported */
+
+/* a few values that are interesting for one reason or another */
+static INT32B Edges[] = {
+	0, 1, 2, 3, 0x7fff, 0x8000, 0xffff, 0x10000, 46340, 46341,
+	0x3fffffff, 0x40000000, 0x7ffffffe, 0x7fffffff
+};
+#define NUMEDGES	(sizeof(Edges) / sizeof(Edges[0]))
+
+/* error handler, so that the routines don't print anything */
+static void
+quiet(int code)
+{
+	Errors++;
+}
+
+/* return a pseudo-random 32-bit number; xorshift, so it is the same
+ * everywhere for a given seed */
+static UINT32B
+rand32(void)
+{
+	Seed ^= Seed << 13;
+	Seed ^= Seed >> 7;
+	Seed ^= Seed << 17;
+	return ((UINT32B)(Seed >> 16) ^ (UINT32B)Seed);
+}
+
+/* return a random nonnegative number no bigger than MAXLONG, from one of
+ * several ranges */
+static INT32B
+randmag(void)
+{
+	switch (rand32() % 6) {
+	case 0:
+		return (rand32() % 0x80);
+	case 1:
+		return (rand32() % 0x8000);
+	case 2:
+		return (rand32() % 0x1000000);
+	case 3:
+		return (rand32() & MAXLONG);
+	case 4:
+		return (MAXLONG - (INT32B)(rand32() % 0x100));
+	default:
+		return (Edges[rand32() % NUMEDGES]);
+	}
+}
+
+/* return a random rational in standard form */
+static RATIONAL
+randrat(void)
+{
+	RATIONAL r;
+
+	r.n = randmag();
+	if (rand32() & 1) {
+		r.n = -r.n;
+	}
+	do {
+		r.d = randmag();
+	} while (r.d == 0);
+	old_rred(&r);
+	return (r);
+}
+
+/* compare one result with the old one, and complain if they differ */
+static void
+check(char *op, RATIONAL x, RATIONAL y, RATIONAL new, int newerr,
+		RATIONAL old, int olderr)
+{
+	if (new.n == old.n && new.d == old.d && newerr == olderr) {
+		return;
+	}
+	Failures++;
+	if (Failures <= 20) {
+		(void)printf("%s(%ld/%ld, %ld/%ld): new %ld/%ld err %d, old %ld/%ld err %d\n",
+				op, (long)x.n, (long)x.d, (long)y.n, (long)y.d,
+				(long)new.n, (long)new.d, newerr,
+				(long)old.n, (long)old.d, olderr);
+	}
+}
+
+/* compare one truth value with the old one */
+static void
+checkbool(char *op, RATIONAL x, RATIONAL y, int new, int old)
+{
+	RATIONAL rnew, rold;
+
+	rnew.n = new;
+	rnew.d = 1;
+	rold.n = old;
+	rold.d = 1;
+	check(op, x, y, rnew, 0, rold, 0);
+}
+
+/* try all the operations on one pair of numbers */
+static void
+tryall(RATIONAL x, RATIONAL y)
+{
+	RATIONAL new, old;
+	int newerr;
+	int p;
+
+	new = radd(x, y);
+	newerr = raterrno;
+	old = old_radd(x, y);
+	check("radd", x, y, new, newerr, old, old_raterrno);
+
+	new = rsub(x, y);
+	newerr = raterrno;
+	old = old_rsub(x, y);
+	check("rsub", x, y, new, newerr, old, old_raterrno);
+
+	new = rmul(x, y);
+	newerr = raterrno;
+	old = old_rmul(x, y);
+	check("rmul", x, y, new, newerr, old, old_raterrno);
+
+	new = rdiv(x, y);
+	newerr = raterrno;
+	old = old_rdiv(x, y);
+	check("rdiv", x, y, new, newerr, old, old_raterrno);
+
+	p = (int)(rand32() % 7) - 3;
+	new = rrai(x, p);
+	newerr = raterrno;
+	old = old_rrai(x, p);
+	check("rrai", x, y, new, newerr, old, old_raterrno);
+
+	/* the comparisons can only be meaningful with positive denominators */
+	if (x.d > 0 && y.d > 0) {
+		checkbool("gtrat", x, y, gtrat(x, y), old_gtrat(x, y));
+		checkbool("GT", x, y, GT(x, y), old_gtrat(x, y));
+		checkbool("LT", x, y, LT(x, y), old_gtrat(y, x));
+		checkbool("GE", x, y, GE(x, y), ! old_gtrat(y, x));
+		checkbool("LE", x, y, LE(x, y), ! old_gtrat(x, y));
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	long iterations;
+	long i;
+	int e, f;
+	RATIONAL x, y;
+
+	iterations = (argc > 1 ? atol(argv[1]) : 1000000L);
+	if (argc > 2) {
+		Seed = strtoul(argv[2], (char **)0, 0);
+		if (Seed == 0) {
+			Seed = 1;
+		}
+	}
+	raterrfuncp = quiet;
+	old_raterrfuncp = quiet;
+
+	/* every pair of edge values, with both signs */
+	for (e = 0; e < (int)NUMEDGES; e++) {
+		for (f = 0; f < (int)NUMEDGES; f++) {
+			if (Edges[f] == 0) {
+				continue;
+			}
+			x.n = Edges[e];
+			x.d = Edges[f];
+			old_rred(&x);
+			y = x;
+			y.n = -y.n;
+			tryall(x, x);
+			tryall(x, y);
+			tryall(y, x);
+		}
+	}
+
+	/* invalid numbers, with zero denominator, too big to be "small" */
+	x.n = 0x10000;
+	x.d = 0;
+	y.n = 1;
+	y.d = 3;
+	tryall(x, y);
+	tryall(y, x);
+
+	for (i = 0; i < iterations; i++) {
+		tryall(randrat(), randrat());
+	}
+
+	(void)printf("rattest: %ld iterations, %ld rational errors, %ld mismatches\n",
+			iterations, Errors, Failures);
+	return (Failures == 0 ? 0 : 1);
+}
@@ -35,6 +35,8 @@ struct ALLOC_INFO {
 	char newp[CSIZE];	/* name of variable the allocated space will
 				 * be assigned to; the new_p in the Mup
 				 * allocation macros. */
+	char arena[CSIZE];	/* name of the arena the space came from,
+				 * e.g., parse, scratch, or heap */
 };
 
 /* Call this at the beginning of memory functions */
@@ -87,9 +87,18 @@
  * NEED_GETOPT		If defined, the getopt suite is not available,
  *			therefore use the limited one in main.c.
  * OPTION_MARKER	The char which precedes command line options.
+ * HAVE_WRITEV		If defined, writev() can be used to write several
+ *			buffers with one system call.
+ * HAVE_FORK		If defined, fork(), pipe(), and waitpid() are available,
+ *			so pages can be printed by several processes at once.
+ * HAVE_GETRUSAGE	If defined, getrusage() and gettimeofday() can be used
+ *			to get CPU time, wall time, and memory use for -T.
  */
 #ifdef unix
 #define UNIX_LIKE_FILES
+#define HAVE_WRITEV
+#define HAVE_FORK
+#define HAVE_GETRUSAGE
 #define	UNIX_LIKE_PATH_RULES
 #define CORE_MESSAGE
 #define OPTION_MARKER	'-'
@@ -1569,6 +1578,23 @@
 /* number of rectangles to allocate at a time in Rectab */
 #define RECTCHUNK       (100)
 
+/* bytes to get from malloc at a time for the parse and scratch arenas */
+#define PARSE_ARENA_CHUNK	(256 * 1024)
+#define SCRATCH_ARENA_CHUNK	(32 * 1024)
+/* and for the pool of interned strings */
+#define INTERN_ARENA_CHUNK	(32 * 1024)
+
+/* things counted for the -T report; indexes into Stat_count */
+#define ST_ALLOCS	(0)	/* MALLOC, CALLOC, and REALLOC calls */
+#define ST_ALLOCBYTES	(1)	/* bytes asked for by them */
+#define ST_SSVREPLAYS	(2)	/* calls to setssvstate() */
+#define ST_SSVASSIGNS	(3)	/* SSVs assigned by setssvstate() */
+#define ST_TRYABS	(4)	/* trial scale factors tried by abshorz */
+#define ST_STRMETHITS	(5)	/* string metrics found in the cache */
+#define ST_STRMETMISSES	(6)	/* string metrics that had to be measured */
+#define ST_INTERNSHARED	(7)	/* strings that shared an interned copy */
+#define NUMSTATS	(8)
+
 /*
  * Define miscellaneous macros =============================================
  */
@@ -1609,15 +1635,16 @@
 #define CALLOCA_DEBUG_END(new_p)
 #define REALLOCA_DEBUG_START(type, numelem, new_p)
 #define REALLOCA_DEBUG_END(new_p)
-#define FREE_DEBUG(mem_p)  free(mem_p)
+#define FREE_DEBUG(mem_p)  arena_free(mem_p)
 #endif
 
 /*
- * Define macros for allocating structures.
+ * Define macros for allocating structures.  These go through arena.c, which
+ * uses the normal heap unless an arena has been made current by set_arena().
  */
 #define	MALLOC(structtype, new_p, numelem) {				\
 	MALLOC_DEBUG_START(structtype, numelem, new_p)			\
-	if ((new_p = (struct structtype *)malloc((unsigned)		\
+	if ((new_p = (struct structtype *)arena_malloc((unsigned)	\
 			(((numelem) == 0 ? 1 : (numelem)) *		\
 			sizeof(struct structtype)))) == 0)		\
 		l_no_mem(__FILE__, __LINE__);				\
@@ -1625,7 +1652,7 @@
 }
 #define	CALLOC(structtype, new_p, numelem) {				\
 	CALLOC_DEBUG_START(structtype, numelem, new_p)			\
-	if ((new_p = (struct structtype *)calloc(			\
+	if ((new_p = (struct structtype *)arena_calloc(			\
 			(numelem) == 0 ? 1 : (numelem),			\
 			(unsigned)sizeof(struct structtype)))  == 0)	\
 		l_no_mem(__FILE__, __LINE__);				\
@@ -1634,7 +1661,7 @@
 #ifndef __STDC__
 #define	REALLOC(structtype, new_p, numelem) {				\
 	REALLOC_DEBUG_START(structtype, numelem, new_p)			\
-	if ((new_p = (struct structtype *)realloc((char *)(new_p),	\
+	if ((new_p = (struct structtype *)arena_realloc((char *)(new_p), \
 			(unsigned)(((numelem) == 0 ? 1 : (numelem)) *	\
 			sizeof(struct structtype)))) == 0) 		\
 		l_no_mem(__FILE__, __LINE__);				\
@@ -1643,7 +1670,7 @@
 #else
 #define	REALLOC(structtype, new_p, numelem) {				\
 	REALLOC_DEBUG_START(structtype, numelem, new_p)			\
-	if ((new_p = (struct structtype *)realloc((void *)(new_p),	\
+	if ((new_p = (struct structtype *)arena_realloc((void *)(new_p), \
 			(unsigned)(((numelem) == 0 ? 1 : (numelem)) *	\
 			sizeof(struct structtype)))) == 0) 		\
 		l_no_mem(__FILE__, __LINE__);				\
@@ -1656,7 +1683,7 @@
  */
 #define	MALLOCA(type, new_p, numelem) {					\
 	MALLOCA_DEBUG_START(type, numelem, new_p)			\
-	if ((new_p = (type *)malloc((unsigned)				\
+	if ((new_p = (type *)arena_malloc((unsigned)			\
 			(((numelem) == 0 ? 1 : (numelem)) *		\
 			sizeof(type)))) == 0)				\
 		l_no_mem(__FILE__, __LINE__);				\
@@ -1664,7 +1691,7 @@
 }
 #define	CALLOCA(type, new_p, numelem) {					\
 	CALLOCA_DEBUG_START(type, numelem, new_p)			\
-	if ((new_p = (type *)calloc((numelem) == 0 ? 1 : (numelem),	\
+	if ((new_p = (type *)arena_calloc((numelem) == 0 ? 1 : (numelem), \
 			(unsigned)sizeof(type)))  == 0)			\
 		l_no_mem(__FILE__, __LINE__);				\
 	CALLOCA_DEBUG_END(new_p) \
@@ -1672,7 +1699,7 @@
 #ifndef __STDC__
 #define	REALLOCA(type, new_p, numelem) {				\
 	REALLOCA_DEBUG_START(type, numelem, new_p)			\
-	if ((new_p = (type *)realloc((char *)(new_p),			\
+	if ((new_p = (type *)arena_realloc((char *)(new_p),		\
 			(unsigned)(((numelem) == 0 ? 1 : (numelem)) *	\
 			sizeof(type)))) == 0)				\
 		l_no_mem(__FILE__, __LINE__);				\
@@ -1681,7 +1708,7 @@
 #else
 #define	REALLOCA(type, new_p, numelem) {				\
 	REALLOCA_DEBUG_START(type, numelem, new_p)			\
-	if ((new_p = (type *)realloc((void *)(new_p),			\
+	if ((new_p = (type *)arena_realloc((void *)(new_p),		\
 			(unsigned)(((numelem) == 0 ? 1 : (numelem)) *	\
 			sizeof(type)))) == 0)				\
 		l_no_mem(__FILE__, __LINE__);				\
@@ -1732,7 +1759,7 @@
 	(gs_p)->notelist[ (gs_p)->stemdir == UP ? 0 : (gs_p)->nnotes - 1 ]
 
 #define MAX_ACCS	(4)	/* max number of accidentals on one note */
-#define NO_DEFERRED_ACC (-100)	/* used in Deferred_acc */
+#define NO_DEFERRED_ACC (-100)	/* used in MIDITRACK deferred_acc */
 #define BAD_ACCS_OFFSET	(-100)	/* return value from accs_offset() */
 
 #define EQ_ACCS(list1, list2)	(strncmp(list1, list2, MAX_ACCS * 2) == 0)
@@ -120,9 +120,7 @@ extern int Letshift[];
 extern char Circle[];
 extern char Acclets[];
 extern char *Acctostr[];
-extern char Accidental_map[MAXMIDINOTES][MAX_ACCS * 2];
-extern char Deferred_acc[MAXMIDINOTES][MAX_ACCS * 2];
-extern short Tie_table[MAXMIDINOTES];
+extern struct MIDITRACK *Midi_track_p;
 extern struct ACCIDENTALS *Acc_contexts_list_p;
 extern char No_accs[MAX_ACCS * 2];
 extern char Ped_start[];
@@ -182,6 +180,11 @@ extern struct ATEND_INFO Atend_info;
 extern struct RECTAB *Rectab;
 extern int Reclim;
 
+extern struct ARENA *Parse_arena;
+extern struct ARENA *Scratch_arena;
+
+extern long Stat_count[NUMSTATS];
+
 extern int Ignore_staffscale;
 
 extern float Staffscale;
@@ -285,6 +288,22 @@ extern void abshorz P((void));
 /* absvert.c */
 extern void absvert P((void));
 
+/* arena.c */
+extern struct ARENA *new_arena P((char *name, long chunksize));
+extern struct ARENA *set_arena P((struct ARENA *arena_p));
+extern char *arena_name P((void));
+extern char *arena_malloc P((unsigned size));
+extern char *arena_calloc P((unsigned numelem, unsigned elemsize));
+extern char *arena_realloc P((char *mem_p, unsigned size));
+extern void arena_free P((char *mem_p));
+extern void arena_mark P((struct ARENA *arena_p, struct ARENA_MARK *mark_p));
+extern void arena_release P((struct ARENA *arena_p,
+		struct ARENA_MARK *mark_p));
+extern void reset_arena P((struct ARENA *arena_p));
+extern void free_arena P((struct ARENA *arena_p));
+extern float *new_coords P((void));
+extern void free_coords P((float *c));
+
 /* assign.c */
 extern void assign_int P((int var, int value, struct MAINLL *mainll_item_p));
 extern void assign_float P((int var, double value,
@@ -335,6 +354,9 @@ extern void set_margin P((int var, double leftval, double rightval,
 extern void assign_direction P((int param, int value, struct MAINLL *mainll_p));
 extern void check_beamstyle P((struct SSV *ssv_p ));
 
+/* batch.c */
+extern int batch P((int argc, char ***argv_p));
+
 /* beaming.c */
 extern void setbeamloc P((struct GRPSYL *curr_grp_p,
 		struct GRPSYL *last_grp_p));
@@ -373,6 +395,7 @@ extern double strascent P((char *str));
 extern double strdescent P((char *str));
 extern double strheight P((char *str));
 extern double strwidth P((char *str));
+extern void forget_strmetrics P((void));
 extern char *tranchstr P((char *chordstring, int staffno));
 extern int restchar P((struct GRPSYL *grp_p, int *font_p));
 extern char *dashstr P((char *str));
@@ -450,6 +473,8 @@ extern void cant_open P((char *filename));
 extern void warning P((char *format, ...));
 extern void l_yyerror P((char *fname, int lineno, char *format, ...));
 extern void l_warning P((char *filename, int lineno, char *format, ...));
+extern void log_warnings P((FILE *log_p));
+extern int replay_warning P((FILE *log_p));
 extern void debug P((int level, char *format, ...));
 extern int debug_on P((int level));
 extern void doraterr P((int code));
@@ -473,6 +498,9 @@ extern void init_psfont_metrics P((void));
 extern int yyparse P((void));
 extern int yyerror P((char *msg));
 extern void check_same_ended P((void));
+extern struct MAINLL *snapshot_context P((UINT32B *contexts_p,
+		int *multiple_p));
+extern void resume_context P((UINT32B context, struct MAINLL *mll_p));
 
 /* grpsyl.c */
 extern struct GRPSYL *newGRPSYL P((int grp_or_syl));
@@ -526,6 +554,10 @@ extern int proc_emptymeas P((int startstaff));
 extern int is_internal_token P((char *token));
 extern void emptym_err P((char *severity));
 
+/* intern.c */
+extern char *intern P((char *str));
+extern char *intern_owned P((char *str));
+
 /* keymap.c */
 extern struct KEYMAP *get_keymap P((char *name));
 extern void map_all_strings P((void));
@@ -537,7 +569,7 @@ extern char *map_print_str P((char *str, char *fname, int linenum));
 
 /* lex.l */
 extern void chk_ifdefs P((void));
-extern int save_macro P((FILE *file));
+extern int save_macro P((void));
 extern int yylex P((void));
 extern void get_parameters P((char *macname));
 extern int get_mac_arguments P((char *macname, int num_args));
@@ -579,13 +611,18 @@ extern void define_macro P((char *macname, int is_expression));
 extern void undef_macro P((char *macname));
 extern void call_macro P((char *macname));
 extern int is_defined P((char *macname, int paramtoo));
-#ifndef unix
-extern void mac_cleanup P((void));
-#endif
 extern void add_parameter P((char *macname, char *param_name));
 extern void set_parm_value P((char *macname, char *argbuff, int argnum));
 extern char *add2argbuff P((char *argbuff, int c));
+extern void add2macro P((int c));
+extern int mac_read P((char *buff, int max_size));
 extern FILE *find_file P((char **filename_p));
+extern void report_incpaths P((int fd));
+extern void learn_incpaths P((int fd));
+extern void write_cmdline_macros P((void));
+extern int cmdline_macros_match P((void));
+extern void write_mac_snapshot P((void));
+extern void read_mac_snapshot P((void));
 extern void preproc P((void));
 extern void mac_saveto P((char *name));
 extern void mac_restorefrom P((char *name));
@@ -620,7 +657,7 @@ extern void makechords P((void));
 
 /* midi.c */
 extern void gen_midi P((char *midifilename));
-extern UINT32B write_delta P((int mfile));
+extern UINT32B write_delta P((void));
 extern int voice_used P((int staffno, int vno));
 extern void insert_midistufflist P((struct STUFF *stuff_p));
 
@@ -641,17 +678,20 @@ extern int num_notemaps P((void));
 extern void set_map_index P((int idx));
 
 /* midiutil.c */
-extern void fix_track_size P((int mfile, long track_start, long track_size));
+extern void alloc_midi_tracks P((int ntracks));
+extern void set_midi_track P((int t));
+extern void fix_track_size P((long track_size));
+extern void flush_midi P((int mfile));
 extern int parse_octave P((char *string, int place, char *fname, int lineno));
 extern int clocks P((int num));
 extern int getkeyword P((char *string, char **key_p, int *leng_p,
 		char **arg_p_p));
 extern int matches P((char *key, int leng, char *cmd));
 extern int hexdig P((int ch));
-extern UINT32B midi_wrstring P((int mfile, char *str, int internalform));
-extern UINT32B wr_varlength P((int mfile, UINT32B num));
-extern UINT32B midi_keysig P((int mfile, int sharps, int is_minor));
-extern UINT32B midi_timesig P((int mfile));
+extern UINT32B midi_wrstring P((char *str, int internalform));
+extern UINT32B wr_varlength P((UINT32B num));
+extern UINT32B midi_keysig P((int sharps, int is_minor));
+extern UINT32B midi_timesig P((void));
 extern void add_rest P((struct GRPSYL *gs_p, RATIONAL fulltime));
 extern struct GRPSYL *grp_before P((struct GRPSYL *gs_p, struct MAINLL *mll_p,
                 int staffno, int v));
@@ -668,9 +708,9 @@ extern void init_accidental_map P((int staffno));
 extern void init_tie_table P((void));
 extern void mark_accidental P((int pitch_offset, int acc));
 extern int staff_audible P((int staff));
-extern int out_notemap P((int mfile, int map_number));
+extern int out_notemap P((int map_number));
 extern int accs_offset P((char *acclist));
-extern void midiwrite P((int fd, unsigned char * data, int length));
+extern int midiwrite P((unsigned char * data, int length));
 extern void reset_sigs P((void));
 
 /* from musfont.c */
@@ -724,6 +764,11 @@ extern void init_reh P((int rehnumber, char *rehletter,
 		struct MAINLL *mainbar_p));
 extern void conv_ph_eph P((void));
 
+/* phase.c */
+extern int set_phase_report P((char *format));
+extern void phase P((char *name));
+extern void phase_report P((void));
+
 /* phrase.c */
 extern void phrase_points P((struct MAINLL *mll_p, struct STUFF *stuff_p));
 extern void tieslur_points P((struct MAINLL *mll_p, struct STUFF *stuff_p));
@@ -850,6 +895,7 @@ extern void do_rotate P((int angle));
 extern void draw_parallelogram P((double x1, double y1, double x2, double y2,
 		double halfwidth));
 extern void print_blank_page P((void));
+extern long print_part P((int pages_before, int is_last));
 
 /* prntdata.c */
 extern void pr_staff P((struct MAINLL *mll_p));
@@ -925,7 +971,7 @@ extern void save_vcombine_range P((int begin, int end));
 extern void free_vcombine_range P((void));
 
 /* relvert.c */
-extern void relvert P((void));
+extern void relvert P((int jobs));
 
 /* restsyl.c */
 extern void restsyl P((void));
@@ -947,6 +993,9 @@ extern void do_rolls P((struct MAINLL *mll_p));
 extern void print_roll P((struct GRPSYL *gs_p));
 extern int gets_roll P((struct GRPSYL *gs_p, struct STAFF *staff_p, int v));
 
+/* serve.c */
+extern int serve P((char *sockname, char ***argv_p));
+
 /* setgrps.c */
 extern void setgrps P((void));
 extern void applyaccstrs P((struct GRPSYL *g_p[], int numgrps));
@@ -954,6 +1003,23 @@ extern void applyaccstrs P((struct GRPSYL *g_p[], int numgrps));
 /* setnotes.c */
 extern void setnotes P((void));
 
+/* snapshot.c */
+extern void write_snapshot P((FILE *file_p, char *filename, char *version));
+extern int is_snapshot P((char *buff, long size));
+extern int snapshot_fits P((char *buff, long size, char *name,
+		char *version));
+extern void load_snapshot P((char *buff, long size, char *name,
+		char *version));
+extern long snap_ssv_index P((struct SSV *ssv_p));
+extern struct SSV *snap_ssv_at P((long index));
+extern void snap_damaged P((void));
+extern void snap_putbytes P((char *bytes, long length));
+extern void snap_putnum P((long num));
+extern void snap_putstr P((char *str));
+extern void snap_getbytes P((char *bytes, long length));
+extern long snap_getnum P((void));
+extern char *snap_getstr P((void));
+
 /* from shapes.c */
 extern int get_shape_override P((int staffno, int vno, int *font_p,
 		int *code_p));
@@ -969,6 +1035,7 @@ extern struct SSV *svpath P((int s, int field));
 extern struct SSV *vvpath P((int s, int v, int field));
 extern void asgnssv P((struct SSV *i_p));
 extern void setssvstate P((struct MAINLL *mainll_p));
+extern void discard_ssv_ckpts P((void));
 extern void savessvstate P((void));
 extern void restoressvstate P((void));
 extern struct MAINLL *restoreparms P((struct MAINLL *save_p,
@@ -996,6 +1063,8 @@ extern int nheadchar P((int headshape, int basictime, int stemdir,
 extern int get_shape_num P((char *shapename));
 extern double stem_yoff P((int headch, int font, int stemdir));
 extern void remember_tsig_params P((struct MAINLL *mll_p));
+extern void write_tsig_snapshot P((void));
+extern void read_tsig_snapshot P((void));
 extern void upd_ref P((float *old_p, float *new_p));
 extern void rep_inpcoord P((struct INPCOORD *old_inpcoord_p,
 		struct INPCOORD *new_inpcoord_p));
@@ -1039,6 +1108,8 @@ extern int has_extender P((char *syl));
 extern void cont_extender P((struct MAINLL *mll_p, int sylplace,
 		int verseno));
 extern int last_char P((char *str));
+extern void log_carryovers P((FILE *log_p));
+extern int replay_carryover P((FILE *log_p));
 
 /* utils.c */
 extern void set_cur P((double x, double y));
@@ -92,12 +92,31 @@ typedef struct rational RATIONAL;
 #define EQ(a, b)	((a).n == (b).n && (a).d == (b).d)
 #define NE(a, b)	((a).n != (b).n || (a).d != (b).d)
 
-/* must call function for inequalities, because overflow possibilities */
+/*
+ * For inequalities, we must cross-multiply, which can overflow 32 bits.  If
+ * the compiler has a native 64-bit type, do that inline; otherwise call a
+ * function that emulates 64-bit arithmetic.  (An inline function rather than
+ * a macro, so the arguments are only evaluated once.)
+ */
 
+#if __STDC_VERSION__ >= 199901L
+static inline int
+ratgt(RATIONAL x, RATIONAL y)
+{
+	/* note:  this depends on positive denominators */
+	return((int64_t)x.n * y.d > (int64_t)x.d * y.n);
+}
+
+#define GT(a, b)	ratgt(a, b)
+#define LT(a, b)	ratgt(b, a)
+#define GE(a, b)	( ! ratgt(b, a) )
+#define LE(a, b)	( ! ratgt(a, b) )
+#else
 #define GT(a, b)	gtrat(a, b)
 #define LT(a, b)	gtrat(b, a)
 #define GE(a, b)	( ! gtrat(b, a) )
 #define LE(a, b)	( ! gtrat(a, b) )
+#endif
 
 
 /* macros for testing a rational number */
@@ -335,12 +335,20 @@ struct KEYMAP {
 	char *name;			/* The user-supplied name for keymap */
 	struct KEYMAP_ENTRY *map_p;	/* The key mapping table itself */
 	int entries;			/* how many entries used */ 
-	int code_index[MAX_CHARS_IN_FONT];/* For each code (e.g. ASCII value)
-					 * this gives the index in map_p
-					 * for the first entry that starts
-					 * with that code, to know where to
-					 * start looking for matches. */
-	int is_sorted;			/* has map_p been sorted?  YES or NO */
+	/* The patterns are compiled into a trie, so that the longest one
+	 * matching at some place in a string can be found by walking
+	 * the string once. Only byte values that occur in some pattern
+	 * get a column in the transition table. */
+	unsigned char byteclass[256];	/* column for each byte value, 1 to
+					 * numclasses, or 0 if not in any
+					 * pattern */
+	int numclasses;			/* number of distinct byte values */
+	int *trie;			/* (numclasses + 1) next states for
+					 * each state, 0 meaning no match is
+					 * possible. State 1 is the start. */
+	int *trie_match;		/* for each state, index in map_p of
+					 * the pattern that ends there, or -1 */
+	int is_compiled;		/* has trie been made?  YES or NO */
 };
 
 /* This stores the information for one entry from an "accidentals" context. */
@@ -868,6 +876,13 @@ struct BAR {
 	 * set during the input for a voice rather than in their own context.
 	 */
 	struct TIMEDSSV *timedssv_p;
+
+	/*
+	 * If setssvstate() saved the SSV state as of just before this bar,
+	 * this is 1 + its index in the table of those checkpoints, else 0.
+	 * It is only a hint; see ssv.c.
+	 */
+	int ssvckpt;
 };
 
 /* This describes how a subbar looks */
@@ -1130,7 +1145,7 @@ struct GRID {
 struct STUFF {
 
 	short inputlineno;	/* which input line this structure came from */
-	char *inputfile;	/* which file this came from (malloc'ed) */
+	char *inputfile;	/* which file this came from (interned) */
 	char *string;		/* usual convention of 1st 2 bytes = font/size*/
 	short all;		/* does this STUFF actually belong to "all" */
 				/* (the score), not a particular staff? YES/NO*/
@@ -1280,9 +1295,22 @@ struct NOTE {
 	 * (x, y). The NSEW coords define a rectangle surrounding the note
 	 * head.  XY are the center of the note head.
 	 */
-	float *c;		/* must malloc array; see comment in */
+	float *c;		/* must use new_coords(); see comment in */
 				/*  grpsyl.c, add_note() for why */
 
+	char *noteleft_string;	/* string to print left of the note (interned) */
+
+	/*
+	 * nslurto says how many notes of the following group this note is
+	 * slurred to.  If it is greater than 0, an array of that many SLURTO
+	 * structures must be malloc'ed and slurtolist set to point at it.
+	 */
+	struct SLURTO *slurtolist;
+
+	/*
+	 * The fields are in order of size, pointers first and flags last, so
+	 * that no space is wasted on padding between them.
+	 */
 	float waccr;		/* relative coord:  w(accidental)-x(group) */
 	float ydotr;		/* relative coord:  y(dot)-y(group) */
 
@@ -1292,34 +1320,33 @@ struct NOTE {
 
 	/* wlstring is 0 if and only if noteleft_string is 0 (null) */
 	float wlstring;		/* relative coord:  w(string)-x(group) */
-	char *noteleft_string;	/* malloc: string to print left of the note */
 
-	/*
-	 * nslurto says how many notes of the following group this note is
-	 * slurred to.  If it is greater than 0, an array of that many SLURTO
-	 * structures must be malloc'ed and slurtolist set to point at it.
-	 */
-	struct SLURTO *slurtolist;
 	short nslurto;
-
-	char letter;		/* a to g */
-	char acclist[MAX_ACCS * 2]; /* font/char bytes for each accidental */
 	short octave;		/* 0 to 9 */
 	short stepsup;		/* how many steps above middle line is note? */
-	char headfont;		/* music char font of this note head */
-	char headchar;		/* music char number of this note head */
 	short headshape;	/* shape type of this note head */
 	short notesize;		/* size of the note head */
-	short tie;		/* if YES, tie this note to the same note in
-				 * the next note group */
 	short tiestyle;		/* what type of tie: L_[NORMAL|DOTTED|DASHED] */
 	short tiedir;		/* should tie bulge UP or DOWN? */
 	short tied_to_voice;	/* voice number of the note we are tying to */
-	short tied_from_other;	/* is a tie coming from a different voice? */
-	short slurred_from_other; /* is a slur coming from a different voice? */
-	short acc_has_paren;	/* does the accidental have () around it? */
-	short note_has_paren;	/* does the entire note have () around it? */
-	short is_bend;		/* is last item in slurto list really "bend"? */
+
+	char letter;		/* a to g */
+	char acclist[MAX_ACCS * 2]; /* font/char bytes for each accidental */
+	char headfont;		/* music char font of this note head */
+	char headchar;		/* music char number of this note head */
+
+	/* YES/NO flags. Being bit fields, their addresses can't be taken. */
+	unsigned tie : 1;	/* if YES, tie this note to the same note in
+				 * the next note group */
+	unsigned tied_from_other : 1;	/* is a tie coming from a different
+				 * voice? */
+	unsigned slurred_from_other : 1; /* is a slur coming from a different
+				 * voice? */
+	unsigned acc_has_paren : 1;	/* does the accidental have () around
+				 * it? */
+	unsigned note_has_paren : 1;	/* does the entire note have () around
+				 * it? */
+	unsigned is_bend : 1;	/* is last item in slurto list really "bend"? */
 
 	/*
 	 * On a tabnote staff, when there is a bend of <= 1/4 steps, the bent-
@@ -1327,7 +1354,7 @@ struct NOTE {
 	 * curved line gets drawn.  In the input, the user specifies this by
 	 * saying ^/ after the note.
 	 */
-	short smallbend;
+	unsigned smallbend : 1;
 
 	/*
 	 * On a tablature staff, when a note is tied to the following group,
@@ -1335,7 +1362,7 @@ struct NOTE {
 	 * tabnote note will be, though.)  This flag says not to print this
 	 * note.
 	 */
-	short inhibitprint;
+	unsigned inhibitprint : 1;
 };
 /*
  * For tablature, the items above are used differently from the usual meaning.
@@ -1395,12 +1422,20 @@ struct WITH_ITEM {
  */
 struct GRPSYL {
 
+	/*
+	 * The fields used most during placement (linkage, coordinates, time
+	 * values, notes) come first, so that they tend to share cache lines.
+	 * Within each section, fields are in order of size, so that no space
+	 * is wasted on padding, and the YES/NO flags are bit fields at the
+	 * end of their section, so their addresses can't be taken.
+	 */
+
+	/* ======== LINKAGE ======== */
+	struct GRPSYL *prev;	/* point at previous group/syl in voice/verse*/
+	struct GRPSYL *next;	/* point at next group/syl in voice/verse */
+	struct GRPSYL *gs_p;	/* point at next group/syl in chord */
+
 	/* ======== ITEMS FOR GROUPS AND SYLLABLES ======== */
-	short inputlineno;	/* which input line this structure came from */
-	char *inputfile;	/* which file this came from (malloc'ed) */
-	short staffno;		/* staff number */
-	short vno;		/* voice (1 to MAXVOICES) or verse number */
-	short grpsyl;		/* is it group or syllable? */
 
 	/*
 	 * Define the coords x, y, north, south, east, west, both relative
@@ -1428,6 +1463,18 @@ struct GRPSYL {
 	 */
 	float orig_rw;
 
+	/*
+	 * Full time is basic time modified by dots, tuplets, etc.  It's the
+	 * actual time duration, and thus for grace it's always 0.
+	 */
+	RATIONAL fulltime;
+
+	float padding;		/* extra space to allow */
+
+	short staffno;		/* staff number */
+	short vno;		/* voice (1 to MAXVOICES) or verse number */
+	short grpsyl;		/* is it group or syllable? */
+
 	/*
 	 * For multirests, basictime is negative the number of measures.
 	 *
@@ -1442,6 +1489,17 @@ struct GRPSYL {
 	 */
 	short basictime;
 
+	short dots;		/* number of dots applied to time value */
+
+	short tuploc;		/* none, start, inner, end, lone (for tuplet) */
+	short tupcont;		/* number to print for the tuplet */
+
+	/*
+	 * MRT_NONE, MRT_SINGLE, MRT_DOUBLE, MRT_QUAD.  Note that in the
+	 * double and quad cases, it is set to that in every measure of it.
+	 */
+	short meas_rpt_type;	/* MRT_* */
+
 	/*
 	 * is_meas tells whether an "m" was used with the time in the input.
 	 * This is used for "measure" rests, spaces, or repeats (mr, ms, mrpt).
@@ -1451,48 +1509,22 @@ struct GRPSYL {
 	 * draw.)  Their fulltime is the time signature.  mr and mrpt are
 	 * centered in the measure.
 	 */
-	short is_meas;
+	unsigned is_meas : 1;
 
-	/*
-	 * MRT_NONE, MRT_SINGLE, MRT_DOUBLE, MRT_QUAD.  Note that in the
-	 * double and quad cases, it is set to that in every measure of it.
-	 */
-	short meas_rpt_type;	/* MRT_* */
-
-	short is_multirest;	/* is this a multirest, YES or NO */
-
-	short dots;		/* number of dots applied to time value */
+	unsigned is_multirest : 1;	/* is this a multirest, YES or NO */
 
-	short tuploc;		/* none, start, inner, end, lone (for tuplet) */
-	short tupcont;		/* number to print for the tuplet */
+	/* ======== ITEMS FOR GROUPS ONLY ======== */
 
 	/*
-	 * Full time is basic time modified by dots, tuplets, etc.  It's the
-	 * actual time duration, and thus for grace it's always 0.
+	 * nnotes says how many notes there are in the group.  An array of
+	 * that many note structures must be malloc'ed and notelist set to
+	 * point at it.  The notes are stored in order of descending pitch,
+	 * regardless of the user's input ordering.  These fields are valid
+	 * only for note groups.
+	 * But for measure repeats (mrpt), even though they are GC_NOTES,
+	 * nnotes is 0 and notelist is a null pointer.
 	 */
-	RATIONAL fulltime;
-
-	float padding;		/* extra space to allow */
-
-	/* ======== ITEMS FOR GROUPS ONLY ======== */
-	short pvno;		/* pseudo voice number: normally equals vno,
-				 * but when voice 3 is treated like voice 1 or
-				 * or 2, that number is stored here */
-				/* also used as scratch area in mkchords.c */
-	short grpcont;		/* note(s), rest, or space; although normally
-				 * meaningful only for groups, gram.y uses it
-				 * as scratch while processing syllables */
-	short grpvalue;		/* normal time value; or zero for grace group
-				 * or for all-space chords in MIDI */
-	short grpsize;		/* size of items in group */
-	short headshape;	/* default shape of noteheads in group */
-	short uncompressible;	/* is this space a "us" (used for space only)*/
-
-	short beamloc;		/* none, start, inner, end (only note groups)*/
-	float beamslope;	/* user specified angle of beam in degrees */
-	float tupletslope;	/* user specified angle of bracket in degrees */
-	short autobeam;		/* if autobeaming applies to this group, value
-				 * can be NOITEM, STARITEM, INITEM, or ENDITEM*/
+	struct NOTE *notelist;	/* list of notes in group */
 
 	/*
 	 * If this GRPSYL is not for a rest, this will be NULL.  Otherwise, this
@@ -1503,6 +1535,20 @@ struct GRPSYL {
 	 */
 	float *restc;
 
+	/*
+	 * When symbols are to be drawn "with" a group, they are stored in the
+	 * list below in order, starting from the group and moving outwards,
+	 * in either or both directions.  When nwith is 0, there is no list.
+	 * Otherwise, a list must be malloc'ed and the pointer must be set to
+	 * point at it.  Each item in the list is a pointer to a structure,
+	 * which contains a string of the item (interned) and the side
+	 * it should go on (above, below, or unknown).  The user can choose
+	 * above or below; otherwise parsing sets it to unknown and placement
+	 * decides.
+	 * These fields are not valid for space groups.
+	 */
+	struct WITH_ITEM *withlist;	/* list of symbols with group */
+
 	/*
 	 * Stem length applies to groups shorter than a whole note and groups
 	 * joined by "alternation" beams.  It starts out based only on
@@ -1513,42 +1559,13 @@ struct GRPSYL {
 	 * These fields are valid only for note groups.
 	 */
 	float stemlen;
-	short stemdir;		/* up or down */
 	float stemx;
 
-	/*
-	 * beamto is always CS_SAME, except when this group is a notes or
-	 * space group and is involved in cross staff beaming.  It then tells
-	 * whether we are beamed with the staff above us or below us.  It is
-	 * set for all the note and space groups on both staffs in the set.
-	 * So on the top staff it's set to CS_BELOW, and on the bottom staff
-	 * it's set to CS_ABOVE.
-	 */
-	short beamto;
-
-	/*
-	 * See setbeam(): this flag is used only by the first group in a
-	 * beamed set.  It is needed because with cross staff stemming,
-	 * beamstem is called on both passes.
-	 */
-	short ran_setbeam;
-
-	/* see csbstempad(): this flag remembers if we did it */
-	short padded_csb_stem;
-
-	/*
-	 * stemto is always CS_SAME, except when this group is a notes group
-	 * and is involved in cross staff steming.  It then tells whether we
-	 * are stemmed with the staff above us or below us.  When stemto is not
-	 * CS_SAME, stemto_idx is an index into notelist[].  For CS_ABOVE,
-	 * it indexes to the last note that is on the above staff.  For
-	 * CS_BELOW, it indexes to the first note that is on the below staff.
-	 */
-	short stemto;
-	short stemto_idx;
+	/* the X positions of dots are the same for every note in the group */
+	float xdotr;		/* relative coord of dots:  x(dot)-x(group) */
 
-	/* YES if the last group in a subbeam */
-	short breakbeam;
+	float beamslope;	/* user specified angle of beam in degrees */
+	float tupletslope;	/* user specified angle of bracket in degrees */
 
 	/*
 	 * printtup tells whether the user wants a tuplet number and bracket to
@@ -1569,41 +1586,66 @@ struct GRPSYL {
 	 * that the tuplet number can still be placed as halfway between the
 	 * invisible bracket's endpoints.
 	 */
-	short printtup;
 	float tupextend;
-	short tupside;		/* should number & bracket be above or below?*/
-
-	short phraseside;	/* relevant side(s) for phrase mark space */
 
 	/*
-	 * nnotes says how many notes there are in the group.  An array of
-	 * that many note structures must be malloc'ed and notelist set to
-	 * point at it.  The notes are stored in order of descending pitch,
-	 * regardless of the user's input ordering.  These fields are valid
-	 * only for note groups.
-	 * But for measure repeats (mrpt), even though they are GC_NOTES,
-	 * nnotes is 0 and notelist is a null pointer.
+	 * These are for the user-specified horizontal offset of the group from
+	 * the chord's X.  The value is in stepsizes; negative to the left, and
+	 * positive to the right.
 	 */
+	float ho_value;		/* value to use when ho_usage is HO_VALUE */
+
 	short nnotes;		/* no. of notes in group */
-	struct NOTE *notelist;	/* list of notes in group */
+	short nwith;			/* number of symbols with group */
 
-	/* how many phrase start or end at this group */
-	short phcount;		/* start */
-	short ephcount;		/* end */
+	short pvno;		/* pseudo voice number: normally equals vno,
+				 * but when voice 3 is treated like voice 1 or
+				 * or 2, that number is stored here */
+				/* also used as scratch area in mkchords.c */
+	short grpcont;		/* note(s), rest, or space; although normally
+				 * meaningful only for groups, gram.y uses it
+				 * as scratch while processing syllables */
+	short grpvalue;		/* normal time value; or zero for grace group
+				 * or for all-space chords in MIDI */
+	short grpsize;		/* size of items in group */
+	short headshape;	/* default shape of noteheads in group */
 
-	/* whether each phrase is above or below */
-	char phplace[PH_COUNT];
-	/* whether each phrase is normal, dotted, or dashed */
-	char phlinetype[PH_COUNT];
+	short beamloc;		/* none, start, inner, end (only note groups)*/
+	short autobeam;		/* if autobeaming applies to this group, value
+				 * can be NOITEM, STARITEM, INITEM, or ENDITEM*/
+
+	short stemdir;		/* up or down */
 
 	/*
-	 * If tie is set to YES, all notes in the group are to be tied to
-	 * corresponding notes in the following group. The "tie" flag will
-	 * also be set on each individual note in its NOTE struct, but it
-	 * turns out to be handy to have the whole group marked here too.
-	 * This field is valid only for note groups.
+	 * beamto is always CS_SAME, except when this group is a notes or
+	 * space group and is involved in cross staff beaming.  It then tells
+	 * whether we are beamed with the staff above us or below us.  It is
+	 * set for all the note and space groups on both staffs in the set.
+	 * So on the top staff it's set to CS_BELOW, and on the bottom staff
+	 * it's set to CS_ABOVE.
 	 */
-	short tie;
+	short beamto;
+
+	/*
+	 * stemto is always CS_SAME, except when this group is a notes group
+	 * and is involved in cross staff steming.  It then tells whether we
+	 * are stemmed with the staff above us or below us.  When stemto is not
+	 * CS_SAME, stemto_idx is an index into notelist[].  For CS_ABOVE,
+	 * it indexes to the last note that is on the above staff.  For
+	 * CS_BELOW, it indexes to the first note that is on the below staff.
+	 */
+	short stemto;
+	short stemto_idx;
+
+	/* see tupextend above */
+	short printtup;
+	short tupside;		/* should number & bracket be above or below?*/
+
+	short phraseside;	/* relevant side(s) for phrase mark space */
+
+	/* how many phrase start or end at this group */
+	short phcount;		/* start */
+	short ephcount;		/* end */
 
 	/*
 	 * The slash_alt field is used for slashes on a group or between
@@ -1616,13 +1658,6 @@ struct GRPSYL {
 	 */
 	short slash_alt;
 
-	/*
-	 * Record whether accidentals must be printed separately before each
-	 * group in this chord on this staff.  That is the case when some
-	 * common note(s) in them have contradictory accidentals.  Otherwise
-	 * they are all printed to the left of all the groups.
-	 */
-	short sep_accs;
 	/*
 	 * This is used for rests only.  If not used, it is NORESTDIST.
 	 * Otherwise, it is the vertical offset of the "center" of the rest
@@ -1631,58 +1666,72 @@ struct GRPSYL {
 	 */
 	short restdist;
 
+	short ho_usage;		/* HO_*; see ho_value above */
+
+	short roll;		/* where is this group in a roll, if at all? */
+	short rolldir;		/* is the roll's arrow UP, DOWN, or UNKNOWN? */
+				/*  (with UNKNOWN, roll is up, but no arrow) */
+
+	short clef;		/* clef to be printed with this group */
+
+	/* whether each phrase is above or below */
+	char phplace[PH_COUNT];
+	/* whether each phrase is normal, dotted, or dashed */
+	char phlinetype[PH_COUNT];
+
+	unsigned uncompressible : 1;	/* is this space a "us" (used for
+				 * space only)*/
+
 	/*
-	 * Are we in a region of this voice where rests are to be aligned?
-	 * (This is the current value of the alignrests parameter.  Because of
-	 * the way we have to search forward and backwards from each rest, over
-	 * multiple measures, it is simpler to store this value here on one
-	 * pass, and then go through again and use it.)
+	 * See setbeam(): this flag is used only by the first group in a
+	 * beamed set.  It is needed because with cross staff stemming,
+	 * beamstem is called on both passes.
 	 */
-	short alignrests;
+	unsigned ran_setbeam : 1;
+
+	/* see csbstempad(): this flag remembers if we did it */
+	unsigned padded_csb_stem : 1;
+
+	/* YES if the last group in a subbeam */
+	unsigned breakbeam : 1;
 
 	/*
-	 * These are for the user-specified horizontal offset of the group from
-	 * the chord's X.  The value is in stepsizes; negative to the left, and
-	 * positive to the right.
+	 * If tie is set to YES, all notes in the group are to be tied to
+	 * corresponding notes in the following group. The "tie" flag will
+	 * also be set on each individual note in its NOTE struct, but it
+	 * turns out to be handy to have the whole group marked here too.
+	 * This field is valid only for note groups.
 	 */
-	short ho_usage;		/* HO_* */
-	float ho_value;		/* value to use when ho_usage is HO_VALUE */
+	unsigned tie : 1;
 
-
-	/* the X positions of dots are the same for every note in the group */
-	float xdotr;		/* relative coord of dots:  x(dot)-x(group) */
 	/*
-	 * When symbols are to be drawn "with" a group, they are stored in the
-	 * list below in order, starting from the group and moving outwards,
-	 * in either or both directions.  When nwith is 0, there is no list.
-	 * Otherwise, a list must be malloc'ed and the pointer must be set to
-	 * point at it.  Each item in the list is a pointer to a structure,
-	 * which contains a string of the item (also be malloc'ed) and the side
-	 * it should go on (above, below, or unknown).  The user can choose
-	 * above or below; otherwise parsing sets it to unknown and placement
-	 * decides.
-	 * These fields are not valid for space groups.
+	 * Record whether accidentals must be printed separately before each
+	 * group in this chord on this staff.  That is the case when some
+	 * common note(s) in them have contradictory accidentals.  Otherwise
+	 * they are all printed to the left of all the groups.
 	 */
-	short nwith;			/* number of symbols with group */
-	struct WITH_ITEM *withlist;	/* list of symbols with group */
+	unsigned sep_accs : 1;
 
-	short roll;		/* where is this group in a roll, if at all? */
-	short rolldir;		/* is the roll's arrow UP, DOWN, or UNKNOWN? */
-				/*  (with UNKNOWN, roll is up, but no arrow) */
+	/*
+	 * Are we in a region of this voice where rests are to be aligned?
+	 * (This is the current value of the alignrests parameter.  Because of
+	 * the way we have to search forward and backwards from each rest, over
+	 * multiple measures, it is simpler to store this value here on one
+	 * pass, and then go through again and use it.)
+	 */
+	unsigned alignrests : 1;
 
-	short clef;		/* clef to be printed with this group */
-	short clef_vert;	/* pile clef vertically with the groups */
+	unsigned clef_vert : 1;	/* pile clef vertically with the groups */
 
-	short with_was_gtc;	/* "with" list was good til cancelled */
+	unsigned with_was_gtc : 1;	/* "with" list was good til cancelled */
 
 	/* ======== ITEMS FOR SYLLABLES ONLY ======== */
 	char *syl;		/* malloc a place for the syllable */
 	short sylposition;	/* points left of chord's X to start syl */
 
-	/* ======== LINKAGE ======== */
-	struct GRPSYL *prev;	/* point at previous group/syl in voice/verse*/
-	struct GRPSYL *next;	/* point at next group/syl in voice/verse */
-	struct GRPSYL *gs_p;	/* point at next group/syl in chord */
+	/* ======== SELDOM USED ITEMS ======== */
+	short inputlineno;	/* which input line this structure came from */
+	char *inputfile;	/* which file this came from (interned) */
 	struct GRPSYL *vcombdest_p; /* if vcombine made this a space, point at
 				     * the destination GRPSYL */
 };
@@ -1698,6 +1747,90 @@ struct RECTAB {
 	short tried;		/* have we tried this one yet? */
 };
 
+/*
+ * Define structures for memory arenas.  An arena is a list of big chunks
+ * that small allocations are carved out of sequentially.  Individual items
+ * are never really freed; the whole arena (or everything allocated after a
+ * mark) is released at once.  See arena.c.
+ */
+struct ARENA_CHUNK {
+	struct ARENA_CHUNK *prev;	/* chunk allocated before this one */
+	struct ARENA *arena_p;		/* arena this chunk belongs to */
+	char *start;			/* first byte usable for allocations */
+	char *end;			/* one past the last usable byte */
+};
+
+struct ARENA {
+	char *name;			/* for debugging output */
+	long chunksize;			/* normal size of a chunk */
+	struct ARENA_CHUNK *chunk_p;	/* chunk currently being carved up */
+	char *next;			/* where next allocation comes from */
+	long bytes;			/* total bytes handed out */
+};
+
+/* to remember how far an arena had been used, so it can be cut back later */
+struct ARENA_MARK {
+	struct ARENA_CHUNK *chunk_p;	/* ARENA chunk_p at time of mark */
+	char *next;			/* ARENA next at time of mark */
+	long bytes;			/* ARENA bytes at time of mark */
+};
+
+/*
+ * Define the state of one MIDI track while it is being generated.  All the
+ * tracks are filled in during one walk through the main list, so each needs
+ * its own copy of everything that carries from one event to the next.  The
+ * track being written to at the moment is pointed to by Midi_track_p.
+ */
+struct MIDITRACK {
+	unsigned char *data;	/* the bytes of the track, built in memory */
+	UINT32B length;		/* how many bytes of data are used */
+	UINT32B alloc;		/* how many bytes of data are allocated */
+	UINT32B start;		/* where in data the track header is */
+	UINT32B size;		/* bytes written since the track header */
+
+	short staffno;		/* staff and voice index this track is for */
+	short vno;
+	short got_data;		/* YES if voice has been seen in this meas */
+	struct STAFF *last_staff_p; /* most recent STAFF for staffno when the
+				 * voice didn't exist there */
+
+	/* keep track of all time to an absolute reference so that all
+	 * tracks stay in sync, even though midi times are stored as delta
+	 * times */
+	RATIONAL absolute_time;
+	RATIONAL sum_of_deltas;
+
+	int status;		/* 0 if haven't yet written first MIDI status
+				 * byte for the track. Otherwise is the
+				 * current MIDI status byte. */
+	short channel;		/* MIDI channel, 0-15 */
+	char onvelocity[MAXHAND];	/* note on velocity */
+	char offvelocity[MAXHAND];	/* note off velocity */
+	short pedbounce;	/* YES if pedal bounce pending */
+
+	struct MIDISTUFF *midistufflist_p; /* MIDI STUFF for current measure */
+	struct PENDGRAD *pendgrad_p;	/* gradual changes yet to be done */
+
+	/* saved signature values to avoid writing events if no actual change */
+	short curr_sharps;
+	short curr_is_minor;
+	short curr_timenum;
+	short curr_timeden;
+
+	/* if a note has an implied accidental, either due to the key
+	 * signature or an accidental earlier in the measure, this table
+	 * holds the accidental.  For example, if we have a C, but are in the
+	 * key of D, the table entry for C would have a sharp in it. */
+	char accidental_map[MAXMIDINOTES][MAX_ACCS * 2];
+
+	/* If the first byte of a note's entry is set to something other
+	 * than NO_DEFERRED_ACC, then once the current tie on this note ends,
+	 * we need to set the accidental_map entry to this value. */
+	char deferred_acc[MAXMIDINOTES][MAX_ACCS * 2];
+
+	short tie_table[MAXMIDINOTES];	/* YES if note number has a tie on it */
+};
+
 /*
  * Define the structure for a chord.
  */
@@ -1788,7 +1921,7 @@ struct ATEND_INFO {
 struct MAINLL {
 	short str;	/* which structure in the union is now being used? */
 	short inputlineno; /* which input line this structure came from */
-	char *inputfile;	/* which file this came from (malloc'ed) */
+	char *inputfile;	/* which file this came from (interned) */
 	union {			/* malloc'ed structures to be pointed at */
 		struct SSV *ssv_p;	/* score/staff/voice context info */
 		struct FEED *feed_p;	/* score and/or page feed */
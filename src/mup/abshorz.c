@@ -44,6 +44,7 @@
  *		horizontal coordinates.
  */
 
+#include <stdlib.h>
 #include <string.h>
 #include "defines.h"
 #include "structs.h"
@@ -56,6 +57,14 @@ static void abschunk P((struct MAINLL *mainll_p, struct MAINLL *end_p));
 static struct MAINLL *tryabs P((struct MAINLL *mainll_p,
 		struct MAINLL *prevfeed_p, double scale, int *scores_p,
 		short measinscore[]));
+static int dpabs P((struct MAINLL *start_p, double scale, int numbars,
+		short measinscore[]));
+static double setroom P((struct MAINLL *start_p, struct MAINLL *mainll_p,
+		struct MAINLL *prevfeed_p, struct CLEFSIG *clefsig_p,
+		struct BAR *bar_p));
+static double elasticwidth P((struct MAINLL *mainll_p, struct MAINLL *end_p,
+		double scale));
+static double badness P((double extra, double elastic));
 static int endchunk P((struct MAINLL *mainll_p));
 static int prev_is_restart P((struct MAINLL *mainll_p));
 static int this_is_restart P((struct MAINLL *mainll_p));
@@ -106,6 +115,38 @@ static int getmultinum P((struct MAINLL *mll_p));
  * because we need to allow room for carry-in ties/slurs.
  */
 #define CSP(clefsig_p)	(((clefsig_p)->bar_p == 0 ? 2.0 : 9.0) * STDPAD)
+
+/*
+ * For the dynamic programming line breaker:  the most a score's stretchable
+ * chords are assumed to be able to stretch, when figuring badness (beyond
+ * that, it's all equally bad); the badness of a score that overflows; and
+ * how much overflow to forgive due to roundoff error.
+ */
+#define DP_MAXRATIO	(10.0)
+#define DP_OVERFULL	(1.0e20)
+#define DP_FUDGE	(0.001)
+
+/*
+ * Info that the dynamic programming line breaker keeps about each set of
+ * measures that must be kept on the same score.
+ */
+struct MEASSET {
+	struct MAINLL *start_p;	/* first thing in the set, as for trymeasset */
+	float width;		/* width of the set at the minimal scale */
+	float adjust;		/* bar line adjust, if set ends a score */
+	double avail;		/* room on a score that begins with this set */
+	int measures;		/* number of measures in the set */
+	int countable;		/* how many count toward maxmeasures */
+	int restart;		/* is it a restart pseudo-measure? */
+	int indentrestart;	/* value of that parameter before the set */
+};
+
+/*
+ * Should abschunk() use the old method of finding the scale by bisection,
+ * instead of the dynamic programming line breaker?  Set from the MUP_LAYOUT
+ * environment variable, mainly so the two can be compared.
+ */
+static int Layout_bisect = NO;
 
 /*
  * Name:        abshorz()
@@ -130,11 +171,17 @@ abshorz()
 	struct MAINLL *mainfeed_p;	/* point at MAINLL containing a FEED */
 	struct MAINLL *end_p;		/* point to end of a chunk of MAINLL */
 	int gotbar;			/* found a bar in this chunk */
+	char *layout;			/* value of MUP_LAYOUT */
 
 
 	debug(16, "abshorz");
 	ml2_p = 0;		/* prevent useless 'used before set' warning */
 
+	/* MUP_LAYOUT=bisect asks for the old way of breaking into scores */
+	layout = getenv("MUP_LAYOUT");
+	Layout_bisect = (layout != 0 && strcmp(layout, "bisect") == 0)
+			? YES : NO;
+
 	/*
 	 * The parse phase put any user-requested score feeds in the main
 	 * linked list.  We must now insert a FEED before the first measure,
@@ -969,10 +1016,11 @@ struct CHHEAD *chhead_p;	/* point at the preceding chhead */
  * Description: This function is given a chunk of the piece, which is
  *		delimited by FEEDs.  It estimates how many inches should
  *		be allocated to each whole note of time.  Then it calls
- *		tryabs() repeatedly, trying to find a scale factor that
- *		will avoid having the last score be too empty.  Finally,
- *		it calls setabs() to set the absolute horizontal coordinates
- *		of everything in the chunk.
+ *		dpabs() to choose where the scores break; or, if that can't
+ *		be used, it calls tryabs() repeatedly, trying to find a scale
+ *		factor that will avoid having the last score be too empty.
+ *		Finally, it calls setabs() to set the absolute horizontal
+ *		coordinates of everything in the chunk.
  */
 
 static void
@@ -987,7 +1035,9 @@ struct MAINLL *end_p;		/* points after last struct in chunk (or 0) */
 	struct MAINLL *mainll_p;/* point at items in main linked list*/
 	struct MAINLL *prevfeed_p; /* remember where last FEED in chunk goes */
 	struct CHORD *ch_p;	/* point at a chord */
-	short *measinscore;	/* malloc'ed array; bars in each score */
+	short *measinscore;	/* scratch array; bars in each score */
+	struct ARENA_MARK mark;	/* Scratch_arena before measinscore */
+	struct ARENA *old_arena_p; /* arena that was current before */
 	float packfact;		/* as it was at the start of this score */
 	float lowscale;		/* small guess at inches per whole */
 	float origlowscale;	/* remember original lowscale */
@@ -997,6 +1047,7 @@ struct MAINLL *end_p;		/* points after last struct in chunk (or 0) */
 	int numbars;		/* number of measures in this chunk */
 	int scores;		/* number of scores needed for this chunk */
 	int reqscores;		/* the number of score required */
+	int dpscores;		/* number of scores from dpabs() */
 	int trial;		/* trial number for getting correct scale */
 	int must_set_right_margin;   /* did user say "rightmargin = auto"? */
 
@@ -1086,7 +1137,10 @@ struct MAINLL *end_p;		/* points after last struct in chunk (or 0) */
 	 * many that will be.  So allocate enough for the worst case, where
 	 * each measure is so wide that it has to go on a separate score.
 	 */
+	arena_mark(Scratch_arena, &mark);
+	old_arena_p = set_arena(Scratch_arena);
 	MALLOCA(short, measinscore, numbars + 1);
+	(void) set_arena(old_arena_p);
 
 	/*
 	 * Our first trial is to allow "packfact" times the minimal
@@ -1108,7 +1162,19 @@ struct MAINLL *end_p;		/* points after last struct in chunk (or 0) */
 	 */
 	if (scores == 1 || must_set_right_margin) {
 		setabs(start_p, scores, measinscore);
-		FREE(measinscore);
+		arena_release(Scratch_arena, &mark);
+		return;
+	}
+
+	/*
+	 * Normally, let the dynamic programming line breaker choose where the
+	 * scores break.  If it can't, or the user asked for the old way, fall
+	 * through to the bisection below.
+	 */
+	if (Layout_bisect == NO && (dpscores = dpabs(start_p, lowscale,
+			numbars, measinscore)) > 0) {
+		setabs(start_p, dpscores, measinscore);
+		arena_release(Scratch_arena, &mark);
 		return;
 	}
 
@@ -1220,9 +1286,399 @@ struct MAINLL *end_p;		/* points after last struct in chunk (or 0) */
 	/* set all coordinates based on the layout we just found */
 	setabs(start_p, scores, measinscore);
 
-	FREE(measinscore);
+	arena_release(Scratch_arena, &mark);
 }
 
+/*
+ * Name:        dpabs()
+ *
+ * Abstract:    Choose where the scores of a chunk break, by dynamic programming.
+ *
+ * Returns:	number of scores, or 0 if the caller should fall back on
+ *		the bisection method
+ *
+ * Description: This function is an alternative to calling tryabs()
+ *		repeatedly with different scales.  It walks the chunk once at
+ *		the given (minimal) scale, recording for each set of measures
+ *		that must be kept on the same score its width, how much of
+ *		that width is "elastic" (chords whose width comes from their
+ *		time value rather than their contents), and how much room a
+ *		score beginning with that set would have.  From prefix sums of
+ *		these, it finds the breaks that minimize the total badness of
+ *		the scores, in the style of the Knuth-Plass line breaker,
+ *		obeying maxmeasures, indentrestart, and the user's right
+ *		margin on the last score.  The room on each score depends on
+ *		the labels printed, which depend on where the previous score
+ *		began; the first walk can only guess at that, so once the
+ *		breaks are chosen, the room is figured again for real, and if
+ *		anything would not fit, 0 is returned.
+ */
+
+static int
+dpabs(start_p, scale, numbars, measinscore)
+
+struct MAINLL *start_p;		/* FEED at start of chunk of MAINLL */
+double scale;			/* inches per "whole" unit of time */
+int numbars;			/* number of measures in this chunk */
+short measinscore[];		/* return number of measures in each score */
+
+{
+	struct MEASSET *set_p;	/* info about each set of measures */
+	double *width_p;	/* prefix sums of widths of sets */
+	double *elastic_p;	/* prefix sums of elastic widths of sets */
+	int *countable_p;	/* prefix sums of countable measures of sets */
+	double *cost_p;		/* least badness for breaking before a set */
+	int *lines_p;		/* fewest scores for breaking before a set */
+	int *from_p;		/* set that starts the score ending there */
+	struct ARENA_MARK mark;	/* Scratch_arena before our arrays */
+	struct ARENA *old_arena_p; /* arena that was current before */
+	struct MAINLL *mainll_p;/* points along main linked list */
+	struct MAINLL *new_p;	/* points at first struct of next set */
+	struct CLEFSIG clefsig;	/* temporary CLEFSIG for start of each score */
+	struct BAR bar;		/* temp BAR; may be need by the above CLEFSIG*/
+	float measwidth;	/* width needed by a set of measures */
+	float adjust;		/* bar line adjust if last measure in score */
+	double maxavail;	/* most room any score could have */
+	double width;		/* width of the sets on one score */
+	double room;		/* room on one score */
+	double cost;		/* badness of a possible score */
+	float userdelta;	/* (user right margin) - (normal right margin)*/
+	int ressv;		/* did we apply a CLEFSIG-causing SSV? */
+	int maxmeasures;	/* from the SSV state at the start of chunk */
+	int num_in_set;		/* no. of measures in a set from trymeasset */
+	int numsets;		/* number of sets of measures */
+	int scores;		/* number of scores needed */
+	int i, j, k;		/* set indexes */
+
+
+	debug(32, "dpabs file=%s line=%d scale=%f", start_p->inputfile,
+			start_p->inputlineno, (float)scale);
+
+	if (eff_rightmargin(start_p->next) == MG_AUTO) {
+		userdelta = 0.0;
+	} else {
+		userdelta = eff_rightmargin(start_p->next) -
+			    eff_rightmargin((struct MAINLL *)0);
+	}
+
+	/* there can't be more sets, or scores, than there are measures */
+	arena_mark(Scratch_arena, &mark);
+	old_arena_p = set_arena(Scratch_arena);
+	MALLOC(MEASSET, set_p, numbars);
+	MALLOCA(double, width_p, numbars + 1);
+	MALLOCA(double, elastic_p, numbars + 1);
+	MALLOCA(int, countable_p, numbars + 1);
+	MALLOCA(double, cost_p, numbars + 1);
+	MALLOCA(int, lines_p, numbars + 1);
+	MALLOCA(int, from_p, numbars + 1);
+	(void) set_arena(old_arena_p);
+
+	/*
+	 * Walk through the chunk once, getting the info about each set of
+	 * measures.  The room on a score is figured as if the set started
+	 * it, guessing that the previous score starts the chunk.
+	 */
+	setssvstate(start_p);
+	maxmeasures = Score.maxmeasures;
+	maxavail = 0.0;
+	width_p[0] = elastic_p[0] = 0.0;
+	countable_p[0] = 0;
+	for (mainll_p = start_p, numsets = 0; ; mainll_p = new_p) {
+		if (numsets >= numbars) {
+			pfatal("more sets of measures than measures in chunk");
+		}
+		set_p[numsets].start_p = mainll_p;
+		set_p[numsets].restart = this_is_restart(mainll_p);
+		set_p[numsets].indentrestart = Score.indentrestart;
+		set_p[numsets].avail = setroom(start_p, mainll_p, start_p,
+				&clefsig, &bar);
+		if (set_p[numsets].avail > maxavail) {
+			maxavail = set_p[numsets].avail;
+		}
+
+		new_p = trymeasset(mainll_p, scale, &measwidth, &adjust,
+				&ressv, &set_p[numsets].measures);
+		set_p[numsets].width = measwidth;
+		set_p[numsets].adjust = adjust;
+		set_p[numsets].countable = set_p[numsets].measures;
+		if (countable_measure(mainll_p) == NO) {
+			set_p[numsets].countable--;
+		}
+
+		width_p[numsets + 1] = width_p[numsets] + measwidth;
+		elastic_p[numsets + 1] = elastic_p[numsets] +
+				elasticwidth(mainll_p, new_p, scale);
+		countable_p[numsets + 1] = countable_p[numsets] +
+				set_p[numsets].countable;
+		numsets++;
+
+		if (endchunk(new_p)) {
+			break;
+		}
+	}
+
+	/*
+	 * For putting sets 0 through j-1 on scores, lines_p[j] is the fewest
+	 * scores it can be done in, cost_p[j] is the least total badness of
+	 * doing it in that many, and from_p[j] is the first set on the last
+	 * of those scores.  Like the bisection, we never use more scores
+	 * than are needed at the minimal scale; we just choose better where
+	 * they break.  A score holding sets i through j-1 must fit (unless
+	 * it is a single set, which has to go somewhere), and once the sets
+	 * get wider than the widest score could be, no smaller i can work.
+	 */
+	cost_p[0] = 0.0;
+	lines_p[0] = 0;
+	for (j = 1; j <= numsets; j++) {
+		cost_p[j] = 0.0;
+		lines_p[j] = 0;
+		from_p[j] = -1;
+		for (i = j - 1; i >= 0; i--) {
+			width = width_p[j] - width_p[i] - set_p[j - 1].adjust;
+			/* an unindented restart starting a score takes no room*/
+			if (set_p[i].restart == YES &&
+					set_p[i].indentrestart == NO) {
+				width -= set_p[i].width;
+			}
+			room = set_p[i].avail - (j == numsets ? userdelta : 0.0);
+
+			if (i < j - 1) {
+				/* the sets after the first already can't fit */
+				if (width_p[j] - width_p[i + 1] -
+						set_p[j - 1].adjust > maxavail) {
+					break;
+				}
+				if (countable_p[j - 1] - countable_p[i] +
+						set_p[j - 1].measures >
+						maxmeasures) {
+					break;
+				}
+				if (width > room) {
+					continue;
+				}
+				/*
+				 * With indentrestart, a restart can't end a
+				 * score; it goes to the start of the next one.
+				 */
+				if (j < numsets && set_p[j - 1].restart == YES
+						&& set_p[j - 1].indentrestart
+						== YES) {
+					continue;
+				}
+			}
+			if (i > 0 && from_p[i] < 0) {
+				continue;	/* no way to break before set i */
+			}
+
+			cost = cost_p[i] + badness(room - width,
+					elastic_p[j] - elastic_p[i]);
+			if (from_p[j] < 0 || lines_p[i] + 1 < lines_p[j] ||
+					(lines_p[i] + 1 == lines_p[j] &&
+					cost < cost_p[j])) {
+				cost_p[j] = cost;
+				lines_p[j] = lines_p[i] + 1;
+				from_p[j] = i;
+			}
+		}
+		if (from_p[j] < 0) {
+			/* can only happen if a single set broke a rule */
+			arena_release(Scratch_arena, &mark);
+			return (0);
+		}
+	}
+
+	/* count the scores, then fill in measinscore from the last one back */
+	scores = 0;
+	for (j = numsets; j > 0; j = from_p[j]) {
+		scores++;
+	}
+	k = scores;
+	for (j = numsets; j > 0; j = from_p[j]) {
+		k--;
+		measinscore[k] = 0;
+		for (i = from_p[j]; i < j; i++) {
+			measinscore[k] += set_p[i].measures;
+		}
+		/* remember where each score starts, for checking below */
+		set_p[from_p[j]].avail = -1.0;
+	}
+
+	/*
+	 * Now that we know where each score really starts, figure the room on
+	 * each one for real, and make sure everything fits.  Scores with only
+	 * one set were forced, and are allowed not to.
+	 */
+	setssvstate(start_p);
+	i = 0;			/* first set on the current score */
+	room = 0.0;
+	for (k = 0; k < numsets; k++) {
+		if (set_p[k].avail < 0.0) {
+			room = setroom(start_p, set_p[k].start_p,
+					set_p[i].start_p, &clefsig, &bar);
+			i = k;
+		}
+		(void)trymeasset(set_p[k].start_p, scale, &measwidth, &adjust,
+				&ressv, &num_in_set);
+		if (k == numsets - 1 || set_p[k + 1].avail < 0.0) {
+			/* k is the last set on this score */
+			width = width_p[k + 1] - width_p[i] - set_p[k].adjust;
+			if (set_p[i].restart == YES &&
+					set_p[i].indentrestart == NO) {
+				width -= set_p[i].width;
+			}
+			if (k == numsets - 1) {
+				room -= userdelta;
+			}
+			if (k > i && width > room + DP_FUDGE) {
+				debug(32, "dpabs: score at set %d overflows", i);
+				arena_release(Scratch_arena, &mark);
+				return (0);
+			}
+		}
+	}
+
+	arena_release(Scratch_arena, &mark);
+	return (scores);
+}
+
+/*
+ * Name:        setroom()
+ *
+ * Abstract:    Find the room on a score that would start at a given place.
+ *
+ * Returns:	the width available for measures
+ *
+ * Description: This function finds how much width is available on a score
+ *		beginning at the given set of measures, allowing for margins,
+ *		labels, and the CLEFSIG that would be printed at the start of
+ *		it, assuming the current SSV state.  It assumes the normal
+ *		right margin.  The CLEFSIG and its BAR are scratch space
+ *		provided by the caller.
+ */
+
+static double
+setroom(start_p, mainll_p, prevfeed_p, clefsig_p, bar_p)
+
+struct MAINLL *start_p;		/* FEED at start of chunk of MAINLL */
+struct MAINLL *mainll_p;	/* where the score would start */
+struct MAINLL *prevfeed_p;	/* where the previous score would start */
+struct CLEFSIG *clefsig_p;	/* scratch CLEFSIG */
+struct BAR *bar_p;		/* scratch BAR */
+
+{
+	double room;		/* the answer */
+
+
+	if (mainll_p == start_p) {
+		/* the FEED really exists, and may have a user left margin */
+		room = EFF_PG_WIDTH - eff_rightmargin((struct MAINLL *)0)
+				- eff_leftmargin(start_p);
+		room -= width_left_of_score(start_p);
+	} else {
+		room = EFF_PG_WIDTH - eff_rightmargin((struct MAINLL *)0)
+				- eff_leftmargin((struct MAINLL *)0);
+		room -= pwidth_left_of_score(mainll_p, prevfeed_p);
+	}
+
+	(void)memset((char *)clefsig_p, 0, sizeof(*clefsig_p));
+	(void)memset((char *)bar_p, 0, sizeof(*bar_p));
+	clefsig_p->bar_p = bar_p;
+	fillclefsig(clefsig_p, mainll_p);
+	room -= width_clefsig(mainll_p, clefsig_p) + CSP(clefsig_p);
+
+	return (room);
+}
+
+/*
+ * Name:        elasticwidth()
+ *
+ * Abstract:    Find the width of chords that get their width from time.
+ *
+ * Returns:	the width
+ *
+ * Description: This function, given a set of measures, adds up the widths
+ *		(at the given scale) of the chords whose width comes from their
+ *		pseudodur rather than from what's in them.  This is roughly
+ *		the part of the set that grows when a score is spread out.
+ */
+
+static double
+elasticwidth(mainll_p, end_p, scale)
+
+struct MAINLL *mainll_p;	/* first thing in the set, or FEED */
+struct MAINLL *end_p;		/* first thing after the set, or 0 */
+double scale;			/* inches per "whole" unit of time */
+
+{
+	struct CHORD *ch_p;	/* point at a chord */
+	double idealwidth;	/* the width a chord should be, based on time*/
+	double width;		/* the answer */
+
+
+	width = 0.0;
+	for ( ; mainll_p != end_p; mainll_p = mainll_p->next) {
+		if (mainll_p->str != S_CHHEAD) {
+			continue;
+		}
+		for (ch_p = mainll_p->u.chhead_p->ch_p; ch_p != 0;
+					ch_p = ch_p->ch_p) {
+			idealwidth = scale * ch_p->pseudodur;
+			if (ch_p->uncollapsible == YES &&
+					idealwidth >= ch_p->width) {
+				width += idealwidth;
+			}
+		}
+	}
+	return (width);
+}
+
+/*
+ * Name:        badness()
+ *
+ * Abstract:    Find the badness of a score for the line breaker.
+ *
+ * Returns:	the badness
+ *
+ * Description: This function, given the white space left over on a score
+ *		and the width of the parts of it that can stretch, finds how
+ *		bad it would look to spread the score out to fill it.  As in
+ *		Knuth-Plass, badness grows as the cube of the stretch ratio,
+ *		and it is squared, so that evenly stretched scores win over a
+ *		mix of tight and loose ones.  The last score of a chunk is
+ *		charged the same way, so it ends up balanced with the others
+ *		instead of being left mostly empty.  A score that overflows
+ *		(a single set that's too wide) is very bad but allowed.
+ */
+
+static double
+badness(extra, elastic)
+
+double extra;			/* room left over on the score */
+double elastic;			/* width of chords that can stretch */
+
+{
+	double ratio;		/* how much the elastic part must stretch */
+	double bad;		/* the answer, before squaring */
+
+
+	if (extra < -DP_FUDGE) {
+		return (DP_OVERFULL);
+	}
+	if (extra <= 0.0) {
+		ratio = 0.0;
+	} else if (elastic > DP_FUDGE) {
+		ratio = extra / elastic;
+	} else {
+		ratio = DP_MAXRATIO;	/* nothing can stretch */
+	}
+	if (ratio > DP_MAXRATIO) {
+		ratio = DP_MAXRATIO;
+	}
+
+	bad = 1.0 + 100.0 * ratio * ratio * ratio;
+	return (bad * bad);
+}
+
 /*
  * Name:        tryabs()
  *
@@ -1283,6 +1739,7 @@ short measinscore[];		/* return number of measures in each score */
 
 	debug(32, "tryabs file=%s line=%d scale=%f", start_p->inputfile,
 			start_p->inputlineno, (float)scale);
+	Stat_count[ST_TRYABS]++;
 	/* must apply all SSVs from start, to get the right clef/key/time; */
 	setssvstate(start_p);
 	maxmeasures = Score.maxmeasures;
@@ -4441,6 +4898,7 @@ int *ressv_p;			/* must the caller reapply SSVs? */
 			ssv_p->used[VISIBLE] = NO;
 		}
 	}
+	discard_ssv_ckpts();
 
 	/* the SSVs to be put at the end go after the last bar line */
 	ins_p = lastbar_p;
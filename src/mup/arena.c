@@ -0,0 +1,708 @@
+/*
+ Copyright (c) 1995-2024  by Arkkra Enterprises.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms,
+ with or without modification, are permitted provided that
+ the following conditions are met:
+
+ 1. Redistributions of source code must retain
+ the above copyright notice, this list of conditions
+ and the following DISCLAIMER.
+
+ 2. Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and
+ the following DISCLAIMER in the documentation and/or
+ other materials provided with the distribution.
+
+ 3. Any additions, deletions, or changes to the original files
+ must be clearly indicated in accompanying documentation,
+ including the reasons for the changes,
+ and the names of those who made the modifications.
+
+	DISCLAIMER
+
+ THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS
+ OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Name:	arena.c
+ *
+ * Description:	This file contains functions for allocating memory from
+ *		arenas.  The MALLOC, CALLOC, REALLOC, and FREE macros (and
+ *		the ...A versions) go through here.  When no arena is current,
+ *		they behave exactly like malloc, calloc, realloc, and free.
+ *		When an arena is current, allocations are carved sequentially
+ *		out of big chunks, which is much cheaper than going to malloc
+ *		for every little structure, and the whole arena can be thrown
+ *		away at once.  Freeing something that lives in an arena does
+ *		nothing, except that if it was the very last thing allocated,
+ *		the space is given back, so that short-lived allocate/free
+ *		pairs don't use up the arena.
+ *
+ *		Each item in an arena is preceded by a header telling its size,
+ *		so that REALLOC knows how much to copy.  To be able to tell
+ *		whether a pointer passed to FREE or REALLOC belongs to an
+ *		arena, a table of all chunks of all arenas is kept, sorted by
+ *		address, and binary searched.
+ *
+ *		There is also a slab allocator for coordinate arrays of
+ *		NUMCTYPE floats, which are needed for every note and rest.
+ *
+ *		Allocations are counted in Stat_count, for the -T report.
+ */
+
+#include "defines.h"
+#include "structs.h"
+#include "globals.h"
+
+/* Each item is preceded by one of these, which also forces alignment */
+union ARENA_HDR {
+	long size;		/* number of usable bytes in the item */
+	double d;		/* these are just for alignment */
+	char *p;
+};
+#define ARENA_ALIGN	(sizeof(union ARENA_HDR))
+#define ARENA_ROUND(n)	(((n) + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN)
+
+/* How much to grow the chunk table by when it fills up */
+#define CHUNKTAB_CHUNK	(64)
+
+/* all chunks of all arenas, sorted by start address */
+static struct ARENA_CHUNK **Chunktab;
+static int Numchunks;
+static int Chunktabsize;
+
+/* the arena new allocations come from, or 0 for the normal heap */
+static struct ARENA *Curr_arena_p;
+
+/* Coordinate arrays are handed out in blocks of this many floats, which is
+ * NUMCTYPE rounded up, so that every block is aligned well enough to hold
+ * the free list pointer. */
+#define COORDBLOCK	((NUMCTYPE + 3) / 4 * 4)
+/* how many coordinate blocks to allocate at a time */
+#define COORDS_PER_PAGE	(1024)
+
+static float *Coordpage;	/* page blocks are currently handed out from */
+static int Coordpage_used;	/* how many blocks of Coordpage are in use */
+static float *Free_coords;	/* freed blocks, linked through their
+				 * first bytes */
+
+static char *arena_get P((struct ARENA *arena_p, long size));
+static struct ARENA_CHUNK *new_chunk P((struct ARENA *arena_p, long size));
+static void free_chunk P((struct ARENA_CHUNK *chunk_p));
+static int find_chunk P((char *addr));
+
+
+/*
+ * Name:        new_arena()
+ *
+ * Abstract:    Create a new, empty arena.
+ *
+ * Returns:     pointer to the arena
+ *
+ * Description: This function allocates an ARENA and initializes it.  No
+ *		chunk is allocated until something is put in the arena.
+ */
+
+struct ARENA *
+new_arena(name, chunksize)
+
+char *name;		/* for debugging output */
+long chunksize;		/* how much to get from malloc at a time */
+
+{
+	struct ARENA *arena_p;
+
+
+	/* the ARENA itself always comes from the heap */
+	if ((arena_p = (struct ARENA *) malloc(sizeof(struct ARENA))) == 0) {
+		l_no_mem(__FILE__, __LINE__);
+	}
+	arena_p->name = name;
+	arena_p->chunksize = chunksize;
+	arena_p->chunk_p = (struct ARENA_CHUNK *) 0;
+	arena_p->next = (char *) 0;
+	arena_p->bytes = 0;
+	return(arena_p);
+}
+
+
+/*
+ * Name:        set_arena()
+ *
+ * Abstract:    Set which arena new allocations should come from.
+ *
+ * Returns:     the previously current arena
+ *
+ * Description: This function makes the given arena the current one, so that
+ *		MALLOC and friends carve from it.  A null pointer means to
+ *		use the normal heap.  The old value is returned, so callers
+ *		can put it back when done.
+ */
+
+struct ARENA *
+set_arena(arena_p)
+
+struct ARENA *arena_p;	/* the arena to use, or 0 for the heap */
+
+{
+	struct ARENA *old_arena_p;
+
+
+	old_arena_p = Curr_arena_p;
+	Curr_arena_p = arena_p;
+	return(old_arena_p);
+}
+
+
+/*
+ * Name:        arena_name()
+ *
+ * Abstract:    Return the name of the current arena.
+ *
+ * Returns:     name of the current arena, or "heap" if there isn't one
+ *
+ * Description: This function is used for debugging output.
+ */
+
+char *
+arena_name()
+{
+	return(Curr_arena_p == (struct ARENA *) 0 ? "heap" : Curr_arena_p->name);
+}
+
+
+/*
+ * Name:        arena_malloc()
+ *
+ * Abstract:    Allocate memory from the current arena or heap.
+ *
+ * Returns:     pointer to the memory, or 0 if out of memory
+ *
+ * Description: This function is what the MALLOC macros call instead of
+ *		malloc().
+ */
+
+char *
+arena_malloc(size)
+
+unsigned size;		/* number of bytes wanted */
+
+{
+	Stat_count[ST_ALLOCS]++;
+	Stat_count[ST_ALLOCBYTES] += size;
+	if (Curr_arena_p == (struct ARENA *) 0) {
+		return((char *) malloc(size));
+	}
+	return(arena_get(Curr_arena_p, (long) size));
+}
+
+
+/*
+ * Name:        arena_calloc()
+ *
+ * Abstract:    Allocate zeroed memory from the current arena or heap.
+ *
+ * Returns:     pointer to the memory, or 0 if out of memory
+ *
+ * Description: This function is what the CALLOC macros call instead of
+ *		calloc().
+ */
+
+char *
+arena_calloc(numelem, elemsize)
+
+unsigned numelem;	/* number of elements wanted */
+unsigned elemsize;	/* size of each element */
+
+{
+	char *mem_p;
+
+
+	Stat_count[ST_ALLOCS]++;
+	Stat_count[ST_ALLOCBYTES] += (long) numelem * elemsize;
+	if (Curr_arena_p == (struct ARENA *) 0) {
+		return((char *) calloc(numelem, elemsize));
+	}
+	if ((mem_p = arena_get(Curr_arena_p, (long) numelem * elemsize)) != 0) {
+		(void) memset(mem_p, 0, (long) numelem * elemsize);
+	}
+	return(mem_p);
+}
+
+
+/*
+ * Name:        arena_realloc()
+ *
+ * Abstract:    Change the size of previously allocated memory.
+ *
+ * Returns:     pointer to the memory, or 0 if out of memory
+ *
+ * Description: This function is what the REALLOC macros call instead of
+ *		realloc().  Memory from the heap stays in the heap.  Memory
+ *		from an arena stays where it is if it is shrinking, or if it
+ *		is the last thing in its arena and there is room to grow it
+ *		in place.  Otherwise new space is gotten from the current arena
+ *		(or heap) and the contents are copied there.
+ */
+
+char *
+arena_realloc(mem_p, size)
+
+char *mem_p;		/* what to reallocate */
+unsigned size;		/* new size in bytes */
+
+{
+	union ARENA_HDR *hdr_p;		/* header of mem_p's item */
+	struct ARENA *arena_p;		/* arena mem_p is in */
+	char *new_p;			/* new location */
+	int c;				/* index into Chunktab */
+
+
+	if (mem_p == (char *) 0) {
+		return(arena_malloc(size));
+	}
+	if ((c = find_chunk(mem_p)) < 0) {
+		Stat_count[ST_ALLOCS]++;
+		Stat_count[ST_ALLOCBYTES] += size;
+		return((char *) realloc(mem_p, size));
+	}
+
+	hdr_p = ((union ARENA_HDR *) mem_p) - 1;
+	if (size <= hdr_p->size) {
+		return(mem_p);
+	}
+
+	/* if this was the last item allocated, try to grow in place */
+	arena_p = Chunktab[c]->arena_p;
+	if (Chunktab[c] == arena_p->chunk_p
+			&& mem_p + hdr_p->size == arena_p->next
+			&& mem_p + ARENA_ROUND(size) <= arena_p->chunk_p->end) {
+		Stat_count[ST_ALLOCS]++;
+		Stat_count[ST_ALLOCBYTES] += size;
+		arena_p->bytes += ARENA_ROUND(size) - hdr_p->size;
+		hdr_p->size = ARENA_ROUND(size);
+		arena_p->next = mem_p + hdr_p->size;
+		return(mem_p);
+	}
+
+	if ((new_p = arena_malloc(size)) != (char *) 0) {
+		(void) memcpy(new_p, mem_p, hdr_p->size);
+	}
+	return(new_p);
+}
+
+
+/*
+ * Name:        arena_free()
+ *
+ * Abstract:    Free memory from an arena or the heap.
+ *
+ * Returns:     void
+ *
+ * Description: This function is what the FREE macro calls instead of free().
+ *		Heap memory is freed.  Arena memory is left alone, unless it
+ *		was the last thing allocated in its arena, in which case
+ *		that space can be handed out again.
+ */
+
+void
+arena_free(mem_p)
+
+char *mem_p;		/* what to free */
+
+{
+	union ARENA_HDR *hdr_p;		/* header of mem_p's item */
+	struct ARENA *arena_p;		/* arena mem_p is in */
+	int c;				/* index into Chunktab */
+
+
+	if (mem_p == (char *) 0) {
+		return;
+	}
+	if ((c = find_chunk(mem_p)) < 0) {
+		free(mem_p);
+		return;
+	}
+
+	hdr_p = ((union ARENA_HDR *) mem_p) - 1;
+	arena_p = Chunktab[c]->arena_p;
+	if (Chunktab[c] == arena_p->chunk_p
+			&& mem_p + hdr_p->size == arena_p->next) {
+		arena_p->next = (char *) hdr_p;
+		arena_p->bytes -= hdr_p->size + ARENA_ALIGN;
+	}
+}
+
+
+/*
+ * Name:        arena_mark()
+ *
+ * Abstract:    Remember how much of an arena is used.
+ *
+ * Returns:     void
+ *
+ * Description: This function saves the current state of an arena, so that
+ *		arena_release() can later throw away everything allocated
+ *		from it after this point.
+ */
+
+void
+arena_mark(arena_p, mark_p)
+
+struct ARENA *arena_p;		/* the arena to mark */
+struct ARENA_MARK *mark_p;	/* return the state here */
+
+{
+	mark_p->chunk_p = arena_p->chunk_p;
+	mark_p->next = arena_p->next;
+	mark_p->bytes = arena_p->bytes;
+}
+
+
+/*
+ * Name:        arena_release()
+ *
+ * Abstract:    Throw away everything allocated in an arena after a mark.
+ *
+ * Returns:     void
+ *
+ * Description: This function frees all chunks allocated in an arena since the
+ *		given mark was made, and resets it to carve from where it was
+ *		at that time.  If that takes the arena back to empty, the
+ *		oldest chunk is kept, so that an arena that is repeatedly
+ *		filled and emptied doesn't keep going back to malloc.
+ *		Marks must be released in the reverse order they were made.
+ */
+
+void
+arena_release(arena_p, mark_p)
+
+struct ARENA *arena_p;		/* the arena to cut back */
+struct ARENA_MARK *mark_p;	/* state to go back to */
+
+{
+	struct ARENA_CHUNK *chunk_p;	/* chunk to free */
+
+
+	while (arena_p->chunk_p != mark_p->chunk_p) {
+		chunk_p = arena_p->chunk_p;
+		if (mark_p->chunk_p == (struct ARENA_CHUNK *) 0
+				&& chunk_p->prev == (struct ARENA_CHUNK *) 0) {
+			/* keep the oldest chunk, but empty */
+			arena_p->next = chunk_p->start;
+			arena_p->bytes = 0;
+			return;
+		}
+		arena_p->chunk_p = chunk_p->prev;
+		free_chunk(chunk_p);
+	}
+	arena_p->next = mark_p->next;
+	arena_p->bytes = mark_p->bytes;
+}
+
+
+/*
+ * Name:        reset_arena()
+ *
+ * Abstract:    Throw away everything in an arena.
+ *
+ * Returns:     void
+ *
+ * Description: This function empties an arena, so the space can be reused.
+ *		Everything that was allocated from it becomes invalid.
+ */
+
+void
+reset_arena(arena_p)
+
+struct ARENA *arena_p;		/* the arena to empty */
+
+{
+	struct ARENA_MARK empty;
+
+
+	empty.chunk_p = (struct ARENA_CHUNK *) 0;
+	empty.next = (char *) 0;
+	empty.bytes = 0;
+	arena_release(arena_p, &empty);
+}
+
+
+/*
+ * Name:        free_arena()
+ *
+ * Abstract:    Free an arena and everything in it.
+ *
+ * Returns:     void
+ *
+ * Description: This function gives all the memory of an arena back to the
+ *		heap, including the ARENA itself.  Its cost depends only on
+ *		the number of chunks, not on how many things were allocated.
+ */
+
+void
+free_arena(arena_p)
+
+struct ARENA *arena_p;		/* the arena to free */
+
+{
+	struct ARENA_CHUNK *chunk_p;	/* chunk to free */
+
+
+	while ((chunk_p = arena_p->chunk_p) != (struct ARENA_CHUNK *) 0) {
+		arena_p->chunk_p = chunk_p->prev;
+		free_chunk(chunk_p);
+	}
+	if (Curr_arena_p == arena_p) {
+		Curr_arena_p = (struct ARENA *) 0;
+	}
+	free((char *) arena_p);
+}
+
+
+/*
+ * Name:        arena_get()
+ *
+ * Abstract:    Carve some memory out of an arena.
+ *
+ * Returns:     pointer to the memory, or 0 if out of memory
+ *
+ * Description: This function returns the next piece of the arena's current
+ *		chunk, getting a new chunk first if there isn't enough room.
+ */
+
+static char *
+arena_get(arena_p, size)
+
+struct ARENA *arena_p;		/* the arena to allocate from */
+long size;			/* bytes wanted */
+
+{
+	union ARENA_HDR *hdr_p;		/* header of the new item */
+	long need;			/* size rounded up, plus header */
+
+
+	if (size < 1) {
+		size = 1;
+	}
+	need = ARENA_ROUND(size) + ARENA_ALIGN;
+	if (arena_p->chunk_p == (struct ARENA_CHUNK *) 0
+			|| arena_p->next + need > arena_p->chunk_p->end) {
+		if (new_chunk(arena_p, need) == (struct ARENA_CHUNK *) 0) {
+			return((char *) 0);
+		}
+	}
+
+	hdr_p = (union ARENA_HDR *) arena_p->next;
+	hdr_p->size = need - ARENA_ALIGN;
+	arena_p->next += need;
+	arena_p->bytes += need;
+	return((char *) (hdr_p + 1));
+}
+
+
+/*
+ * Name:        new_chunk()
+ *
+ * Abstract:    Add a new chunk to an arena.
+ *
+ * Returns:     pointer to the chunk, or 0 if out of memory
+ *
+ * Description: This function mallocs a new chunk, big enough for at least
+ *		"size" bytes, makes it the arena's current chunk, and adds
+ *		it to the table of chunks.  Whatever was left at the end of
+ *		the previous chunk is not used.
+ */
+
+static struct ARENA_CHUNK *
+new_chunk(arena_p, size)
+
+struct ARENA *arena_p;		/* add chunk to this arena */
+long size;			/* it must hold at least this many bytes */
+
+{
+	struct ARENA_CHUNK *chunk_p;	/* the new chunk */
+	long hdrsize;			/* room for the ARENA_CHUNK itself */
+	int c;				/* index into Chunktab */
+
+
+	if (size < arena_p->chunksize) {
+		size = arena_p->chunksize;
+	}
+	hdrsize = ARENA_ROUND(sizeof(struct ARENA_CHUNK));
+	if ((chunk_p = (struct ARENA_CHUNK *) malloc((unsigned)
+					(hdrsize + size))) == 0) {
+		return((struct ARENA_CHUNK *) 0);
+	}
+	chunk_p->arena_p = arena_p;
+	chunk_p->start = (char *) chunk_p + hdrsize;
+	chunk_p->end = chunk_p->start + size;
+	chunk_p->prev = arena_p->chunk_p;
+	arena_p->chunk_p = chunk_p;
+	arena_p->next = chunk_p->start;
+
+	/* make room in the table if necessary */
+	if (Numchunks >= Chunktabsize) {
+		Chunktabsize += CHUNKTAB_CHUNK;
+		if ((Chunktab = (struct ARENA_CHUNK **) realloc((char *) Chunktab,
+				Chunktabsize * sizeof(struct ARENA_CHUNK *)))
+				== 0) {
+			l_no_mem(__FILE__, __LINE__);
+		}
+	}
+
+	/* insert it, keeping the table sorted by address */
+	for (c = Numchunks; c > 0 && Chunktab[c - 1]->start > chunk_p->start;
+								c--) {
+		Chunktab[c] = Chunktab[c - 1];
+	}
+	Chunktab[c] = chunk_p;
+	Numchunks++;
+
+	return(chunk_p);
+}
+
+
+/*
+ * Name:        free_chunk()
+ *
+ * Abstract:    Free a chunk.
+ *
+ * Returns:     void
+ *
+ * Description: This function removes a chunk from the table of chunks and
+ *		gives it back to the heap.  The caller must already have
+ *		unlinked it from its arena.
+ */
+
+static void
+free_chunk(chunk_p)
+
+struct ARENA_CHUNK *chunk_p;	/* the chunk to free */
+
+{
+	int c;				/* index into Chunktab */
+
+
+	if ((c = find_chunk(chunk_p->start)) < 0) {
+		pfatal("arena chunk missing from table");
+	}
+	for (Numchunks--; c < Numchunks; c++) {
+		Chunktab[c] = Chunktab[c + 1];
+	}
+	free((char *) chunk_p);
+}
+
+
+/*
+ * Name:        find_chunk()
+ *
+ * Abstract:    Find which arena chunk, if any, an address is in.
+ *
+ * Returns:     index into Chunktab, or -1 if not in any arena
+ *
+ * Description: This function does a binary search of the chunk table.
+ */
+
+static int
+find_chunk(addr)
+
+char *addr;			/* the address to look for */
+
+{
+	int lo, hi, mid;		/* binary search bounds */
+
+
+	lo = 0;
+	hi = Numchunks - 1;
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		if (addr < Chunktab[mid]->start) {
+			hi = mid - 1;
+		}
+		else if (addr >= Chunktab[mid]->end) {
+			lo = mid + 1;
+		}
+		else {
+			return(mid);
+		}
+	}
+	return(-1);
+}
+
+
+/*
+ * Name:        new_coords()
+ *
+ * Abstract:    Allocate a coordinate array.
+ *
+ * Returns:     pointer to NUMCTYPE floats, all zero
+ *
+ * Description: This function hands out a coordinate array for a NOTE or
+ *		the restc of a GRPSYL.  These are pointed to by location tags,
+ *		so they must never move, but there can be hundreds of thousands
+ *		of them.  So rather than mallocing each one, they are handed
+ *		out in order from big pages, which keeps the coordinates of
+ *		neighboring notes close together in memory.  Arrays given back
+ *		by free_coords() are reused first.
+ */
+
+float *
+new_coords()
+{
+	float *c;		/* the array to return */
+
+
+	if (Free_coords != (float *) 0) {
+		c = Free_coords;
+		(void) memcpy((char *) &Free_coords, (char *) c,
+						sizeof(Free_coords));
+	}
+	else {
+		if (Coordpage == (float *) 0 || Coordpage_used >= COORDS_PER_PAGE) {
+			MALLOCA(float, Coordpage, COORDS_PER_PAGE * COORDBLOCK);
+			Coordpage_used = 0;
+		}
+		c = Coordpage + Coordpage_used * COORDBLOCK;
+		Coordpage_used++;
+	}
+	(void) memset((char *) c, 0, NUMCTYPE * sizeof(float));
+	return(c);
+}
+
+
+/*
+ * Name:        free_coords()
+ *
+ * Abstract:    Free a coordinate array.
+ *
+ * Returns:     void
+ *
+ * Description: This function puts a coordinate array that was allocated by
+ *		new_coords() on the free list, to be reused.
+ */
+
+void
+free_coords(c)
+
+float *c;		/* the array to free */
+
+{
+	(void) memcpy((char *) c, (char *) &Free_coords, sizeof(Free_coords));
+	Free_coords = c;
+}
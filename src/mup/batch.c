@@ -0,0 +1,442 @@
+/*
+ Copyright (c) 1995-2024  by Arkkra Enterprises.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms,
+ with or without modification, are permitted provided that
+ the following conditions are met:
+
+ 1. Redistributions of source code must retain
+ the above copyright notice, this list of conditions
+ and the following DISCLAIMER.
+
+ 2. Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and
+ the following DISCLAIMER in the documentation and/or
+ other materials provided with the distribution.
+
+ 3. Any additions, deletions, or changes to the original files
+ must be clearly indicated in accompanying documentation,
+ including the reasons for the changes,
+ and the names of those who made the modifications.
+
+	DISCLAIMER
+
+ THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS
+ OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Name:	batch.c
+ *
+ * Description:	This file contains functions for running Mup on lots of
+ *		independent files at once ("mup --batch"), as for building
+ *		a songbook. Mup's one-time initialization (font metrics,
+ *		character tables, symbol table) is done once, and then each
+ *		file is compiled in a child process forked from that, so the
+ *		tables, along with the PostScript prolog and other constant
+ *		data, are shared by all the jobs. Up to a given number of
+ *		jobs are run at once. As in serve.c, batch() returns in each
+ *		child with the arguments for that job, and main() carries on
+ *		from there just as if Mup had been started with them.
+ *
+ *		The jobs can be given as file names, or in a manifest file,
+ *		one job per line, each line being the Mup command line
+ *		arguments for that job, with the input file last.
+ *		Words are separated by white space; blank lines and lines
+ *		starting with # are ignored. Unless a job's arguments say
+ *		otherwise, output goes to a file derived from the input file
+ *		name, like with -F, and errors go to a file whose name is
+ *		derived the same way, but ending in .err, which is removed
+ *		if it ends up empty. At the end, how long each job took and
+ *		how it turned out are printed.
+ */
+
+#include "defines.h"
+#include "structs.h"
+#include "globals.h"
+
+#ifdef HAVE_FORK
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/* how many jobs to run at once if not told */
+#define DFLT_BATCH_JOBS	(4)
+/* longest manifest line */
+#define BATCHLINELEN	(4096)
+/* most words on a manifest line */
+#define MAXBATCHWORDS	(256)
+/* how many more jobs to make room for at a time */
+#define BATCH_CHUNK	(64)
+
+struct BATCHJOB {
+	int argc;		/* arguments for job, with */
+	char **argv;		/* the program name first */
+	char *infile;		/* Mup input file name */
+	char *errfile;		/* error log */
+	pid_t pid;		/* process running it */
+	int incpath_fd;		/* where it says where include files were */
+	double start;		/* when it was started */
+	double elapsed;		/* how long it took, in seconds */
+	int exitcode;		/* how it ended, or -1 if it died */
+};
+
+static struct BATCHJOB *Batchjobs;
+static int Numbatchjobs;
+static int Allocbatchjobs;
+
+static void add_job P((char *progname, char **words, int numwords));
+static void read_manifest P((char *progname, char *manifest));
+static char *derive_err_name P((char *infile));
+static double now P((void));
+static void batch_report P((double elapsed));
+#endif
+
+
+/* Run as a batch compiler. argv[1] is "--batch"; the rest are options for
+ * the batch and then files. This only returns in child processes made to
+ * run a job, in which case *argv_p is pointed to the arguments for the
+ * job, and the number of arguments is returned. The parent exits when
+ * all the jobs are done. */
+
+int
+batch(argc, argv_p)
+
+int argc;
+char ***argv_p;
+
+{
+#ifdef HAVE_FORK
+	char **argv;
+	char *progname;
+	int jobs = DFLT_BATCH_JOBS;	/* how many to run at once */
+	int running;			/* how many are running now */
+	int next;			/* next job to start */
+	int a;
+	int j;
+	int status;
+	pid_t pid;
+	int incpath_pipe[2];		/* job tells where include files were */
+	double start;			/* when the batch started */
+
+
+	debug(1, "batch");
+
+	argv = *argv_p;
+	progname = argv[0];
+	for (a = 2; a < argc; a++) {
+		if (strcmp(argv[a], "-j") == 0 && a + 1 < argc) {
+			jobs = atoi(argv[++a]);
+			if (jobs < 1) {
+				ufatal("--batch -j value must be at least 1");
+			}
+		}
+		else if (strcmp(argv[a], "-i") == 0 && a + 1 < argc) {
+			read_manifest(progname, argv[++a]);
+		}
+		else if (argv[a][0] == '-') {
+			ufatal("usage: %s --batch [-j N] [-i manifest] [file.mup ...]",
+					progname);
+		}
+		else {
+			add_job(progname, &(argv[a]), 1);
+		}
+	}
+	if (Numbatchjobs == 0) {
+		ufatal("no files given for --batch");
+	}
+
+	start = now();
+	for (next = running = 0; next < Numbatchjobs || running > 0; ) {
+		if (next < Numbatchjobs && running < jobs) {
+			Batchjobs[next].start = now();
+			if (pipe(incpath_pipe) != 0) {
+				ufatal("can't create pipe for --batch job");
+			}
+			if ((pid = fork()) < 0) {
+				ufatal("can't create process for --batch job");
+			}
+			if (pid == 0) {
+				/* We are the job. Anything not going to the
+				 * job's output or error files is discarded. */
+				if (freopen("/dev/null", "r", stdin) == (FILE *) 0
+						|| freopen("/dev/null", "w", stdout)
+						== (FILE *) 0) {
+					_exit(1);
+				}
+				/* Tell the parent where include files were
+				 * found, so later jobs can go right to them */
+				(void) close(incpath_pipe[0]);
+				for (j = 0; j < next; j++) {
+					if (Batchjobs[j].incpath_fd >= 0) {
+						(void) close(Batchjobs[j].incpath_fd);
+					}
+				}
+				report_incpaths(incpath_pipe[1]);
+				*argv_p = Batchjobs[next].argv;
+				return(Batchjobs[next].argc);
+			}
+			(void) close(incpath_pipe[1]);
+			Batchjobs[next].pid = pid;
+			Batchjobs[next].incpath_fd = incpath_pipe[0];
+			next++;
+			running++;
+			continue;
+		}
+
+		/* wait for one to finish */
+		if ((pid = wait(&status)) < 0) {
+			pfatal("lost track of --batch jobs");
+		}
+		for (j = 0; j < next; j++) {
+			if (Batchjobs[j].pid == pid) {
+				break;
+			}
+		}
+		if (j == next) {
+			continue;
+		}
+		Batchjobs[j].elapsed = now() - Batchjobs[j].start;
+		Batchjobs[j].exitcode = (WIFEXITED(status)
+					? WEXITSTATUS(status) : -1);
+		learn_incpaths(Batchjobs[j].incpath_fd);
+		(void) close(Batchjobs[j].incpath_fd);
+		Batchjobs[j].incpath_fd = -1;
+		running--;
+	}
+
+	batch_report(now() - start);
+	/*NOTREACHED*/
+	return(0);
+#else
+	ufatal("--batch is not supported on this system");
+	/*NOTREACHED*/
+	return(0);
+#endif
+}
+
+#ifdef HAVE_FORK
+
+/* Add a job with the given arguments. The last is the input file. */
+
+static void
+add_job(progname, words, numwords)
+
+char *progname;
+char **words;		/* Mup arguments for the job */
+int numwords;
+
+{
+	struct BATCHJOB *job_p;
+	int has_output = NO;	/* was an output file given? */
+	char *errfile = (char *) 0;	/* error file, if given */
+	int w;
+	int a;
+
+
+	if (Numbatchjobs >= Allocbatchjobs) {
+		Allocbatchjobs += BATCH_CHUNK;
+		if (Batchjobs == (struct BATCHJOB *) 0) {
+			MALLOC(BATCHJOB, Batchjobs, Allocbatchjobs);
+		}
+		else {
+			REALLOC(BATCHJOB, Batchjobs, Allocbatchjobs);
+		}
+	}
+	job_p = &(Batchjobs[Numbatchjobs++]);
+
+	for (w = 0; w < numwords; w++) {
+		if (words[w][0] != '-') {
+			continue;
+		}
+		switch (words[w][1]) {
+		case 'f':
+		case 'F':
+		case 'm':
+		case 'M':
+			has_output = YES;
+			break;
+		case 'e':
+			if (words[w][2] != '\0') {
+				errfile = words[w] + 2;
+			}
+			else if (w + 1 < numwords) {
+				errfile = words[w + 1];
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	/* room for program name, -q, -F, -e errfile, and null */
+	MALLOCA(char *, job_p->argv, numwords + 6);
+	a = 0;
+	job_p->argv[a++] = progname;
+	job_p->argv[a++] = "-q";
+	if (has_output == NO) {
+		job_p->argv[a++] = "-F";
+	}
+	job_p->infile = words[numwords - 1];
+	if (errfile == (char *) 0) {
+		errfile = derive_err_name(job_p->infile);
+		job_p->argv[a++] = "-e";
+		job_p->argv[a++] = errfile;
+	}
+	job_p->errfile = errfile;
+	for (w = 0; w < numwords; w++) {
+		job_p->argv[a++] = words[w];
+	}
+	job_p->argv[a] = (char *) 0;
+	job_p->argc = a;
+	job_p->pid = 0;
+	job_p->elapsed = 0.0;
+	job_p->exitcode = -1;
+}
+
+
+/* Read the jobs listed in a manifest file */
+
+static void
+read_manifest(progname, manifest)
+
+char *progname;
+char *manifest;		/* file name, or "-" for standard input */
+
+{
+	FILE *file_p;
+	char line[BATCHLINELEN];
+	char *words[MAXBATCHWORDS];
+	char *copy;		/* of line, to keep the words in */
+	char *word;
+	int numwords;
+	int lineno;
+
+
+	if (strcmp(manifest, "-") == 0) {
+		file_p = stdin;
+	}
+	else if ((file_p = fopen(manifest, "r")) == (FILE *) 0) {
+		cant_open(manifest);
+		exit(1);
+	}
+
+	for (lineno = 1; fgets(line, sizeof(line), file_p) != (char *) 0;
+							lineno++) {
+		MALLOCA(char, copy, strlen(line) + 1);
+		(void) strcpy(copy, line);
+		numwords = 0;
+		for (word = strtok(copy, " \t\r\n"); word != (char *) 0;
+					word = strtok((char *) 0, " \t\r\n")) {
+			if (numwords >= MAXBATCHWORDS) {
+				l_ufatal(manifest, lineno,
+					"too many words on manifest line");
+			}
+			words[numwords++] = word;
+		}
+		if (numwords == 0 || words[0][0] == '#') {
+			FREE(copy);
+			continue;
+		}
+		add_job(progname, words, numwords);
+	}
+
+	if (file_p != stdin) {
+		(void) fclose(file_p);
+	}
+}
+
+
+/* Return the name to use for a job's error file: the input file with its
+ * .mup or .MUP replaced with .err or .ERR, or .err added if it has neither. */
+
+static char *
+derive_err_name(infile)
+
+char *infile;
+
+{
+	char *errfile;
+	int length;
+
+
+	length = strlen(infile);
+	MALLOCA(char, errfile, length + 5);
+	(void) strcpy(errfile, infile);
+	if (length > 4 && strcmp(errfile + length - 4, ".mup") == 0) {
+		(void) strcpy(errfile + length - 4, ".err");
+	}
+	else if (length > 4 && strcmp(errfile + length - 4, ".MUP") == 0) {
+		(void) strcpy(errfile + length - 4, ".ERR");
+	}
+	else {
+		(void) strcpy(errfile + length, ".err");
+	}
+	return(errfile);
+}
+
+
+/* Return the current time of day, in seconds */
+
+static double
+now()
+
+{
+	struct timeval tv;
+
+	(void) gettimeofday(&tv, (struct timezone *) 0);
+	return((double) tv.tv_sec + (double) tv.tv_usec / 1000000.0);
+}
+
+
+/* Print how each job went, and a summary, then exit, with an exit code
+ * of 1 if any of them failed. Error files that are empty are removed. */
+
+static void
+batch_report(elapsed)
+
+double elapsed;		/* how long the whole batch took */
+
+{
+	FILE *err_p;
+	double total = 0.0;	/* time for all jobs added up */
+	int failed = 0;
+	int j;
+
+
+	for (j = 0; j < Numbatchjobs; j++) {
+		if ((err_p = fopen(Batchjobs[j].errfile, "r")) != (FILE *) 0) {
+			if (getc(err_p) == EOF) {
+				(void) unlink(Batchjobs[j].errfile);
+			}
+			(void) fclose(err_p);
+		}
+		if (Batchjobs[j].exitcode != 0) {
+			failed++;
+		}
+		total += Batchjobs[j].elapsed;
+		(void) printf("%8.3fs  %-7s %s\n", Batchjobs[j].elapsed,
+				Batchjobs[j].exitcode == 0 ? "ok"
+				: (Batchjobs[j].exitcode < 0 ? "died"
+				: "failed"), Batchjobs[j].infile);
+	}
+	(void) printf("%d file%s, %d failed, %.3fs of compiling done in %.3fs\n",
+			Numbatchjobs, Numbatchjobs == 1 ? "" : "s", failed,
+			total, elapsed);
+	exit(failed == 0 ? 0 : 1);
+}
+#endif
@@ -137,6 +137,25 @@ static int BS_allocated_len;
  * ability to backspace, like verticial motion of a newline. */
 static short BS_is_allowed;
 
+/* The same strings get measured many times, during placement and again
+ * when printing, so their metrics are cached. This is how many can be
+ * remembered at once; it must be a power of 2. */
+#define STRMET_SLOTS	(4096)
+
+struct STRMETRICS {
+	char *str;		/* copy of the string, or 0 if slot is unused */
+	unsigned long hash;	/* hash of str */
+	int len;		/* strlen(str) */
+	float width;		/* what strwidth() returns */
+	float ascent;		/* what strascent() returns */
+	float descent;		/* what strdescent() returns */
+	short pagenum;		/* Pagenum when measured */
+	int last_pagenum;	/* Last_pagenum when measured */
+};
+
+/* The cache, allocated when first needed */
+static struct STRMETRICS *Strmet_p;
+
 /* Font from which we are allocating user-defined characters */
 static int Curr_usym_font = FONT_USERDEF1;
 /* Font of the currently-being-defined character. This will be the same
@@ -162,6 +181,9 @@ static int family_base_of P((int font));
 static char *get_num P((char *string, int *num_p));
 static void add_char P((char *name, int fontkind, int code));
 static double lwidth_common P((char *string, int consider_start_pile));
+static struct STRMETRICS *strmetrics P((char *str));
+static void measure_str P((char *str, float *width_p, float *ascent_p,
+		float *descent_p));
 static int starts_piled P((char *string, int *font_p, int *size_p,
 		char **pile_start_p_p));
 static int str_cmd P((char *str, int *size_p, int *font_p, int *in_pile_p));
@@ -1362,90 +1384,213 @@ strascent(str)
 char *str;	/* which string to process */
 
 {
-	float max_ascent, a;	/* tallest and current ascent */
-	char *s;		/* to walk through string */
-	int font, size, code;
-	int textfont;
-	double vertical, horizontal;
-	float baseline_offset;	/* to account for vertical motion */
-	int in_pile;
-	int only_mus_sym;	/* YES if string consists solely
-				 * of a music char */
+	if (str == (char *) 0) {
+		return(0.0);
+	}
+	return(strmetrics(str)->ascent);
+}
+
 
+/* return the descent of a string in inches. This is the largest descent of any
+ * character in the string */
+
+double
+strdescent(str)
+
+char *str;	/* which string to process */
 
+{
 	if (str == (char *) 0) {
 		return(0.0);
 	}
+	return(strmetrics(str)->descent);
+}
 
-	only_mus_sym = is_music_symbol(str);
 
-	/* first 2 bytes are font and size. */
-	font = str[0];
-	size = str[1];
+/* return the height of a string in inches. This is the maximum ascent plus the
+ * maximum descent */
 
-	/* Walk through the string. */
-	for (max_ascent = 0.0, baseline_offset = 0.0, s = str + 2;
-			(code = nxt_str_char(&s, &font, &size, &textfont,
-			&vertical, &horizontal, &in_pile, NO)) > 0;    ) {
+double
+strheight(str)
 
-		/* A newline goes to following line, so we probably won't
-		 * get any higher ascent than we have so far, but if
-		 * user gives enough vertical motion, we might, so continue. */
-		if (code == '\n') {
-			baseline_offset -= fontheight(font, size);
-		}
+char *str;		/* which string to process */
+{
+	struct STRMETRICS *met_p;
 
-		/* adjust for any vertical motion */
-		if (vertical != 0.0) {
-			baseline_offset += vertical;
-		}
+	if (str == (char *) 0) {
+		return(0.0);
+	}
 
-		/* music characters inside strings get moved up to the baseline,
-		 * so use their height as ascent.
-		 * Regular characters use the
-		 * ascent of the character */
-		if ((IS_MUSIC_FONT(font))  && (only_mus_sym == NO)) {
-			a = height(font, size, code);
-		}
-		else {
-			a = ascent(font, size, code);
-		}
-		a += baseline_offset;
+	/* Since letters may not
+	 * align because of ascent/descent, we get the tallest extent
+	 * by adding the largest ascent to the largest descent */
+	met_p = strmetrics(str);
+	return( (double) met_p->ascent + (double) met_p->descent);
+}
 
-		/* if tallest seen save this height */
-		if (a > max_ascent) {
-			max_ascent = a;
+
+/* return the width of a string. This is the sum of the widths of the
+ * individual characters in the string */
+
+double
+strwidth(str)
+char *str;
+{
+	if (str == (char *) 0) {
+		return(0.0);
+	}
+	return(strmetrics(str)->width);
+}
+
+
+/* Return the cached metrics of a string, measuring it first if it isn't
+ * in the cache. The cache is keyed by the string's contents, not its
+ * address, since strings get freed and their space reused, and some are
+ * changed in place (circled_dimensions() does that briefly).
+ * A width that includes a page number or number of pages is only good
+ * for the page numbers it was measured with, so those are checked too.
+ * Strings with a pile are not cached at all: how nxt_str_char() walks a
+ * pile depends on what string it walked before, so they are measured
+ * afresh every time, exactly as they always were. */
+
+static struct STRMETRICS *
+strmetrics(str)
+
+char *str;
+
+{
+	unsigned long hash;
+	int len;
+	int has_pgnum;		/* YES if may contain STR_PAGENUM or
+				 * STR_NUMPAGES */
+	int has_pile;		/* YES if may contain STR_PILE */
+	struct STRMETRICS *met_p;
+	static struct STRMETRICS unsaved;	/* for piled strings */
+	float width, ascent, descent;
+	struct ARENA *old_arena_p;
+
+
+	/* Hash the string. While we're at it, look for things that make
+	 * the metrics depend on more than the string. This is just looking
+	 * at bytes, so it could be fooled by the argument of some other
+	 * STR_* command, but that only makes us a little more careful. */
+	has_pgnum = has_pile = NO;
+	for (hash = 5381, len = 0; str[len] != '\0'; len++) {
+		hash = hash * 33 + (str[len] & 0xff);
+		switch (str[len] & 0xff) {
+		case STR_PAGENUM:
+		case STR_NUMPAGES:
+			has_pgnum = YES;
+			break;
+		case STR_PILE:
+			has_pile = YES;
+			break;
+		default:
+			break;
 		}
 	}
 
-	/* if boxed, allow space for that */
-	if (IS_BOXED(str) == YES) {
-		max_ascent += 2.5 * STDPAD;
+	if (has_pile == YES) {
+		Stat_count[ST_STRMETMISSES]++;
+		measure_str(str, &(unsaved.width), &(unsaved.ascent),
+					&(unsaved.descent));
+		return(&unsaved);
+	}
+
+	if (Strmet_p == (struct STRMETRICS *) 0) {
+		old_arena_p = set_arena((struct ARENA *) 0);
+		CALLOC(STRMETRICS, Strmet_p, STRMET_SLOTS);
+		(void) set_arena(old_arena_p);
+	}
+
+	met_p = &(Strmet_p[hash & (STRMET_SLOTS - 1)]);
+	if (met_p->str != (char *) 0 && met_p->hash == hash
+			&& met_p->len == len
+			&& memcmp(met_p->str, str, len) == 0
+			&& (has_pgnum == NO || (met_p->pagenum == Pagenum
+				&& met_p->last_pagenum == Last_pagenum))) {
+		Stat_count[ST_STRMETHITS]++;
+		return(met_p);
+	}
+	Stat_count[ST_STRMETMISSES]++;
+
+	/* Measure it. This can measure other strings (for circled ones),
+	 * which could use this same slot, so the slot isn't touched until
+	 * we're done. */
+	measure_str(str, &width, &ascent, &descent);
+
+	old_arena_p = set_arena((struct ARENA *) 0);
+	if (met_p->str == (char *) 0) {
+		MALLOCA(char, met_p->str, len + 1);
+	}
+	else if (met_p->len < len) {
+		REALLOCA(char, met_p->str, len + 1);
+	}
+	(void) set_arena(old_arena_p);
+	(void) memcpy(met_p->str, str, len + 1);
+	met_p->hash = hash;
+	met_p->len = len;
+	met_p->width = width;
+	met_p->ascent = ascent;
+	met_p->descent = descent;
+	met_p->pagenum = Pagenum;
+	met_p->last_pagenum = Last_pagenum;
+	return(met_p);
+}
+
+
+/* Forget all the cached string metrics. This must be called whenever the
+ * size of any character changes, like when a font file is read or a user
+ * symbol is defined. */
+
+void
+forget_strmetrics()
+
+{
+	int s;
+
+	if (Strmet_p == (struct STRMETRICS *) 0) {
+		return;
 	}
-	/* similarly, allow space for circle */
-	if (IS_CIRCLED(str) == YES) {
-		float ascent_adjust;
-		max_ascent += circled_dimensions(str, (float *) 0, (float *) 0,
-					&ascent_adjust, (float *) 0);
-		max_ascent += ascent_adjust;
+	for (s = 0; s < STRMET_SLOTS; s++) {
+		if (Strmet_p[s].str != (char *) 0) {
+			FREE(Strmet_p[s].str);
+			Strmet_p[s].str = (char *) 0;
+		}
 	}
-	return(max_ascent);
 }
-
 
-/* return the descent of a string in inches. This is the largest descent of any
- * character in the string */
 
-double
-strdescent(str)
+/* Walk through a string once, getting its width, ascent, and descent.
+ * The ascent is the largest ascent of any character in the string;
+ * the descent is the largest descent; and the width is the sum of the
+ * widths of the individual characters, or of the widest line if there
+ * is more than one line. */
 
-char *str;	/* which string to process */
+static void
+measure_str(str, width_p, ascent_p, descent_p)
+
+char *str;		/* which string to process */
+float *width_p;		/* width is returned here */
+float *ascent_p;	/* ascent is returned here */
+float *descent_p;	/* descent is returned here */
 
 {
+	float tot_width;
+	float widest_line;	/* for multi-line strings */
+	float curr_width;
+	float max_ascent, a;	/* tallest and current ascent */
+	float baseline_offset;	/* to account for vertical motion */
 	float max_descent, d;	/* largest and current descent */
 	float line_descent;	/* descent caused by newlines */
-	double vertical, horizontal;
-	int in_pile;
+	float circ_extra;	/* space added above and below for circle */
+	float ascent_adjust;	/* added to ascent of circled short string */
+	double horizontal, vertical;
+	int was_in_pile;	/* if in pile last time through loop */
+	int in_pile_now;	/* if current character is inside a pile */
+	int at_end;		/* YES once past the last character. There
+				 * can still be vertical motion after that,
+				 * which only matters for descent. */
 	char *s;		/* to walk through string */
 	int font, size, code;
 	int textfont;
@@ -1453,123 +1598,98 @@ char *str;	/* which string to process */
 				 * of a music char */
 
 
-	if (str == (char *) 0) {
-		return(0.0);
-	}
-
 	only_mus_sym = is_music_symbol(str);
 
 	/* first 2 bytes are font and size. */
 	font = str[0];
 	size = str[1];
 
-	/* walk through the string. */
-	for (max_descent = line_descent = 0.0, s = str + 2;
+ 	/* walk through string */
+	was_in_pile = NO;
+	at_end = NO;
+	curr_width = tot_width = widest_line = 0.0;
+	max_ascent = baseline_offset = 0.0;
+	max_descent = line_descent = 0.0;
+	for (s = str + 2;
 			(code = nxt_str_char(&s, &font, &size, &textfont,
-			&vertical, &horizontal, &in_pile, NO)) > 0
-			|| vertical != 0.0;  ) {
+			&vertical, &horizontal, &in_pile_now, NO)) > 0
+			|| vertical != 0.0;
+			was_in_pile = in_pile_now) {
 
-		/* Adjust for vertical motion. Since line_descent is
+		if (code <= 0) {
+			at_end = YES;
+		}
+
+		/* Descent. Adjust for vertical motion. Since line_descent is
 		 * measured downward and vertical is upward, have to
 		 * substract the vertical, then adjust max_descent
 		 * to compensate. */
 		if (vertical != 0.0) {
 			line_descent -= vertical;
 			max_descent += vertical;
-			if (code == 0) {
-				/* motion only */
-				continue;
-			}
 		}
-
-		if (code == '\n') {
+		if (code == 0) {
+			/* motion only */
+		}
+		else if (code == '\n') {
 			/* at newline, descent goes down to next baseline,
 			 * which will be down from current baseline
 			 * by height of font */
 			line_descent += fontheight(font, size);
 			max_descent = 0.0;
-			continue;
-		}
-
-		/* music characters inside strings get moved up to the
-		 * baseline, so have no descent. */
-		if ( ! (IS_MUSIC_FONT(font)) || (only_mus_sym == YES)) {
-			d = descent(font, size, code);
 		}
 		else {
-			d = 0.0;
-		}
+			/* music characters inside strings get moved up to
+			 * the baseline, so have no descent. */
+			if ( ! (IS_MUSIC_FONT(font)) || (only_mus_sym == YES)) {
+				d = descent(font, size, code);
+			}
+			else {
+				d = 0.0;
+			}
 
-		/* if largest descent seen, save this descent */
-		if (d > max_descent) {
-			max_descent = d;
+			/* if largest descent seen, save this descent */
+			if (d > max_descent) {
+				max_descent = d;
+			}
 		}
-	}
 
-	/* if boxed, allow space for that */
-	if (IS_BOXED(str) == YES) {
-		max_descent += 3.5 * STDPAD;
-	}
-	/* similarly, allow space for circle */
-	if (IS_CIRCLED(str) == YES) {
-		max_descent += circled_dimensions(str, (float *) 0, (float *) 0,
-						(float *) 0, (float *) 0);
-	}
-	return(max_descent + line_descent);
-}
-
-
-/* return the height of a string in inches. This is the maximum ascent plus the
- * maximum descent */
-
-double
-strheight(str)
-
-char *str;		/* which string to process */
-{
-	/* Since letters may not
-	 * align because of ascent/descent, we get the tallest extent
-	 * by adding the largest ascent to the largest descent */
-	return( strascent(str) + strdescent(str));
-}
-
-
-/* return the width of a string. This is the sum of the widths of the
- * individual characters in the string */
-
-double
-strwidth(str)
-char *str;
-{
-	float tot_width;
-	float widest_line;	/* for multi-line strings */
-	float curr_width;
-	double horizontal, vertical;
-	int was_in_pile;	/* if in pile last time through loop */
-	int in_pile_now;	/* if current character is inside a pile */
-	char *s;		/* to walk through string */
-	int font, size, code;
-	int textfont;
+		if (at_end == YES) {
+			continue;
+		}
 
+		/* Ascent. A newline goes to following line, so we probably
+		 * won't get any higher ascent than we have so far, but if
+		 * user gives enough vertical motion, we might, so continue. */
+		if (code == '\n') {
+			baseline_offset -= fontheight(font, size);
+		}
 
-	if (str == (char *) 0) {
-		return(0.0);
-	}
+		/* adjust for any vertical motion */
+		if (vertical != 0.0) {
+			baseline_offset += vertical;
+		}
 
-	/* first 2 bytes are font and size. */
-	font = str[0];
-	size = str[1];
+		/* music characters inside strings get moved up to the baseline,
+		 * so use their height as ascent.
+		 * Regular characters use the
+		 * ascent of the character */
+		if ((IS_MUSIC_FONT(font))  && (only_mus_sym == NO)) {
+			a = height(font, size, code);
+		}
+		else {
+			a = ascent(font, size, code);
+		}
+		a += baseline_offset;
 
- 	/* walk through string */
-	was_in_pile = NO;
-	for (curr_width = tot_width = widest_line = 0.0, s = str + 2;
-			(code = nxt_str_char(&s, &font, &size, &textfont,
-			&vertical, &horizontal, &in_pile_now, NO)) > 0;
-			was_in_pile = in_pile_now) {
+		/* if tallest seen save this height */
+		if (a > max_ascent) {
+			max_ascent = a;
+		}
 
-		/* Piles are handled specially. As soon as we enter a pile,
-		 * we call the function to get its entire width. Then for
-		 * the rest of the pile, we just skip past everything */
+		/* Width. Piles are handled specially. As soon as we enter a
+		 * pile, we call the function to get its entire width. Then
+		 * for the rest of the pile, we just skip past everything */
 		if (in_pile_now == YES) {
 			if (was_in_pile == NO) {
 				curr_width += pile_width();
@@ -1640,18 +1760,27 @@ char *str;
 	if (tot_width < widest_line) {
 		tot_width = widest_line;
 	}
-	/* if string is boxed, allow space for the box */
+
+	/* if boxed, allow space for that */
 	if (IS_BOXED(str) == YES) {
 		tot_width += 6.0 * STDPAD;
+		max_ascent += 2.5 * STDPAD;
+		max_descent += 3.5 * STDPAD;
 	}
-	/* similarly, allow space for circled */
+	/* similarly, allow space for circle */
 	if (IS_CIRCLED(str) == YES) {
-		(void) circled_dimensions(str, (float *) 0, &tot_width,
-						(float *) 0, (float *) 0);
+		circ_extra = circled_dimensions(str, (float *) 0, &tot_width,
+					&ascent_adjust, (float *) 0);
+		max_ascent += circ_extra;
+		max_ascent += ascent_adjust;
+		max_descent += circ_extra;
 	}
-	return(tot_width);
+
+	*width_p = tot_width;
+	*ascent_p = max_ascent;
+	*descent_p = max_descent + line_descent;
 }
-
+
 
 /* If the last character of the given string is a space,
  * returns its width, else returns 0.0 */
@@ -3965,6 +4094,9 @@ define_usym()
 			Fontinfo[f_index].maxascent = Fontinfo[f_index].ch_ascent[Usym_code];
 		}
 
+		/* Any strings measured so far may have used the old size */
+		forget_strmetrics();
+
 		/* If is a notehead, add to table of valid noteheads */
 		if (usym_p->flags & US_STEMOFFSET) {
 			if (usym_p->upstem_y < usym_p->lly ||
@@ -1223,7 +1223,7 @@ int c;	/* argument to -c command line option;
 						gs_p != 0; gs_p = gs_p->next) {
 					if (gs_p->grpcont == GC_REST &&
 							gs_p->restc == 0) {
-						MALLOCA(float, gs_p->restc, NUMCTYPE);
+						gs_p->restc = new_coords();
 					}
 				}
 			}
@@ -1366,6 +1366,7 @@ int min_combine;	/* minimum number to combine, or NORESTCOMBINE */
 	 * on the first one in case they were needed at the end of this
 	 * function.
 	 */
+	discard_ssv_ckpts();
 	if (begin_p == (struct MAINLL *) 0) {
 		old_p = Mainllhc_p;
 		Mainllhc_p = end_p;
@@ -2221,6 +2222,7 @@ int end;	/* Play only through this measure number.
 			 * We don't bother to free the space.
 			 */
 			if (mll_p != 0) {
+				discard_ssv_ckpts();
 				mll_p->prev->next = 0;
 				Mainlltc_p = mll_p->prev;
 			}
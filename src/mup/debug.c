@@ -1307,7 +1307,8 @@ char *acclist;
  * and save data about every malloc and free done via the MALLOC and similar
  * macros. An offline program (smadi) can then render that information human
  * readable, to help gives clues on where the memory corruption
- * might be happening.
+ * might be happening. It also summarizes how many bytes of each type
+ * were allocated from each arena, which shows the memory profile of a score.
  *
  * It is also possible to set environment variable MUP_FREE_SKIP to a
  * number, or a range (a pair of numbers, comma or dash separated) to make Mup
@@ -1420,13 +1421,13 @@ get_call_address()
  * to fill in the return value, and increment the index for the next item. */
 
 void
-alloc_debug_ret_addr(ret_addr)
+alloc_debug_ret_value(ret_value)
 
-void *ret_addr;
+void *ret_value;
 
 {
 	if (Alloc_info != 0) {
-		Alloc_info[Alloc_index].ret_addr = ret_addr;
+		Alloc_info[Alloc_index].ret_value = ret_value;
 		Alloc_count++;
 		Alloc_index++;
 	}
@@ -1465,6 +1466,7 @@ char *newp;		/* *LLOC* macro new_p field */
 	if (newp != 0) {
 		strncpy(Alloc_info[Alloc_index].newp, newp, CSIZE-1);
 	}
+	strncpy(Alloc_info[Alloc_index].arena, arena_name(), CSIZE-1);
 	Alloc_info[Alloc_index].call_addr = get_call_address();
 	if (ai_type == AI_FREE || ai_type == AI_FREE_SKIPPED) {
 		Alloc_index++;
@@ -1485,6 +1487,6 @@ free_debug(void *addr)
 		return;
 	}
 	alloc_debug(AI_FREE, 0, Free_count, addr, 0, 0);
-	free(addr);
+	arena_free(addr);
 }
 #endif
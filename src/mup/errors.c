@@ -70,6 +70,14 @@ extern void exit P((int status));
 #endif
 
 static void error_header P((char *filename, int lineno, char * errtype));
+static void log_warning P((int kind, char *filename, int lineno,
+		char *format, va_list args));
+
+/* If not null, warnings are written here, rather than being printed, for
+ * replay_warning() to print later. This is for processes forked to do part
+ * of the work, so that the parent can print their warnings in the order
+ * they would have come out if it had done all the work itself. */
+static FILE *Warnlog_p = (FILE *) 0;
 
 /* Print a message for a user error, and exit with the value of Errorcount,
  * or of MAX_ERRORS if > MAX_ERRORS */
@@ -103,10 +111,6 @@ va_dcl
 	va_start(args);
 #endif
 
-#ifndef UNIX_LIKE_FILES
-	mac_cleanup();
-#endif
-
 	(void) fprintf(stderr, "\n! Fatal user error: ");
 	(void) vfprintf(stderr, format, args);
 	va_end(args);
@@ -149,10 +153,6 @@ va_dcl
 	va_start(args);
 #endif
 
-#ifndef UNIX_LIKE_FILES
-	mac_cleanup();
-#endif
-
 	error_header(filename, lineno, "! Fatal user error");
 
 	(void) vfprintf(stderr, format, args);
@@ -199,10 +199,6 @@ va_dcl
 	va_start(args);
 #endif
 
-#ifndef UNIX_LIKE_FILES
-	mac_cleanup();
-#endif
-
 	/* print specified message with newline */
 	(void) fprintf(stderr, "\n! Fatal internal error: ");
 	(void) vfprintf(stderr, format, args);
@@ -330,6 +326,12 @@ va_dcl
 	va_start(args);
 #endif
 
+	if (Warnlog_p != (FILE *) 0) {
+		log_warning('w', (char *) 0, -1, format, args);
+		va_end(args);
+		return;
+	}
+
 	(void) fprintf(stderr, "- Warning: ");
 	(void) vfprintf(stderr, format, args);
 	(void) fprintf(stderr, "\n");
@@ -379,6 +381,12 @@ va_dcl
 	va_start(args);
 #endif
 
+	if (Warnlog_p != (FILE *) 0) {
+		log_warning('W', filename, lineno, format, args);
+		va_end(args);
+		return;
+	}
+
 	error_header(filename, lineno, "- Warning");
 	(void) vfprintf(stderr, format, args);
 	(void) fprintf(stderr, "\n");
@@ -395,6 +403,105 @@ va_dcl
 }
 
 
+/* Write warnings to the given file from now on, rather than printing them,
+ * or if the file is null, go back to printing them. */
+
+void
+log_warnings(log_p)
+
+FILE *log_p;
+
+{
+	Warnlog_p = log_p;
+}
+
+
+/* Write a warning to Warnlog_p. It is a record of the kind of warning, the
+ * file name pointer and line number, and the message with a null at the end.
+ * Since the file name is written as a pointer, only this process, or one
+ * forked from it, can read the record back. */
+
+static void
+log_warning(kind, filename, lineno, format, args)
+
+int kind;		/* W for l_warning(), w for warning() */
+char *filename;
+int lineno;
+char *format;
+va_list args;
+
+{
+	(void) putc(kind, Warnlog_p);
+	(void) fwrite((char *) &filename, sizeof(filename), 1, Warnlog_p);
+	(void) fwrite((char *) &lineno, sizeof(lineno), 1, Warnlog_p);
+	(void) vfprintf(Warnlog_p, format, args);
+	(void) putc('\0', Warnlog_p);
+}
+
+
+/* If the next thing in the given file is a warning written by log_warning(),
+ * read it, and print it just as it would have been printed in the first
+ * place, and return YES. Otherwise leave the file as is and return NO. */
+
+int
+replay_warning(log_p)
+
+FILE *log_p;
+
+{
+	char buff[BUFSIZ];	/* message text */
+	char *filename;
+	int lineno;
+	int kind;
+	int c;
+	int n;			/* bytes in buff */
+
+
+	if ((kind = getc(log_p)) != 'W' && kind != 'w') {
+		if (kind != EOF) {
+			(void) ungetc(kind, log_p);
+		}
+		return(NO);
+	}
+	if (fread((char *) &filename, sizeof(filename), 1, log_p) != 1 ||
+			fread((char *) &lineno, sizeof(lineno), 1, log_p) != 1) {
+		return(NO);
+	}
+
+	if (kind == 'W') {
+		error_header(filename, lineno, "- Warning");
+	}
+	else {
+		(void) fprintf(stderr, "- Warning: ");
+	}
+	n = 0;
+	while ((c = getc(log_p)) != '\0' && c != EOF) {
+		if (n == sizeof(buff)) {
+			(void) fwrite(buff, 1, n, stderr);
+			n = 0;
+		}
+		buff[n++] = c;
+	}
+	(void) fwrite(buff, 1, n, stderr);
+	(void) fprintf(stderr, "\n");
+
+	/* if doing macro expansion, also tell where macro was defined */
+	mac_error();
+	/* similar for when expanding emptymeas parameter */
+	emptym_err("warning");
+
+#ifdef Mac_BBEdit
+	if (kind == 'W') {
+		AppendWarning(filename, lineno);
+	}
+	else {
+		AppendWarning((char *) 0, -1);
+	}
+#endif
+	return(YES);
+}
+
+
 /* varargs version of yyerror, passing a file and linenumber (or -1 for the
  * lineno if you don't want a filename and linenumber printed) */
 
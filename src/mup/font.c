@@ -334,6 +334,9 @@ char *filename;
 	Fontinfo[findex].maxheight =  (double) max_height / (double) FONTFACTOR;
 	Fontinfo[findex].maxascent =  (double) max_ascent / (double) FONTFACTOR;
 
+	/* Any strings measured so far may have used the old sizes */
+	forget_strmetrics();
+
 	/* Next line of file is expected to contain the PostScript: line */
 	if ((ps_name = get_expected(fontfile_p, filename, PS_definition, &lineno))
 							== (char *) 0) {
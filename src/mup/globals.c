@@ -131,18 +131,8 @@ char Acclets[] = "B&n#x";
 /* external accidental symbols */
 char *Acctostr[] = { "&&", "&", "", "#", "x" };
 
-/* if a note has an implied accidental, either due to the key signature or an
- * accidental earlier in the measure, this table holds the accidental.  For
- * example, if we have a C, but are in the key of D, the table entry for C
- * would have a sharp in it. */
-char Accidental_map[MAXMIDINOTES][MAX_ACCS * 2];
-
-/* If the first byte of a note's entry is set to something other than
- * NO_DEFERRED_ACC, then once the current tie on this note ends, we need to
- * set the Accidental_map entry to this value. */
-char Deferred_acc[MAXMIDINOTES][MAX_ACCS * 2];
-
-short Tie_table[MAXMIDINOTES];	/* YES if note number has a tie on it */
+/* the MIDI track currently being generated */
+struct MIDITRACK *Midi_track_p;
 
 /*
  * This points to a linked list that lets us map from the user's name for an
@@ -322,6 +312,21 @@ struct ATEND_INFO Atend_info;
 struct RECTAB *Rectab;
 int Reclim;
 
+/*
+ * Arenas that MALLOC and friends can be told to allocate from (see arena.c).
+ * Parse_arena holds things made while parsing, which live until Mup exits.
+ * Scratch_arena is for short-lived placement data like Rectab; users mark it
+ * before allocating and release back to the mark when done.
+ */
+struct ARENA *Parse_arena;
+struct ARENA *Scratch_arena;
+
+/*
+ * Counts of things that are interesting for performance, for the -T report
+ * (see phase.c). They are indexed by the ST_* values.
+ */
+long Stat_count[NUMSTATS];
+
 /*
  * From the beginning of the placement phase (considered to be transgroups(),
  * although you could argue that real placement doesn't begin until setnotes()),
@@ -83,6 +83,8 @@ static struct BLOCKHEAD *Currblock_p;	/* current block, if non-zero */
 
 static struct INPCOORD *Curr_loc_info_p; /* location info being collected */
 static struct USER_SYMBOL *Curr_usym_p;	/* user-defined symbol being defined */
+static UINT32B Contexts_used;		/* every context that has been ended,
+					 * for write_snapshot() */
 
 
 static short Saw_restoreparms;		/* Yes if we have seen a restoreparms
@@ -4526,11 +4528,7 @@ mark:	mark_item
 		/* if too many items, get some more space */
 		if (Item_count >= Max_items) {
 			Max_items += ITEMS;
-			if ((Curr_marklist = (struct WITH_ITEM *) realloc(Curr_marklist,
-						Max_items * sizeof(struct WITH_ITEM)))
-						==  0) {
-				l_no_mem(__FILE__, __LINE__);
-			}
+			REALLOC(WITH_ITEM, Curr_marklist, Max_items);
 		}
 		Curr_marklist[Item_count].string = $1;
 		Curr_marklist[Item_count].place = PL_UNKNOWN;
@@ -5054,7 +5052,7 @@ extra_item:
 				 * already be allocated if user specified
 				 * more than one tag. */
 				if (Curr_grpsyl_p->restc == 0) {
-					MALLOCA(float, Curr_grpsyl_p->restc, NUMCTYPE);
+					Curr_grpsyl_p->restc = new_coords();
 				}
 				addsym($2, Curr_grpsyl_p->restc, CT_NOTE);
 				break;
@@ -8136,6 +8134,8 @@ end_prev_context()
 	 * the right value if that assumption is wrong */
 	place_p = Mainlltc_p;
 
+	Contexts_used |= Context;
+
 	/* If current main list item hasn't been added to list yet,
 	 * do that now. */
 	if (Currstruct_p != (struct MAINLL *) 0 && Currstruct_p != place_p) {
@@ -8220,6 +8220,66 @@ end_prev_context()
 }
 
 
+/* For writing a snapshot of what has been parsed, return the main list
+ * struct of the current context's SSV, or null if it isn't an SSV context.
+ * Unlike the other SSVs, this one isn't on the main list or applied yet,
+ * since its context hasn't ended. The contexts that were used, including
+ * the current one, are returned via contexts_p. multiple_p is set to YES
+ * if the current context is for more than one staff or voice, since
+ * resume_context() can't carry on in a context like that. */
+
+struct MAINLL *
+snapshot_context(contexts_p, multiple_p)
+
+UINT32B *contexts_p;
+int *multiple_p;
+
+{
+	struct SVRANGELIST *svr_p;
+	struct RANGELIST *r_p;
+
+
+	*contexts_p = Contexts_used | Context;
+	*multiple_p = NO;
+	if (Currstruct_p == (struct MAINLL *) 0 || Currstruct_p->str != S_SSV
+				|| Currstruct_p == Mainlltc_p) {
+		return((struct MAINLL *) 0);
+	}
+
+	if ((svr_p = Svrangelist_p) != (struct SVRANGELIST *) 0) {
+		if (svr_p->next != (struct SVRANGELIST *) 0) {
+			*multiple_p = YES;
+		}
+		if ((r_p = svr_p->stafflist_p) != (struct RANGELIST *) 0
+				&& (r_p->next != (struct RANGELIST *) 0
+				|| r_p->begin != r_p->end)) {
+			*multiple_p = YES;
+		}
+		if ((r_p = svr_p->vnolist_p) != (struct RANGELIST *) 0
+				&& (r_p->next != (struct RANGELIST *) 0
+				|| r_p->begin != r_p->end)) {
+			*multiple_p = YES;
+		}
+	}
+	return(Currstruct_p);
+}
+
+
+/* After loading a snapshot, carry on in the context its input ended in,
+ * with the SSV that snapshot_context() returned for it, if any. */
+
+void
+resume_context(context, mll_p)
+
+UINT32B context;
+struct MAINLL *mll_p;
+
+{
+	Context = context;
+	Currstruct_p = mll_p;
+}
+
+
 /* If user gave a list of staffs for a "staff" context, clone copies of
  * the SSV that we made for the first on the list for the rest of the list. */
 
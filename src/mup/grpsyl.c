@@ -519,7 +519,7 @@ int copy_acc_etc;	/* if YES, copy accidentals.  If just reusing a
 		}
 
 		/* alloc space for coordinates */
-		CALLOCA(float, new_p->notelist[n].c, NUMCTYPE);
+		new_p->notelist[n].c = new_coords();
 	}
 
 	/* if a note that was cloned had an accidental on it,
@@ -579,7 +579,8 @@ char *bendstring;		/* bend specification, or null if no bend */
 	index = grpsyl_p->nnotes;
 
 	/* allocate space for coordinates. The coordinates must be in a
-	 * malloc-ed array and not a static array. At one point, we thought
+	 * separately allocated array (from new_coords()) and not a static
+	 * array. At one point, we thought
 	 * we could save a few bytes by changing back to array, but that
 	 * would be a lot of work. The reason is that the
 	 * coordinates are pointed to whenever there is a location tag on a
@@ -594,7 +595,7 @@ char *bendstring;		/* bend specification, or null if no bend */
 	 * also require either going back to patch up any lines, curves, and
 	 * prints that used the coords, or delaying their definition by saving
 	 * lots of information around. */
-	CALLOCA(float, grpsyl_p->notelist[index].c, NUMCTYPE);
+	grpsyl_p->notelist[index].c = new_coords();
 
 	grpsyl_p->notelist [ index ].letter = (short) pitch;
 	COPY_ACCS(grpsyl_p->notelist [ index ].acclist, acclist);
@@ -2037,6 +2038,10 @@ int lineno;		/* input line number for error messages */
 			(vvpath(staffno, vno, WITHFAMILY))->withfamily,
 			(vvpath(staffno, vno, WITHSIZE))->withsize,
 			fname, lineno);
+		/* things like staccato dots are used over and over,
+		 * so share one copy of each */
+		gs_p->withlist[n].string =
+				intern_owned(gs_p->withlist[n].string);
 	}
 
 	for (n = 0; n < gs_p->nnotes; n++) {
@@ -2051,6 +2056,8 @@ int lineno;		/* input line number for error messages */
 				(vvpath(staffno, vno, NOTELEFTFAMILY))->noteleftfamily,
 				(vvpath(staffno, vno, NOTELEFTSIZE))->noteleftsize,
 				fname, lineno);
+			gs_p->notelist[n].noteleft_string = intern_owned(
+				gs_p->notelist[n].noteleft_string);
 		}
 	}
 
@@ -3103,7 +3110,7 @@ struct GRPSYL *gs_p;
 	for (n = 0; n < gs_p->nnotes; n++) {
 		/* free coordinate array, if any */
 		if (gs_p->notelist[n].c != (float *) 0) {
-			FREE(gs_p->notelist[n].c);
+			free_coords(gs_p->notelist[n].c);
 		}
 
 		/* free any slurto lists */
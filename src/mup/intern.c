@@ -0,0 +1,220 @@
+/*
+ Copyright (c) 1995-2024  by Arkkra Enterprises.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms,
+ with or without modification, are permitted provided that
+ the following conditions are met:
+
+ 1. Redistributions of source code must retain
+ the above copyright notice, this list of conditions
+ and the following DISCLAIMER.
+
+ 2. Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and
+ the following DISCLAIMER in the documentation and/or
+ other materials provided with the distribution.
+
+ 3. Any additions, deletions, or changes to the original files
+ must be clearly indicated in accompanying documentation,
+ including the reasons for the changes,
+ and the names of those who made the modifications.
+
+	DISCLAIMER
+
+ THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS
+ OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*
+ * Name:	intern.c
+ *
+ * Description:	This file contains functions for keeping a pool of
+ *		interned strings. Every distinct string that is interned
+ *		gets exactly one copy in the pool, so strings that are used
+ *		over and over, like input file names, or dynamics marks
+ *		and "with" list items, don't each need their own copy, and
+ *		two interned strings are equal if and only if their
+ *		pointers are equal.
+ *
+ *		Interned strings must never be changed, since they are
+ *		shared. They live in their own arena, which is never thrown
+ *		away, so it is harmless if code that doesn't know a string
+ *		is interned FREEs it: FREE of arena memory does nothing,
+ *		and the pool is arranged so that the last thing allocated
+ *		in its arena is never a string.
+ */
+
+#include <string.h>
+#include "defines.h"
+#include "structs.h"
+#include "globals.h"
+
+/* initial number of hash buckets; must be a power of 2. The table is
+ * doubled whenever there get to be more strings than buckets. */
+#define INTERN_BUCKETS	(1024)
+
+/* one string in the pool */
+struct INTERNED {
+	char *str;		/* the one copy of the string */
+	unsigned long hash;	/* hash of str */
+	struct INTERNED *next;	/* for hash collision list */
+};
+
+static struct ARENA *Intern_arena;
+static struct INTERNED **Intern_table;
+static long Intern_buckets;	/* how many slots in Intern_table */
+static long Num_interned;	/* how many strings are in the pool */
+
+static unsigned long hashstr P((char *str));
+static void grow_intern_table P((void));
+
+
+/* Return the pool's copy of the given string, adding it to the pool if it
+ * isn't there yet. The given string is not changed or freed. */
+
+char *
+intern(str)
+
+char *str;
+
+{
+	unsigned long hash;
+	struct INTERNED *int_p;
+	struct ARENA *old_arena_p;
+	char *copy;
+
+
+	if (str == (char *) 0) {
+		return((char *) 0);
+	}
+
+	hash = hashstr(str);
+	if (Intern_table != (struct INTERNED **) 0) {
+		for (int_p = Intern_table[hash & (Intern_buckets - 1)];
+				int_p != (struct INTERNED *) 0;
+				int_p = int_p->next) {
+			if (int_p->hash == hash && (int_p->str == str
+					|| strcmp(int_p->str, str) == 0)) {
+				Stat_count[ST_INTERNSHARED]++;
+				return(int_p->str);
+			}
+		}
+	}
+
+	if (Num_interned >= Intern_buckets) {
+		grow_intern_table();
+	}
+
+	/* Make the copy, and then the INTERNED that points to it. Doing it
+	 * in this order means a string is never the last thing in the arena,
+	 * so a stray FREE of it can't give its space back. */
+	if (Intern_arena == (struct ARENA *) 0) {
+		Intern_arena = new_arena("intern", INTERN_ARENA_CHUNK);
+	}
+	old_arena_p = set_arena(Intern_arena);
+	MALLOCA(char, copy, strlen(str) + 1);
+	(void) strcpy(copy, str);
+	MALLOC(INTERNED, int_p, 1);
+	(void) set_arena(old_arena_p);
+
+	int_p->str = copy;
+	int_p->hash = hash;
+	int_p->next = Intern_table[hash & (Intern_buckets - 1)];
+	Intern_table[hash & (Intern_buckets - 1)] = int_p;
+	Num_interned++;
+
+	return(copy);
+}
+
+
+/* Like intern(), but for a malloc-ed string that the caller is done with.
+ * Unless the string was already the interned copy, it is freed.
+ * This makes it easy to replace a string by its interned copy:
+ *	str_p = intern_owned(str_p);
+ */
+
+char *
+intern_owned(str)
+
+char *str;
+
+{
+	char *interned;
+
+
+	if ((interned = intern(str)) != str) {
+		FREE(str);
+	}
+	return(interned);
+}
+
+
+/* Hash a string, in a way that gives different results for strings
+ * that differ only in their font and size bytes. */
+
+static unsigned long
+hashstr(str)
+
+char *str;
+
+{
+	unsigned long hash;
+
+	for (hash = 5381; *str != '\0'; str++) {
+		hash = hash * 33 + (*str & 0xff);
+	}
+	return(hash);
+}
+
+
+/* Make the hash table bigger (or create it the first time), and move
+ * all the strings into their new buckets. */
+
+static void
+grow_intern_table()
+
+{
+	struct INTERNED **new_table;
+	struct INTERNED *int_p;
+	struct INTERNED *next_p;
+	struct ARENA *old_arena_p;
+	long new_buckets;
+	long b;
+
+
+	new_buckets = (Intern_buckets == 0 ? INTERN_BUCKETS
+						: Intern_buckets * 2);
+
+	/* The table itself is on the heap, since old ones get freed */
+	old_arena_p = set_arena((struct ARENA *) 0);
+	CALLOCA(struct INTERNED *, new_table, new_buckets);
+	(void) set_arena(old_arena_p);
+
+	for (b = 0; b < Intern_buckets; b++) {
+		for (int_p = Intern_table[b]; int_p != (struct INTERNED *) 0;
+							int_p = next_p) {
+			next_p = int_p->next;
+			int_p->next = new_table[int_p->hash & (new_buckets - 1)];
+			new_table[int_p->hash & (new_buckets - 1)] = int_p;
+		}
+	}
+	if (Intern_table != (struct INTERNED **) 0) {
+		FREE(Intern_table);
+	}
+	Intern_table = new_table;
+	Intern_buckets = new_buckets;
+}
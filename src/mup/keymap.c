@@ -69,14 +69,17 @@
  * that kind of font. So while the character code
  * for something in one of the extended fonts or the music
  * font might be the same as the code for "a" in the base ASCII fonts,
- * a mapping of an "a" would not affect that. To deal with this, the patterns,
- * replacements, and target strings to be matched against patterns are put
- * into a normalized internal format, which consists of a STR_FONT followed
+ * a mapping of an "a" would not affect that. To deal with this, the patterns
+ * and replacements are put into a normalized internal format,
+ * which consists of a STR_FONT followed
  * by a "character set" number that masked out the irrelevances in the font,
  * and then the character codes. So a pattern or replacement of "a" would be
  *   STR_FONT FONT_TR a
  * but would match an "a" string in all the base fonts FONT_TR through
- * FONT_PX. 
+ * FONT_PX. Target strings to be matched against patterns are normalized
+ * the same way, a byte at a time, as they are run through a trie
+ * compiled from the patterns of a map, which finds the longest pattern
+ * that matches at each place in the string.
  *
  * Typically we expect both patterns and  replacements
  * to be one character long each, but allow either or both
@@ -106,17 +109,21 @@
  */
 #define MAP_CHUNK	80
 
-/* We have three normalized string types: patterns to be matched,
- * replacements strings for when those patterns are matched,
- * and strings that are candidate to be matched by some pattern. */
+/* We have two normalized string types: patterns to be matched,
+ * and replacements strings for when those patterns are matched. */
 #define NST_PATTERN		1
 #define NST_REPLACEMENT		2
-#define	NST_MATCH_CANDIDATE	3
 
-/* We sort of "hash" on the code of the first character of a normalized
- * string to get an index into a table that tells us where patterns
- * starting with that start in the map */
-#define FIRST_CODE_INDEX(nstring) (nstring[2] - FIRST_CHAR)
+/* Trie state 0 is a dead end, with no transitions out of it, so that
+ * once there, we know nothing can match. State 1 is where we start. */
+#define TRIE_DEAD	0
+#define TRIE_START	1
+
+/* Get the next state in a keymap's trie, given a state and a byte of
+ * normalized string */
+#define TRIE_NEXT(map_p, state, byte) \
+	((map_p)->trie[(state) * ((map_p)->numclasses + 1) \
+	+ (map_p)->byteclass[(byte) & 0xff]])
 
 /* Define how many keymaps there can be.
  * Since entry 0 is used for "no mapping," we add one
@@ -143,11 +150,6 @@ static int Num_keymaps = 0;
  * so that the yacc code doesn't have to constantly pass it back to us. */
 static int Curr_keymap;
 
-/* When chopping up a string into substrings that might need to be mapped,
- * no need to make a candidate substring any longer than the longest pattern,
- * so this keeps track of how long that is. */
-static int Longest_pattern = 0;
-
 /* We want to use a 1-byte "handle" as argument to STR_KEYMAP, but it can't
  * be a zero, because that would be a string terminator. Since zero is a
  * valid index, we adjust for that. Note that the parentheses around the h
@@ -158,15 +160,10 @@ static int Longest_pattern = 0;
 /* declarations of static functions */
 static void init_keymaps P((void));
 static int charset P((int font));
-#ifdef __STDC__
-static int comp_keymap P((const void *item1_p, const void *item2_p));
-#else
-static int comp_keymap P((char *item1_p, char *item2_p));
-#endif
 static char *normalize P((char *str, int currfont, int nstrtype));
 static char *unnormalize P((char *str, int currfont));
-static int match P((char *candidate, int cand_len, char *pattern, int pat_len));
-static char *find_match P((char *candidate, struct KEYMAP *map_p, int *used_p));
+static char *find_match P((char *str, int currfont, struct KEYMAP *map_p,
+		int *used_p));
 static char *map_string P((char *str, struct KEYMAP *map_p, char *fname, int linenum));
 static struct KEYMAP *kpvp_map P((int staffno, int param));
 static void map_bar P((struct BAR *bar_p, char *fname, int linenum));
@@ -207,8 +204,10 @@ char *name;	/* Map name provided by user */
 			FREE(Maplist_p[m].map_p);
 			Maplist_p[m].map_p = 0;
 			Maplist_p[m].entries = 0;
-			/* Note that the code_index array is not used
-			 * until mapping time, so we can ignore it here. */
+			if (Maplist_p[m].is_compiled == YES) {
+				FREE(Maplist_p[m].trie);
+				FREE(Maplist_p[m].trie_match);
+			}
 			break;
 		}
 	}
@@ -232,7 +231,7 @@ char *name;	/* Map name provided by user */
 	Curr_keymap = m;
 
 	Maplist_p[m].entries = 0;
-	Maplist_p[m].is_sorted = NO;
+	Maplist_p[m].is_compiled = NO;
 }
 
 
@@ -293,13 +292,6 @@ char *replacement;		/* what to replace the pattern with */
 					NST_REPLACEMENT);
 	entry_p->rep_len = strlen(entry_p->replacement);
 
-	/* If this pattern is longer than any we'd seen before,
-	 * make a note of that. Knowing the longest lets us optimize
-	 * how much to attempt to match. */
-	if (entry_p->pat_len > Longest_pattern) {
-		Longest_pattern = entry_p->pat_len;
-	}
-
 	/* Check for duplicate of something we already had. Might be nice
 	 * to check earlier, but seemed easier to check here, and not worth
 	 * optimizing for something that should be rare. */
@@ -386,6 +378,12 @@ map_all_strings()
 						kpvp_map(mll_p->u.staff_p->staffno, TEXTKEYMAP),
 						mll_p->inputfile,
 						mll_p->inputlineno);
+					/* text was interned during parse, so
+					 * intern what it was mapped to */
+					if (IS_TEXT(stuff_p->stuff_type)) {
+						stuff_p->string = intern_owned(
+							stuff_p->string);
+					}
 				}
 			}
 
@@ -408,19 +406,21 @@ map_all_strings()
 			for (v = 0; v < MAXVOICES; v++) {
 				for (gs_p = mll_p->u.staff_p->groups_p[v]; gs_p != 0; gs_p = gs_p->next) {
 					for (w = 0; w < gs_p->nwith; w++) {
-						gs_p->withlist[w].string = map_string(
+						gs_p->withlist[w].string = intern_owned(
+							map_string(
 							gs_p->withlist[w].string,
 							map_p,
 							gs_p->inputfile,
-							gs_p->inputlineno);
+							gs_p->inputlineno));
 					}
 					for (n = 0; n < gs_p->nnotes; n++) {
 						if (gs_p->notelist[n].noteleft_string != 0) {
-							gs_p->notelist[n].noteleft_string = map_string(
+							gs_p->notelist[n].noteleft_string = intern_owned(
+							    map_string(
 							    gs_p->notelist[n].noteleft_string,
 							    map_p,
 							    gs_p->inputfile,
-							    gs_p->inputlineno);
+							    gs_p->inputlineno));
 						}
 					}
 				}
@@ -514,6 +514,9 @@ map_all_strings()
 			break;
 		}
 	}
+
+	/* Any SSV checkpoints saved during parse have the unmapped labels */
+	discard_ssv_ckpts();
 }
 
 
@@ -533,6 +536,7 @@ init_keymaps()
 		Maplist_p[0].name = "";
 		Maplist_p[0].map_p = 0;
 		Maplist_p[0].entries = 0;
+		Maplist_p[0].is_compiled = NO;
 		Num_keymaps++;
 	}
 }
@@ -641,57 +645,6 @@ int font;	/* like FONT_TR, FONT_HX, FONT_ZD1, or FONT_MUSIC,
 }
 
 
-/* This is sort of like strcmp, except for KEYMAP_ENTRYs rather than strings,
- * and can be used as a comparision function for qsorting a KEYMAP_ENTRY array.
- * It returns negative, zero, or positive, based on whether the first
- * argument goes before the second, they are equal, or it goes after. */
-
-static int
-comp_keymap(item1_p, item2_p)
-
-#ifdef __STDC__
-const void *item1_p;
-const void *item2_p;
-#else
-char *item1_p;
-char *item2_p;
-#endif
-
-{
-	int complength;	/* how many bytes to compare */
-	int comp;	/* result of a strncmp comparison */
-	struct KEYMAP_ENTRY *entry1_p;
-	struct KEYMAP_ENTRY *entry2_p;
-
-
-	/* Cast the opaque generic types to what args really are */
-	entry1_p = (struct KEYMAP_ENTRY *) item1_p;
-	entry2_p = (struct KEYMAP_ENTRY *) item2_p;
-
-	/* If they are the same length, we can do a simple strncmp */
-	if (entry1_p->pat_len == entry2_p->pat_len) {
-		return(strncmp(entry1_p->pattern, entry2_p->pattern,
-			entry1_p->pat_len));
-	}
-
-	complength = MIN(entry1_p->pat_len, entry2_p->pat_len);
-	if ((comp = strncmp(entry1_p->pattern, entry2_p->pattern, complength))
-							 != 0) {
-		/* They differed within their common length. */
-		return(comp);
-	}
-
-	/* Their common length was the same. Put longer before shorter,
-	 * because we want longest matches. */
-	if (entry1_p->pat_len > entry2_p->pat_len) {
-		return(-1);
-	}
-	else {
-		return(1);
-	}
-}
-
-
 /* Given a string and its current font, put it in a normalized form that
  * removes the distinctions between rom/bold/ital/boldital and between
  * font families. Each STR_FONT argument is effectively replaced with
@@ -713,7 +666,7 @@ char *str;	/* What to normalize */
 int currfont;	/* The font when at the beginning of str (str can be in
 		 * the middle of a longer string so we can't use the
 		 * first byte) */
-int nstrtype;	/* NST_PATTERN, NST_REPLACEMENT, or NST_MATCH_CANDIDATE */
+int nstrtype;	/* NST_PATTERN or NST_REPLACEMENT */
 
 {
 	int length;		/* strlen(str) */
@@ -723,13 +676,8 @@ int nstrtype;	/* NST_PATTERN, NST_REPLACEMENT, or NST_MATCH_CANDIDATE */
 
 
 	/* Malloc space for normalized version.
-	 * If NST_MATCH_CANDIDATE, limit to length of longest pattern,
-	 * because we know we can't match more than that.
 	 * Add 3 for adding STR_FONT and character set value plus null terminator. */
 	length = strlen(str);
-	if (nstrtype == NST_MATCH_CANDIDATE && length > Longest_pattern) {
-		length = Longest_pattern;
-	}
 	MALLOCA(char, normalized, length + 3);
 
 	/* Set first two bytes of normalized to STR_FONT and the
@@ -832,95 +780,77 @@ int currfont;
 }
 
 
-/* This is vaguely like strncmp, but tells if the initial part of a
- * normalized candidate string matches a normalized pattern.
- * If they match, 0 is returned. If they don't match, but some future
- * pattern in a sorted list of pattern might match, it returns -1.
- * If it doesn't match, and it's already past any pattern in a sorted list
- * that could match, it returns 1. In the sorted list, patterns with
- * overlapping initial values must be sorting longest to shortest,
- * because we want to match the longest pattern.
- */
-
-static int
-match(candidate, cand_len, pattern, pat_len)
-
-char *candidate;	/* the string to try to match */
-int cand_len;		/* expected to be strlen(candidate) */
-char *pattern;		/* the pattern to check */
-int pat_len;		/* expected to be strlen(pattern) */
-
-{
-	if ((candidate[0] & 0xff) != STR_FONT
-					|| (pattern[0] & 0xff) != STR_FONT) {
-		pfatal("in match() normalized string doesn't start with font as expected; got 0x%x and 0x%x",
-					candidate[0] & 0xff, pattern[0] & 0xff);
-	}
-
-	/* The entire pattern must match (although the entire candidate does
-	 * not, just an initial substring), so if too short,
-	 * this is not a match. */
-	if (cand_len < pat_len) {
-		return(-1);
-	}
-
-	return (strncmp(pattern, candidate, pat_len));
-}
-
-
-/* Given a candidate string and a keymap, find the longest matching pattern 
- * in the map, if any. If found, return the replacement, else zero.
+/* Given a place in a string, the font in effect there, and a keymap,
+ * find the longest pattern in the map that matches there, if any.
+ * If found, return the replacement, else zero. The string is normalized
+ * (as normalize() would do) a byte at a time as we walk the trie, so there
+ * is no need to make a copy of it, and we can stop as soon as the trie
+ * says no longer pattern could match.
  */
 
 static char *
-find_match(candidate, keymap_p, used_p)
+find_match(str, currfont, keymap_p, used_p)
 
-char *candidate;		/* try to find something matching this... */
+char *str;			/* try to find something matching here... */
+int currfont;			/* the font at the beginning of str */
 struct KEYMAP *keymap_p;	/* ... in this keymap */
-int *used_p;			/* how many bytes of candidate matched is
+int *used_p;			/* how many bytes of str matched is
 				 * returned here */
 
 {
-	int index;		/* of pattern to try to match */
-	int result;		/* return code of match() */
-	int cand_length;	/* strlen(candidate) */
+	int state;		/* current state in the trie */
+	int matched;		/* index in map of longest match so far, or -1*/
+	int i;			/* index through str */
+	int ch;			/* one byte of str */
 
 
-	if (keymap_p == 0) {
+	if (keymap_p == 0 || keymap_p->entries == 0) {
 		return(0);
 	}
 
 	*used_p = 0;
+	matched = -1;
 
-	/* Based on the first character code of the candidate string,
-	 * we look up the index of the first entry in the map that starts
-	 * with that code. */
-	if ((index = keymap_p->code_index[FIRST_CODE_INDEX(candidate)]) < 0) {
-		/* No patterns exist that start like the candidate string
-		 * so can't be any patterns that match */
-		return(0);
-	}
+	/* Like normalized strings, start with the character set */
+	state = TRIE_NEXT(keymap_p, TRIE_START, STR_FONT);
+	state = TRIE_NEXT(keymap_p, state, charset(currfont));
 
-	for (cand_length = strlen(candidate); cand_length > 0; cand_length--) {
-		for (    ; index < keymap_p->entries; index++) {
-			result = match(candidate, cand_length,
-					keymap_p->map_p[index].pattern,
-					keymap_p->map_p[index].pat_len);
-			if (result == 0) {
-				/* subtract off the leading STR_FONT */
-				*used_p = keymap_p->map_p[index].pat_len - 2;
-				return(keymap_p->map_p[index].replacement);
+	for (i = 0; state != TRIE_DEAD && str[i] != '\0'; ) {
+		ch = str[i] & 0xff;
+		if (IS_STR_COMMAND(ch)) {
+			/* Same rules as in normalize(): font changes become
+			 * character set changes, and any other STR_* besides
+			 * the music and user defined ones ends the string. */
+			if (ch == STR_FONT) {
+				state = TRIE_NEXT(keymap_p, state, STR_FONT);
+				state = TRIE_NEXT(keymap_p, state,
+							charset(str[i+1]));
+			}
+			else if (ch == STR_MUS_CHAR || ch == STR_MUS_CHAR2
+						|| ch == STR_USERDEF1) {
+				state = TRIE_NEXT(keymap_p, state, ch);
+				state = TRIE_NEXT(keymap_p, state, str[i+1]);
 			}
-			else if (result > 0) {
-				/* give up on inner loop. Outer loop
-				 * may then try a shorter pattern. */
+			else {
 				break;
 			}
+			i += 2;
+		}
+		else {
+			state = TRIE_NEXT(keymap_p, state, ch);
+			i++;
+		}
+
+		/* If a pattern ends here, it is the longest so far */
+		if (keymap_p->trie_match[state] >= 0) {
+			matched = keymap_p->trie_match[state];
+			*used_p = i;
 		}
 	}
-	return(0);
+
+	return(matched >= 0 ? keymap_p->map_p[matched].replacement : 0);
 }
-
+
 
 /* Do key mapping of given string using given map.
  * The mapped string is returned. It will be the original str if no mapping
@@ -937,8 +867,6 @@ int linenum;			/* input line number, for error messages */
 
 {
 	int curr_font;
-	char *segment;		/* piece of str that is a candidate
-				 * for maybe being replaced */
 	char *replacement;	/* normalized replacement */
 	char *realrep;		/* unnormalized replacement */
 	int rep_len;		/* length of realrep */
@@ -984,12 +912,12 @@ int linenum;			/* input line number, for error messages */
 	result[1] = str[1];
 	r = 2;
 
-	/* Chop string into normalized potential matches */
+	/* Look for a pattern to replace at each place in the string */
 	for (s = 2; str[s] != '\0'; s += used) {
-		segment = normalize(str + s, curr_font, NST_MATCH_CANDIDATE);
 
 		/* If there is a match, get the normalized replacement */
-		if ((replacement = find_match(segment, map_p, &used)) != 0) {
+		if ((replacement = find_match(str + s, curr_font, map_p, &used))
+								!= 0) {
 
 			/* This is to be mapped, so get the replacement
 			 * that is unnormalized to account for the
@@ -1114,7 +1042,6 @@ int linenum;			/* input line number, for error messages */
 				break;
 			}
 		}
-		FREE(segment);
 	}
 
 	if (mapped_something == YES) {
@@ -1221,61 +1148,82 @@ int linenum;			/* input line number, for error messages */
 }
 
 
-/* Go through all the key maps. For each, sort the entries. Then make an
- * index of the first entries starting with each code, for quick lookup.
+/* Go through all the key maps. For each, compile the patterns into a trie,
+ * so that map_string() can find the longest pattern matching at any place
+ * in a string by walking the string once.
  */
 
 static void
 prepare_maps_for_searching()
 
 {
+	struct KEYMAP *keymap_p;	/* map being compiled */
+	char *pattern;			/* pattern being added to the trie */
 	int m;		/* index through maps */
-	int i;		/* index through code_index */
 	int e;		/* index through map entries */
-	int startchar_index;	/* index of entry in map of the first entry
-				 * starting with a given code */
+	int i;		/* index through pattern */
+	int ch;		/* one byte of pattern */
+	int maxstates;	/* states needed if no patterns share a prefix */
+	int numstates;	/* states used so far */
+	int state;	/* current state while adding a pattern */
+	int *next_p;	/* transition being followed or set */
 
 	for (m = 0; m < Num_keymaps; m++) {
 
-		if (Maplist_p[m].is_sorted == YES) {
+		keymap_p = &(Maplist_p[m]);
+		if (keymap_p->is_compiled == YES) {
 			/* already handled earlier on some previous call */
 			continue;
 		}
 
-		qsort(Maplist_p[m].map_p, Maplist_p[m].entries,
-				sizeof(struct KEYMAP_ENTRY), comp_keymap);
-		/* For each character that has patterns that start with it,
-		 * save the index to the first such pattern, so we can
-		 * jump immediately to the first possible match. 
-		 * First init all slot to negative value to mark as unused. */
-		for (i = 0; i < MAX_CHARS_IN_FONT; i++) {
-			Maplist_p[m].code_index[i] = -1;
+		/* Give a column of the transition table to each byte value
+		 * used in any pattern, and count how many states there
+		 * could be: the dead end, the start, and one per byte. */
+		memset(keymap_p->byteclass, 0, sizeof(keymap_p->byteclass));
+		keymap_p->numclasses = 0;
+		maxstates = 2;
+		for (e = 0; e < keymap_p->entries; e++) {
+			pattern = keymap_p->map_p[e].pattern;
+			for (i = 0; pattern[i] != '\0'; i++) {
+				ch = pattern[i] & 0xff;
+				if (keymap_p->byteclass[ch] == 0) {
+					keymap_p->byteclass[ch] =
+						++(keymap_p->numclasses);
+				}
+			}
+			maxstates += keymap_p->map_p[e].pat_len;
+		}
+
+		/* All transitions start out going to the dead end */
+		CALLOCA(int, keymap_p->trie,
+				maxstates * (keymap_p->numclasses + 1));
+		MALLOCA(int, keymap_p->trie_match, maxstates);
+		for (state = 0; state < maxstates; state++) {
+			keymap_p->trie_match[state] = -1;
 		}
-		for (e = 0; e < Maplist_p[m].entries; e++) {
-			/* The first two bytes of pattern will have been
-			 * normalized to STR_FONT and some character set,
-			 * so the code will be in byte [2] */
-			startchar_index = FIRST_CODE_INDEX(Maplist_p[m].map_p[e].pattern);
-			if (Maplist_p[m].code_index[startchar_index] < 0) {
-				/* Hadn't seen this code yet, so this is the
-				 * first entry for the code; save it. */
-				Maplist_p[m].code_index[startchar_index] = e;
+
+		/* Add each pattern, sharing states with any others
+		 * that start the same way. Duplicate patterns were
+		 * already weeded out when the map was built. */
+		numstates = 2;
+		for (e = 0; e < keymap_p->entries; e++) {
+			pattern = keymap_p->map_p[e].pattern;
+			state = TRIE_START;
+			for (i = 0; pattern[i] != '\0'; i++) {
+				next_p = &(TRIE_NEXT(keymap_p, state,
+							pattern[i]));
+				if (*next_p == TRIE_DEAD) {
+					*next_p = numstates++;
+				}
+				state = *next_p;
 			}
+			keymap_p->trie_match[state] = e;
 		}
-		Maplist_p[m].is_sorted = YES;
-
-		/* NOTE: It is likely we have more entries allocated than were
-		 * actually used, so we could potentially REALLOC them here
-		 * (if not somewhere else earlier).
-		 * But with current settings, it would be less than 1K
-		 * worst case on a 32-bit machine, 2K on 64-bit,
-		 * and frequently a lot less than worst case,
-		 * so probably not worth the effort. If KEYMAP_ENTRY and/or
-		 * MAX_KEYMAPS get a lot bigger, could reconsider.
-		 */
+
+		keymap_p->is_compiled = YES;
 	}
 }
-
+
 
 /* This gets called from parse phase to map strings that are in blocks.
  * They have to be done at that time, because it is kind of doing
@@ -40,9 +40,10 @@
 */
 
 /* This file contains functions to support Mup macros.
- * When a macro is defined, its text is copied to a file. When a macro is
- * invoked, information about the current input file is pushed on a stack,
- * and the macro text is read from the macro file. This file also has the
+ * When a macro is defined, its text is copied to an in-memory buffer.
+ * When a macro is invoked, information about the current input file is
+ * pushed on a stack, and the lexer is given a copy of the macro text
+ * to read from. This file also has the
  * code to handle include files. They are handled similarly. Info about the
  * current file is pushed on a stack, and text is read from the included
  * file. */
@@ -50,22 +51,30 @@
 #include <string.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <limits.h>
 #ifndef __DJGPP__
 #include <fenv.h>
 #endif
 #include "globals.h"
 
-#ifdef VMS
-#define unlink delete
-#endif
-
 /* size of macro name hash table. should be prime, big enough to not have too
  * many collisions, small enough to not use too much memory. */
 #define MTSIZE	(67)
 
+/* size of hash table of where include files were found. Should be prime. */
+#define INCTSIZE	(31)
+
+/* POSIX guarantees writes to a pipe of at least this much are atomic */
+#ifndef PIPE_BUF
+#define PIPE_BUF	(512)
+#endif
+
 /* how many bytes to allocate at a time when collecting macro arguments */
 #define MAC_ARG_SZ	(512)
 
+/* how many bytes to allocate at a time for storing macro text */
+#define MACBUFF_SZ	(16 * 1024)
+
 /* Maximum length of a macro name that is stitched together from
  * other macros. */
 #define MAX_CONCAT_NAME_LEN 1000
@@ -91,9 +100,9 @@ struct MACRO {
 	char	*filename;	/* file in which macro was defined */	
 	int	lineno;		/* line in file where macro definition began */
 	int	lineoffset;	/* how many lines we are into macro */
-	long	offset;		/* offset in macro temporary file where the
-				 * text of the macro is stored for later use */
-	long	quoted_offset;	/* offset into macro temp file where the
+	long	offset;		/* offset in Macbuff where the text
+				 * of the macro is stored for later use */
+	long	quoted_offset;	/* offset into Macbuff where the
 				 * quoted version is stored, if any. */
 	struct MACRO 	*next;	/* for hash collision list */
 	int	recursion;	/* incremented each time the macro is called,
@@ -113,6 +122,9 @@ struct MACRO {
 /* macro information hash table */
 static struct MACRO *Mactable[MTSIZE];
 
+/* what macros defined on the command line give as their file */
+static char Cmdline_filename[] = "Command line argument";
+
 /* This points to an array of pointers to saved macro hash tables.
  * Each time the user does savemacros, we realloc this array one bigger,
  * and create a new macro hash table.
@@ -126,23 +138,15 @@ static struct MACRO ***Saved_mac_tables;
  * Once it becomes nonzero, we don't do that, to be safe.  */
 static int Num_mac_tables;
 
-/* temporary file for saving text of macros. Need separate handles for reading
- * and writing */
-static FILE *Mactmp_read = (FILE *) 0;
-static FILE *Mactmp_write = (FILE *) 0;
-#ifdef UNIX_LIKE_FILES
-static char Macfile[] = "mupmacXXXXXX";		/* name of temp file */
-#else
-/* As last resort, we use a temp file name of 11 character length,
- * so make sure we have enough room for that. Usually L_tmpnam is
- * already longer than that, but better safe than core dump.
- */
-#if L_tmpnam < 12
-#undef L_tmpnam
-#define L_tmpnam 12
-#endif
-static char Macfile[L_tmpnam];		/* name of temp file */
-#endif
+/* Text of all macros, each terminated by a null. This is only ever
+ * appended to, never overwritten, so offsets into it stay valid
+ * for the life of the run, even when macros are redefined or undefined,
+ * which is what allows saved macro tables to be restored later.
+ * Macbuff_used is how many bytes are in use, Macbuff_size how many
+ * are allocated. */
+static char *Macbuff = (char *) 0;
+static long Macbuff_used = 0;
+static long Macbuff_size = 0;
 
 /* Some OSs require us to open files in binary mode. Most implementations
  * of fopen these days accept the 'b' suffix, even when they don't care
@@ -150,16 +154,8 @@ static char Macfile[L_tmpnam];		/* name of temp file */
  * binary mode defined. */
 #ifdef O_BINARY
 static char *Read_mode = "rb";
-#ifndef UNIX_LIKE_FILES
-static char *Write_mode = "wb";
-static char *Append_mode = "ab";
-#endif
 #else
 static char *Read_mode = "r";
-#ifndef UNIX_LIKE_FILES
-static char *Write_mode = "w";
-static char *Append_mode = "a";
-#endif
 #endif
 
 /* maximum number of files on file stack */
@@ -170,17 +166,20 @@ static char *Append_mode = "a";
 #define FOPEN_MAX	(20)
 #endif
 #endif
-/* The -5 is to account for stdin, stdout, stderr, and the 2 tmp file handles.
+/* The -3 is to account for stdin, stdout, and stderr.
  * The +20 is to allow for nested macros. They can take 2 stack slots per call
- * since argument expansion also uses a slot, but they don't take extra
- * file descriptors, since all the macros are kept in one file. */
-#define MAXFSTK	(FOPEN_MAX - 5 + 20)
+ * since argument expansion also uses a slot, but they don't take
+ * file descriptors, since all the macros are kept in memory. */
+#define MAXFSTK	(FOPEN_MAX - 3 + 20)
 
 
 struct FILESTACK {
 	FILE	*file;
 	char	*filename;
 	long	fileoffset;		/* fseek position in file */
+	long	macoffset;		/* if pushing because of a macro call,
+					 * where in Macbuff the lexer will
+					 * read the next text of the macro */
 	int	lineno;			/* where we are in the file */
 	int	lineno_inc;		/* saved Lineno_increment */
 	struct MACRO	*mac_p;		/* if pushing because of a macro call,
@@ -190,6 +189,26 @@ struct FILESTACK {
 
 static struct FILESTACK Filestack[MAXFSTK];
 
+/* Where include files have been found, so that including the same file
+ * again doesn't have to go through the MUPPATH and suffix search again.
+ * Where a name is found depends on the directory of the including file,
+ * the current directory, and $MUPPATH, so all of those are in the key.
+ * With --batch and --serve, each job tells the parent process what it
+ * found (see report_incpaths() and learn_incpaths()), so that jobs
+ * started after it already know where to look. */
+struct INCPATH {
+	char	*name;			/* name as given */
+	char	*includer_dir;		/* directory of file including it */
+	char	*cwd;			/* current directory */
+	char	*muppath;		/* $MUPPATH, or 0 if not set */
+	char	*path;			/* where the file was found */
+	struct INCPATH	*next;		/* for hash collision list */
+};
+static struct INCPATH *Incpath_table[INCTSIZE];
+
+/* If not -1, newly found include files are written here for the parent */
+static int Incpath_fd = -1;
+
 static int Fstkptr = -1;		/* stack pointer for Filestack */
 static char quote_designator[] = "`";
 /* We save information about an "eval" expression in a temporary macro
@@ -199,15 +218,19 @@ static struct MACRO Curr_expr_macro;
 /* This is the final result of current "eval" expression */
 extern struct VALUE Expr_result;
 
-extern int unlink();			/* to remove temp file */
-extern char *tmpnam();		/* generate temp file name */
-
 /* static function declarations */
 static void pushfile P((FILE *file, char *filename, int lineno,
-		struct MACRO *mac_p));
+		struct MACRO *mac_p, long macoffset));
 static int macro_call P((char *macname));
 static char *path_combiner P((char *prefix));
 static FILE * find_relative_file P((char **filename_p));
+static int includer_dir_length P((void));
+static struct INCPATH *find_incpath P((char *name, char *includer_dir,
+		int dirlen, char *cwd, char *muppath));
+static void add_incpath P((char *name, char *includer_dir, int dirlen,
+		char *cwd, char *muppath, char *path));
+static void save_incpath P((char *name, int dirlen, char *cwd,
+		char *muppath, char *path));
 static FILE *find_with_suffix P((char **filename_p, char *searchpath,
 		char *path_separator));
 static int is_absolute_path P((char *filename));
@@ -216,6 +239,7 @@ static int hashmac P(( char *macname));
 static struct MACRO *setup_macro P((char *macname, int has_params, int expr_state));
 static void prepare_mac_write P((struct MACRO *mac_p));
 static void finish_mac_write P((void));
+static void add2macro_str P((char *str));
 static void begin_macro_read P((struct MACRO *mac_p, char *macname));
 static void free_parameters P((struct MAC_PARAM *param_p, char *macname,
 		int values_only));
@@ -223,12 +247,13 @@ static char *mkmacparm_name P((char *macname, char *param_name));
 static struct MACRO *resolve_mac_name P((char *macname));
 static int has_quote_designator P((char *macname));
 static void clone_mac_table P((struct MACRO **src_tbl, struct MACRO **dest_tbl));
+static int is_cmdline_macro P((struct MACRO *mac_p));
 static void stringify P((struct MACRO *mac_p));
 
 
 
 
-/* add macro name to hash table and arrange to save its text in temp file */
+/* add macro name to hash table and arrange to save its text in Macbuff */
 
 void
 define_macro(macname, is_expression)
@@ -267,23 +292,23 @@ int is_expression;	/* YES if is expression to be evaluated */
 		get_parameters(mac_name);
 	}
 
-	/* Copy the macro text to the macro temp file. We used to use the
+	/* Copy the macro text to the macro buffer. We used to use the
 	 * return value to decide whether to skip saving a quoted
 	 * copy of the parameter when it is called, as a optimization.
 	 * But it turned out that the optimization could be fooled into
 	 * being used when it shouldn't be, namely by passing to another
 	 * macro which then wanted quoting. Now we create a quoted copy
 	 * when we discover we actually need it. */
-	(void) save_macro(Mactmp_write);
+	(void) save_macro();
 
 	if (is_expression == YES) {
 		/* Add special terminator to signal lex */
-		fputs(":=:", Mactmp_write);
+		add2macro_str(":=:");
 	}
 
-	/* terminate the macro with a NULL, so that when lex hits it when
-	 * the macro is called, it will think it hit EOF */
-	putc('\0', Mactmp_write);
+	/* terminate the macro with a NULL, which marks where the text
+	 * to give to lex ends when the macro is called */
+	add2macro('\0');
 
 	finish_mac_write();
 
@@ -294,8 +319,7 @@ int is_expression;	/* YES if is expression to be evaluated */
 }
 
 
-/* save macro info in hash table and make sure macro temporary file is
- * set up and ready to use */
+/* save macro info in hash table and note where its text will be stored */
 
 static struct MACRO *
 setup_macro(macname, has_params, expr_state)
@@ -369,125 +393,62 @@ prepare_mac_write(mac_p)
 struct MACRO *mac_p;
 
 {
-	static int have_mac_file = NO;
-#ifdef UNIX_LIKE_FILES
-	int filedesc;		/* of tmp file for storing macros */
-#endif
-
-	/* if we don't yet have a temp file to store macro info, open one */
-	if (have_mac_file == NO) {
-		/* We need separate read/write file pointers in case of defining
-		 * one macro inside another, so can't easily use tmpfile().
-		 * The most straightforward way to do this is to use tmpnam.
-		 * But recent versions of gcc complain loudly that tmpnam
-		 * is dangerous--you should use mkstemp instead. While it's
-		 * true tmpnam could have problems under certain conditions,
-		 * Mup's use of it hardly qualifies as "dangerous." Yes,
-		 * perhaps if you tried really hard by running lots and
-		 * lots of instances of Mup simultaneously, and they all
-		 * used macros, maybe you could get one of them to fail once
-		 * in a while. But some systems may not support mkstemp,
-		 * since it's more from BSD than System V, and it's unclear
-		 * how it ought to function on a system that has DOS-style
-		 * (8.3 character) filenames if you gave it a longer string
-		 * than would be a legal file name.
-		 * And, interestingly, the Solaris manual pages say
-		 * that you should NOT use mkstemp, in direct conflict with
-		 * gcc's opinion. They say to use tmpfile, which we can't do
-		 * because that just gives a single file pointer for writing,
-		 * but we want one for writing and one for reading.
-		 * So it's very unclear what to do. For unix-ish systems
-		 * we'll go with mkstemp, and for others use tmpnam.
-		 * We get a temp file name, open it twice, once for writing,
-		 * once for reading, then remove the file. This will make it a
- 		 * hidden file that will disappear when the 2 file pointers
-		 * are closed.
-		 */
-#ifdef UNIX_LIKE_FILES
-		if ((filedesc = mkstemp(Macfile)) < 0) {
-			ufatal("can't create temporary file for macro storage (possibly you don't have write permissions on directory/file?)");
-		}
-		if ((Mactmp_write = fdopen(filedesc, "w")) == (FILE *) 0) {
-			pfatal("can't fdopen temporary file for macro storage");
-		}
-		if ((Mactmp_read = fopen(Macfile, "r")) == (FILE *) 0) {
-			pfatal("can't open temporary file for reading macro");
-		}
-
-		/* arrange for file to vanish */
-		(void) unlink(Macfile);
-#else
-		/* On non-UNIX systems, unlinking an open file may not have
-		 * the desired effect, and some systems don't properly
-		 * handle both a read and write FILE * on the same file.
-		 * So for those we just create it here and have to open
-		 * and close the file each time. */
-		(void) tmpnam(Macfile);
-		if ((Mactmp_write = fopen(Macfile, Write_mode)) == (FILE *) 0) {
-			/* If tmpnam isn't implemented or fails,
-			 * try a hard-coded temp name and hope
-			 * for the best... */
-			(void) strcpy(Macfile, "MupMacF.tmp");
-			if ((Mactmp_write = fopen(Macfile, Write_mode))
-							== (FILE *) 0) {
-				ufatal("can't open temporary file for macro storage (possibly you don't have write permissions on directory/file?)");
-			}
-		}
-#endif
-		have_mac_file = YES;
-	}
-#ifndef UNIX_LIKE_FILES
-	else {
-		if ((Mactmp_write = fopen(Macfile, Append_mode)) == (FILE *) 0) {
-			pfatal("can't open temporary file for macro storage (maybe out of memory?)");
-		}
-	}
-#endif
-	/* make sure we're at the end. Now that we have separate read/write
-	 * file pointers, this should be unnecessary. However, on one non-UNIX
-	 * system is seemed the opening for append didn't really work,
-	 * requiring this fseek to actually go to the end. And in a previous
-	 * variation of this code, this fseek was needed for the UNIX way too.
-	 * In any case, it doesn't hurt to be sure we are where we want to be. */
-	if (fseek(Mactmp_write, 0L, SEEK_END) != 0) {
-		pfatal("fseek failed in setup_macro");
-	}
-
-	/* keep track of where this macro will begin in the temp file */
-	mac_p->offset = ftell(Mactmp_write);
+	/* keep track of where this macro will begin in Macbuff */
+	mac_p->offset = Macbuff_used;
 	/* We may make a quoted copy of it later, but only if needed */
 	mac_p->quoted_offset = 0;
 }
 
+/* Called when done writing the text of a macro. Since the text is
+ * kept in memory, there is nothing to flush, but we make sure the text
+ * got properly terminated, since everything that reads it relies on that. */
 
 static void
 finish_mac_write()
 
 {
-	(void) fflush(Mactmp_write);
-#ifndef UNIX_LIKE_FILES
-	fclose(Mactmp_write);
-#endif
+	if (Macbuff_used == 0 || Macbuff[Macbuff_used - 1] != '\0') {
+		pfatal("macro text not terminated");
+	}
 }
 
-
-#ifndef UNIX_LIKE_FILES
-/* on non-unix systems, unlinking an open file may produce undesired results,
- * so clean up the macro temp file after parsing is done. Unfortunately,
- * this leave a higher possibility of leaving an orphan temp file. */
+/* Add a character to the end of the macro text buffer,
+ * growing the buffer if necessary. */
 
 void
-mac_cleanup()
+add2macro(c)
+
+int c;
 
 {
-	if (Macfile[0] != '\0') {
-		unlink(Macfile);
+	if (Macbuff_used >= Macbuff_size) {
+		if (Macbuff_size == 0) {
+			Macbuff_size = MACBUFF_SZ;
+			MALLOCA(char, Macbuff, Macbuff_size);
+		}
+		else {
+			/* Double the size, so that even if there
+			 * are a lot of macros, we don't realloc too often */
+			Macbuff_size *= 2;
+			REALLOCA(char, Macbuff, Macbuff_size);
+		}
 	}
-	Macfile[0] =  '\0';
+	Macbuff[Macbuff_used++] = (char) c;
 }
-#endif
 
+/* Add a string (not including its null) to the macro text buffer */
 
+static void
+add2macro_str(str)
+
+char *str;
+
+{
+	for (  ; *str != '\0'; str++) {
+		add2macro(*str);
+	}
+}
+
 /* look up macro name in hash table and return info about it, or null if
  * not defined */
 
@@ -517,9 +478,9 @@ char *macname;		/* which macro to look up */
 
 
 /* Remove a macro definition. We just remove its entry from the current
- * hash table. Its text will still remain in the macro temp file,
+ * hash table. Its text will still remain in Macbuff,
  * because it seems like too much trouble to do storage management
- * on a temp file, and because if macros have been saved,
+ * on it, and because if macros have been saved,
  * it could get restored later.
  * Note that if asked to undef a macro that isn't defined, it silently
  * does nothing.
@@ -580,7 +541,7 @@ char *macname;
 }
 
 
-/* when macro is called, arrange to read its text from macro file */
+/* when macro is called, arrange to read its text from Macbuff */
 
 void
 call_macro(macname)
@@ -630,7 +591,7 @@ char *macname;		/* which macro to call */
 }
 
 
-/* Prepare to read macro text from the macro temp file. */
+/* Prepare to read macro text from Macbuff. */
 
 static void
 begin_macro_read(mac_p, macname)
@@ -639,35 +600,31 @@ struct MACRO *mac_p;
 char *macname;
 
 {
-#ifndef UNIX_LIKE_FILES
-	if ((Mactmp_read = fopen(Macfile, Read_mode)) == (FILE *) 0) {
-		pfatal("can't open macro file for reading (maybe out of memory?)");
-	}
-#endif
+	long offset;
+
 
-	/* save old yyin value and make macro definition the input */
-	pushfile(Mactmp_read, mac_p->filename, mac_p->lineno, mac_p);
-	
 	/* go to where macro definition begins */
-	if (fseek(Mactmp_read, (has_quote_designator(macname)
-			? mac_p->quoted_offset : mac_p->offset),
-			SEEK_SET) != 0) {
-		pfatal("fseek failed in macro_call");
-	}
+	offset = (has_quote_designator(macname)
+			? mac_p->quoted_offset : mac_p->offset);
+
+	/* save old yyin value and make macro definition the input */
+	pushfile((FILE *) 0, mac_p->filename, mac_p->lineno, mac_p, offset);
 }
-
+
 
 /* save info about current yyin and set yyin to specified file */
 
 static void
-pushfile(file, filename, lineno, mac_p)
+pushfile(file, filename, lineno, mac_p, macoffset)
 
 FILE *file;		/* replace current file with this file */
 char *filename;		/* name of new file to use */
 int lineno;		/* current linenumber in new file */
-struct MACRO *mac_p;	/* if switching to macro temp file because of a
+struct MACRO *mac_p;	/* if switching to macro text because of a
 			 * macro call, this is information about macro.
 			 * Otherwise, it will be null. */
+long macoffset;		/* if mac_p is not null, where in Macbuff its
+			 * text begins */
 
 {
 	debug(4, "pushfile file=%s", filename);
@@ -695,8 +652,10 @@ struct MACRO *mac_p;	/* if switching to macro temp file because of a
 	Filestack[Fstkptr].lineno_inc = Lineno_increment;
 	Lineno_increment = 0;
 	Filestack[Fstkptr].mac_p = mac_p;
+	Filestack[Fstkptr].macoffset = macoffset;
 
-	/* arrange to use the new file */
+	/* arrange to use the new file. For a macro, there is no file;
+	 * the lexer will get the text from Macbuff via mac_read() */
 	new_lexbuff(file);
 
 	/* if we are now expanding a macro, we don't change the input line
@@ -728,11 +687,6 @@ popfile()
 	if (Filestack[Fstkptr].mac_p != (struct MACRO *) 0) {
 		/* returning from macro call */
 		Filestack[Fstkptr].mac_p->recursion = 0;
-#ifndef UNIX_LIKE_FILES
-		if (yyin != 0) {
-			(void) fclose(yyin);
-		}
-#endif
 	}
 	else {
 		/* this is an include rather than a macro file, so close it */
@@ -761,6 +715,36 @@ popfile()
 	return(1);
 }
 
+/* If we are currently expanding a macro, copy as much of its remaining
+ * text as will fit into buff, for the lexer to use, and return how many
+ * bytes were copied, which will be 0 once the whole macro has been read.
+ * If not expanding a macro, return -1, meaning lexer should read from
+ * yyin instead. */
+
+int
+mac_read(buff, max_size)
+
+char *buff;	/* copy the macro text into here */
+int max_size;	/* how much room there is in buff */
+
+{
+	char *text_p;	/* where to copy from */
+	int length;	/* how many bytes copied */
+
+
+	if (Fstkptr < 0 || Filestack[Fstkptr].mac_p == (struct MACRO *) 0) {
+		return(-1);
+	}
+
+	text_p = Macbuff + Filestack[Fstkptr].macoffset;
+	for (length = 0; length < max_size && text_p[length] != '\0';
+							length++) {
+		buff[length] = text_p[length];
+	}
+	Filestack[Fstkptr].macoffset += length;
+	return(length);
+}
+
 
 /* return 1 if we are NOT currently expanding a macro, 0 if we are.
  * This backwards logic is used because when we ARE doing a macro, we
@@ -833,11 +817,12 @@ char *fname;	/* name of file to include */
 				"can't open include file '%s'", fname);
 	}
 
-	/* need to make copy of file name */
-	fnamecopy = strdup(fname);
+	/* need to make copy of file name; if the same file is included
+	 * many times, they can all share one */
+	fnamecopy = intern(fname);
 
 	/* arrange to connect yyin to the included file, save info, etc */
-	pushfile(file, fnamecopy, 1, (struct MACRO *) 0);
+	pushfile(file, fnamecopy, 1, (struct MACRO *) 0, 0L);
 }
 
 
@@ -860,13 +845,35 @@ char **filename_p;
 	char *filename;
 	FILE *file;
 	char *envmuppath;		/* from getenv("MUPPATH") */
-	char envbuff[BUFSIZ];		/* in case MUPPATH is not set */
+	char *muppath;			/* MUPPATH to search */
+	char cwd[BUFSIZ];		/* current directory */
+	int have_cwd;			/* YES if cwd could be found */
 	char *path_separator = "\0";	/* between components in $MUPPATH */
+	struct INCPATH *incpath_p;	/* where found before, if anywhere */
+	int dirlen;			/* length of includer's directory */
 
 
-	/* first try name just as it is. */
+	/* If this was found before, go right to where it was, as long
+	 * as it is still there. */
 	filename = *filename_p;
+	envmuppath = getenv("MUPPATH");
+	have_cwd = (getcwd(cwd, sizeof(cwd)) != 0 ? YES : NO);
+	dirlen = includer_dir_length();
+	if (have_cwd == YES && (incpath_p = find_incpath(filename,
+			Curr_filename, dirlen, cwd, envmuppath))
+			!= (struct INCPATH *) 0
+			&& (file = fopen(incpath_p->path, Read_mode))
+			!= (FILE *) 0) {
+		*filename_p = incpath_p->path;
+		return(file);
+	}
+
+	/* first try name just as it is. */
 	if ((file = fopen(filename, Read_mode)) != (FILE *) 0) {
+		if (have_cwd == YES) {
+			save_incpath(filename, dirlen, cwd, envmuppath,
+							filename);
+		}
 		return(file);
 	}
 
@@ -875,7 +882,7 @@ char **filename_p;
 		return ((FILE *) 0);
 	}
 
-	if ((envmuppath = getenv("MUPPATH")) != (char *) 0) {
+	if ((muppath = envmuppath) != (char *) 0) {
 
 #ifdef UNIX_LIKE_PATH_RULES
 		path_separator = ":";
@@ -895,19 +902,267 @@ char **filename_p;
 	}
 	else {
 		/* Create an effective MUPPATH */
-		if (getcwd(envbuff, sizeof(envbuff)) == 0) {
+		if (have_cwd == NO) {
 			ufatal("Cannot obtain current working directory");
 		}
-		envmuppath = envbuff;
+		muppath = cwd;
 	}
-	if ((file = find_with_suffix(filename_p, envmuppath, path_separator)) != 0) {
-		return(file);
+	if ((file = find_with_suffix(filename_p, muppath, path_separator)) == 0) {
+		/* try relative to including file */
+		file = find_relative_file(filename_p);
+	}
+	if (file != (FILE *) 0 && have_cwd == YES) {
+		save_incpath(filename, dirlen, cwd, envmuppath, *filename_p);
 	}
+	return(file);
+}
+
 
-	/* try relative to including file */
-	return(find_relative_file(filename_p));
+/* Return the length of the directory part of the current (including)
+ * file's name, or 0 if it has none. That is everything up to the last
+ * instance of whatever separates a directory from a file in a path. */
+
+static int
+includer_dir_length()
+
+{
+	char *dir_separator; 	/* what is between a directory and file in path name */
+	char *curr_dir_separator;	/* current instance of dir_separator */
+	char *last_dir_separator = 0;	/* the rightmost dir_separator */
+	char *filepath;			/* points into Curr_filename */
+
+
+	if (Curr_filename == (char *) 0) {
+		return(0);
+	}
+	dir_separator = path_combiner(".");
+	for (filepath = Curr_filename;
+			(curr_dir_separator = strstr(filepath, dir_separator)) != 0;
+			last_dir_separator = curr_dir_separator) {
+		filepath = curr_dir_separator + strlen(dir_separator);
+	}
+	return(last_dir_separator == 0 ? 0 : last_dir_separator - Curr_filename);
 }
-
+
+
+/* Return where the given file was found before when included from a file
+ * in the directory that is the first dirlen characters of includer_dir,
+ * with the given current directory and MUPPATH, or 0 if it hasn't been. */
+
+static struct INCPATH *
+find_incpath(name, includer_dir, dirlen, cwd, muppath)
+
+char *name;
+char *includer_dir;
+int dirlen;
+char *cwd;
+char *muppath;		/* may be 0 if $MUPPATH not set */
+
+{
+	struct INCPATH *incpath_p;
+
+	for (incpath_p = Incpath_table[hashmac(name) % INCTSIZE];
+			incpath_p != (struct INCPATH *) 0;
+			incpath_p = incpath_p->next) {
+		if (strcmp(incpath_p->name, name) == 0
+				&& strlen(incpath_p->includer_dir) == dirlen
+				&& (dirlen == 0
+				|| strncmp(incpath_p->includer_dir,
+				includer_dir, dirlen) == 0)
+				&& strcmp(incpath_p->cwd, cwd) == 0
+				&& (incpath_p->muppath == muppath
+				|| (incpath_p->muppath != (char *) 0
+				&& muppath != (char *) 0
+				&& strcmp(incpath_p->muppath, muppath) == 0))) {
+			return(incpath_p);
+		}
+	}
+	return((struct INCPATH *) 0);
+}
+
+
+/* Add where an include file was found to the table */
+
+static void
+add_incpath(name, includer_dir, dirlen, cwd, muppath, path)
+
+char *name;
+char *includer_dir;	/* first dirlen characters are the directory */
+int dirlen;
+char *cwd;
+char *muppath;		/* may be 0 if $MUPPATH not set */
+char *path;		/* where it was found */
+
+{
+	struct INCPATH *incpath_p;
+	char *dir;
+	int h;
+
+	if ((incpath_p = find_incpath(name, includer_dir, dirlen, cwd, muppath))
+					== (struct INCPATH *) 0) {
+		MALLOC(INCPATH, incpath_p, 1);
+		incpath_p->name = intern(name);
+		MALLOCA(char, dir, dirlen + 1);
+		if (dirlen > 0) {
+			(void) strncpy(dir, includer_dir, dirlen);
+		}
+		dir[dirlen] = '\0';
+		incpath_p->includer_dir = intern(dir);
+		FREE(dir);
+		incpath_p->cwd = intern(cwd);
+		incpath_p->muppath = (muppath == (char *) 0
+					? (char *) 0 : intern(muppath));
+		h = hashmac(name) % INCTSIZE;
+		incpath_p->next = Incpath_table[h];
+		Incpath_table[h] = incpath_p;
+	}
+	/* The path is interned, rather than freed if it moved since last
+	 * time, because find_file() may have handed the old one out. */
+	incpath_p->path = intern(path);
+}
+
+
+/* Remember where an include file was found, included from the current
+ * file, and tell the parent process, if any */
+
+static void
+save_incpath(name, dirlen, cwd, muppath, path)
+
+char *name;
+int dirlen;		/* length of includer's directory in Curr_filename */
+char *cwd;
+char *muppath;		/* may be 0 if $MUPPATH not set */
+char *path;		/* where it was found */
+
+{
+#ifdef HAVE_FORK
+	char record[PIPE_BUF];
+	char *fields[5];
+	int length;
+	int f;
+#endif
+
+
+	add_incpath(name, Curr_filename, dirlen, cwd, muppath, path);
+
+#ifdef HAVE_FORK
+	if (Incpath_fd < 0) {
+		return;
+	}
+
+	/* The record is the five fields, each ending with a null.
+	 * $MUPPATH starts with '=' if set, so it can be told from unset. */
+	fields[0] = name;
+	fields[1] = Curr_filename;
+	fields[2] = cwd;
+	fields[3] = (muppath == (char *) 0 ? "" : muppath);
+	fields[4] = path;
+	length = strlen(name) + dirlen + strlen(cwd) + strlen(fields[3])
+			+ (muppath == (char *) 0 ? 0 : 1) + strlen(path) + 5;
+	if (length > sizeof(record)) {
+		/* Too long to be written all at once; not worth bothering */
+		return;
+	}
+	length = 0;
+	for (f = 0; f < 5; f++) {
+		if (f == 1) {
+			/* only the directory part of the includer's name */
+			if (dirlen > 0) {
+				(void) strncpy(record + length, fields[f],
+								dirlen);
+			}
+			length += dirlen;
+		}
+		else {
+			if (f == 3 && muppath != (char *) 0) {
+				record[length++] = '=';
+			}
+			(void) strcpy(record + length, fields[f]);
+			length += strlen(fields[f]);
+		}
+		record[length++] = '\0';
+	}
+
+	/* The write end is non-blocking, and the parent doesn't read until
+	 * the job is done, so if the pipe is ever full, stop reporting
+	 * rather than wait forever. A write of no more than PIPE_BUF bytes
+	 * is all or nothing. */
+	if (write(Incpath_fd, record, length) != length) {
+		(void) close(Incpath_fd);
+		Incpath_fd = -1;
+	}
+#endif
+}
+
+
+#ifdef HAVE_FORK
+/* Called in a --batch or --serve job, to make it write where it found
+ * include files to fd, to be read by learn_incpaths() in the parent. */
+
+void
+report_incpaths(fd)
+
+int fd;		/* write end of pipe to parent */
+
+{
+	(void) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	Incpath_fd = fd;
+}
+
+
+/* Called in the --batch or --serve parent when a job is done, to read
+ * where the job found include files, so that jobs started later can
+ * go right to them. */
+
+void
+learn_incpaths(fd)
+
+int fd;		/* read end of pipe from job */
+
+{
+	char *buff;
+	int alloc;		/* bytes allocated for buff */
+	int length;		/* bytes in buff */
+	int n;
+	char *fields[5];
+	char *p;
+	int f;
+
+
+	alloc = PIPE_BUF;
+	MALLOCA(char, buff, alloc);
+	length = 0;
+	for ( ; ; ) {
+		if (length == alloc) {
+			alloc *= 2;
+			REALLOCA(char, buff, alloc);
+		}
+		if ((n = read(fd, buff + length, alloc - length)) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		if (n == 0) {
+			break;
+		}
+		length += n;
+	}
+
+	/* Records are always written whole, so only complete ones are here */
+	for (p = buff; p < buff + length; ) {
+		for (f = 0; f < 5; f++) {
+			fields[f] = p;
+			p += strlen(p) + 1;
+		}
+		add_incpath(fields[0], fields[1], strlen(fields[1]), fields[2],
+				(fields[3][0] == '=' ? fields[3] + 1 : (char *) 0),
+				fields[4]);
+	}
+	FREE(buff);
+}
+#endif
+
 
 /* Given a file name, try to find it relative to the current file (the
  * one that is including it). If found, return FILE * to it, and update
@@ -919,26 +1174,13 @@ find_relative_file(filename_p)
 char **filename_p;	/* what to find; will be updated with path if found */
 
 {
-	char *dir_separator; 	/* what is between a directory and file in path name */
-	char *curr_dir_separator = 0;	/* current instance of dir_separator */
-	char *last_dir_separator = 0;	/* the rightmost dir_separator */
-	char *filepath;			/* points into Curr_filename */
 	char *includer_dir;		/* copy of Curr_filename's directory */
 	int dir_name_length;		/* strlen of includer_dir */
 	FILE *file;			/* what to return */
 
 
-	/* Get what would separate directory from file in file path */
-	dir_separator = path_combiner(".");
-
-	/* Find the last instance of that separator in the "including"
-	 * file path. The current file is that includer. */
-	for (filepath = Curr_filename;
-			(curr_dir_separator = strstr(filepath, dir_separator)) != 0;
-			last_dir_separator = curr_dir_separator) {
-		filepath = curr_dir_separator + strlen(dir_separator);
-	}
-	if (last_dir_separator == 0) {
+	/* The current file is the includer */
+	if ((dir_name_length = includer_dir_length()) == 0) {
 		/* Just a filename with no directory leading
 		 * up to it. We've already tried relative to the
 		 * current directory, so no point in trying that again. */
@@ -947,7 +1189,6 @@ char **filename_p;	/* what to find; will be updated with path if found */
 
 	/* Make a pseudo $MUPPATH which consists of the directory of 
 	 * the including file, and try looking for the include file in there. */
-	dir_name_length = last_dir_separator - Curr_filename;
 	MALLOCA(char, includer_dir, dir_name_length + 1);
 	strncpy(includer_dir, Curr_filename, dir_name_length);
 	includer_dir[dir_name_length] = '\0';
@@ -1178,18 +1419,201 @@ char *macdef;	/* MACRO=definition */
 		return;
 	}
 
-	Curr_filename = "Command line argument";
+	Curr_filename = intern(Cmdline_filename);
 	/* command line macros can never have parameters or be expressions */
 	(void) setup_macro(macdef, NO, NOT_EXPR);
 
-	/* copy the macro to the macro temp file */
-	do {
-		putc(*def, Mactmp_write);
-	} while ( *def++ != '\0');
+	/* copy the macro to the macro buffer */
+	add2macro_str(def);
+	add2macro('\0');
 	finish_mac_write();
 }
 
 
+/* Return YES if the given macro was defined on the command line */
+
+static int
+is_cmdline_macro(mac_p)
+
+struct MACRO *mac_p;
+
+{
+	return((mac_p->filename != (char *) 0 &&
+			strcmp(mac_p->filename, Cmdline_filename) == 0)
+			? YES : NO);
+}
+
+
+/* Write the names and text of the macros defined on the command line
+ * to the snapshot being written. */
+
+void
+write_cmdline_macros()
+
+{
+	struct MACRO *mac_p;
+	int h;
+
+
+	for (h = 0; h < MTSIZE; h++) {
+		for (mac_p = Mactable[h]; mac_p != (struct MACRO *) 0;
+						mac_p = mac_p->next) {
+			if (is_cmdline_macro(mac_p) == YES) {
+				snap_putstr(mac_p->macname);
+				snap_putstr(Macbuff + mac_p->offset);
+			}
+		}
+	}
+	snap_putstr((char *) 0);
+}
+
+
+/* Read what write_cmdline_macros() wrote, from the snapshot being loaded,
+ * and return YES if the same macros, with the same text, are defined on
+ * the command line now. */
+
+int
+cmdline_macros_match()
+
+{
+	struct MACRO *mac_p;
+	char *macname;
+	char *text;
+	int count;		/* how many are in the snapshot */
+	int match;
+	int h;
+
+
+	match = YES;
+	for (count = 0; (macname = snap_getstr()) != (char *) 0; count++) {
+		text = snap_getstr();
+		if ((mac_p = findMacro(macname)) == (struct MACRO *) 0
+				|| is_cmdline_macro(mac_p) == NO
+				|| text == (char *) 0
+				|| strcmp(Macbuff + mac_p->offset, text) != 0) {
+			match = NO;
+		}
+		FREE(macname);
+		if (text != (char *) 0) {
+			FREE(text);
+		}
+	}
+
+	/* make sure there aren't any more now */
+	for (h = 0; h < MTSIZE; h++) {
+		for (mac_p = Mactable[h]; mac_p != (struct MACRO *) 0;
+						mac_p = mac_p->next) {
+			if (is_cmdline_macro(mac_p) == YES) {
+				count--;
+			}
+		}
+	}
+	return((match == YES && count == 0) ? YES : NO);
+}
+
+
+/* Write the macros that are defined, other than those that were
+ * defined on the command line, to the snapshot being written. */
+
+void
+write_mac_snapshot()
+
+{
+	struct MACRO *mac_p;
+	struct MAC_PARAM *param_p;
+	int h;
+
+
+	if (Num_mac_tables > 0) {
+		ufatal("input for a snapshot can't use savemacros");
+	}
+	for (h = 0; h < MTSIZE; h++) {
+		for (mac_p = Mactable[h]; mac_p != (struct MACRO *) 0;
+						mac_p = mac_p->next) {
+			if (is_cmdline_macro(mac_p) == YES) {
+				continue;
+			}
+			snap_putstr(mac_p->macname);
+			snap_putstr(mac_p->filename);
+			snap_putnum((long) mac_p->lineno);
+			snap_putnum((long) mac_p->num_params);
+			for (param_p = mac_p->parameters_p;
+					param_p != (struct MAC_PARAM *) 0;
+					param_p = param_p->next) {
+				snap_putstr(param_p->param_name);
+			}
+			snap_putstr(Macbuff + mac_p->offset);
+		}
+	}
+	snap_putstr((char *) 0);
+}
+
+
+/* Define the macros written by write_mac_snapshot(), from the snapshot
+ * being loaded. Like with parsing the input the snapshot was made from,
+ * they replace any that were defined on the command line. */
+
+void
+read_mac_snapshot()
+
+{
+	struct MACRO *mac_p;
+	struct MAC_PARAM **param_p_p;
+	char *macname;
+	char *filename;
+	char *text;
+	int lineno;
+	int num_params;
+	int p;
+	int h;
+
+
+	while ((macname = snap_getstr()) != (char *) 0) {
+		filename = snap_getstr();
+		if (filename != (char *) 0) {
+			filename = intern_owned(filename);
+		}
+		lineno = (int) snap_getnum();
+		num_params = (int) snap_getnum();
+
+		if ((mac_p = findMacro(macname)) == (struct MACRO *) 0) {
+			MALLOC(MACRO, mac_p, 1);
+			h = hashmac(macname);
+			mac_p->next = Mactable[h];
+			Mactable[h] = mac_p;
+			mac_p->macname = macname;
+			mac_p->recursion = 0;
+		}
+		else {
+			l_warning(filename, lineno,
+					"macro '%s' redefined", macname);
+			free_parameters(mac_p->parameters_p, macname, NO);
+			FREE(macname);
+		}
+		mac_p->filename = filename;
+		mac_p->lineno = lineno;
+		mac_p->num_params = num_params;
+
+		param_p_p = &(mac_p->parameters_p);
+		for (p = 0; p < num_params; p++) {
+			MALLOC(MAC_PARAM, *param_p_p, 1);
+			(*param_p_p)->param_name = snap_getstr();
+			param_p_p = &((*param_p_p)->next);
+		}
+		*param_p_p = (struct MAC_PARAM *) 0;
+
+		if ((text = snap_getstr()) == (char *) 0) {
+			snap_damaged();
+		}
+		prepare_mac_write(mac_p);
+		add2macro_str(text);
+		add2macro('\0');
+		finish_mac_write();
+		FREE(text);
+	}
+}
+
+
 /* recursively free a list of macro parameters */
 
 static void
@@ -1339,9 +1763,9 @@ int argnum;	/* which argument. 1 for the first, 2 for second, etc */
 	/* A parameter cannot itself have parameters */
 	(void)setup_macro(mp_name, NO, NOT_EXPR);
 
-	/* Copy the parameter text to the macro temp file. */
-	fprintf(Mactmp_write, "%s", argbuff);
-	putc('\0', Mactmp_write);
+	/* Copy the parameter text to the macro buffer. */
+	add2macro_str(argbuff);
+	add2macro('\0');
 
 	finish_mac_write();
 
@@ -1655,7 +2079,8 @@ char *concat_name; /* the A##B style name to be concatenated. */
 	char save;		/* original character at a point where we
 				 * want to temporarily put a NULL to 
 				 * end a segment for processing. */
-	int c;			/* character read from macro file */
+	int c;			/* character read from macro text */
+	char *text_p;		/* walks through macro text */
 	int quote_count = 0;	/* how many ` seen */
 
 	index = 0;
@@ -1684,8 +2109,7 @@ char *concat_name; /* the A##B style name to be concatenated. */
 			 * in the following switch.
 			 * We temporarily add a null to terminate this segment,
 			 * then invoke macro_call on this segment, which will
-			 * arrange to read that macro's content from the
-			 * macro file.
+			 * arrange to read that macro's content from Macbuff.
 			 */
 			save = *end_p;
 			*end_p = '\0';
@@ -1702,11 +2126,9 @@ char *concat_name; /* the A##B style name to be concatenated. */
 			/* We read the contents on the macro, and transfer that
 			 * to what will be the ultimate macro name we need.
 			 */
-			for ( ; ; ) {
-				c = getc(yyin);
-				if (c == EOF) {
-					pfatal("unexpected end of file in macro");
-				}
+			for (text_p = Macbuff + Filestack[Fstkptr].macoffset;
+							; text_p++) {
+				c = *text_p;
 				if (isspace(c)) {
 					/* ignore any white space */
 					continue;
@@ -1798,23 +2220,19 @@ struct MACRO *mac_p;
 				 * thing we are string-izing. */
 	int escaped = NO;	/* If we have seen a backslash to escape the
 				 * following character. */
+	long offset;		/* where in Macbuff we are reading the
+				 * unquoted macro value from */
 
 
-#ifndef UNIX_LIKE_FILES
-	if ((Mactmp_write = fopen(Macfile, Append_mode)) == (FILE *) 0) {
-		pfatal("can't open temporary file for macro storage (even though could earlier)");
-	}
-#endif
-
 	/* Remember where we are stashing this quoted copy */
-	fseek(Mactmp_write, 0L, SEEK_END);
-	mac_p->quoted_offset = ftell(Mactmp_write);
+	mac_p->quoted_offset = Macbuff_used;
 
 	/* Add the initial quote */
-	putc('"', Mactmp_write);
+	add2macro('"');
 
-	/* Arrange to read the unquoted macro value from the macro file */
+	/* Arrange to read the unquoted macro value from the macro buffer */
 	call_macro(mac_p->macname);
+	offset = Filestack[Fstkptr].macoffset;
 
 	/* Have to copy a character at a time, because we
 	 * need to backslash any embedded quotes. This follows
@@ -1824,10 +2242,12 @@ struct MACRO *mac_p;
 	 * squeeze not-in-string white space runs to a single space,
 	 * because this keeps the code simpler and there's no
 	 * particular benefit in squeezing, other than perhaps
-	 * saving a few bytes in the macro temp file. This code
-	 * is similar to the gcc implementation of cpp. */
+	 * saving a few bytes in the macro buffer. This code
+	 * is similar to the gcc implementation of cpp.
+	 * Note that adding to Macbuff may move it, so we have to
+	 * access what we are reading via its offset. */
 	in_string = escaped = NO;
-	while ((c = getc(Mactmp_read)) != '\0') {
+	while ((c = Macbuff[offset++]) != '\0') {
 		if (escaped == YES) {
 			escaped = NO;
 		}
@@ -1850,14 +2270,14 @@ struct MACRO *mac_p;
 		/* Escape quotes always; escape backslashes
 		 * when they are inside strings. */
 		if (c == '"' || (in_string == YES && c == '\\')) {
-			putc('\\', Mactmp_write);
+			add2macro('\\');
 		}
-		putc(c, Mactmp_write);
+		add2macro(c);
 	}
 
 	/* Add the final quote */
-	putc('"', Mactmp_write);
-	putc('\0', Mactmp_write);
+	add2macro('"');
+	add2macro('\0');
 	finish_mac_write();
 
 	/* put the input back where it was */
@@ -1871,10 +2291,13 @@ void
 do_eval()
 
 {
-	/* Write the evaluated result into the macro tmp file */
+	char result[512];	/* evaluated result as text */
+
+
+	/* Write the evaluated result into the macro buffer */
 	setup_macro(Curr_expr_macro.macname, NO, SETTING_EXPR);
 	if (Expr_result.type == TYPE_INT) {
-		fprintf(Mactmp_write, "%d", Expr_result.intval);
+		(void) sprintf(result, "%d", Expr_result.intval);
 	}
 	else if (Expr_result.type == TYPE_FLOAT) {
 		if ( isnan(Expr_result.floatval)
@@ -1888,16 +2311,18 @@ do_eval()
 			 * future issues. */
 			Expr_result.floatval = 1.0;
 		}
-		fprintf(Mactmp_write, "%f", Expr_result.floatval);
+		(void) snprintf(result, sizeof(result), "%f",
+						Expr_result.floatval);
 	}
 	else {
 		pfatal("invalid value type %d\n", Expr_result.type);
 	}
-	putc('\0', Mactmp_write);
+	add2macro_str(result);
+	add2macro('\0');
 	finish_mac_write();
 	/* We no longer need the "temporary" macro that was the expression
-	 * before evaluation. The text of the expression will still in the
-	 * temp file, but we never bother to try to reclaim anything in there.
+	 * before evaluation. The text of the expression will still in
+	 * Macbuff, but we never bother to try to reclaim anything in there.
 	 */
 	FREE(Curr_expr_macro.macname);
 	Curr_expr_macro.macname = 0;
@@ -73,7 +73,9 @@ static char Copyright[] =
  * -olist	print only pages given in list
  * -pN		start numbering pages at N instead of from 1.
  *			optionally followed by a comma plus leftpage or rightpage
+ * -P file	read file before the input files; it can be a snapshot
  * -slist	print only the staffs in list
+ * -S snapfile	write a snapshot of the input to snapfile, for use with -P
  * -v    	print verion number and exit
  * -xN,M	extract just measures N through M.
  *	Negative values are relative to the end of the song.
@@ -99,6 +101,11 @@ static char Copyright[] =
 #include <fcntl.h>
 #include "defines.h"
 #include "globals.h"
+#ifdef HAVE_FORK
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 
 /* List of valid command line options and their explanations */
@@ -115,13 +122,17 @@ struct Options {
 	{ 'E', "",		"run macro preprocessor only" },
 	{ 'f', " outfile",	"write output to outfile" },
 	{ 'F', "",		"write output to file with derived name" },
+	{ 'j', " N",		"place staffs and print pages using N processes" },
 	{ 'l', "",		"show license and exit" },
 	{ 'm', " midifile",	"generate MIDI output file" },
 	{ 'M', "",		"generate MIDI output file, derive file name" },
 	{ 'o', " pagelist",	"only print pages in pagelist" },
 	{ 'p', " N[,side]",	"start numbering pages at N; leftpage or rightpage" },
+	{ 'P', " file",		"read file (input or snapshot) before the input" },
 	{ 'q', "",		"quiet - don't print copyright notice" },
 	{ 's', " stafflist",	"print only staffs in stafflist" },
+	{ 'S', " snapfile",	"write snapshot of the input to snapfile" },
+	{ 'T', " format",	"report time used by each phase, as table or json" },
 	{ 'v', "",		"print version number and exit" },
 	{ 'x', " N[,M]",	"extract measures N through M" }
 };
@@ -140,6 +151,13 @@ static char **Arglist;		/* global pointer to argv */
 static int Num_args;		/* global copy of argc */
 static char Version[] = "7.2";	/* Mup version number */
 static int Quiet = NO;		/* -q option */
+static int Jobs = 1;		/* -j option */
+
+/* Most processes we will use at once with -j */
+#define MAXJOBS	(64)
+
+/* size of the stdio buffer for the PostScript output */
+#define OUTBUFSIZE	(256 * 1024)
 
 /* The different kinds of things that can be argument to -o option.
  * User values of "odd" and "even" will map to PG_ODD and PG_EVEN.
@@ -169,6 +187,34 @@ static char * Read_mode = "r";
  */
 static struct RANGELIST *Page_range_p;
 
+/* Command line options whose values are used after parsing */
+static char *Midifilename = (char *) 0;	/* -m */
+static int Combine = NORESTCOMBINE;	/* number of measures to combine into
+					 * multirests with -c option */
+static int Derive_out_name = NO;	/* YES if -F option is specified */
+static char *Vis_stafflist = (char *) 0;	/* -s list of visible staffs */
+static int First_pagenum = MINFIRSTPAGE - 1;	/* -p page, or "not set" */
+static int Side = PGSIDE_NOT_SET;	/* optional second argument to -p */
+static char *Pagelist = (char *) 0;	/* -o */
+static int Xstart = 1, Xend = -1;	/* Arguments to -x option */
+static int Has_x_arg = NO;
+static int Outfile_args = 0;	/* we only allow one instance of [fFmM] */
+
+static char *Prelude_file = (char *) 0;	/* -P */
+static int Prelude_text = NO;	/* YES if Prelude_file is still to be read */
+static char *Prelude_snap = (char *) 0;	/* Prelude_file's snapshot, if it
+					 * is one, to be loaded */
+static long Prelude_snap_size;
+static int Stdin_last = NO;	/* YES if only -P file given; read stdin after */
+static char *Snapshot_file = (char *) 0;	/* -S */
+static FILE *Snapshot_p = (FILE *) 0;	/* if non-null, write snapshot here
+					 * rather than to Snapshot_file */
+/* With --serve --prelude or --batch --prelude, the prelude file, which
+ * each job uses like -P, and a snapshot of it, if one could be made. */
+static char *Shared_prelude = (char *) 0;
+static char *Shared_snap = (char *) 0;
+static long Shared_snap_size;
+
 static void usage P((char **argv));	/* print usage message and exit */
 static int ignore_option P((int opt));
 static void notice P((void));
@@ -181,6 +227,19 @@ static struct RANGELIST **save_range P((int lower, int upper,
 		struct RANGELIST **linkpoint_p_p));
 static void prune_page_range P((int start_page));
 static void vis_staffs P((char *stafflist));
+static void do_options P((int argc, char **argv));
+static void setup_prelude P((void));
+static char *read_whole_file P((FILE *file_p, char *name, long *size_p));
+static void make_snapshot P((void));
+static void mup_init P((void));
+static int mup_main P((int argc, char **argv));
+#ifdef HAVE_FORK
+static void share_prelude P((char *progname, char *prelude));
+#endif
+#ifdef HAVE_FORK
+static int par_print P((int pagenum, int jobs));
+static void replay_errors P((FILE *err_p, FILE *preverr_p));
+#endif
 
 
 int
@@ -190,27 +249,25 @@ int argc;
 char **argv;
 
 {
-	int a;			/* for command line args */
-	char *midifilename = (char *) 0;
-	int combine = NORESTCOMBINE;	/* number of measures to combine into
-				 * multirests with -c option */
-	int derive_out_name = NO;	/* YES is -F option is specified */
-	char *vis_stafflist = (char *) 0;	/* -s list of visible staffs */
-	int pagenum;
-	int side = PGSIDE_NOT_SET;	/* optional second argument to -p */
-	char *pagelist = 0;
-	int start = 1, end = -1;	/* Arguments to -x option */
-	int has_x_arg = NO;
-	int outfile_args = 0;	/* we only allow one instance of [fFmM] options */
-	int n, i;
-	int num_options;
-	char *getopt_string;
-	/* The following three variables are to guard against infinite loops */
-	struct RANGELIST *prev_page_range_p;
-	int prev_begin = 0;
-	int prev_end = 0;
+	return(mup_main(argc, argv));
+}
+
+
+/* Do the initialization that only ever needs to be done once, even when
+ * mup_main() is run again, as it is to make a snapshot of a prelude. */
+
+static void
+mup_init()
+
+{
+	static int done = NO;
 
 
+	if (done == YES) {
+		return;
+	}
+	done = YES;
+
 	/* Initialize all the font metrics.
 	 * This must happen before init_symtbl() */
 	init_psfont_metrics();
@@ -219,16 +276,384 @@ char **argv;
 
 	/* must init head shapes table before first call to initstructs */
 	init_symtbl();
+}
+
+
+/* Run Mup with the given arguments, just as if it had been started as
+ * a program with them. */
+
+static int
+mup_main(argc, argv)
+
+int argc;
+char **argv;
+
+{
+	int pagenum;
+	/* The following three variables are to guard against infinite loops */
+	struct RANGELIST *prev_page_range_p;
+	int prev_begin = 0;
+	int prev_end = 0;
+	char **jobargv;		/* arguments without the --prelude */
+	int a;
 
-	/* set initial page number to "not set" */
-	pagenum = MINFIRSTPAGE - 1;
+
+	mup_init();
 	initstructs();
 
+	/* In server and batch modes, everything above is done just once,
+	 * and then each job gets its own copy of that state. These only
+	 * return in a job, with the arguments for that job.
+	 * If there is a prelude file, each job reads it as if it had been
+	 * given with -P, so a snapshot of it is made first, if possible,
+	 * for the jobs to load rather than each parsing it again. */
+	if (argc > 1 && (strcmp(argv[1], "--serve") == 0
+				|| strcmp(argv[1], "--batch") == 0)) {
+		if (argc > 3 && strcmp(argv[2], "--prelude") == 0) {
+			Shared_prelude = argv[3];
+#ifdef HAVE_FORK
+			share_prelude(argv[0], Shared_prelude);
+#endif
+			MALLOCA(char *, jobargv, argc - 1);
+			jobargv[0] = argv[0];
+			jobargv[1] = argv[1];
+			for (a = 4; a < argc; a++) {
+				jobargv[a - 2] = argv[a];
+			}
+			jobargv[argc - 2] = (char *) 0;
+			argv = jobargv;
+			argc -= 2;
+		}
+		if (strcmp(argv[1], "--serve") == 0) {
+			argc = serve((argc > 2 ? argv[2] : (char *) 0), &argv);
+		}
+		else {
+			argc = batch(argc, &argv);
+		}
+	}
+
+	do_options(argc, argv);
+
+	/* save info about arguments so yywrap can open additional input files
+	 * if necessary */
+	Arglist = argv;
+	Num_args = argc;
+	yyin = stdin;
+	yyout = stderr;
+	setup_prelude();
+
+	/* if file argument (or -P file to read), open that, else use stdin */
+	if (Prelude_text == YES || optind <= argc - 1) {
+		(void) yywrap();
+	}
+	else {
+#ifdef Mac_BBEdit
+		Curr_filename  = intern(_mup_input_filename);
+#else
+		Curr_filename = intern("stdin");
+#if defined(unix) || defined(__WATCOM__)
+		/* Sometimes people forget to give a file name,
+		 * then wonder why Mup is "hanging," so let user
+		 * know it isn't hanging... it's waiting for them
+		 * to type something. But only if input is a terminal,
+		 * and stderr is a terminal--if stdin is a pipe,
+		 * user probably doesn't need a reminder. */
+		if (isatty(0) && isatty(2)) {
+			fprintf(stderr, "No input file specified; reading standard input.\n\n");
+		}
+#endif
+#endif
+	}
+
+	/* Almost everything made while parsing lives until we exit, so
+	 * carve it all out of one arena rather than mallocing each piece. */
+	Parse_arena = new_arena("parse", PARSE_ARENA_CHUNK);
+	Scratch_arena = new_arena("scratch", SCRATCH_ARENA_CHUNK);
+	(void) set_arena(Parse_arena);
+
+	/* initialize for parser */
+	raterrfuncp = doraterr;
+	initstructs();
+	vis_staffs(Vis_stafflist);
+	reset_ped_state();
+
+	/* parse the input */
+	phase("parse");
+	if (Prelude_snap != (char *) 0) {
+		load_snapshot(Prelude_snap, Prelude_snap_size, Prelude_file,
+								Version);
+	}
+	if (Preproc == YES) {
+		preproc();
+	}
+	else {
+		(void) yyparse();
+	}
+	if (Snapshot_file != (char *) 0 || Snapshot_p != (FILE *) 0) {
+		make_snapshot();
+		return(0);
+	}
+	pagenum = First_pagenum;
+	/* Apply keymaps. This has to happen before calc_block_heights so
+	 * that that function is using the mapped strings */
+	if (Errorcount == 0) {
+		phase("map_strings");
+		map_all_strings();
+	}
+
+	/* do final checks and cleanup of input data */
+	phase("checks");
+	/* check for missing endif */
+	chk_ifdefs();	
+	if (Preproc == YES) {
+		error_exit();
+	}
+
+	/* Set Firstpageside, taking -p option and SSVs into account
+	 * as appropriate. This needs to be done before calling
+	 * calc_block_heights, to populate the left/right versions it needs. */
+	Firstpageside = set_firstpageside(Side);
+
+	/* find height of headers and footers */
+	/* Note: this has to be called when we are at the *end* of the main
+	 * list with all SSVs applied, so that we know the margin settings */
+	/* Skip this if there were errors, in case one of the errors involved
+	 * an invalid expression. */
+	if (Errorcount == 0) {
+		calc_block_heights();
+	}
+
+	/* make sure there is a final barline */
+	check4barline_at_end();
+	/* make sure we go to new score if visibility changes */
+	chk_vis_feed();
+
+	/* derive tabnote staff data for tablature staffs. But if there
+	 * have been errors found, don't bother, because we may have
+	 * some incomplete/inconsistent data that tab2tabnote doesn't
+	 * know how to deal with cleanly. */
+	if (Errorcount == 0) {
+		tab2tabnote();
+	}
+
+	/* Convert ph-eph pairs into phrase STUFFs */
+	conv_ph_eph();
+
+	/* process multi-measure repeats */
+	if (Mrptused == YES && Errorcount == 0) {
+		set_mrpt_info();
+	}
+
+	/* do -c option or restcombine parameter */
+	combine_rests(Combine);
+
+	/* make sure there aren't til clauses past end of song */
+	chk4dangling_til_clauses("the end of the song");
+
+	/* count how many verses */
+	set_maxverses();
+
+	/* process ties */
+	phase("tie");
+	tie();
+
+	/* Verify that -o argument (and maybe -p or firstpage parameter)
+	 * is valid. If not, this will ufatal. */
+	pagenum = get_first_page(pagenum);
+	set_pagelist(Pagelist, pagenum);
+
+	/* Do -x (extract) option if needed. But if there were errors before,
+	 * skip this, because there could be empty measures and such,
+	 * that could confuse it, and we're going to give up soon anyway. */
+	if (Has_x_arg == YES && Errorcount == 0) {
+		phase("extract");
+		extract(Xstart, Xend);
+	}
+
+	debug(2, "finished with parsing, Errorcount is %d", Errorcount);
+
+	/* Placement frees a lot of what it allocates as it goes, so it
+	 * uses the heap, except for scratch data that uses Scratch_arena. */
+	(void) set_arena((struct ARENA *) 0);
+	debug(2, "parse arena used %ld bytes", Parse_arena->bytes);
+
+	if (Errorcount > 0) {
+		(void) fprintf(stderr, "\nstopping due to previous error%s\n",
+						Errorcount ? "s" : "");
+		error_exit();
+	}
+
+	/* do the placement phase */
+	phase("transpose");
+
+	/* initialize the Staffscale and related variables to default values */
+	initstructs();
+	set_staffscale(0);
+	Ignore_staffscale = YES;
+	/* SSV checkpoints saved so far observed staffscale, so are stale now */
+	discard_ssv_ckpts();
+
+	/* transpose */
+	transgroups();
+
+	/* set up ties that carry into next measure */
+	tie_carry();
+
+	if (Doing_MIDI == YES) {
+		/* For MIDI, expand any repeated sections as if the user
+		 * had written them out fully without repeats. */
+		expand_repeats();
+	}
+
+	/* line up chords */
+	phase("makechords");
+	makechords();
+
+	/* place notes relative to staff and set stem direction */
+	phase("setnotes");
+	setnotes();	
+	/* find relative horizontal position of notes */
+	phase("setgrps");
+	setgrps();
+	/* set coordinates of rests and syllables */
+	phase("restsyl");
+	restsyl();
+
+	/* generate MIDI file if appropriate. We wait until here to
+	 * do MIDI, so that chord widths have been established, so midi
+	 * code can more easily figure out how to crunch all-space chords */
+	if (Doing_MIDI == YES) {
+		phase("midi");
+		if (Midifilename == (char *) 0) {
+			/* -M option, so we have to derive the name */
+			Midifilename = derive_file_name(".mid");
+		}
+		gen_midi(Midifilename);
+		phase_report();
+		exit(0);
+	}
+
+	/* figure out absolute horizontal locations */
+	phase("abshorz");
+	abshorz();
+	/* find lengths of beams, angles of beams, etc */
+	phase("beamstem");
+	beamstem();
+	/* set up mussym, octave, rom, bold, pedal, etc */
+	phase("stuff");
+	stuff();
+
+	/* find vertical coordinates relative to staff */
+	phase("relvert");
+	relvert(Jobs);
+	/* set absolute vertical coordinates */
+	phase("absvert");
+	absvert();
+
+	/* split lines and curves */
+	phase("fix_locvars");
+	fix_locvars();	
+
+	/* If debugging bit 128 is on, dump the main list */
+	print_mainll();
+
+	if (Derive_out_name == YES) {
+		Outfilename = derive_file_name(".ps");
+	}
+	if (*Outfilename != '\0') {
+		if (freopen(Outfilename, "w", stdout) == (FILE *) 0) {
+			cant_open(Outfilename);
+			exit(1);
+		}
+	}
+	/* The print phase writes a great many small pieces, so give the output
+	 * a big buffer. Nothing has been written to stdout yet. */
+	(void) setvbuf(stdout, (char *) 0, _IOFBF, OUTBUFSIZE);
+
+	/* output PostScript for printing */
+	phase("print");
+	prune_page_range(pagenum);
+
+#ifdef HAVE_FORK
+	/* if user asked for it, and it can be done, print the pages in
+	 * parallel. That includes the trailer. */
+	if (Jobs > 1 && par_print(pagenum, Jobs) == YES) {
+		phase_report();
+		return(0);
+	}
+#endif
+
+	/* Initialize infinite loop guards */
+	prev_page_range_p = Page_range_p;
+	if (Page_range_p != 0) {
+		prev_begin = Page_range_p->begin;
+		prev_end = Page_range_p->end;
+	}
+	
+	do {
+		Pagenum = (short) pagenum;
+		print_music();
+		/* As a guard against infinite loop bugs, we make sure
+		 * that each time through this loop we make some progress.
+		 * We need to either have moved on to a new range or have
+		 * reduced the current range. */
+		if (Page_range_p != 0) {
+			if (prev_page_range_p == Page_range_p
+					&& prev_begin == Page_range_p->begin
+					&& prev_end == Page_range_p->end) {
+				pfatal("infinite loop in finding pages to print");
+			}
+			else {
+				prev_page_range_p = Page_range_p;
+				prev_begin = Page_range_p->begin;
+				prev_end = Page_range_p->end;
+			}
+		}
+	} while (Page_range_p != 0);
+	trailer();
+
+	/* get all the output written out before saying how long it took */
+	(void) fflush(stdout);
+	phase_report();
+
+	/* if we get to here, all is okay. If there was a problem,
+	 * we would have exited where the problem occurred */
+	return(0);
+}
+
+
+/* print copyright notice */
+
+static void
+notice()
+
+{
+	if (getenv("MUPQUIET") == (char *) 0 && Quiet == NO) {
+		(void) fprintf(stderr, "Mup - Music Publisher   Version %s\n", Version);
+		(void) fputs(Copyright, stderr);
+	}
+}
+
+
+/* Process command line options */
+
+static void
+do_options(argc, argv)
+
+int argc;
+char **argv;
+
+{
+	int a;			/* for command line args */
+	int n, i;
+	int num_options;
+	char *getopt_string;
+
+
 	/* If run via mupmate, user may not understand error messages	
 	 * about things like -c or -p, so we give different messages. */
 	Mupmate = (getenv("MUPMATE") == 0 ? NO : YES);
 
-	/* process command line arguments */
 	/* create getopt string */
 	num_options = NUMELEM(Option_list);
 	/* allow for worst case of all requiring colon */
@@ -250,8 +675,8 @@ char **argv;
 		switch (a) {
 
 		case 'c':
-			combine = atoi(optarg);
-			if (combine < MINRESTCOMBINE || combine > MAXRESTCOMBINE) {
+			Combine = atoi(optarg);
+			if (Combine < MINRESTCOMBINE || Combine > MAXRESTCOMBINE) {
 				if (Mupmate == YES) {
 					/* Should be impossible to get here,
 					 * since mupmate refuses to accept
@@ -286,18 +711,26 @@ char **argv;
 
 		case 'f':
 			Outfilename = optarg;
-			outfile_args++;
+			Outfile_args++;
 			break;
 
 		case 'F':
-			derive_out_name = YES;
-			outfile_args++;
+			Derive_out_name = YES;
+			Outfile_args++;
 			break;
 
 		case 'D':
 			cmdline_macro(optarg);
 			break;
 
+		case 'j':
+			Jobs = atoi(optarg);
+			if (Jobs < 1 || Jobs > MAXJOBS) {
+				l_yyerror(0, -1, "argument for %cj (number of processes to use) must be between 1 and %d",
+					Optch, MAXJOBS);
+			}
+			break;
+
 		case 'l':
 			printf("\nMup license:\n\n%s\n", license_text);
 			exit(0);
@@ -305,22 +738,26 @@ char **argv;
 			break;
 
 		case 'm':
-			midifilename = optarg;
+			Midifilename = optarg;
 			/* FALLTHRU */
 		case 'M':
 			Doing_MIDI = YES;
 			/* define "built-in" MIDI macro */
 			cmdline_macro("MIDI");
-			outfile_args++;
+			Outfile_args++;
 			break;
 
 		case 'o':
-			pagelist = optarg;
+			Pagelist = optarg;
+			break;
+
+		case 'P':
+			Prelude_file = optarg;
 			break;
 
 		case 'p':
-			pagenum = atoi(optarg);
-			if (pagenum < MINFIRSTPAGE || pagenum > MAXFIRSTPAGE) {
+			First_pagenum = atoi(optarg);
+			if (First_pagenum < MINFIRSTPAGE || First_pagenum > MAXFIRSTPAGE) {
 				if (Mupmate == YES) {
 					/* Should be impossible to get here,
 					 * since mupmate refuses to accept
@@ -352,10 +789,10 @@ char **argv;
 					}
 
 					if (strcmp(optarg + n, "leftpage") == 0) {
-						side = PGSIDE_LEFT;
+						Side = PGSIDE_LEFT;
 					}
 					else if (strcmp(optarg + n, "rightpage") == 0) {
-						side = PGSIDE_RIGHT;
+						Side = PGSIDE_RIGHT;
 					}
 					else {
 						l_yyerror(0, -1, "-p side specification must be leftpage or rightpage");
@@ -368,295 +805,250 @@ char **argv;
 			Quiet = YES;
 			break;
 		case 's':
-			vis_stafflist = optarg;
-			break;
-
-		case 'v':
-			notice();
-
-			(void) fprintf(stderr,"Version %s\n", Version);
-			exit(0);
-			/*NOTREACHED*/
+			Vis_stafflist = optarg;
 			break;
 
-		case 'x':
-			chk_x_arg(optarg, &start, &end);
-			has_x_arg = YES;
+		case 'S':
+			Snapshot_file = optarg;
 			break;
 
-		default:
-			usage(argv);
+		case 'T':
+			if (set_phase_report(optarg) == NO) {
+				l_yyerror(0, -1, "argument for %cT (report format) must be table or json",
+					Optch);
+			}
 			break;
-		}
-	}
-
-	notice();
-
-	if (Ppcomments == YES && Preproc == NO) {
-		warning("-C only valid with -E; ignored");
-	}
-
-	if (Preproc == YES && vis_stafflist != 0) {
-		warning("-s not valid with -E; ignored");
-	}
-
-	if (outfile_args > 1) {
-		(void) fprintf(stderr, "Only one output file option (-f, -F, -m, -M) can be specified\n");
-		exit(1);
-	}
-
-	/* turn on yacc debug flag if appropriate */
-	if (Debuglevel & 1) {
-		yydebug = 1;
-		exprdebug = 1;
-	}
-
-	/* save info about arguments so yywrap can open additional input files
-	 * if necessary */
-	Arglist = argv;
-	Num_args = argc;
-	yyin = stdin;
-	yyout = stderr;
-
-	/* if file argument, open that, else use stdin */
-	if (optind <= argc - 1) {
-		(void) yywrap();
-	}
-	else {
-#ifdef Mac_BBEdit
-		Curr_filename  = _mup_input_filename;
-#else
-		Curr_filename = "stdin";
-#if defined(unix) || defined(__WATCOM__)
-		/* Sometimes people forget to give a file name,
-		 * then wonder why Mup is "hanging," so let user
-		 * know it isn't hanging... it's waiting for them
-		 * to type something. But only if input is a terminal,
-		 * and stderr is a terminal--if stdin is a pipe,
-		 * user probably doesn't need a reminder. */
-		if (isatty(0) && isatty(2)) {
-			fprintf(stderr, "No input file specified; reading standard input.\n\n");
-		}
-#endif
-#endif
-	}
-
-	/* initialize for parser */
-	raterrfuncp = doraterr;
-	initstructs();
-	vis_staffs(vis_stafflist);
-	reset_ped_state();
 
-	/* parse the input */
-	if (Preproc == YES) {
-		preproc();
-	}
-	else {
-		(void) yyparse();
-	}
-#ifndef UNIX_LIKE_FILES
-	mac_cleanup();
-#endif
+		case 'v':
+			notice();
 
-	/* Apply keymaps. This has to happen before calc_block_heights so
-	 * that that function is using the mapped strings */
-	if (Errorcount == 0) {
-		map_all_strings();
-	}
+			(void) fprintf(stderr,"Version %s\n", Version);
+			exit(0);
+			/*NOTREACHED*/
+			break;
 
-	/* do final checks and cleanup of input data */
-	/* check for missing endif */
-	chk_ifdefs();	
-	if (Preproc == YES) {
-		error_exit();
+		case 'x':
+			chk_x_arg(optarg, &Xstart, &Xend);
+			Has_x_arg = YES;
+			break;
+
+		default:
+			usage(argv);
+			break;
+		}
 	}
 
-	/* Set Firstpageside, taking -p option and SSVs into account
-	 * as appropriate. This needs to be done before calling
-	 * calc_block_heights, to populate the left/right versions it needs. */
-	Firstpageside = set_firstpageside(side);
+	notice();
 
-	/* find height of headers and footers */
-	/* Note: this has to be called when we are at the *end* of the main
-	 * list with all SSVs applied, so that we know the margin settings */
-	/* Skip this if there were errors, in case one of the errors involved
-	 * an invalid expression. */
-	if (Errorcount == 0) {
-		calc_block_heights();
+	if (Ppcomments == YES && Preproc == NO) {
+		warning("-C only valid with -E; ignored");
 	}
 
-	/* make sure there is a final barline */
-	check4barline_at_end();
-	/* make sure we go to new score if visibility changes */
-	chk_vis_feed();
+	if (Preproc == YES && Vis_stafflist != 0) {
+		warning("-s not valid with -E; ignored");
+	}
 
-	/* derive tabnote staff data for tablature staffs. But if there
-	 * have been errors found, don't bother, because we may have
-	 * some incomplete/inconsistent data that tab2tabnote doesn't
-	 * know how to deal with cleanly. */
-	if (Errorcount == 0) {
-		tab2tabnote();
+	if (Preproc == YES && Snapshot_file != (char *) 0) {
+		ufatal("%cS cannot be used with %cE", Optch, Optch);
 	}
 
-	/* Convert ph-eph pairs into phrase STUFFs */
-	conv_ph_eph();
+	if (Outfile_args > 1) {
+		(void) fprintf(stderr, "Only one output file option (-f, -F, -m, -M) can be specified\n");
+		exit(1);
+	}
 
-	/* process multi-measure repeats */
-	if (Mrptused == YES && Errorcount == 0) {
-		set_mrpt_info();
+	/* turn on yacc debug flag if appropriate */
+	if (Debuglevel & 1) {
+		yydebug = 1;
+		exprdebug = 1;
 	}
+}
 
-	/* do -c option or restcombine parameter */
-	combine_rests(combine);
 
-	/* make sure there aren't til clauses past end of song */
-	chk4dangling_til_clauses("the end of the song");
+/* Arrange for the -P file, or the --prelude file, to be read before the
+ * input files. If it is a snapshot, it is read into memory now, to be
+ * loaded after the parser is initialized. Otherwise yywrap() will open
+ * it first. A --prelude file is used just like -P, except that if a
+ * snapshot was made of it, that is loaded when it fits this job. */
 
-	/* count how many verses */
-	set_maxverses();
+static void
+setup_prelude()
 
-	/* process ties */
-	tie();
+{
+	FILE *file_p;
 
-	/* Verify that -o argument (and maybe -p or firstpage parameter)
-	 * is valid. If not, this will ufatal. */
-	pagenum = get_first_page(pagenum);
-	set_pagelist(pagelist, pagenum);
 
-	/* Do -x (extract) option if needed. But if there were errors before,
-	 * skip this, because there could be empty measures and such,
-	 * that could confuse it, and we're going to give up soon anyway. */
-	if (has_x_arg == YES && Errorcount == 0) {
-		extract(start, end);
+	if (Shared_prelude != (char *) 0) {
+		if (Prelude_file != (char *) 0) {
+			ufatal("%cP cannot be used with --prelude", Optch);
+		}
+		Prelude_file = Shared_prelude;
+
+		/* The snapshot can only be used for this job if it would
+		 * give the same result as reading the prelude would. */
+		if (Shared_snap != (char *) 0 && Preproc == NO &&
+				snapshot_fits(Shared_snap, Shared_snap_size,
+				Shared_prelude, Version) == YES) {
+			Prelude_snap = Shared_snap;
+			Prelude_snap_size = Shared_snap_size;
+			return;
+		}
 	}
+	if (Prelude_file != (char *) 0) {
+		if ((file_p = fopen(Prelude_file, Read_mode)) == (FILE *) 0) {
+			cant_open(Prelude_file);
+		}
+		Prelude_snap = read_whole_file(file_p, Prelude_file,
+							&Prelude_snap_size);
+		(void) fclose(file_p);
+		if (is_snapshot(Prelude_snap, Prelude_snap_size) == YES) {
+			if (Preproc == YES) {
+				ufatal("%cE cannot be used with a snapshot",
+								Optch);
+			}
+			return;
+		}
+		FREE(Prelude_snap);
+		Prelude_snap = (char *) 0;
 
-	debug(2, "finished with parsing, Errorcount is %d", Errorcount);
-
-	if (Errorcount > 0) {
-		(void) fprintf(stderr, "\nstopping due to previous error%s\n",
-						Errorcount ? "s" : "");
-		error_exit();
+		Prelude_text = YES;
+		if (optind >= Num_args) {
+			Stdin_last = YES;
+		}
 	}
+}
 
-	/* do the placement phase */
 
-	/* initialize the Staffscale and related variables to default values */
-	initstructs();
-	set_staffscale(0);
-	Ignore_staffscale = YES;
+/* Read all of a file into malloc-ed memory and return it. Its size is
+ * returned via size_p. */
 
-	/* transpose */
-	transgroups();
+static char *
+read_whole_file(file_p, name, size_p)
 
-	/* set up ties that carry into next measure */
-	tie_carry();
+FILE *file_p;
+char *name;		/* of the file, for error message */
+long *size_p;
 
-	if (Doing_MIDI == YES) {
-		/* For MIDI, expand any repeated sections as if the user
-		 * had written them out fully without repeats. */
-		expand_repeats();
+{
+	char *buff;
+	long size;		/* of buff */
+	long used;		/* bytes in buff */
+	size_t n;
+
+
+	size = BUFSIZ;
+	MALLOCA(char, buff, size);
+	for (used = 0; (n = fread(buff + used, 1, (size_t) (size - used),
+						file_p)) > 0; ) {
+		used += n;
+		if (used == size) {
+			size *= 2;
+			REALLOCA(char, buff, size);
+		}
+	}
+	if (ferror(file_p)) {
+		ufatal("error reading %s", name);
 	}
+	*size_p = used;
+	return(buff);
+}
 
-	/* line up chords */
-	makechords();
 
-	/* place notes relative to staff and set stem direction */
-	setnotes();	
-	/* find relative horizontal position of notes */
-	setgrps();
-	/* set coordinates of rests and syllables */
-	restsyl();
+/* With -S, this is called right after parsing, to write the snapshot
+ * instead of going on to print. */
 
-	/* generate MIDI file if appropriate. We wait until here to
-	 * do MIDI, so that chord widths have been established, so midi
-	 * code can more easily figure out how to crunch all-space chords */
-	if (Doing_MIDI == YES) {
-		if (midifilename == (char *) 0) {
-			/* -M option, so we have to derive the name */
-			midifilename = derive_file_name(".mid");
-		}
-		gen_midi(midifilename);
-		exit(0);
+static void
+make_snapshot()
+
+{
+	/* check for missing endif */
+	chk_ifdefs();
+	if (Errorcount > 0) {
+		error_exit();
 	}
+	write_snapshot(Snapshot_p, Snapshot_file, Version);
+}
 
-	/* figure out absolute horizontal locations */
-	abshorz();
-	/* find lengths of beams, angles of beams, etc */
-	beamstem();
-	/* set up mussym, octave, rom, bold, pedal, etc */
-	stuff();
 
-	/* find vertical coordinates relative to staff */
-	relvert();
-	/* set absolute vertical coordinates */
-	absvert();
+#ifdef HAVE_FORK
+/* For --serve --prelude or --batch --prelude, make a snapshot of the
+ * prelude for the jobs to load. This is done in a child, like mup -S,
+ * so that nothing parsed is left behind here. If the prelude can't be
+ * put in a snapshot, or gets any errors or warnings, there is no
+ * snapshot, so each job reads the prelude itself and reports them. */
 
-	/* split lines and curves */
-	fix_locvars();	
+static void
+share_prelude(progname, prelude)
 
-	/* If debugging bit 128 is on, dump the main list */
-	print_mainll();
+char *progname;
+char *prelude;
 
-	if (derive_out_name == YES) {
-		Outfilename = derive_file_name(".ps");
+{
+	static char *args[3];	/* arguments for making the snapshot */
+	FILE *file_p;
+	char *buff;		/* contents of prelude */
+	long size;		/* bytes in buff */
+	FILE *snap_p;		/* the snapshot is written here */
+	FILE *err_p;		/* the child's error output */
+	int incpath_pipe[2];	/* to learn where include files were found */
+	pid_t pid;
+	int status;
+
+
+	/* If it is a snapshot already, each job will just load it */
+	if ((file_p = fopen(prelude, Read_mode)) == (FILE *) 0) {
+		cant_open(prelude);
 	}
-	if (*Outfilename != '\0') {
-		if (freopen(Outfilename, "w", stdout) == (FILE *) 0) {
-			cant_open(Outfilename);
-			exit(1);
-		}
+	buff = read_whole_file(file_p, prelude, &size);
+	(void) fclose(file_p);
+	if (is_snapshot(buff, size) == YES) {
+		FREE(buff);
+		return;
 	}
+	FREE(buff);
 
-	/* output PostScript for printing */
-	prune_page_range(pagenum);
-
-	/* Initialize infinite loop guards */
-	prev_page_range_p = Page_range_p;
-	if (Page_range_p != 0) {
-		prev_begin = Page_range_p->begin;
-		prev_end = Page_range_p->end;
+	if ((snap_p = tmpfile()) == (FILE *) 0
+			|| (err_p = tmpfile()) == (FILE *) 0
+			|| pipe(incpath_pipe) != 0) {
+		return;
+	}
+	(void) fflush(stdout);
+	(void) fflush(stderr);
+	if ((pid = fork()) < 0) {
+		return;
 	}
-	
-	do {
-		Pagenum = (short) pagenum;
-		print_music();
-		/* As a guard against infinite loop bugs, we make sure
-		 * that each time through this loop we make some progress.
-		 * We need to either have moved on to a new range or have
-		 * reduced the current range. */
-		if (Page_range_p != 0) {
-			if (prev_page_range_p == Page_range_p
-					&& prev_begin == Page_range_p->begin
-					&& prev_end == Page_range_p->end) {
-				pfatal("infinite loop in finding pages to print");
-			}
-			else {
-				prev_page_range_p = Page_range_p;
-				prev_begin = Page_range_p->begin;
-				prev_end = Page_range_p->end;
-			}
-		}
-	} while (Page_range_p != 0);
-	trailer();
-
-	/* if we get to here, all is okay. If there was a problem,
-	 * we would have exited where the problem occurred */
-	return(0);
-}
-
-
-/* print copyright notice */
 
-static void
-notice()
+	if (pid == 0) {
+		(void) close(incpath_pipe[0]);
+		if (dup2(fileno(err_p), 2) < 0) {
+			_exit(1);
+		}
+		report_incpaths(incpath_pipe[1]);
+		Shared_prelude = (char *) 0;
+		Snapshot_p = snap_p;
+		Quiet = YES;
+		args[0] = progname;
+		args[1] = prelude;
+		args[2] = (char *) 0;
+		exit(mup_main(2, args));
+	}
 
-{
-	if (getenv("MUPQUIET") == (char *) 0 && Quiet == NO) {
-		(void) fprintf(stderr, "Mup - Music Publisher   Version %s\n", Version);
-		(void) fputs(Copyright, stderr);
+	(void) close(incpath_pipe[1]);
+	if (waitpid(pid, &status, 0) == pid && WIFEXITED(status)
+			&& WEXITSTATUS(status) == 0
+			&& fseek(err_p, 0L, SEEK_END) == 0
+			&& ftell(err_p) == 0L) {
+		rewind(snap_p);
+		Shared_snap = read_whole_file(snap_p, prelude,
+							&Shared_snap_size);
 	}
+	learn_incpaths(incpath_pipe[0]);
+	(void) close(incpath_pipe[0]);
+	(void) fclose(snap_p);
+	(void) fclose(err_p);
 }
-
+#endif
+
 
 /* print usage message and exit */
 
@@ -761,6 +1153,17 @@ yywrap()
 		return(0);
 	}
 
+	/* A -P file that isn't a snapshot comes before the others */
+	if (Prelude_text == YES) {
+		Prelude_text = NO;
+		if ((yyin = fopen(Prelude_file, Read_mode)) == NULL) {
+			cant_open(Prelude_file);
+		}
+		Curr_filename = intern(Prelude_file);
+		yylineno = 1;
+		return(0);
+	}
+
 	/* if user specified more files, open the next one */
 	for (  ; optind < Num_args; optind++) {
 		if (yyin != NULL) {
@@ -768,7 +1171,7 @@ yywrap()
 		}
 		errno = 0;
 		if ((yyin = fopen(Arglist[optind], Read_mode)) != NULL) {
-			Curr_filename = Arglist[optind++];
+			Curr_filename = intern(Arglist[optind++]);
 			yylineno = 1;
 			return(0);
 		}
@@ -786,6 +1189,7 @@ yywrap()
 			MALLOCA(char, Curr_filename, leng + 5);
 			sprintf(Curr_filename, "%s.mup", Arglist[optind]);
 			if ((yyin = fopen(Curr_filename, Read_mode)) != NULL) {
+				Curr_filename = intern_owned(Curr_filename);
 				yylineno = 1;
 				optind++;
 				return(0);
@@ -793,6 +1197,7 @@ yywrap()
 			/* try upper case suffix before giving up */
 			sprintf(Curr_filename, "%s.MUP", Arglist[optind]);
 			if ((yyin = fopen(Curr_filename, Read_mode)) != NULL) {
+				Curr_filename = intern_owned(Curr_filename);
 				yylineno = 1;
 				optind++;
 				return(0);
@@ -802,6 +1207,18 @@ yywrap()
 		cant_open(Arglist[optind]);
 	}
 
+	/* If there was only a -P file, standard input comes after it */
+	if (Stdin_last == YES) {
+		Stdin_last = NO;
+		if (yyin != NULL) {
+			(void) fclose(yyin);
+		}
+		yyin = stdin;
+		Curr_filename = intern("stdin");
+		yylineno = 1;
+		return(0);
+	}
+
 	return(1);
 }
 
@@ -1313,6 +1730,186 @@ int pagenum;
 }
 
 
+#ifdef HAVE_FORK
+/* Print the pages using several processes at once. Each does a contiguous
+ * part of the pages, into its own temporary file, and then those are copied
+ * to the output in order. Every part has to walk through the main list from
+ * the beginning to get things like the SSVs, fonts, and page sides right for
+ * its pages, but formatting the output for the pages, which is where most of
+ * the time goes, gets spread over the processes. This only handles the usual
+ * case of printing one range of pages in order. Returns YES if the pages
+ * were printed, NO if they need to be done the normal way. */
+
+static int
+par_print(pagenum, jobs)
+
+int pagenum;	/* page number of the first page */
+int jobs;	/* how many processes to use */
+
+{
+	FILE *part_p[MAXJOBS];		/* output of each part */
+	FILE *err_p[MAXJOBS];		/* error output of each part */
+	int offset_fd[MAXJOBS];		/* to read where each's pages start */
+	long offset[MAXJOBS];		/* where pages start in each part */
+	pid_t pid[MAXJOBS];		/* process doing each part */
+	int pipefd[2];
+	int first;			/* first page to print */
+	int pairs;			/* number of pairs of pages */
+	int begin, end;			/* pages to do in a part */
+	int status;			/* of a child process */
+	int partcode;			/* exit code of a part */
+	int exitcode;			/* what to exit with if a part failed */
+	char buff[BUFSIZ];		/* for copying output */
+	size_t n;			/* bytes in buff */
+	int j;				/* part index */
+
+
+	debug(256, "par_print");
+
+	if (Page_range_p == 0 || Page_range_p->next != 0
+			|| Page_range_p->begin == BLANK_PAGE
+			|| Pages_reversed == YES || Pglist_filter != PG_ALL) {
+		return(NO);
+	}
+
+	/* keep pages in pairs, in case there are two panels per page */
+	first = Page_range_p->begin;
+	pairs = (Page_range_p->end - first + 2) / 2;
+	if (jobs > pairs) {
+		jobs = pairs;
+	}
+	if (jobs < 2) {
+		return(NO);
+	}
+
+	(void) fflush(stdout);
+	for (j = 0; j < jobs; j++) {
+		begin = first + 2 * (pairs * j / jobs);
+		end = first + 2 * (pairs * (j + 1) / jobs) - 1;
+		if (end > Page_range_p->end) {
+			end = Page_range_p->end;
+		}
+
+		if ((part_p[j] = tmpfile()) == (FILE *) 0
+				|| (err_p[j] = tmpfile()) == (FILE *) 0
+				|| pipe(pipefd) != 0) {
+			ufatal("can't create temporary file for printing");
+		}
+		if ((pid[j] = fork()) < 0) {
+			ufatal("can't create process for printing");
+		}
+
+		if (pid[j] == 0) {
+			/* We are the child. Print our pages into our file,
+			 * and any errors or warnings into our error file,
+			 * for the parent to pass along. */
+			(void) close(pipefd[0]);
+			if (dup2(fileno(part_p[j]), 1) < 0
+					|| dup2(fileno(err_p[j]), 2) < 0) {
+				_exit(1);
+			}
+			Page_range_p->begin = begin;
+			Page_range_p->end = end;
+			Pagenum = (short) pagenum;
+			offset[j] = print_part(begin - first,
+					(j == jobs - 1 ? YES : NO));
+			if (ferror(stdout) || offset[j] < 0L ||
+					write(pipefd[1], &offset[j],
+					sizeof(offset[j])) != sizeof(offset[j])) {
+				_exit(1);
+			}
+			_exit(0);
+		}
+		(void) close(pipefd[1]);
+		offset_fd[j] = pipefd[0];
+	}
+
+	/* Wait for all the parts, passing along their errors in order, before
+	 * copying any of their output, so that if any part failed, no pages
+	 * go out, rather than only some of them. */
+	exitcode = 0;
+	for (j = 0; j < jobs; j++) {
+		if (read(offset_fd[j], &offset[j], sizeof(offset[j]))
+						!= sizeof(offset[j])) {
+			offset[j] = -1L;
+		}
+		(void) close(offset_fd[j]);
+		partcode = 1;
+		if (waitpid(pid[j], &status, 0) == pid[j] && WIFEXITED(status)) {
+			partcode = WEXITSTATUS(status);
+		}
+		if (partcode == 0 && offset[j] < 0L) {
+			partcode = 1;
+		}
+		/* the final part reported any error, so use its code */
+		if (partcode != 0 && (exitcode == 0 || j == jobs - 1)) {
+			exitcode = partcode;
+		}
+		replay_errors(err_p[j], (j == 0 ? (FILE *) 0 : err_p[j - 1]));
+		if (j > 0) {
+			(void) fclose(err_p[j - 1]);
+		}
+	}
+	(void) fclose(err_p[jobs - 1]);
+	if (exitcode != 0) {
+		exit(exitcode);
+	}
+
+	/* Copy the parts to the output in order. The first part gets copied
+	 * whole; the others are copied from where their pages start, since
+	 * everything before that is the same prolog as in the first one. */
+	for (j = 0; j < jobs; j++) {
+		if (fseek(part_p[j], (j == 0 ? 0L : offset[j]), SEEK_SET) != 0) {
+			ufatal("can't read temporary file for printing");
+		}
+		while ((n = fread(buff, 1, sizeof(buff), part_p[j])) > 0) {
+			(void) fwrite(buff, 1, n, stdout);
+		}
+		(void) fclose(part_p[j]);
+	}
+	return(YES);
+}
+
+
+/* Write out the errors and warnings from one part of a par_print().
+ * Each part has to go through all the pages before its own, so it
+ * reports again whatever the previous part did, before going on to
+ * its own pages. So skip as much as matches what the previous part
+ * wrote, so that nothing comes out twice. */
+
+static void
+replay_errors(err_p, preverr_p)
+
+FILE *err_p;		/* error output of this part */
+FILE *preverr_p;	/* error output of previous part, or null if none */
+
+{
+	char buff[BUFSIZ];	/* for copying */
+	size_t n;		/* bytes in buff */
+	long skip;		/* how much was already reported */
+	int c;
+
+
+	(void) fflush(stderr);
+	rewind(err_p);
+	if (preverr_p != (FILE *) 0) {
+		rewind(preverr_p);
+		for (skip = 0L; (c = getc(preverr_p)) != EOF
+					&& c == getc(err_p); skip++) {
+			;
+		}
+		if (fseek(err_p, skip, SEEK_SET) != 0) {
+			rewind(err_p);
+		}
+	}
+	while ((n = fread(buff, 1, sizeof(buff), err_p)) > 0) {
+		(void) fwrite(buff, 1, n, stderr);
+	}
+	(void) fflush(stderr);
+}
+#endif
+
+
 /* Return YES if we have printed all the page the user asked us to. */
 
 int
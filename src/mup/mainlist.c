@@ -155,6 +155,13 @@ struct MAINLL *where;	/* put it right after this one in the list */
 			info_p->str, info_p->inputfile, info_p->inputlineno);
 	}
 
+	/* adding an SSV or BAR before the end could change the SSV state
+	 * at BARs after it */
+	if ((info_p->str == S_SSV || info_p->str == S_BAR)
+					&& where != Mainlltc_p) {
+		discard_ssv_ckpts();
+	}
+
 	/* if where is NULL, this means to insert at beginning of list */
 	if (where == (struct MAINLL *) 0) {
 		if (Mainllhc_p != (struct MAINLL *) 0) {
@@ -208,6 +215,10 @@ unlinkMAINLL(which_p)
 struct MAINLL *which_p;	/* the one to unlink */
 
 {
+	if (which_p->str == S_SSV || which_p->str == S_BAR) {
+		discard_ssv_ckpts();
+	}
+
 	if (which_p->prev != (struct MAINLL *) 0) {
 		which_p->prev->next = which_p->next;
 	}
@@ -114,38 +114,22 @@ struct MIDIROLL {
 /* default note on velocity */
 #define DFLT_VELOCITY	(64)
 
-/* the MIDI STUFF info for current measure/voice */
-static struct MIDISTUFF *Midistufflist_p;
-
 /* list of pending rolls to do */
 static struct MIDIROLL *Midirollinfo_p;
 
 /* map staff number and voice index to track */
 static short Voice2track_map [MAXSTAFFS + 1] [MAXVOICES];
 
-
-/* keep track of all time to an absolute reference so that all tracks stay
- * in sync, even though midi times are stored as delta times */
-static RATIONAL Absolute_time;
-static RATIONAL Sum_of_deltas;
-
-static int Status;	/* 0 if haven't yet written first MIDI status byte
-			 * for current track. Otherwise is the current MIDI
-			 * status byte. */
-
-static short Channel = 0;	/* MIDI channel, 0-15 */
-static char Onvelocity[MAXHAND];	/* note on velocity */
-static char Offvelocity[MAXHAND];	/* note off velocity */
 static short Time_specified_by_user = NO;	/* YES if user had a score SSV
 				 * setting the time before any music data */
 static short Key_specified_by_user = NO;	/* YES if user had a score SSV
 				 * setting the key before any music data */
 static int Division = DEFDIVISION;	/* clock ticks per quarter note */
 
+/* Tempo for gradual changes. The voice tracks all use whatever value
+ * track 0 left here. */
 static UINT32B Usec_per_quarter_note = DFLT_USEC_PER_QUARTER;
 
-static short Pedbounce = NO;	/* if pedal bounce pending */
-
 /* The valid keywords, listed here in alphabetical order */
 static char *KW_channel = "channel";
 static char *KW_chanpressure = "chanpressure";
@@ -166,19 +150,21 @@ static char *KW_text = "text";
 
 /* local functions */
 static RATIONAL eff_meas_time P((struct MAINLL *mll_p));
-static void midi_header P((int mfile, int ntracks));
-static void track_header P((int mfile));
-static UINT32B write_midi_data P((int mfile, struct GRPSYL *gs_p));
-static UINT32B midi_multirest P((int mfile, struct STAFF *staff_p, int staffno,
+static void midi_meas P((struct STAFF *staff_p));
+static void midi_bar P((struct MAINLL *mll_p));
+static void midi_header P((int ntracks));
+static void track_header P((void));
+static UINT32B write_midi_data P((struct GRPSYL *gs_p));
+static UINT32B midi_multirest P((struct STAFF *staff_p, int staffno,
 		int vno, int nummeas));
 static int xlate_note P((struct NOTE *note_p, char *fname, int lineno,
 		int staff, int *raw_notenum_p));
 static void prepmidi_stuff P((struct STAFF *staff_p, int vno, int all));
-static UINT32B do_midi_stuff P((RATIONAL timeval, int mfile, int all));
-static UINT32B midihex P((int mfile, char *str, char *fname, int lineno));
-static UINT32B midi_item P((struct STUFF *stuff_p, int mfile, int all));
-static UINT32B wr_meta P((int mfile, int evtype, char *str));
-static UINT32B all_midi P((int mfile));
+static UINT32B do_midi_stuff P((RATIONAL timeval, int all));
+static UINT32B midihex P((char *str, char *fname, int lineno));
+static UINT32B midi_item P((struct STUFF *stuff_p, int all));
+static UINT32B wr_meta P((int evtype, char *str));
+static UINT32B all_midi P((void));
 static void midi_adjust P((void));
 static void adjust_notes P((struct GRPSYL *gs_p, int staffno, int v,
 		struct MAINLL *mll_p));
@@ -188,7 +174,7 @@ void steal4grace P((struct MAINLL *mll_p, int staffno, int voice,
 RATIONAL calc_graceadj P((struct GRPSYL *gs_p, int numgrace));
 static void add_release P((struct GRPSYL *gs_p, RATIONAL release_adjust,
 		struct MAINLL *mll_p));
-static UINT32B pedswitch P((int nfile, int on));
+static UINT32B pedswitch P((int on));
 static void midi_roll P((struct GRPSYL *gs_p, struct GRPSYL **gslist_p_p));
 static RATIONAL roll_time P((RATIONAL grptime, int nnotes));
 static void do_mroll P((struct GRPSYL *gs_p, struct GRPSYL **gslist_p_p,
@@ -206,9 +192,10 @@ static void comb_accs P((struct NOTE *note_p, char *fname, int linenum));
 
 
 /* generate a MIDI file. Assigns each staff/voice combo to a MIDI track.
- * Write MIDI file header and first track with tempo, etc info. Then for
- * each staff/voice, generate a MIDI track with all note on/off and
- * whatever STUFF we know how to deal with. */
+ * Write MIDI file header and first track with tempo, etc info. Then go
+ * through the main list once, generating the MIDI tracks for all the
+ * staff/voices together, with all note on/off and whatever STUFF we know
+ * how to deal with. */
 
 void
 gen_midi(midifilename)
@@ -217,13 +204,11 @@ char *midifilename;		/* put MIDI data in this file */
 
 {
 	struct MAINLL *mll_p;	/* to index through main list */
-	int i;
+	struct SSV *ssv_p;	/* SSV in main list */
 	int track = 0;
 	int staff;
 	int vno;		/* voice index */
 	int mfile;		/* file descriptor for MIDI output file */
-	UINT32B track_size;	/* bytes in track */
-	UINT32B track_start;	/* offset in file where track begins */
 	int t;			/* track index */
 	/* tables for mapping track to staff number and voice index */
 	short track2staff_map [MAXSTAFFS * MAXVOICES];
@@ -231,15 +216,6 @@ char *midifilename;		/* put MIDI data in this file */
 	int curr_map;		/* which tuning map we are using now */
 	int saw_a_staff;	/* YES if we have seen a STAFF since the most
 				 * recent run of SSVs */
-	int got_data;		/* YES or NO, to deal with case where the
-				 * number of staffs/voices changes mid-stream */
-	struct STAFF *staff_p;	/* need to refer to STAFF a lot, so keep a
-				 * pointer to it. */
-	struct STAFF *last_staff_p = (struct STAFF *) 0;/* in case measure
-				 * was invisible or something,
-				 * this points to the most recent
-				 * staff for current loop */
-	struct GRPSYL *g_p;
 
 
 	debug(256, "gen_midi");
@@ -292,6 +268,10 @@ char *midifilename;		/* put MIDI data in this file */
 		ufatal("can't open MIDI file '%s'", midifilename);
 	}
 
+	/* Track 0 is the one with time signature, tempo, etc. Until we
+	 * start generating it, the passes below use its state for scratch. */
+	alloc_midi_tracks(track + 1);
+
 	/* adjust grace notes to get a little time, etc */
 	midi_adjust();
 
@@ -311,190 +291,207 @@ char *midifilename;		/* put MIDI data in this file */
 	}
 
 	/* generate MIDI file header */
+	set_midi_track(0);
 	initstructs();
 	Usec_per_quarter_note = DFLT_USEC_PER_QUARTER;
-	midi_header(mfile, track);
-
-	/* go through  the main list once for each staff/voice, generating a
-	 * MIDI track for it. */
-	for (t = 0; t < track; t++)  {
-
-		/* initialize everything for this track */
-		initstructs();
-		init_tie_table();
-		reset_sigs();
-		track_start = lseek(mfile, 0L, SEEK_CUR);
-		track_header(mfile);
-		staff = track2staff_map[t];
-		vno = track2voice_map[t];
-		curr_map = 0;
-		set_map_index(curr_map);
-		saw_a_staff = NO;
-		track_size = 0;
-		got_data = NO;
+	midi_header(track);
+
+	/* initialize everything for the staff/voice tracks */
+	for (t = 1; t <= track; t++) {
+		set_midi_track(t);
+		track_header();
+		staff = Midi_track_p->staffno = track2staff_map[t - 1];
+		Midi_track_p->vno = track2voice_map[t - 1];
 		Octave_adjust[staff] = 0;
 		Octave_bars[staff] = 0;
 		Octave_count[staff] = 0.0;
-		Channel = 0;
-		/* Pedbounce should already be NO, but it doesn't hurt
-		 * to force it, to be more robust if there is some bug. */
-		Pedbounce = NO;
-		for (i = 0; i < MAXHAND; i++) {
-			Onvelocity[i] = (char) DFLT_VELOCITY;
-			Offvelocity[i] = (char) 0;
-		}
-
-		/* go through main list */
-		for (mll_p = Mainllhc_p; mll_p != (struct MAINLL *) 0;
-						mll_p = mll_p->next) {
-
-			switch (mll_p->str) {
-
-			case S_STAFF:
-				saw_a_staff = YES;
-				staff_p = mll_p->u.staff_p;
-				/* check if this is for the staff we are
-				 * currently generating midi data for */
-				if (staff_p->staffno == staff
-						&& staff_p->groups_p[vno]
-						!= (struct GRPSYL *) 0) {
-
-					/* Handle inaudible staffs, or
-					 * staffs that happen to be tab now,
-					 * even though they aren't somewhere
-					 * else */
-					if (staff_audible(staff) == NO || is_tab_staff(staff) == YES) {
-						/* Convert notes to rests.
-						 * Can't just ignore,
-						 * because if we do, space
-						 * that has been squeezed
-						 * out isn't handled right,
-						 * and tracks can get out of
-						 * sync with each other */
-						for (g_p = staff_p->groups_p[vno];
-								g_p != 0;
-								g_p = g_p->next) {
-							if (g_p->nnotes > 0) {
-								g_p->grpcont
-								= GC_REST;
-							}
-						}
-					}
+	}
 
-					/* found information for the track/voice
-					 * we are currently generating */
-					got_data = YES;
-
-					/* check for multi-rest */
-					if (staff_p->groups_p[vno]->is_multirest
-								== YES) {
-						track_size += midi_multirest
-							(mfile, staff_p,
-							staff, vno,
-							-(staff_p->groups_p[vno]
-							->basictime) );
-						break;
-					}
+	/* go through the main list once, adding to each track as we come
+	 * to things for its staff/voice */
+	initstructs();
+	curr_map = 0;
+	set_map_index(curr_map);
+	saw_a_staff = NO;
+	for (mll_p = Mainllhc_p; mll_p != (struct MAINLL *) 0;
+					mll_p = mll_p->next) {
 
-					/* generate MIDI data */
-					init_accidental_map(staff);
-					prepmidi_stuff(staff_p, vno, NO);
-					track_size += write_midi_data(mfile,
-						staff_p->groups_p[vno]);
-				}
-				else if (staff_p->staffno == staff) {
-					/* Voice doesn't exist in this meas,
-					 * so just keep track of the staff
-					 * so when we hit the bar we can
-					 * add the silence, and update any
-					 * midi parameters and such. */
-					last_staff_p = staff_p;
-				}
-				break;
+		switch (mll_p->str) {
 
-			case S_SSV:
-				asgnssv(mll_p->u.ssv_p);
-
-				/* update key signature for this track
-				 * if necessary. Note that score-wide
-				 * key signature changes will be written
-				 * out via all_midi(). */
-				if (mll_p->u.ssv_p->context == C_STAFF &&
-						mll_p->u.ssv_p->staffno
-						== staff &&
-						(mll_p->u.ssv_p->used[SHARPS]
-						== YES ||
-						mll_p->u.ssv_p->used[TRANSPOSITION]
-						== YES ||
-						mll_p->u.ssv_p->used[ADDTRANSPOSITION]
-						== YES) ) {
-					track_size += midi_keysig(mfile,
-						eff_key(mll_p->u.ssv_p->staffno),
-						mll_p->u.ssv_p->is_minor);
-					Status = 0;
-				}
-				if (TUNEPARMSSV(mll_p->u.ssv_p)) {
-					if (saw_a_staff == YES) {
-						set_map_index(++curr_map);
-					}
-					/* If there are other SSVs having
-					 * tune parameters before we see
-					 * another staff, we don't want to
-					 * increment the curr_map */
-					saw_a_staff = NO;
+		case S_STAFF:
+			saw_a_staff = YES;
+			staff = mll_p->u.staff_p->staffno;
+			for (vno = 0; vno < MAXVOICES; vno++) {
+				if ((t = Voice2track_map[staff][vno]) != 0) {
+					set_midi_track(t);
+					midi_meas(mll_p->u.staff_p);
 				}
-				break;
+			}
+			break;
 
-			case S_BAR:
-				/* if this voice is defined somewhere in the
-				 * song, but not in this measure, need to add
-				 * virtual measure of rest. (This could happen
-				 * if user changed the number of staffs
-				 * and/or voices in mid-stream */
-				if (got_data == NO && mll_p->inputlineno != -1) {
-					/* Arrange to do any midi things
-					 * for this voice, even though it
-					 * doesn't exist at the moment. */
-					if (last_staff_p != (struct STAFF *) 0) {
-						prepmidi_stuff(last_staff_p,
-								vno, NO);
+		case S_SSV:
+			ssv_p = mll_p->u.ssv_p;
+			asgnssv(ssv_p);
+
+			/* update key signature for tracks on this staff
+			 * if necessary. Note that score-wide key signature
+			 * changes will be written out via all_midi(). */
+			if (ssv_p->context == C_STAFF &&
+					(ssv_p->used[SHARPS] == YES ||
+					ssv_p->used[TRANSPOSITION] == YES ||
+					ssv_p->used[ADDTRANSPOSITION] == YES) ) {
+				for (vno = 0; vno < MAXVOICES; vno++) {
+					if ((t = Voice2track_map[ssv_p->staffno]
+							[vno]) == 0) {
+						continue;
 					}
-					track_size += do_midi_stuff(Zero,
-							mfile, NO);
-					/* This will update the current
-					 * absolute time to include the
-					 * effective time for this measure. */
-					track_size += do_midi_stuff(
-							eff_meas_time(mll_p),
-							mfile, NO);
-					last_staff_p = (struct STAFF *) 0;
+					set_midi_track(t);
+					Midi_track_p->size += midi_keysig(
+						eff_key(ssv_p->staffno),
+						ssv_p->is_minor);
+					Midi_track_p->status = 0;
 				}
-				else {
-					got_data = NO;
+			}
+			if (TUNEPARMSSV(ssv_p)) {
+				if (saw_a_staff == YES) {
+					set_map_index(++curr_map);
 				}
-				break;
-
-			default:
-				break;
+				/* If there are other SSVs having
+				 * tune parameters before we see
+				 * another staff, we don't want to
+				 * increment the curr_map */
+				saw_a_staff = NO;
 			}
+			break;
 
-			if (mll_p == (struct MAINLL *) 0) {
-				/* Really shouldn't ever happen,
-				 * but just in case, don't core dump... */
-				break;
+		case S_BAR:
+			for (t = 1; t <= track; t++) {
+				set_midi_track(t);
+				midi_bar(mll_p);
 			}
+			break;
+
+		default:
+			break;
 		}
+	}
+
+	for (t = 1; t <= track; t++) {
+		set_midi_track(t);
 
 		/* add end of track mark */
-		track_size += write(mfile, "\0\377/\0", 4);
+		Midi_track_p->size += midiwrite(
+					(unsigned char *) "\0\377/\0", 4);
 
 		/* now that we know the track size, fill it in */
-		fix_track_size(mfile, track_start, track_size);
+		fix_track_size(Midi_track_p->size);
 	}
 
+	/* the tracks were all built in memory; write them out now */
+	flush_midi(mfile);
 	(void) close(mfile);
 }
-
+
+
+/* Generate the MIDI data for one measure of the staff/voice of the current
+ * track, given the STAFF for its staff. */
+
+static void
+midi_meas(staff_p)
+
+struct STAFF *staff_p;
+
+{
+	struct MIDITRACK *trk_p;	/* the current track */
+	struct GRPSYL *g_p;
+	int staff;
+	int vno;
+
+
+	trk_p = Midi_track_p;
+	staff = trk_p->staffno;
+	vno = trk_p->vno;
+
+	if (staff_p->groups_p[vno] == (struct GRPSYL *) 0) {
+		/* Voice doesn't exist in this meas,
+		 * so just keep track of the staff
+		 * so when we hit the bar we can
+		 * add the silence, and update any
+		 * midi parameters and such. */
+		trk_p->last_staff_p = staff_p;
+		return;
+	}
+
+	/* Handle inaudible staffs, or
+	 * staffs that happen to be tab now,
+	 * even though they aren't somewhere
+	 * else */
+	if (staff_audible(staff) == NO || is_tab_staff(staff) == YES) {
+		/* Convert notes to rests.
+		 * Can't just ignore,
+		 * because if we do, space
+		 * that has been squeezed
+		 * out isn't handled right,
+		 * and tracks can get out of
+		 * sync with each other */
+		for (g_p = staff_p->groups_p[vno]; g_p != 0; g_p = g_p->next) {
+			if (g_p->nnotes > 0) {
+				g_p->grpcont = GC_REST;
+			}
+		}
+	}
+
+	/* found information for the track/voice */
+	trk_p->got_data = YES;
+
+	/* check for multi-rest */
+	if (staff_p->groups_p[vno]->is_multirest == YES) {
+		trk_p->size += midi_multirest(staff_p, staff, vno,
+				-(staff_p->groups_p[vno]->basictime) );
+		return;
+	}
+
+	/* generate MIDI data */
+	init_accidental_map(staff);
+	prepmidi_stuff(staff_p, vno, NO);
+	trk_p->size += write_midi_data(staff_p->groups_p[vno]);
+}
+
+
+/* At a bar line, if the staff/voice of the current track is defined
+ * somewhere in the song, but not in this measure, need to add virtual
+ * measure of rest. (This could happen if user changed the number of staffs
+ * and/or voices in mid-stream) */
+
+static void
+midi_bar(mll_p)
+
+struct MAINLL *mll_p;	/* the BAR */
+
+{
+	struct MIDITRACK *trk_p;	/* the current track */
+
+
+	trk_p = Midi_track_p;
+	if (trk_p->got_data == NO && mll_p->inputlineno != -1) {
+		/* Arrange to do any midi things
+		 * for this voice, even though it
+		 * doesn't exist at the moment. */
+		if (trk_p->last_staff_p != (struct STAFF *) 0) {
+			prepmidi_stuff(trk_p->last_staff_p, trk_p->vno, NO);
+		}
+		trk_p->size += do_midi_stuff(Zero, NO);
+		/* This will update the current
+		 * absolute time to include the
+		 * effective time for this measure. */
+		trk_p->size += do_midi_stuff(eff_meas_time(mll_p), NO);
+		trk_p->last_staff_p = (struct STAFF *) 0;
+	}
+	else {
+		trk_p->got_data = NO;
+	}
+}
+
 
 /* Find the "effective" duration of a measure. Because of squeezing of
  * space chords, a measure may be shorter than the time signature.
@@ -550,20 +547,18 @@ struct MAINLL *mll_p;
 /* write MIDI header to file */
 
 static void 
-midi_header(mfile, ntracks)
+midi_header(ntracks)
 
-int mfile;	/* file descriptor to write to */
 int ntracks;	/* how many tracks are to be written */
 
 {
 	unsigned char buff[8];
-	UINT32B track1start;
 	UINT32B trklength;
 
 
 	debug(512, "midi_header");
 
-	trklength = write(mfile, "MThd\0\0\0\6\0", 9);
+	trklength = midiwrite((unsigned char *) "MThd\0\0\0\6\0", 9);
 
 	/* always use format 1 */
 	buff[0] = 1;
@@ -576,12 +571,10 @@ int ntracks;	/* how many tracks are to be written */
 	/* division field. */
 	buff[3] = (unsigned char) (Division >> 8);
 	buff[4] = (unsigned char) (Division & 0xff);
-	midiwrite(mfile, buff, 5);
+	midiwrite(buff, 5);
 
 	/* now do first track, which gives time and key signature info */
-	reset_sigs();
-	track1start = lseek(mfile, 0L, SEEK_CUR);
-	track_header(mfile);
+	track_header();
 	trklength = 0;
 
 	/* if there is a header and the first item to print is centered,
@@ -589,69 +582,82 @@ int ntracks;	/* how many tracks are to be written */
 	if (Header.printdata_p != (struct PRINTDATA *) 0) {
 		if (Header.printdata_p->justifytype == J_CENTER &&
 				Header.printdata_p->string != (char *) 0) {
-			trklength += write_delta(mfile);
+			trklength += write_delta();
 			buff[0] = 0xff;
 			buff[1] = 0x01;
-			trklength += write(mfile, buff, 2);
-			trklength += midi_wrstring(mfile,
+			trklength += midiwrite(buff, 2);
+			trklength += midi_wrstring(
 					Header.printdata_p->string, YES);
 		}
 	}
 	/* do default time signature if necessary */
 	if (Time_specified_by_user == NO) {
-		trklength += midi_timesig(mfile);
+		trklength += midi_timesig();
 	}
 
 	/* do default key signature if necessary */
 	if (Key_specified_by_user == NO) {
-		trklength += midi_keysig(mfile, eff_key(0), Score.is_minor);
+		trklength += midi_keysig(eff_key(0), Score.is_minor);
 	}
 
 	/* output usecs per quarter note */
-	trklength += write(mfile, "\0\377Q\3", 4);
+	trklength += midiwrite((unsigned char *) "\0\377Q\3", 4);
 	buff[0] = (Usec_per_quarter_note >> 16) & 0xff;
 	buff[1] = (Usec_per_quarter_note >> 8) & 0xff;
 	buff[2] = Usec_per_quarter_note & 0xff;
-	trklength += write(mfile, buff, 3);
+	trklength += midiwrite(buff, 3);
 
 	/* do everything else for track 1 */
-	trklength += all_midi(mfile);
+	trklength += all_midi();
 
 	/* end of track marker */
-	trklength += write(mfile, "\0\377/\0", 4);
-	fix_track_size(mfile, track1start, trklength);
+	trklength += midiwrite((unsigned char *) "\0\377/\0", 4);
+	fix_track_size(trklength);
 }
 
 
-/* write a MIDI track header */
+/* write a MIDI track header for the current track, and initialize the
+ * rest of its state */
 
 static void
-track_header(mfile)
-
-int mfile;	/* write track header to this file descriptor */
+track_header()
 
 {
+	int i;
+
+
 	debug(512, "track_header");
 
-	midiwrite(mfile, (unsigned char *) "MTrk\0\0\0\0", 8);
+	Midi_track_p->start = Midi_track_p->length;
+	midiwrite((unsigned char *) "MTrk\0\0\0\0", 8);
+	Midi_track_p->size = 0;
 
 	/* reset time reference */
-	Absolute_time = Sum_of_deltas = Zero;
+	Midi_track_p->absolute_time = Midi_track_p->sum_of_deltas = Zero;
 
 	/* reset "running status" */
-	Status = 0;
+	Midi_track_p->status = 0;
+
+	Midi_track_p->channel = 0;
+	Midi_track_p->pedbounce = NO;
+	for (i = 0; i < MAXHAND; i++) {
+		Midi_track_p->onvelocity[i] = (char) DFLT_VELOCITY;
+		Midi_track_p->offvelocity[i] = (char) 0;
+	}
+	init_tie_table();
+	reset_sigs();
 }
 
 
-/* write MIDI info. Return number of bytes written to mfile */
+/* write MIDI info. Return number of bytes written */
 
 static UINT32B
-write_midi_data(mfile, gs_p)
+write_midi_data(gs_p)
 
-int mfile;		/* write MIDI data to this file descriptor */
 struct GRPSYL *gs_p;	/* write info about these chords */
 
 {
+	struct MIDITRACK *trk_p = Midi_track_p;	/* current track */
 	UINT32B bytes = 0;	/* number of bytes written */
 	int n;			/* walk through notes of chord */
 	unsigned char buff[4];	/* temp storage for MIDI data */
@@ -666,7 +672,7 @@ struct GRPSYL *gs_p;	/* write info about these chords */
 		/* do any MIDI stuffs that happen right on this beat. They
 		 * should happen after notes have been turned off for previous
 		 * chord but before the notes for the following chord */
-		bytes += do_midi_stuff(Zero, mfile, NO);
+		bytes += do_midi_stuff(Zero, NO);
 
 		/* if rest or space, just keep track of time used. */
 		if ( gs_p->grpcont != GC_NOTES) {
@@ -675,10 +681,10 @@ struct GRPSYL *gs_p;	/* write info about these chords */
 			 * at the right time */
 			if (gs_p->grpcont == GC_SPACE && gs_p->grpvalue == GV_ZERO) {
 				adj4squeeze(gs_p->fulltime);
-				bytes += do_midi_stuff(Zero, mfile, NO);
+				bytes += do_midi_stuff(Zero, NO);
 			}
 			else {
-				bytes += do_midi_stuff(gs_p->fulltime, mfile, NO);
+				bytes += do_midi_stuff(gs_p->fulltime, NO);
 			}
 			continue;
 		}
@@ -693,32 +699,32 @@ struct GRPSYL *gs_p;	/* write info about these chords */
 			/* if this note is tied from previous, it is already
 			 * turned on, so just mark off that we've done the tie.
 			 */
-			if (Tie_table[raw_notenum] == YES) {
-				Tie_table[raw_notenum] = NO;
+			if (trk_p->tie_table[raw_notenum] == YES) {
+				trk_p->tie_table[raw_notenum] = NO;
 			}
 
 			else {
 				/* not tied from previous, so turn note on */
-				bytes += write_delta(mfile);
+				bytes += write_delta();
 	
 				/* first time through have to put the status.
 				 * After that we can use running status */
-				newstatus = (0x90 | Channel) & 0xff;
-				if (Status != newstatus) {
+				newstatus = (0x90 | trk_p->channel) & 0xff;
+				if (trk_p->status != newstatus) {
 					buff[0] = (unsigned char) newstatus;
-					midiwrite(mfile, buff, 1);
-					Status = newstatus;
+					midiwrite(buff, 1);
+					trk_p->status = newstatus;
 					bytes++;
 				}
 
 				buff[0] = (unsigned char) notenum;
-				buff[1] = (unsigned char) Onvelocity[n];
-				midiwrite(mfile, buff, 2);
+				buff[1] = (unsigned char) trk_p->onvelocity[n];
+				midiwrite(buff, 2);
 				bytes += 2;
 			}
 		}
 		
-		bytes += do_midi_stuff(gs_p->fulltime, mfile, NO);
+		bytes += do_midi_stuff(gs_p->fulltime, NO);
 
 		/* now turn all the notes off, unless tied */
 		for (n = 0; n < gs_p->nnotes; n++) {
@@ -745,7 +751,7 @@ struct GRPSYL *gs_p;	/* write info about these chords */
 			 * to have parse set a new tied_from_voice field
 			 * in NOTE, so our MIDI code earlier in this function
 			 * could treat that field being other than NO_TO_VOICE
-			 * like Tie_table[raw_notenum] being YES.
+			 * like tie_table[raw_notenum] being YES.
 			 * But only if the channels match,
 			 * which we wouldn't know without considerable work.
 			 * Basically, we would have to walk through the
@@ -766,7 +772,7 @@ struct GRPSYL *gs_p;	/* write info about these chords */
 			 */
 			if ( ((gs_p->notelist[n].tie == YES) || (gs_p->tie == YES) )
 				&& (gs_p->notelist[n].tied_to_voice == NO_TO_VOICE)) {
-					Tie_table[raw_notenum] = YES;
+					trk_p->tie_table[raw_notenum] = YES;
 			}
 			else {
 				if (gs_p->notelist[n].tied_to_voice != NO_TO_VOICE) {
@@ -774,36 +780,40 @@ struct GRPSYL *gs_p;	/* write info about these chords */
 					"tie to another voice is not supported for MIDI, so will be omitted; try using ifdef MIDI to tie to same voice");
 				}
 				/* not tied to next, so turn off */
-				bytes += write_delta(mfile);
+				bytes += write_delta();
 
 				/* use note on with onvelocity 0 (which means
 				 * note off), unless user explicitly set an
 				 * off velocity */
-				if (Offvelocity[n] != 0) {
-					newstatus = (0x80 | Channel) & 0xff;
+				if (trk_p->offvelocity[n] != 0) {
+					newstatus = (0x80 | trk_p->channel)
+									& 0xff;
 				}
 				else {
-					newstatus = (0x90 | Channel) & 0xff;
+					newstatus = (0x90 | trk_p->channel)
+									& 0xff;
 				}
-				if (Status != newstatus) {
+				if (trk_p->status != newstatus) {
 					buff[0] = (unsigned char) newstatus;
-					midiwrite(mfile, buff, 1);
-					Status = newstatus;
+					midiwrite(buff, 1);
+					trk_p->status = newstatus;
 					bytes++;
 				}
 				buff[0] = (unsigned char) notenum;
-				buff[1] = (unsigned char) Offvelocity[n];
-				midiwrite(mfile, buff, 2);
+				buff[1] = (unsigned char) trk_p->offvelocity[n];
+				midiwrite(buff, 2);
 				bytes += 2;
 
 				/* If we had to defer the setting of
 				 * sharps/flats because of a tie into the
 				 * measure, do that now. */
-				if (Deferred_acc[raw_notenum][0] !=
+				if (trk_p->deferred_acc[raw_notenum][0] !=
 						(char) NO_DEFERRED_ACC) {
-					COPY_ACCS(Accidental_map[raw_notenum],
-						  Deferred_acc[raw_notenum]);
-					Deferred_acc[raw_notenum][0] = NO_DEFERRED_ACC;
+					COPY_ACCS(
+					    trk_p->accidental_map[raw_notenum],
+					    trk_p->deferred_acc[raw_notenum]);
+					trk_p->deferred_acc[raw_notenum][0]
+							= NO_DEFERRED_ACC;
 				}
 			}
 		}
@@ -811,7 +821,7 @@ struct GRPSYL *gs_p;	/* write info about these chords */
 
 	/* do any midi events that happen at the end of the measure after
 	 * the notes. */
-	bytes += do_midi_stuff(Zero, mfile, NO);
+	bytes += do_midi_stuff(Zero, NO);
 
 	return(bytes);
 }
@@ -820,11 +830,10 @@ struct GRPSYL *gs_p;	/* write info about these chords */
 /* write out delta value. Return number of bytes written */
 
 UINT32B
-write_delta(mfile)
-
-int mfile;	/* file descriptor of MIDI file */
+write_delta()
 
 {
+	struct MIDITRACK *trk_p = Midi_track_p;	/* current track */
 	UINT32B idelta;		/* delta rounded to 32-bit integer */
 	RATIONAL delta;
 	RATIONAL rounded;	/* idelta converted back to RATIONAL */
@@ -832,31 +841,31 @@ int mfile;	/* file descriptor of MIDI file */
 
 	/* avoid rational overflow, which can happen under certain
 	 * circumstances with lots of grace, rolls, etc */
-	while (Absolute_time.n > MAXMIDI_RAT
-				|| Absolute_time.d > MAXMIDI_RAT) {
+	while (trk_p->absolute_time.n > MAXMIDI_RAT
+				|| trk_p->absolute_time.d > MAXMIDI_RAT) {
 		/* avoid rational divide by zero */
-		if (Absolute_time.d > 1) {
-			Absolute_time.n >>= 1;
-			Absolute_time.d >>= 1;
-			rred ( &Absolute_time );
+		if (trk_p->absolute_time.d > 1) {
+			trk_p->absolute_time.n >>= 1;
+			trk_p->absolute_time.d >>= 1;
+			rred ( &trk_p->absolute_time );
 		}
 		else {
 			break;
 		}
 	}
-	while( Sum_of_deltas.n > MAXMIDI_RAT
-				|| Sum_of_deltas.d > MAXMIDI_RAT) {
-		if (Sum_of_deltas.d > 1) {
-			Sum_of_deltas.n >>= 1;
-			Sum_of_deltas.d >>= 1;
-			rred ( &Sum_of_deltas );
+	while( trk_p->sum_of_deltas.n > MAXMIDI_RAT
+				|| trk_p->sum_of_deltas.d > MAXMIDI_RAT) {
+		if (trk_p->sum_of_deltas.d > 1) {
+			trk_p->sum_of_deltas.n >>= 1;
+			trk_p->sum_of_deltas.d >>= 1;
+			rred ( &trk_p->sum_of_deltas );
 		}
 		else {
 			break;
 		}
 	}
 
-	delta = rsub(Absolute_time, Sum_of_deltas);
+	delta = rsub(trk_p->absolute_time, trk_p->sum_of_deltas);
 	if (LT(delta, Zero)) {
 		delta = Zero;
 	}
@@ -869,7 +878,7 @@ int mfile;	/* file descriptor of MIDI file */
 						/ (double) delta.d) + 0.5);
 
 	/* now convert the rounded-off value back to a RATIONAL,
-	 * and add it to the Sum_of_deltas, so we'll know exactly how far
+	 * and add it to the sum_of_deltas, so we'll know exactly how far
 	 * off we are the next time around and can compensate. */
 	rounded.n = idelta;
 	rounded.d = MIDI_FACTOR;
@@ -884,9 +893,9 @@ int mfile;	/* file descriptor of MIDI file */
 		pfatal("arithmetic overflow on MIDI delta calculation, input probably too complex\n  (hint: changing the 'release' parameter might help)");
 	}
 
-	Sum_of_deltas = radd(Sum_of_deltas, rounded);
+	trk_p->sum_of_deltas = radd(trk_p->sum_of_deltas, rounded);
 
-	return(wr_varlength(mfile, idelta));
+	return(wr_varlength(idelta));
 }
 
 
@@ -902,6 +911,7 @@ int staff;	/* which staff note is associated with, for carryacc */
 int *raw_notenum_p;	/* return the note number without accidentals */
 
 {
+	struct MIDITRACK *trk_p = Midi_track_p;	/* current track */
 	int val;
 	int acc_adjust;	/* half steps to adjust note due to accident */
 
@@ -918,8 +928,8 @@ int *raw_notenum_p;	/* return the note number without accidentals */
 	if (standard_acc(note_p->acclist) == '\0') {
 		/* leave accidental as is from before */
 		acc_adjust = 0;
-		if (Accidental_map[val][0] != 0) {
-			switch (Accidental_map[val][1]) {
+		if (trk_p->accidental_map[val][0] != 0) {
+			switch (trk_p->accidental_map[val][1]) {
 			case C_SHARP:
 				acc_adjust = 1;
 				break;
@@ -946,7 +956,7 @@ int *raw_notenum_p;	/* return the note number without accidentals */
 	 */
 	if (svpath(staff, CARRYACCS)->carryaccs == YES || note_p->tie == YES) {
 		standard_to_acclist(Acclets[acc_adjust + 2],
-				Accidental_map[val]);
+				trk_p->accidental_map[val]);
 	}
 
 	/* the top few notes in octave 9 are outside midi range */
@@ -962,9 +972,8 @@ int *raw_notenum_p;	/* return the note number without accidentals */
  * for the length of the multi-rest */
 
 static UINT32B
-midi_multirest(mfile, staff_p, staffno, vno, nummeas)
+midi_multirest(staff_p, staffno, vno, nummeas)
 
-int mfile;		/* MIDI file */
 struct STAFF *staff_p;
 int staffno;
 int vno;	/* voice number */
@@ -993,7 +1002,7 @@ int nummeas;	/* how many measure of rest */
 
 	rat_nummeas.n = nummeas;
 	rat_nummeas.d = 1;
-	return(do_midi_stuff(rmul(rat_nummeas, Score.time), mfile, NO));
+	return(do_midi_stuff(rmul(rat_nummeas, Score.time), NO));
 }
 
 
@@ -1011,7 +1020,7 @@ int all;		/* YES if processing 'all' stuff */
 	struct STUFF *st_p;		/* walk through staff_p->stuff_p */
 
 
-	Midistufflist_p = (struct MIDISTUFF *) 0;
+	Midi_track_p->midistufflist_p = (struct MIDISTUFF *) 0;
 
 	/* Insert entries for any pending gradual changes that should
 	 * occur in this measure. */
@@ -1050,60 +1059,61 @@ int all;		/* YES if processing 'all' stuff */
 }
 
 
-/* given a timeval to add to Absolute_time, see if there are any MIDI
- * STUFF events that come before then. If so, do them first. If timeval
- * is Zero, do any events happening exactly at Absolute_time. In any case
- * update Absolute_time appropriately. Return number of bytes written */
+/* given a timeval to add to the current track's absolute_time, see if there
+ * are any MIDI STUFF events that come before then. If so, do them first.
+ * If timeval is Zero, do any events happening exactly at absolute_time.
+ * In any case update absolute_time appropriately. Return number of bytes
+ * written */
 
 static UINT32B
-do_midi_stuff(timeval, mfile, all)
+do_midi_stuff(timeval, all)
 
 RATIONAL timeval;
-int mfile;		/* MIDI file */
 int all;		/* YES if processing 'all' stuffs */
 
 {
-	RATIONAL new_abs_time;	/* Absolute_time plus timeval */
+	struct MIDITRACK *trk_p = Midi_track_p;	/* current track */
+	RATIONAL new_abs_time;	/* absolute_time plus timeval */
 	struct MIDISTUFF *ms_p;	/* index through MIDISTUFF list */
 	UINT32B bytes = 0;	/* bytes written */
 
 
 	/* If need to bounce pedal, do that now */
-	if (Pedbounce == YES && NE(timeval, Zero)) {
+	if (trk_p->pedbounce == YES && NE(timeval, Zero)) {
 		RATIONAL instant;
 
 		instant.n = 1;
 		instant.d = MIDI_FACTOR;
-		Absolute_time = radd(Absolute_time, instant);
-		bytes += pedswitch(mfile, YES);
-		Absolute_time = rsub(Absolute_time, instant);
-		Pedbounce = NO;
+		trk_p->absolute_time = radd(trk_p->absolute_time, instant);
+		bytes += pedswitch(YES);
+		trk_p->absolute_time = rsub(trk_p->absolute_time, instant);
+		trk_p->pedbounce = NO;
 	}
 
 	/* find out what final time will be */
-	new_abs_time = radd(Absolute_time, timeval);
+	new_abs_time = radd(trk_p->absolute_time, timeval);
 
 	/* go through list of MIDI STUFF, to see if anything to do before
 	 * final time */
-	for (ms_p = Midistufflist_p; ms_p != (struct MIDISTUFF *) 0;  ) {
+	for (ms_p = trk_p->midistufflist_p; ms_p != (struct MIDISTUFF *) 0;  ) {
 
 		if ( LT(ms_p->time, new_abs_time) || (EQ(timeval, Zero) &&
 					EQ(ms_p->time, new_abs_time) ) ) {
 
 			/* an item to do. Do it */
-			Absolute_time = ms_p->time;
-			bytes += midi_item(ms_p->stuff_p, mfile, all);
+			trk_p->absolute_time = ms_p->time;
+			bytes += midi_item(ms_p->stuff_p, all);
 
 			/* free this item and move to next one */
 			ms_p = ms_p->next;
-			FREE(Midistufflist_p);
-			Midistufflist_p = ms_p;
+			FREE(trk_p->midistufflist_p);
+			trk_p->midistufflist_p = ms_p;
 		}
 		else {
 			break;
 		}
 	}
-	Absolute_time = new_abs_time;
+	trk_p->absolute_time = new_abs_time;
 
 	/* return number of bytes written */
 	return(bytes);
@@ -1113,13 +1123,13 @@ int all;		/* YES if processing 'all' stuffs */
 /* handle a MIDI stuff item */
 
 static UINT32B
-midi_item(stuff_p, mfile, all)
+midi_item(stuff_p, all)
 
 struct STUFF *stuff_p;	/* which STUFF to process */
-int mfile;		/* the MIDI file */
 int all;		/* YES if processing "all" type items now */
 
 {
+	struct MIDITRACK *trk_p = Midi_track_p;	/* current track */
 	UINT32B bytes = 0;	/* bytes written */
 	unsigned char buff[8];
 	char *key;		/* midi directive keyword */
@@ -1151,17 +1161,17 @@ int all;		/* YES if processing "all" type items now */
 		switch(next_str_char(&string, &font, &size) & 0xff) {
 
 		case C_BEGPED:
-			bytes += pedswitch(mfile, YES);
+			bytes += pedswitch(YES);
 			break;
 		
 		case C_PEDAL:
-			bytes += pedswitch(mfile, NO);
+			bytes += pedswitch(NO);
 			/* have to put pedal back up after the next chord */
-			Pedbounce = YES;
+			trk_p->pedbounce = YES;
 			break;
 
 		case C_ENDPED:
-			bytes += pedswitch(mfile, NO);
+			bytes += pedswitch(NO);
 			break;
 		
 		default:
@@ -1198,10 +1208,11 @@ int all;		/* YES if processing "all" type items now */
 		if (l_rangecheck(num, MIDI_MIN, MIDI_MAX, KW_program,
 				stuff_p->inputfile, stuff_p->inputlineno)
 				== YES) {
-			bytes = write_delta(mfile);
-			Status = buff[0] = (unsigned char) (0xc0 | Channel);
+			bytes = write_delta();
+			trk_p->status = buff[0] =
+					(unsigned char) (0xc0 | trk_p->channel);
 			buff[1] = (unsigned char) num;
-			bytes += write(mfile, buff, 2);
+			bytes += midiwrite(buff, 2);
 			process_to_list(stuff_p, KW_program,
 				Usec_per_quarter_note, MIDI_MIN, MIDI_MAX);
 		}
@@ -1225,7 +1236,7 @@ int all;		/* YES if processing "all" type items now */
 		if (l_rangecheck(quarter_notes_per_minute, MINQNPM, MAXQNPM,
 				KW_tempo, stuff_p->inputfile,
 				stuff_p->inputlineno) == YES) {
-			bytes = write_delta(mfile);
+			bytes = write_delta();
 			buff[0] = (unsigned char) 0xff;
 			buff[1] = (unsigned char) 0x51;
 			buff[2] = (unsigned char) 0x3;
@@ -1234,8 +1245,8 @@ int all;		/* YES if processing "all" type items now */
 			buff[3] = (Usec_per_quarter_note >> 16) & 0xff;
 			buff[4] = (Usec_per_quarter_note >> 8) & 0xff;
 			buff[5] = (Usec_per_quarter_note & 0xff);
-			bytes += write(mfile, buff, 6);
-			Status = 0;
+			bytes += midiwrite(buff, 6);
+			trk_p->status = 0;
 			process_to_list(stuff_p, KW_tempo,
 				Usec_per_quarter_note, MINQNPM, MAXQNPM);
 		}
@@ -1253,7 +1264,7 @@ int all;		/* YES if processing "all" type items now */
 		num = atoi(arg);
 		if (l_rangecheck(num, 1, MIDI_MAX, KW_onvelocity, stuff_p->inputfile,
 				stuff_p->inputlineno) == YES) {
-			Onvelocity[0] = (char) num;
+			trk_p->onvelocity[0] = (char) num;
 		}
 		/* if there are more velocities given, process them. If
 		 * there are N velocities given, they give the velocities
@@ -1277,7 +1288,7 @@ int all;		/* YES if processing "all" type items now */
 				if (l_rangecheck(num, 1, MIDI_MAX, KW_onvelocity,
 						stuff_p->inputfile,
 						stuff_p->inputlineno) == YES) {
-					Onvelocity[n] = (char) num;
+					trk_p->onvelocity[n] = (char) num;
 				}
 
 				/* point to next velocity, if any, for next
@@ -1287,7 +1298,7 @@ int all;		/* YES if processing "all" type items now */
 			else {
 				/* use the last user-specified velocity for
 				 * all subsequent notes */
-				Onvelocity[n] = (char) num;
+				trk_p->onvelocity[n] = (char) num;
 			}
 		}
 		process_to_list(stuff_p, KW_onvelocity,
@@ -1311,15 +1322,15 @@ int all;		/* YES if processing "all" type items now */
 					stuff_p->inputlineno) == YES) {
 			/* external MIDI channel numbers are 1-16,
 			 * internal are 0-15 */
-			Channel = num - 1;
+			trk_p->channel = num - 1;
 			/* Output a "channel prefix" meta event */
-			bytes = write_delta(mfile);
+			bytes = write_delta();
 			buff[0] = 0xff;
 			buff[1] = 0x20;
 			buff[2] = 0x01;
-			buff[3] = Channel;
-			bytes += write(mfile, buff, 4);
-			Status = 0;
+			buff[3] = trk_p->channel;
+			bytes += midiwrite(buff, 4);
+			trk_p->status = 0;
 			process_to_list(stuff_p, KW_channel,
 				Usec_per_quarter_note, MIDI_MIN, MIDI_MAX);
 		}
@@ -1331,11 +1342,11 @@ int all;		/* YES if processing "all" type items now */
 
 		if (get_param(arg, stuff_p->inputfile, stuff_p->inputlineno,
 					&parmnum, &parmval) == YES) {
-			bytes += write_delta(mfile);
-			Status = buff[0] = 0xb0 | Channel;
+			bytes += write_delta();
+			trk_p->status = buff[0] = 0xb0 | trk_p->channel;
 			buff[1] = (unsigned char) parmnum;
 			buff[2] = (unsigned char) parmval;
-			bytes += write(mfile, buff, 3);
+			bytes += midiwrite(buff, 3);
 			process_to_list(stuff_p, KW_parameter,
 				Usec_per_quarter_note, MIDI_MIN, MIDI_MAX);
 		}
@@ -1354,7 +1365,7 @@ int all;		/* YES if processing "all" type items now */
 		if (l_rangecheck(num, MIDI_MIN, MIDI_MAX, KW_offvelocity,
 				stuff_p->inputfile,
 				stuff_p->inputlineno) == YES) {
-			Offvelocity[0] = (char) num;
+			trk_p->offvelocity[0] = (char) num;
 		}
 		/* if there are more velocities given, process them. 
 		 * See description of onvelocity above for details.
@@ -1368,7 +1379,7 @@ int all;		/* YES if processing "all" type items now */
 				if (l_rangecheck(num, 1, MIDI_MAX, KW_offvelocity,
 						stuff_p->inputfile,
 						stuff_p->inputlineno) == YES) {
-					Offvelocity[n] = (char) num;
+					trk_p->offvelocity[n] = (char) num;
 				}
 
 				/* point to next velocity, if any, for next
@@ -1378,7 +1389,7 @@ int all;		/* YES if processing "all" type items now */
 			else {
 				/* use the last user-specified velocity for
 				 * all subsequent notes */
-				Offvelocity[n] = (char) num;
+				trk_p->offvelocity[n] = (char) num;
 			}
 		}
 		process_to_list(stuff_p, KW_offvelocity,
@@ -1387,46 +1398,47 @@ int all;		/* YES if processing "all" type items now */
 
 	else if (matches(key, leng, KW_hex) == YES) {
 		nix_til(stuff_p, KW_hex);
-		return(midihex(mfile, arg, stuff_p->inputfile, stuff_p->inputlineno));
+		return(midihex(arg, stuff_p->inputfile, stuff_p->inputlineno));
 	}
 	else if (matches(key, leng, KW_text) == YES) {
 		nix_til(stuff_p, KW_text);
-		return(wr_meta(mfile, 0x01, arg));
+		return(wr_meta(0x01, arg));
 	}
 	else if (matches(key, leng, KW_copyright) == YES) {
 		nix_til(stuff_p, KW_copyright);
-		return(wr_meta(mfile, 0x02, arg));
+		return(wr_meta(0x02, arg));
 	}
 	else if (matches(key, leng, KW_name) == YES) {
 		nix_til(stuff_p, KW_name);
-		return(wr_meta(mfile, 0x03, arg));
+		return(wr_meta(0x03, arg));
 	}
 	else if (matches(key, leng, KW_instrument) == YES) {
 		nix_til(stuff_p, KW_instrument);
-		return(wr_meta(mfile, 0x04, arg));
+		return(wr_meta(0x04, arg));
 	}
 	else if (matches(key, leng, KW_marker) == YES) {
 		nix_til(stuff_p, KW_marker);
-		return(wr_meta(mfile, 0x06, arg));
+		return(wr_meta(0x06, arg));
 	}
 	else if (matches(key, leng, KW_cue) == YES) {
 		nix_til(stuff_p, KW_cue);
-		return(wr_meta(mfile, 0x07, arg));
+		return(wr_meta(0x07, arg));
 	}
 
 	else if (matches(key, leng, KW_seqnum) == YES) {
 		num = atoi(arg);
 		if (l_rangecheck(num, 0, 65535, KW_seqnum, stuff_p->inputfile,
 				stuff_p->inputlineno) == YES) {
-			bytes = write_delta(mfile);
+			bytes = write_delta();
 			buff[0] = 0xff;
 			buff[1] = 0x00;
 			buff[2] = 0x02;
 			buff[3] = (num >> 8) & 0xff;
 			buff[4] = num & 0xff;
-			bytes += write(mfile, buff, 5);
-			Status = 0;
-			if (GT(Absolute_time, Zero) || stuff_p->start.count != 0.0) {
+			bytes += midiwrite(buff, 5);
+			trk_p->status = 0;
+			if (GT(trk_p->absolute_time, Zero)
+					|| stuff_p->start.count != 0.0) {
 				l_warning(stuff_p->inputfile, stuff_p->inputlineno,
 				"seqnum is only supposed to be at the very beginning of a song, at time zero");
 			}
@@ -1439,13 +1451,13 @@ int all;		/* YES if processing "all" type items now */
 		if (l_rangecheck(num, MIDI_MIN, MIDI_MAX, KW_port,
 				stuff_p->inputfile, stuff_p->inputlineno)
 				== YES) {
-			bytes = write_delta(mfile);
+			bytes = write_delta();
 			buff[0] = 0xff;
 			buff[1] = 0x21;
 			buff[2] = 0x01;
 			buff[3] = num;
-			bytes += write(mfile, buff, 4);
-			Status = 0;
+			bytes += midiwrite(buff, 4);
+			trk_p->status = 0;
 			process_to_list(stuff_p, KW_port, Usec_per_quarter_note,
 							MIDI_MIN, MIDI_MAX);
 		}
@@ -1458,11 +1470,11 @@ int all;		/* YES if processing "all" type items now */
 		if (l_rangecheck(num, MIDI_MIN, MIDI_MAX, KW_chanpressure,
 				stuff_p->inputfile, stuff_p->inputlineno)
 				== YES) {
-			bytes += write_delta(mfile);
-			buff[0] = 0xd0 | Channel;
+			bytes += write_delta();
+			buff[0] = 0xd0 | trk_p->channel;
 			buff[1] = (unsigned char) num;
-			bytes += write(mfile, buff, 2);
-			Status = 0;
+			bytes += midiwrite(buff, 2);
+			trk_p->status = 0;
 			process_to_list(stuff_p, KW_chanpressure,
 				Usec_per_quarter_note, MIDI_MIN, MIDI_MAX);
 		}
@@ -1481,9 +1493,8 @@ int all;		/* YES if processing "all" type items now */
  * status to 0. */
 
 static UINT32B
-midihex(mfile, str, fname, lineno)
+midihex(str, fname, lineno)
 
-int mfile;
 char *str;
 char *fname;
 int lineno;
@@ -1494,7 +1505,7 @@ int lineno;
 	unsigned char data;	/* a byte of data to write */
 
 
-	bytes += write_delta(mfile);
+	bytes += write_delta();
 	for (   ; *str != '\0'; str++) {
 
 		/* skip white space */
@@ -1509,7 +1520,7 @@ int lineno;
 			}
 			else {
 				data |= hexdig(*str);
-				midiwrite(mfile, &data, 1);
+				midiwrite(&data, 1);
 				bytes++;
 			}
 			nibble ^= 1;
@@ -1524,7 +1535,7 @@ int lineno;
 	}
 
 	/* set running status to unknown and return number of bytes written */
-	Status = 0;
+	Midi_track_p->status = 0;
 	return(bytes);
 }
 
@@ -1535,9 +1546,8 @@ int lineno;
  */
 
 static UINT32B
-wr_meta(mfile, evtype, str)
+wr_meta(evtype, str)
 
-int mfile;	/* midi file */
 int evtype;	/* meta event type */
 char *str;	/* text string */
 
@@ -1546,14 +1556,14 @@ char *str;	/* text string */
 	unsigned char buff[4];
 
 
-	bytes = write_delta(mfile);
+	bytes = write_delta();
 	buff[0] = 0xff;
 	buff[1] = (unsigned char) (evtype & 0xff);
-	midiwrite(mfile, buff, 2);
+	midiwrite(buff, 2);
 	bytes += 2;
-	bytes += midi_wrstring(mfile, str, NO);
+	bytes += midi_wrstring(str, NO);
 
-	Status = 0;
+	Midi_track_p->status = 0;
 	return(bytes);
 }
 
@@ -1562,9 +1572,7 @@ char *str;	/* text string */
  * list for any "midi all" items */
 
 static UINT32B
-all_midi(mfile)
-
-int mfile;
+all_midi()
 
 {
 	struct MAINLL *mll_p;
@@ -1581,8 +1589,8 @@ int mfile;
 
 	saw_a_staff = NO;
 	if (Tuning_used == YES) {
-		bytes += write_delta(mfile);
-		bytes += out_notemap(mfile, ++curr_notemap);
+		bytes += write_delta();
+		bytes += out_notemap(++curr_notemap);
 	}
 
 	for (mll_p = Mainllhc_p; mll_p != (struct MAINLL *) 0;
@@ -1620,7 +1628,7 @@ int mfile;
 							== GV_ZERO) {
 						adj4squeeze(gs_p->fulltime);
 						bytes += do_midi_stuff(Zero,
-								mfile, YES);
+								YES);
 					}
 					else {
 						if (gs_p->is_multirest == YES) {
@@ -1634,12 +1642,12 @@ int mfile;
 							rred( &fulltime );
 							bytes += do_midi_stuff(
 							fulltime,
-							mfile, YES);
+							YES);
 						}
 						else {
 							bytes += do_midi_stuff(
 							gs_p->fulltime,
-							mfile, YES);
+							YES);
 						}
 					}
 				}
@@ -1647,7 +1655,7 @@ int mfile;
 				/* do any remaining MIDI stuffs. This would
 				 * be any that occur at exactly the time
 				 * signature denominator plus one. */
-				bytes += do_midi_stuff(Zero, mfile, YES);
+				bytes += do_midi_stuff(Zero, YES);
 
 
 				/* can skip any immediately following STAFFs,
@@ -1669,14 +1677,14 @@ int mfile;
 					(mll_p->u.ssv_p->used[SHARPS] == YES ||
 					mll_p->u.ssv_p->used[TRANSPOSITION] == YES ||
 					mll_p->u.ssv_p->used[ADDTRANSPOSITION] == YES) ) {
-				bytes += midi_keysig(mfile,
+				bytes += midi_keysig(
 						eff_key(mll_p->u.ssv_p->staffno),
 						mll_p->u.ssv_p->is_minor);
 			}
 
 			/* if time signature changes, handle that */
 			if (mll_p->u.ssv_p->used[TIME] == YES) {
-				bytes += midi_timesig(mfile);
+				bytes += midi_timesig();
 			}
 
 			/* If any tuning related thing changed since the
@@ -1684,8 +1692,8 @@ int mfile;
 			 * output the new map for that */
 			if (TUNEPARMSSV(mll_p->u.ssv_p)) {
 				if (saw_a_staff == YES) {
-					bytes += write_delta(mfile);
-					bytes += out_notemap(mfile, ++curr_notemap);
+					bytes += write_delta();
+					bytes += out_notemap(++curr_notemap);
 				}
 				saw_a_staff = NO;
 			}
@@ -1694,12 +1702,12 @@ int mfile;
 		case S_BAR:
 			/* rehearsal mark --> midi cue point */
 			if (mll_p->u.bar_p->reh_string != (char *) 0) {
-				bytes += write_delta(mfile);
+				bytes += write_delta();
 				buff[0] = 0xff;
 				buff[1] = 0x07;
-				midiwrite(mfile, buff, 2);
+				midiwrite(buff, 2);
 				bytes += 2;
-				bytes += midi_wrstring(mfile,
+				bytes += midi_wrstring(
 					mll_p->u.bar_p->reh_string, YES);
 			}
 			break;
@@ -1726,6 +1734,7 @@ static void
 midi_adjust()
 
 {
+	struct MIDITRACK *trk_p = Midi_track_p;	/* current track */
 	struct MAINLL *mll_p;	/* index through main list */
 	int v;			/* voice index */
 	int got_data = NO;	/* if got any music data yet */
@@ -1754,7 +1763,7 @@ midi_adjust()
 			if (did_all == NO && svpath(mll_p->u.staff_p->staffno,
 					VISIBLE)->visible == YES) {
 				begin_usec = Usec_per_quarter_note;
-				Absolute_time = Zero;
+				trk_p->absolute_time = Zero;
 				prepmidi_stuff(mll_p->u.staff_p, 0, YES);
 				did_all = YES;
 			}
@@ -1762,7 +1771,7 @@ midi_adjust()
 			/* go through all groups, making adjustments */
 			for (v = 0; v < MAXVOICES; v++) {
 				Usec_per_quarter_note = begin_usec;
-				Absolute_time = Zero;
+				trk_p->absolute_time = Zero;
 				adjust_notes(mll_p->u.staff_p->groups_p[v],
 					mll_p->u.staff_p->staffno, v, mll_p);
 			}
@@ -1794,8 +1803,8 @@ midi_adjust()
 			did_all = NO;
 			fix_tempo(YES);
 			/* free up saved stuff info */
-			free_midistuff(Midistufflist_p);
-			Midistufflist_p = (struct MIDISTUFF *) 0;
+			free_midistuff(trk_p->midistufflist_p);
+			trk_p->midistufflist_p = (struct MIDISTUFF *) 0;
 		}
 	}
 }
@@ -1821,6 +1830,7 @@ int v;
 struct MAINLL *mll_p;	/* groups are attached to main list here */
 
 {
+	struct MIDITRACK *trk_p = Midi_track_p;	/* current track */
 	int numgrace = 0;
 	struct GRPSYL *gracelist_p;	/* one or more grace notes */
 	RATIONAL time_adj;		/* adjustment for alt groups */
@@ -2141,7 +2151,8 @@ struct MAINLL *mll_p;	/* groups are attached to main list here */
 			/* handle any rolls */
 			fix_tempo(NO);
 			midi_roll(gs_p, &(mll_p->u.staff_p->groups_p[v]));
-			Absolute_time = radd(Absolute_time, fulltime);
+			trk_p->absolute_time = radd(trk_p->absolute_time,
+								fulltime);
 		}
 	}
 }
@@ -2307,21 +2318,21 @@ struct MAINLL *mll_p;
 /* turn damper pedal switch on or off. Return number of bytes written */
 
 static UINT32B
-pedswitch(mfile, on)
+pedswitch(on)
 
-int mfile;
 int on;		/* YES if to turn damper pedal on, NO if to turn off */
 
 {
+	struct MIDITRACK *trk_p = Midi_track_p;	/* current track */
 	UINT32B bytes;
 	unsigned char buff[4];
 
 
-	bytes = write_delta(mfile);
-	Status = buff[0] = (unsigned char) (0xb0 | Channel);
+	bytes = write_delta();
+	trk_p->status = buff[0] = (unsigned char) (0xb0 | trk_p->channel);
 	buff[1] = (unsigned char) 64;
 	buff[2] = (on ? 127 : 0);
-	bytes += write(mfile, buff, 3);
+	bytes += midiwrite(buff, 3);
 	return(bytes);
 }
 
@@ -2624,9 +2635,10 @@ struct GRPSYL *gs_p;
 static void
 fix_tempo(to_end)
 
-int to_end;	/* if YES, go all the way to end of Midistufflist_p */
+int to_end;	/* if YES, go all the way to end of midistufflist_p */
 
 {
+	struct MIDITRACK *trk_p = Midi_track_p;	/* current track */
 	struct MIDISTUFF *ms_p;		/* index through list of STUFF */
 	char *key;			/* to check for "tempo" */
 	int leng;			/* length of key */
@@ -2635,9 +2647,9 @@ int to_end;	/* if YES, go all the way to end of Midistufflist_p */
 
 
 	/* check stuff in this measure */
-	for (ms_p = Midistufflist_p; ms_p != (struct MIDISTUFF *) 0;
+	for (ms_p = trk_p->midistufflist_p; ms_p != (struct MIDISTUFF *) 0;
 					ms_p = ms_p->next) {
-		if (GE(ms_p->time, Absolute_time) && to_end == NO) {
+		if (GE(ms_p->time, trk_p->absolute_time) && to_end == NO) {
 			/* beyond where we are in time so far */
 			return;
 		}
@@ -2703,8 +2715,8 @@ RATIONAL timeval;	/* adjust by this much */
 	struct MIDISTUFF *ms_p;	/* walk through list of MIDI stuff to do */
 
 
-	for (ms_p = Midistufflist_p; ms_p != (struct MIDISTUFF *) 0;
-					ms_p = ms_p->next) {
+	for (ms_p = Midi_track_p->midistufflist_p;
+				ms_p != (struct MIDISTUFF *) 0; ms_p = ms_p->next) {
 
 		/* adjust the time */
 		ms_p->time = rsub(ms_p->time, timeval);
@@ -2818,7 +2830,7 @@ int linenum;		/* for error message */
 
 
 /* Given a STUFF, create a MIDISTUFF for it, and link it into the proper place
- * in the list pointed to by Midistufflist_p, based on time offset.
+ * in the current track's midistufflist_p, based on time offset.
  */
 
 void
@@ -2827,6 +2839,7 @@ insert_midistufflist(stuff_p)
 struct STUFF *stuff_p;	/* what to add to the list */
 
 {
+	struct MIDITRACK *trk_p = Midi_track_p;	/* current track */
 	struct MIDISTUFF *ms_p;		/* the allocated struct */
 	struct MIDISTUFF **ms_p_p;	/* for inserting into list */
 
@@ -2851,12 +2864,12 @@ struct STUFF *stuff_p;	/* what to add to the list */
 	ms_p->time.n = (INT32B) (4096.0 * ms_p->time.n / ms_p->time.d);
 	ms_p->time.d = 4096;
 
-	ms_p->time = radd(ms_p->time, Absolute_time);
+	ms_p->time = radd(ms_p->time, trk_p->absolute_time);
 
 	ms_p->stuff_p = stuff_p;
 
 	/* Link onto list. */
-	for (ms_p_p = &Midistufflist_p; *ms_p_p != 0;
+	for (ms_p_p = &trk_p->midistufflist_p; *ms_p_p != 0;
 						ms_p_p = &((*ms_p_p)->next)) {
 		if (GT( (*ms_p_p)->time, ms_p->time)) {
 			break;
@@ -115,9 +115,6 @@ struct PENDGRAD {
 	struct PENDGRAD *next;	/* for linked list */
 };
 
-/* This is the list of gradual changes yet to be processed. */
-static struct PENDGRAD *Pendgrad_p;
-
 /* Static functions for this file */
 static struct CRVLIST **make_to_lists P((char *str, int minval, int maxval,
 		int maxlists, char *miditype, int *numpoints_p,
@@ -201,6 +198,7 @@ int minval;		/* minimum value allowed */
 int maxval;		/* maximum value allowed */
 
 {
+	struct MIDITRACK *trk_p = Midi_track_p;	/* current track */
 	char *string;		/* where list starts in stuff_p->string */
 	int param;		/* If parameter, its number, else -1 */
 	struct CRVLIST **to_lists_p_p;	/* array of linked lists of "to"
@@ -371,8 +369,8 @@ int maxval;		/* maximum value allowed */
 	 * Subsequent measures will be handled via do_gradual_midi() call. */
 	if (do_1_pending_gradual_midi(pendinfo_p) == YES) {
 		/* More to do in subsequent measures, so link onto list. */
-		pendinfo_p->next = Pendgrad_p;
-		Pendgrad_p = pendinfo_p;
+		pendinfo_p->next = trk_p->pendgrad_p;
+		trk_p->pendgrad_p = pendinfo_p;
 	}
 }
 
@@ -651,13 +649,14 @@ void
 do_pending_gradual_midi()
 
 {
+	struct MIDITRACK *trk_p = Midi_track_p;	/* current track */
 	struct PENDGRAD *pendinfo_p;	/* walk through pending list */
 	struct PENDGRAD *next_p;	/* in case we delete the current */
 	struct PENDGRAD **parent_p_p;	/* for closing gap when deleting */
 
 
-	for (pendinfo_p = Pendgrad_p, parent_p_p = &Pendgrad_p; pendinfo_p != 0;
-					pendinfo_p = next_p) {
+	for (pendinfo_p = trk_p->pendgrad_p, parent_p_p = &(trk_p->pendgrad_p);
+			pendinfo_p != 0; pendinfo_p = next_p) {
 
 		/* In case we need to delete the current... */
 		next_p = pendinfo_p->next;
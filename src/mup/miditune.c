@@ -348,6 +348,7 @@ int num_accs;			/* number of accs in that table */
 struct ACCINFO *def_accinfo_p;	/* default info for the std accs */
 
 {
+	struct MIDITRACK *trk_p = Midi_track_p;	/* current track */
 	int n;				/* index into nnotes */
 	struct NOTE *note_p;		/* the note we are working on */
 	struct MIDINOTE *slot_p;	/* points at a place in array */
@@ -384,10 +385,12 @@ struct ACCINFO *def_accinfo_p;	/* default info for the std accs */
 			 * If we had to defer the setting of accs because of a
 			 * tie into the measure, do that now.
 			 */
-			if (Deferred_acc[raw_notenum][0] != NO_DEFERRED_ACC) {
-				COPY_ACCS(Accidental_map[raw_notenum],
-					Deferred_acc[raw_notenum]);
-				Deferred_acc[raw_notenum][0] = NO_DEFERRED_ACC;
+			if (trk_p->deferred_acc[raw_notenum][0]
+						!= NO_DEFERRED_ACC) {
+				COPY_ACCS(trk_p->accidental_map[raw_notenum],
+					trk_p->deferred_acc[raw_notenum]);
+				trk_p->deferred_acc[raw_notenum][0]
+						= NO_DEFERRED_ACC;
 			}
 
 			/*
@@ -550,12 +553,15 @@ struct NOTE *note_p;		/* the note we're working on */
 int raw_notenum;		/* note number of the white note */
 
 {
+	struct MIDITRACK *trk_p = Midi_track_p;	/* current track */
+
+
 	if (note_p->acclist[0] == '\0') {
 		/*
 		 * Note has no accs, so copy from whatever is remembered from
 		 * key sig or prevous note.
 		 */
-		COPY_ACCS(acclist, Accidental_map[raw_notenum]);
+		COPY_ACCS(acclist, trk_p->accidental_map[raw_notenum]);
 	} else {
 		/*
 		 * Note has acc(s).  Copy them.  Also, if the user wants
@@ -565,7 +571,8 @@ int raw_notenum;		/* note number of the white note */
 		COPY_ACCS(acclist, note_p->acclist);
 		if (svpath(staff, CARRYACCS)->carryaccs == YES ||
 				note_p->tie == YES) {
-			COPY_ACCS(Accidental_map[raw_notenum], note_p->acclist);
+			COPY_ACCS(trk_p->accidental_map[raw_notenum],
+							note_p->acclist);
 		}
 	}
 
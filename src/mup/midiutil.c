@@ -47,15 +47,26 @@
 #ifdef __WATCOMC__
 #include <io.h>
 #endif
+#include <string.h>
 #include "defines.h"
 #include "structs.h"
 #include "globals.h"
+#ifdef HAVE_WRITEV
+#include <sys/uio.h>
+#endif
+
+/* Initial size of the buffer for each MIDI track */
+#define MIDIBUFSIZE	(4096)
+
+/* Most buffers to hand to writev at once. POSIX only promises 16. */
+#define MIDI_IOV	(16)
 
-/* Saved signature values to avoid writing events if no actual change */
-static short Curr_sharps;
-static short Curr_is_minor;
-static short Curr_timenum;
-static short Curr_timeden;
+/* The MIDI file is built up in memory, one buffer per track, and then
+ * written all at once, so that track sizes can be filled in without
+ * seeking back in the file, and it doesn't take a system call for every
+ * little event. The first track's buffer also holds the file header. */
+static struct MIDITRACK *Miditracks;
+static int Num_miditracks;	/* how many elements Miditracks has */
 
 static struct GRPSYL *create_prev_grp P((struct MAINLL *mll_p, int staffno,
 		int v));
@@ -70,39 +81,137 @@ static void propogate_accidental P((struct NOTE *note_p, RATIONAL begin_time,
 		RATIONAL end_time, struct GRPSYL *gs_p));
 static void mv_skipped_midi P((struct STUFF *stuff_p, int staffno,
 		struct MAINLL *topstaff_mll_p));
+static void midiwrite_all P((int fd, unsigned char *data, int length));
 
 
-/* seek back to where header size is in file, and fill in the correct size,
- * now that we know what it is. */
+/* Allocate the state and buffers for the given number of MIDI tracks,
+ * all empty, and make the first one current. */
 
 void
-fix_track_size(mfile, track_start, track_size)
+alloc_midi_tracks(ntracks)
+
+int ntracks;
+
+{
+	debug(512, "alloc_midi_tracks");
+
+	CALLOC(MIDITRACK, Miditracks, ntracks);
+	Num_miditracks = ntracks;
+	set_midi_track(0);
+}
+
+
+/* Make the given track the one that MIDI data gets written to, and whose
+ * state is used. */
+
+void
+set_midi_track(t)
+
+int t;		/* track index */
+
+{
+	if (t < 0 || t >= Num_miditracks) {
+		pfatal("invalid MIDI track %d", t);
+	}
+	Midi_track_p = &(Miditracks[t]);
+}
+
+
+/* Now that the track size is known, fill it in to the header of the
+ * current track, where the track header put zeros. */
+
+void
+fix_track_size(track_size)
 
-int mfile;		/* file descriptor of MIDI file */
-long track_start;	/* offset in file where size needs to be put */
 long track_size;	/* track length in bytes */
 
 {
-	unsigned char buff[4];
+	unsigned char *buff;
 
 
 	debug(512, "fix_track_size");
 
-	/* go to where track size is stored in file */
-	(void) lseek(mfile, track_start + 4, SEEK_SET);
+	if (Midi_track_p == (struct MIDITRACK *) 0
+			|| Midi_track_p->length < Midi_track_p->start + 8) {
+		pfatal("fix_track_size called with no track header");
+	}
 
 	/* convert to 4-byte number with correct byte ordering regardless
 	 * of machine byte ordering */
+	buff = Midi_track_p->data + Midi_track_p->start + 4;
 	buff[0] = (track_size >> 24) & 0xff;
 	buff[1] = (track_size >> 16) & 0xff;
 	buff[2] = (track_size >> 8) & 0xff;
 	buff[3] = track_size & 0xff;
-	midiwrite(mfile, buff, 4);
+}
+
+
+/* Write out everything that has been buffered for the MIDI file, all
+ * the tracks at once, and free the buffers. */
+
+void
+flush_midi(mfile)
+
+int mfile;		/* file descriptor of MIDI file */
+
+{
+	int t;
+#ifdef HAVE_WRITEV
+	struct iovec iov[MIDI_IOV];
+	int n;
+	ssize_t expected;
+	ssize_t ret;
+	int i;
+#endif
 
-	/* go back to end of file in case there are more track to write */
-	(void) lseek(mfile, 0L, SEEK_END);
+
+	debug(512, "flush_midi");
+
+#ifdef HAVE_WRITEV
+	/* writev can only take so many at a time, so do them in batches */
+	for (t = 0; t < Num_miditracks; t += n) {
+		expected = 0;
+		for (n = 0; n < MIDI_IOV && t + n < Num_miditracks; n++) {
+			iov[n].iov_base = (void *) Miditracks[t + n].data;
+			iov[n].iov_len = Miditracks[t + n].length;
+			expected += Miditracks[t + n].length;
+		}
+		if ((ret = writev(mfile, iov, n)) != expected) {
+			/* maybe it was only a partial write; do the rest
+			 * one buffer at a time */
+			if (ret < 0) {
+				ufatal("write of midi file failed");
+			}
+			for (i = 0; i < n; i++) {
+				if (ret >= (ssize_t) iov[i].iov_len) {
+					ret -= iov[i].iov_len;
+					continue;
+				}
+				midiwrite_all(mfile,
+					(unsigned char *) iov[i].iov_base + ret,
+					(int) (iov[i].iov_len - ret));
+				ret = 0;
+			}
+		}
+	}
+#else
+	for (t = 0; t < Num_miditracks; t++) {
+		midiwrite_all(mfile, Miditracks[t].data,
+					(int) Miditracks[t].length);
+	}
+#endif
+
+	for (t = 0; t < Num_miditracks; t++) {
+		if (Miditracks[t].data != (unsigned char *) 0) {
+			FREE(Miditracks[t].data);
+		}
+	}
+	FREE(Miditracks);
+	Miditracks = (struct MIDITRACK *) 0;
+	Num_miditracks = 0;
+	Midi_track_p = (struct MIDITRACK *) 0;
 }
-
+
 
 /* given an octave mark string, return number of octaves to tranpose (could
  * be negative if transposing down) */
@@ -280,9 +389,8 @@ int ch;
 /* return number of bytes written */
 
 UINT32B
-midi_wrstring(mfile, str, internalform)
+midi_wrstring(str, internalform)
 
-int mfile;	/* MIDI file */
 char *str;	/* string to write to file */
 int internalform;	/* YES if str is in Mup format, NO if just ASCII,
 			 * C-style null-terminated string to be copied */
@@ -298,13 +406,13 @@ int internalform;	/* YES if str is in Mup format, NO if just ASCII,
 	if (internalform == YES) {
 		buff = ascii_str(str, NO, YES, TM_NONE);
 		length = strlen(buff);
-		bytes = wr_varlength(mfile, (UINT32B) length);
-		bytes += write(mfile, buff, (unsigned) length);
+		bytes = wr_varlength((UINT32B) length);
+		bytes += midiwrite((unsigned char *) buff, length);
 	}
 	else {
 		length = strlen(str);
-		bytes = wr_varlength(mfile, (UINT32B) length);
-		bytes += write(mfile, str, (unsigned) length);
+		bytes = wr_varlength((UINT32B) length);
+		bytes += midiwrite((unsigned char *) str, length);
 	}
 
 	/* return number of bytes written */
@@ -316,9 +424,8 @@ int internalform;	/* YES if str is in Mup format, NO if just ASCII,
  * Return number of bytes written. */
 
 UINT32B
-wr_varlength(mfile, num)
+wr_varlength(num)
 
-int mfile;	/* MIDI file */
 UINT32B num;
 
 {
@@ -343,7 +450,7 @@ UINT32B num;
 		}
 	}
 	buff[i] = num & 0x7f;
-	midiwrite(mfile, buff, (unsigned) (i + 1));
+	midiwrite(buff, (unsigned) (i + 1));
 	return (UINT32B) (i+1);
 }
 
@@ -357,42 +464,45 @@ UINT32B num;
 void
 reset_sigs()
 {
+	struct MIDITRACK *trk_p = Midi_track_p;	/* current track */
+
+
 	/* Set to impossible values to ensure a mismatch */
-	Curr_sharps = -9999;
-	Curr_is_minor = UNSET;
-	Curr_timenum = -9999;
-	Curr_timeden = -9999;
+	trk_p->curr_sharps = -9999;
+	trk_p->curr_is_minor = UNSET;
+	trk_p->curr_timenum = -9999;
+	trk_p->curr_timeden = -9999;
 }
 
 
 /* do key signature. Return number of bytes written */
 
 UINT32B
-midi_keysig(mfile, sharps, is_minor)
+midi_keysig(sharps, is_minor)
 
-int mfile;
 int sharps;
 int is_minor;	/* YES if minor */
 
 {
+	struct MIDITRACK *trk_p = Midi_track_p;	/* current track */
 	UINT32B bytes;
 	unsigned char buff[8];
 
 
 	/* If same as already is, don't bother */
-	if (sharps == Curr_sharps && is_minor == Curr_is_minor) {
+	if (sharps == trk_p->curr_sharps && is_minor == trk_p->curr_is_minor) {
 		return(0);
 	}
-	Curr_sharps = sharps;
-	Curr_is_minor = is_minor;
+	trk_p->curr_sharps = sharps;
+	trk_p->curr_is_minor = is_minor;
 
-	bytes = write_delta(mfile);
+	bytes = write_delta();
 	buff[0] = 0xff;
 	buff[1] = 0x59;
 	buff[2] = 0x02;
 	buff[3] = (char) sharps;
 	buff[4] = (is_minor == YES ? 1 : 0);
-	midiwrite(mfile, buff, 5);
+	midiwrite(buff, 5);
 
 	return(bytes + 5);
 }
@@ -401,10 +511,10 @@ int is_minor;	/* YES if minor */
 /* write out the timesig in Score SSV. Return number of bytes written */
 
 UINT32B
-midi_timesig(mfile)
+midi_timesig()
 
-int mfile;
 {
+	struct MIDITRACK *trk_p = Midi_track_p;	/* current track */
 	UINT32B bytes;
 	unsigned char buff[8];
 
@@ -417,13 +527,14 @@ int mfile;
 	}
 
 	/* If same as already is, don't bother */
-	if (Score.timenum == Curr_timenum && Score.timeden == Curr_timeden) {
+	if (Score.timenum == trk_p->curr_timenum
+				&& Score.timeden == trk_p->curr_timeden) {
 		return(0);
 	}
-	Curr_timenum = Score.timenum;
-	Curr_timeden = Score.timeden;
+	trk_p->curr_timenum = Score.timenum;
+	trk_p->curr_timeden = Score.timeden;
 
-	bytes = write_delta(mfile);
+	bytes = write_delta();
 	buff[0] = 0xff;
 	buff[1] = 0x58;
 	buff[2] = 0x04;
@@ -431,7 +542,7 @@ int mfile;
 	buff[4] = (unsigned char) drmo(Score.timeden);
 	buff[5] = clocks(Score.timeden);
 	buff[6] = 0x8;
-	bytes += write(mfile, buff, 7);
+	bytes += midiwrite(buff, 7);
 	return(bytes);
 }
 
@@ -1669,6 +1780,7 @@ init_accidental_map(staffno)
 int staffno;
 
 {
+	struct MIDITRACK *trk_p = Midi_track_p;	/* current track */
 	register int n;
 
 	/* first clear the map for all MIDI notes */
@@ -1678,14 +1790,14 @@ int staffno;
 		 * but mark that we will need to set the key signature
 		 * value later, after the tie ends. Otherwise we set it
 		 * immediately. */
-		if (Tie_table[n] == YES) {
+		if (trk_p->tie_table[n] == YES) {
 			/* set to zero for now. Will set to something else
 			 * in mark_accidental later if appropriate. */
-			standard_to_acclist('n', Deferred_acc[n]);
+			standard_to_acclist('n', trk_p->deferred_acc[n]);
 		}
 		else {
-			standard_to_acclist('n', Accidental_map[n]);
-			Deferred_acc[n][0] = NO_DEFERRED_ACC;
+			standard_to_acclist('n', trk_p->accidental_map[n]);
+			trk_p->deferred_acc[n][0] = NO_DEFERRED_ACC;
 		}
 	}
 
@@ -1766,7 +1878,7 @@ init_tie_table()
 
 
 	for (i = 0; i < MAXMIDINOTES; i++) {
-		Tie_table[i] = NO;
+		Midi_track_p->tie_table[i] = NO;
 	}
 }
 
@@ -1781,13 +1893,16 @@ int pitch_offset;	/* 0 = C, 2 = D, 4 = E, 5 = F, 7 = G, 9 = A, 11 = B */
 int acc;		/* 1 = sharp, -1 = flat */
 
 {
+	struct MIDITRACK *trk_p = Midi_track_p;	/* current track */
 	register int n;
 
 	for (n = pitch_offset; n < MAXMIDINOTES; n += 12) {
-		if (Tie_table[n] == YES) {
-			standard_to_acclist(Acclets[acc+2], Deferred_acc[n]);
+		if (trk_p->tie_table[n] == YES) {
+			standard_to_acclist(Acclets[acc+2],
+						trk_p->deferred_acc[n]);
 		} else {
-			standard_to_acclist(Acclets[acc+2], Accidental_map[n]);
+			standard_to_acclist(Acclets[acc+2],
+						trk_p->accidental_map[n]);
 		}
 	}
 }
@@ -1827,9 +1942,8 @@ unsigned char *value_p;
 /* Output a tuning map to MIDI file. Returns number of bytes written. */
 
 int
-out_notemap(mfile, map_number)
+out_notemap(map_number)
 
-int mfile;		/* write to this MIDI file */
 int map_number;		/* Use this map number */
 
 {
@@ -1853,11 +1967,11 @@ int map_number;		/* Use this map number */
 
 	/* Output sysex start indicator */
 	tuning_sysex[0] = 0xF0;
-	midiwrite(mfile, tuning_sysex, 1);
+	midiwrite(tuning_sysex, 1);
 	bytes = 1;
 
 	/* Output the sysex length */
-	bytes += wr_varlength(mfile, (UINT32B) length);
+	bytes += wr_varlength((UINT32B) length);
 
 	/* Build and output the tuning command */
 	tuning_sysex[0] = 0x7F;		/* Universal realtime sysex */
@@ -1868,20 +1982,20 @@ int map_number;		/* Use this map number */
 				 * so we don't have to do parameters changes
 				 * to switch maps. */
 	tuning_sysex[5] = numtunings; /* how many note tunings follow */
-	midiwrite(mfile, tuning_sysex, sizeof(tuning_sysex));
+	midiwrite(tuning_sysex, sizeof(tuning_sysex));
 	bytes += sizeof(tuning_sysex);
 
 	/* Output each tuning as note number and 3 byte frequency value */
 	for (i = 0; i < numtunings; i++) {
 		tuning_sysex[0] = notefreq(map_number, i, &freq);
 		freq2tuningval(freq, &(tuning_sysex[1]) );
-		midiwrite(mfile, tuning_sysex, 4);
+		midiwrite(tuning_sysex, 4);
 		bytes += 4;
 	}
 
 	/* Add end-of-sysex */
 	tuning_sysex[0] = 0xF7;
-	midiwrite(mfile, tuning_sysex, 1);
+	midiwrite(tuning_sysex, 1);
 	bytes++;
 
 	return(bytes);
@@ -1940,6 +2054,40 @@ char *acclist;
 }
 
 
+/* Add MIDI data to the buffer for the current track. Nothing actually
+ * goes to the file until flush_midi() is called. Returns the number of
+ * bytes, so callers can keep track of the track size. */
+
+int
+midiwrite(unsigned char * data, int length)
+{
+	struct MIDITRACK *trk_p;
+
+
+	if ((trk_p = Midi_track_p) == (struct MIDITRACK *) 0) {
+		pfatal("midiwrite called with no current track");
+	}
+
+	if (trk_p->length + length > trk_p->alloc) {
+		if (trk_p->alloc == 0) {
+			trk_p->alloc = MIDIBUFSIZE;
+		}
+		while (trk_p->length + length > trk_p->alloc) {
+			trk_p->alloc *= 2;
+		}
+		if (trk_p->data == (unsigned char *) 0) {
+			MALLOCA(unsigned char, trk_p->data, trk_p->alloc);
+		}
+		else {
+			REALLOCA(unsigned char, trk_p->data, trk_p->alloc);
+		}
+	}
+	(void) memcpy(trk_p->data + trk_p->length, data, length);
+	trk_p->length += length;
+	return(length);
+}
+
+
 /* Anyone compiling with -Wunused-result may not get warnings if the
  * return from write() is ignored even if it is explicitly invoked
  * as   (void) write(...)   to make it clear we know it is unused and
@@ -1947,8 +2095,8 @@ char *acclist;
  * check the return.
  */
 
-void
-midiwrite(int fd, unsigned char * data, int length)
+static void
+midiwrite_all(int fd, unsigned char * data, int length)
 {
 	if (write(fd, data, length) != length) {
 		ufatal("write of midi file failed");
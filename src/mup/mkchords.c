@@ -1704,7 +1704,7 @@ struct GRPSYL *src_p;		/* source group, or can be NULL */
 		} else {
 			/* make dest a rest; allocate restc for it */
 			dest_p->grpcont = GC_REST;
-			MALLOCA(float, dest_p->restc, NUMCTYPE);
+			dest_p->restc = new_coords();
 		}
 		return;
 	}
@@ -875,6 +875,14 @@ int all;			/* YES if was "above all" or "below all" */
 				all, staffno,
 				stufflist_p->inputfile,
 				stufflist_p->inputlineno);
+
+		/* Ordinary text, like dynamics marks, is often repeated
+		 * many times, so can share one copy. Other kinds of
+		 * strings may get changed later, so each needs its own. */
+		if (IS_TEXT(stufflist_p->stuff_type)
+				&& ! IS_CHORDLIKE(stufflist_p->modifier)) {
+			newstring = intern_owned(newstring);
+		}
 	}
 	else {
 		newstring = (char *) 0;
@@ -990,7 +998,8 @@ int inputlineno;
  * and "all" to NO. Leave coordinates and next link as 0.
  * Note that the string pointer
  * is copied; it does not make a copy of the string itself, so never call this
- * function more than once with the same string--make a copy. */
+ * function more than once with the same string--make a copy, unless it is
+ * an interned string that nothing will change (see intern.c). */
 
 struct STUFF *
 newSTUFF(string, dist, dist_usage, aligntag,
@@ -0,0 +1,368 @@
+/*
+ Copyright (c) 1995-2024  by Arkkra Enterprises.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms,
+ with or without modification, are permitted provided that
+ the following conditions are met:
+
+ 1. Redistributions of source code must retain
+ the above copyright notice, this list of conditions
+ and the following DISCLAIMER.
+
+ 2. Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and
+ the following DISCLAIMER in the documentation and/or
+ other materials provided with the distribution.
+
+ 3. Any additions, deletions, or changes to the original files
+ must be clearly indicated in accompanying documentation,
+ including the reasons for the changes,
+ and the names of those who made the modifications.
+
+	DISCLAIMER
+
+ THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS
+ OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*
+ * Name:	phase.c
+ *
+ * Description:	This file contains functions for the -T option, which
+ *		reports how long each phase of Mup took (parsing, and each
+ *		of the placement passes, and printing), in wall clock time
+ *		and CPU time, how much the peak memory use grew, and how many
+ *		of the things counted in Stat_count happened during it.
+ *		After that come counts of the main kinds of things in the
+ *		main list, which give an idea of how big the song is.
+ *		The report goes to stderr, either as a table meant for
+ *		people to read, or as JSON, for scripts that compare runs.
+ *
+ *		main() calls phase() at the start of each phase, which also
+ *		ends the previous one, and phase_report() at the end.
+ *		Without -T, phase() does nothing, so it costs nothing.
+ */
+
+#include "defines.h"
+#include "structs.h"
+#include "globals.h"
+
+#ifdef HAVE_GETRUSAGE
+#include <sys/time.h>
+#include <sys/resource.h>
+#else
+#include <time.h>
+#endif
+
+/* report formats */
+#define PF_NONE		(0)	/* no -T option, so no report */
+#define PF_TABLE	(1)
+#define PF_JSON		(2)
+
+/* most phases there can be */
+#define MAXPHASES	(32)
+
+/* What things are like at some moment */
+struct PHSAMPLE {
+	double wall;		/* time of day, in seconds */
+	double cpu;		/* CPU time used so far, in seconds */
+	long maxrss;		/* peak memory use so far, in Kbytes */
+	long stats[NUMSTATS];	/* copy of Stat_count */
+};
+
+/* What happened during one phase */
+struct PHASEINFO {
+	char *name;
+	struct PHSAMPLE start;	/* at the beginning of the phase */
+	struct PHSAMPLE end;	/* at the end of the phase */
+};
+
+static int Phase_format = PF_NONE;
+static struct PHASEINFO Phases[MAXPHASES];
+static int Numphases;
+static int Phase_open = NO;	/* YES if the last phase hasn't ended yet */
+
+/* names of the Stat_count entries, for the report */
+static char *Stat_names[NUMSTATS] = {
+	"allocs", "alloc_bytes", "ssv_replays", "ssv_assigns", "tryabs",
+	"strmet_hits", "strmet_miss", "intern_shared"
+};
+
+static void get_sample P((struct PHSAMPLE *sample_p));
+static void count_mainll P((long *mainll_p, long *grpsyls_p, long *notes_p,
+		long *chords_p));
+
+
+/* Handle the -T option. Return YES if the format is valid, else NO. */
+
+int
+set_phase_report(format)
+
+char *format;		/* "table" or "json" */
+
+{
+	if (strcmp(format, "table") == 0) {
+		Phase_format = PF_TABLE;
+	}
+	else if (strcmp(format, "json") == 0) {
+		Phase_format = PF_JSON;
+	}
+	else {
+		return(NO);
+	}
+	return(YES);
+}
+
+
+/* End the current phase, if any, and start a new one with the given name.
+ * A null name just ends the current phase. */
+
+void
+phase(name)
+
+char *name;		/* name of the phase being started */
+
+{
+	struct PHSAMPLE sample;
+
+
+	if (Phase_format == PF_NONE) {
+		return;
+	}
+
+	get_sample(&sample);
+	if (Phase_open == YES) {
+		Phases[Numphases - 1].end = sample;
+		Phase_open = NO;
+	}
+	if (name == (char *) 0 || Numphases >= MAXPHASES) {
+		return;
+	}
+	Phases[Numphases].name = name;
+	Phases[Numphases].start = sample;
+	Numphases++;
+	Phase_open = YES;
+}
+
+
+/* End the current phase, and print the report, if -T was used */
+
+void
+phase_report()
+
+{
+	struct PHASEINFO *ph_p;
+	struct PHSAMPLE total;		/* whole run, as the sum of phases */
+	long counts[4];			/* things in the main list */
+	static char *count_names[4] = { "mainll", "grpsyls", "notes", "chords" };
+	double hitpct;			/* string metrics cache hit rate */
+	int p;
+	int s;
+
+
+	if (Phase_format == PF_NONE || Numphases == 0) {
+		return;
+	}
+	phase((char *) 0);
+
+	total.wall = total.cpu = 0.0;
+	total.maxrss = Phases[Numphases - 1].end.maxrss - Phases[0].start.maxrss;
+	for (s = 0; s < NUMSTATS; s++) {
+		total.stats[s] = 0;
+	}
+	for (p = 0; p < Numphases; p++) {
+		ph_p = &(Phases[p]);
+		total.wall += ph_p->end.wall - ph_p->start.wall;
+		total.cpu += ph_p->end.cpu - ph_p->start.cpu;
+		for (s = 0; s < NUMSTATS; s++) {
+			total.stats[s] += ph_p->end.stats[s]
+						- ph_p->start.stats[s];
+		}
+	}
+	count_mainll(&counts[0], &counts[1], &counts[2], &counts[3]);
+	if (total.stats[ST_STRMETHITS] + total.stats[ST_STRMETMISSES] > 0) {
+		hitpct = 100.0 * total.stats[ST_STRMETHITS]
+				/ (total.stats[ST_STRMETHITS]
+				+ total.stats[ST_STRMETMISSES]);
+	}
+	else {
+		hitpct = 0.0;
+	}
+
+	if (Phase_format == PF_JSON) {
+		(void) fprintf(stderr, "{\n  \"phases\": [\n");
+		for (p = 0; p < Numphases; p++) {
+			ph_p = &(Phases[p]);
+			(void) fprintf(stderr, "    { \"name\": \"%s\", \"wall\": %.6f, \"cpu\": %.6f, \"maxrss_kb\": %ld",
+					ph_p->name,
+					ph_p->end.wall - ph_p->start.wall,
+					ph_p->end.cpu - ph_p->start.cpu,
+					ph_p->end.maxrss - ph_p->start.maxrss);
+			for (s = 0; s < NUMSTATS; s++) {
+				(void) fprintf(stderr, ", \"%s\": %ld",
+					Stat_names[s], ph_p->end.stats[s]
+					- ph_p->start.stats[s]);
+			}
+			(void) fprintf(stderr, " }%s\n",
+					p < Numphases - 1 ? "," : "");
+		}
+		(void) fprintf(stderr, "  ],\n  \"total\": { \"wall\": %.6f, \"cpu\": %.6f, \"maxrss_kb\": %ld",
+					total.wall, total.cpu, total.maxrss);
+		for (s = 0; s < NUMSTATS; s++) {
+			(void) fprintf(stderr, ", \"%s\": %ld",
+					Stat_names[s], total.stats[s]);
+		}
+		(void) fprintf(stderr, ", \"strmet_hit_pct\": %.1f", hitpct);
+		(void) fprintf(stderr, " },\n  \"counts\": {");
+		for (s = 0; s < NUMELEM(counts); s++) {
+			(void) fprintf(stderr, "%s \"%s\": %ld",
+					s > 0 ? "," : "", count_names[s],
+					counts[s]);
+		}
+		(void) fprintf(stderr, " }\n}\n");
+		return;
+	}
+
+	(void) fprintf(stderr, "\n%-12s %9s %9s %9s", "phase", "wall ms",
+					"cpu ms", "rss KB");
+	for (s = 0; s < NUMSTATS; s++) {
+		(void) fprintf(stderr, " %11s", Stat_names[s]);
+	}
+	(void) fprintf(stderr, "\n");
+	for (p = 0; p <= Numphases; p++) {
+		if (p < Numphases) {
+			ph_p = &(Phases[p]);
+			(void) fprintf(stderr, "%-12s %9.1f %9.1f %9ld",
+				ph_p->name,
+				(ph_p->end.wall - ph_p->start.wall) * 1000.0,
+				(ph_p->end.cpu - ph_p->start.cpu) * 1000.0,
+				ph_p->end.maxrss - ph_p->start.maxrss);
+			for (s = 0; s < NUMSTATS; s++) {
+				(void) fprintf(stderr, " %11ld",
+					ph_p->end.stats[s]
+					- ph_p->start.stats[s]);
+			}
+		}
+		else {
+			(void) fprintf(stderr, "%-12s %9.1f %9.1f %9ld",
+				"total", total.wall * 1000.0,
+				total.cpu * 1000.0, total.maxrss);
+			for (s = 0; s < NUMSTATS; s++) {
+				(void) fprintf(stderr, " %11ld",
+						total.stats[s]);
+			}
+		}
+		(void) fprintf(stderr, "\n");
+	}
+	(void) fprintf(stderr, "\n");
+	for (s = 0; s < NUMELEM(counts); s++) {
+		(void) fprintf(stderr, "%-12s %9ld\n", count_names[s],
+					counts[s]);
+	}
+	(void) fprintf(stderr, "\nstring metrics cache hit rate %.1f%%\n", hitpct);
+}
+
+
+/* Fill in what things are like right now. CPU time includes that of
+ * child processes that have been waited for, so that printing with -j
+ * is accounted for. */
+
+static void
+get_sample(sample_p)
+
+struct PHSAMPLE *sample_p;
+
+{
+#ifdef HAVE_GETRUSAGE
+	struct timeval tv;
+	struct rusage self;
+	struct rusage children;
+
+
+	(void) gettimeofday(&tv, (struct timezone *) 0);
+	(void) getrusage(RUSAGE_SELF, &self);
+	(void) getrusage(RUSAGE_CHILDREN, &children);
+	sample_p->wall = (double) tv.tv_sec + (double) tv.tv_usec / 1000000.0;
+	sample_p->cpu = (double) (self.ru_utime.tv_sec + self.ru_stime.tv_sec
+			+ children.ru_utime.tv_sec + children.ru_stime.tv_sec)
+			+ (double) (self.ru_utime.tv_usec + self.ru_stime.tv_usec
+			+ children.ru_utime.tv_usec
+			+ children.ru_stime.tv_usec) / 1000000.0;
+	sample_p->maxrss = self.ru_maxrss;
+#else
+	/* All we can get is CPU time, so use that for both */
+	sample_p->cpu = (double) clock() / CLOCKS_PER_SEC;
+	sample_p->wall = sample_p->cpu;
+	sample_p->maxrss = 0;
+#endif
+	(void) memcpy(sample_p->stats, Stat_count, sizeof(Stat_count));
+}
+
+
+/* Count the things in the main list */
+
+static void
+count_mainll(mainll_p, grpsyls_p, notes_p, chords_p)
+
+long *mainll_p;		/* return number of MAINLL structs here */
+long *grpsyls_p;	/* return number of GRPSYLs, groups and syllables */
+long *notes_p;		/* return number of notes here */
+long *chords_p;		/* return number of CHORDs here */
+
+{
+	struct MAINLL *mll_p;
+	struct STAFF *staff_p;
+	struct GRPSYL *gs_p;
+	struct CHORD *ch_p;
+	int v;
+
+
+	*mainll_p = *grpsyls_p = *notes_p = *chords_p = 0;
+	for (mll_p = Mainllhc_p; mll_p != (struct MAINLL *) 0;
+					mll_p = mll_p->next) {
+		(*mainll_p)++;
+		switch (mll_p->str) {
+		case S_STAFF:
+			staff_p = mll_p->u.staff_p;
+			for (v = 0; v < MAXVOICES; v++) {
+				for (gs_p = staff_p->groups_p[v];
+						gs_p != (struct GRPSYL *) 0;
+						gs_p = gs_p->next) {
+					(*grpsyls_p)++;
+					if (gs_p->grpcont == GC_NOTES) {
+						*notes_p += gs_p->nnotes;
+					}
+				}
+			}
+			for (v = 0; v < staff_p->nsyllists; v++) {
+				for (gs_p = staff_p->syls_p[v];
+						gs_p != (struct GRPSYL *) 0;
+						gs_p = gs_p->next) {
+					(*grpsyls_p)++;
+				}
+			}
+			break;
+		case S_CHHEAD:
+			for (ch_p = mll_p->u.chhead_p->ch_p;
+					ch_p != (struct CHORD *) 0;
+					ch_p = ch_p->ch_p) {
+				(*chords_p)++;
+			}
+			break;
+		}
+	}
+}
@@ -3154,12 +3154,19 @@ RATIONAL time;			/* time offset to look for */
  */
 
 static int Rectabsize;
+static struct ARENA_MARK Rectab_mark;	/* Scratch_arena before Rectab */
 
 void
 init_rectab()
 {
+	struct ARENA *old_arena_p;
+
+
 	Rectabsize = RECTCHUNK;
+	arena_mark(Scratch_arena, &Rectab_mark);
+	old_arena_p = set_arena(Scratch_arena);
 	MALLOC(RECTAB, Rectab, Rectabsize);
+	(void) set_arena(old_arena_p);
 	Reclim = 0;
 }
 
@@ -3179,6 +3186,9 @@ init_rectab()
 void
 inc_reclim()
 {
+	struct ARENA *old_arena_p;
+
+
 	Reclim++;
 
 	/* if Rectab[Reclim + 1] is still valid, no need to allocate more */
@@ -3186,9 +3196,12 @@ inc_reclim()
 		return;
 	}
 
-	/* must allocate another chunk of rectangles */
+	/* must allocate another chunk of rectangles; since nothing else
+	 * is put in Scratch_arena meanwhile, this usually grows in place */
 	Rectabsize += RECTCHUNK;
+	old_arena_p = set_arena(Scratch_arena);
 	REALLOC(RECTAB, Rectab, Rectabsize);
+	(void) set_arena(old_arena_p);
 }
 
 /*
@@ -3198,13 +3211,15 @@ inc_reclim()
  *
  * Returns:     void
  *
- * Description: This function frees Rectab.
+ * Description: This function frees Rectab, by releasing Scratch_arena back
+ *		to where it was when init_rectab() was called.
  */
 
 void
 free_rectab()
 {
-	FREE(Rectab);
+	arena_release(Scratch_arena, &Rectab_mark);
+	Rectab = (struct RECTAB *) 0;
 }
 
 /*
@@ -59,6 +59,18 @@
 static int Printflag = YES;
 #define OUTP(x)	if (Printflag==YES){(void)printf x;}
 #define OUTPCH(x) if (Printflag == YES){putchar x;}
+/* for constant strings, which don't need to go through printf formatting */
+#define OUTPS(x) if (Printflag == YES){(void)fputs(x, stdout);}
+
+/* Coordinates are output via out2f() rather than printf, since there are so
+ * many of them. It only handles values smaller than this; others go to
+ * printf. It must be small enough that 100 times it fits in an unsigned
+ * long, and that a double that size has plenty of precision past the
+ * hundredths place. */
+#define OUT2F_MAX	(1.0e7)
+/* how close to exactly halfway between hundredths a value can be before we
+ * let printf decide which way it rounds */
+#define OUT2F_FUZZ	(1.0e-6)
 
 
 /* the PostScript commands */
@@ -187,6 +199,11 @@ char *MakeExtendedFont =
 } def\n\n";
 
 static int Pagesprinted = 0;		/* number of pages actually printed */
+static int Print_part = NO;		/* YES if this process is printing only
+					 * part of the pages; see print_part() */
+static long Page1_offset = -1L;		/* when printing part of the pages,
+					 * where in the output the first of
+					 * them begins */
 static int Feednumber;			/* how many pagefeeds we've handled */
 
 
@@ -248,6 +265,7 @@ static void pr_topbot P((struct BLOCKHEAD *blockhead_p, double y));
 static void pr_restarts P((struct MAINLL *mll_p, double y1, double y2,
 		int need_vert_line));
 static void outint P((int val));
+static void out2f P((double val));
 static void pr_wstring P((double x, double y, char *string, int justify,
 		double fullwidth, double horzscale, char * fname, int lineno));
 static void outstring P((double x, double y, double fullwidth, double horzscale,
@@ -315,10 +333,18 @@ print_music()
 	for (mll_p = Mainllhc_p; mll_p != (struct MAINLL *) NULL;
 						mll_p = mll_p->next) {
 
+		/* when printing only part of the pages, once we have done
+		 * them, there is no need to go any further */
+		if (Print_part == YES && Printflag == NO && last_page() == YES) {
+			return;
+		}
+
 		{
 			/* in debug mode, print out Postscript comments
 			 * to make it easier to map output back to input */
-			OUTP(("%%  %s\n", stype_name(mll_p->str)));
+			OUTPS("%  ");
+			OUTPS(stype_name(mll_p->str));
+			OUTPS("\n");
 		}
 
 		/* tell output program what the user input line was */
@@ -470,6 +496,35 @@ trailer()
 }
 
 
+/* Print part of the pages, for printing with multiple processes. This is
+ * called in a child process, after the page list has been cut down to the
+ * pages this process is to do. The pages before those still have to be
+ * walked through (without output) to get everything into the right state,
+ * but once our pages are done, we stop. The process doing the final part
+ * also does the trailer. Each part prints the prolog, which the caller will
+ * discard for all but the first, so return the offset in the output where
+ * our first page begins. */
+
+long
+print_part(pages_before, is_last)
+
+int pages_before;	/* number of pages printed by earlier parts */
+int is_last;		/* YES if doing the final part */
+
+{
+	debug(256, "print_part");
+
+	Print_part = YES;
+	Pagesprinted = pages_before;
+	print_music();
+	if (is_last == YES) {
+		trailer();
+	}
+	(void) fflush(stdout);
+	return(Page1_offset);
+}
+
+
 /* initialize things for print pass through main list */
 
 static void
@@ -2646,7 +2701,62 @@ double val;		/* an x or y value */
 	if (isnan(val)) {
 		pfatal("got invalid number for a coordinate");
 	}
-	OUTP(("%.2f ", val * PPI));
+	out2f(val * PPI);
+}
+
+
+/* Output a value followed by a space, exactly as printf "%.2f " would, but
+ * without the overhead of parsing the format and going through the general
+ * floating point conversion. Values that are not reasonable coordinates,
+ * or that are so close to halfway between two hundredths that we can't be
+ * sure which way printf would round them, are just given to printf. */
+
+static void
+out2f(val)
+
+double val;
+
+{
+	char buff[32];		/* digits, filled in from the end */
+	char *p;		/* where we are in buff */
+	double scaled;		/* absolute value times 100 */
+	double whole;		/* scaled, rounded down */
+	double frac;		/* what was rounded off */
+	unsigned long hundredths;
+
+
+	if (Printflag == NO) {
+		return;
+	}
+	if ( ! (val > -OUT2F_MAX && val < OUT2F_MAX) ) {
+		(void) printf("%.2f ", val);
+		return;
+	}
+	scaled = fabs(val) * 100.0;
+	whole = floor(scaled);
+	frac = scaled - whole;
+	if (fabs(frac - 0.5) < OUT2F_FUZZ) {
+		(void) printf("%.2f ", val);
+		return;
+	}
+	hundredths = (unsigned long) whole + (frac > 0.5 ? 1 : 0);
+
+	p = buff + sizeof(buff);
+	*--p = ' ';
+	*--p = '0' + hundredths % 10;
+	hundredths /= 10;
+	*--p = '0' + hundredths % 10;
+	hundredths /= 10;
+	*--p = '.';
+	do {
+		*--p = '0' + hundredths % 10;
+		hundredths /= 10;
+	} while (hundredths > 0);
+	/* printf keeps the minus sign even if the value rounds to zero */
+	if (signbit(val)) {
+		*--p = '-';
+	}
+	(void) fwrite(p, 1, (buff + sizeof(buff)) - p, stdout);
 }
 
 
@@ -2659,7 +2769,26 @@ outint(val)
 int val;
 
 {
-	OUTP(("%d ", val));
+	char buff[16];		/* digits, filled in from the end */
+	char *p;		/* where we are in buff */
+	unsigned int uval;
+
+
+	if (Printflag == NO) {
+		return;
+	}
+	/* do the arithmetic unsigned, so the most negative int works */
+	uval = (val < 0 ? 0U - (unsigned int) val : (unsigned int) val);
+	p = buff + sizeof(buff);
+	*--p = ' ';
+	do {
+		*--p = '0' + uval % 10;
+		uval /= 10;
+	} while (uval > 0);
+	if (val < 0) {
+		*--p = '-';
+	}
+	(void) fwrite(p, 1, (buff + sizeof(buff)) - p, stdout);
 }
 
 
@@ -3042,19 +3171,19 @@ int op;		/* which operator */
 	switch (op) {
 
 	case O_FONT:
-		OUTP(("findfont\n"));
+		OUTPS("findfont\n");
 		break;
 
 	case O_SETFONT:
-		OUTP(("setfont\n"));
+		OUTPS("setfont\n");
 		break;
 
 	case O_SIZE:
-		OUTP(("scalefont\n"));
+		OUTPS("scalefont\n");
 		break;
 
 	case O_LINE:
-		OUTP(("lineto stroke\n"));
+		OUTPS("lineto stroke\n");
 		break;
 
 	case O_WAVY:
@@ -3062,17 +3191,17 @@ int op;		/* which operator */
 		break;
 
 	case O_CURVETO:
-		OUTP(("curveto\n"));
+		OUTPS("curveto\n");
 		break;
 
 	case O_LINEWIDTH:
-		OUTP(("setlinewidth\n"));
+		OUTPS("setlinewidth\n");
 		break;
 
 	case O_DOTTED:
-		OUTP(("[0.1 5] 0 setdash\n"));
-		OUTP(("1 setlinecap\n"));
-		OUTP(("1 setlinejoin\n"));
+		OUTPS("[0.1 5] 0 setdash\n");
+		OUTPS("1 setlinecap\n");
+		OUTPS("1 setlinejoin\n");
 		break;
 
 	case O_DASHED:
@@ -3080,107 +3209,107 @@ int op;		/* which operator */
 		break;
 
 	case O_ENDDOTTED:
-		OUTP(("[] 0 setdash\n"));
-		OUTP(("0 setlinecap\n"));
-		OUTP(("0 setlinejoin\n"));
+		OUTPS("[] 0 setdash\n");
+		OUTPS("0 setlinecap\n");
+		OUTPS("0 setlinejoin\n");
 		break;
 
 	case O_LINETO:
-		OUTP(("lineto\n"));
+		OUTPS("lineto\n");
 		break;
 
 	case O_SHOWPAGE:
-		OUTP(("showpage\n"));
+		OUTPS("showpage\n");
 		break;
 
 	case O_SHOW:
-		OUTP(("show\n"));
+		OUTPS("show\n");
 		break;
 
 	case O_WIDTHSHOW:
-		OUTP(("widthshow\n"));
+		OUTPS("widthshow\n");
 		break;
 
 	case O_ROLL:
-		OUTP(("roll\n"));
+		OUTPS("roll\n");
 		break;
 
 	case O_STAFF:
-		OUTP(("staff\n"));
+		OUTPS("staff\n");
 		break;
 
 	case O_MOVETO:
-		OUTP(("moveto\n"));
+		OUTPS("moveto\n");
 		break;
 
 	case O_BRACE:
-		OUTP(("brace\n"));
+		OUTPS("brace\n");
 		break;
 
 	case O_BRACKET:
-		OUTP(("bracket\n"));
+		OUTPS("bracket\n");
 		break;
 
 	case O_REPEATBRACKET:
-		OUTP(("repeatbracket\n"));
+		OUTPS("repeatbracket\n");
 		break;
 
 	case O_SAVE:
-		OUTP(("save\n"));
+		OUTPS("save\n");
 		break;
 
 	case O_RESTORE:
-		OUTP(("restore\n"));
+		OUTPS("restore\n");
 		Last_linetype = -1;
 		break;
 
 	case O_GSAVE:
-		OUTP(("gsave\n"));
+		OUTPS("gsave\n");
 		break;
 
 	case O_GRESTORE:
-		OUTP(("grestore\n"));
+		OUTPS("grestore\n");
 		Last_linetype = -1;
 		break;
 
 	case O_CONCAT:
-		OUTP(("concat\n"));
+		OUTPS("concat\n");
 		break;
 
 	case O_TRANSLATE:
-		OUTP(("translate\n"));
+		OUTPS("translate\n");
 		break;
 
 	case O_ROTATE:
-		OUTP(("rotate\n"));
+		OUTPS("rotate\n");
 		break;
 
 	case O_SCALE:
-		OUTP(("scale\n"));
+		OUTPS("scale\n");
 		break;
 
 	case O_ARC:
-		OUTP(("arc\n"));
+		OUTPS("arc\n");
 		break;
 
 	case O_EOFILL:
-		OUTP(("eofill\n"));
+		OUTPS("eofill\n");
 		break;
 
 	case O_FILL:
-		OUTP(("fill\n"));
+		OUTPS("fill\n");
 		break;
 
 	case O_STROKE:
-		OUTP(("stroke\n"));
+		OUTPS("stroke\n");
 		break;
 
 	case O_NEWPATH:
-		OUTP(("newpath\n"));
+		OUTPS("newpath\n");
 		break;
 
 	case O_CLOSEPATH:
-		OUTP(("closepath\n"));
+		OUTPS("closepath\n");
 		break;
 
 	default:
@@ -4482,7 +4611,7 @@ int really_print;	/* if YES, actually print, else just return width */
 						J_LEFT, (char *) 0, -1);
 		}
 		width = strwidth(str1);
-		free(str1);
+		FREE(str1);
 		return(width);
 	}
 	else {
@@ -4511,8 +4640,8 @@ int really_print;	/* if YES, actually print, else just return width */
 				Staffs_y[staffno] - adjust - STDPAD,
 				str2, J_LEFT, (char *) 0, -1);
 		}
-		free(str1);
-		free(str2);
+		FREE(str1);
+		FREE(str2);
 		return(widest);
 	}
 	return(0.0);
@@ -5057,7 +5186,9 @@ int inputlineno;
 						 * add backslashes if needed */
 
 	
-	if (strcmp(fname, inputfile) != 0) {
+	/* File names are interned, so usually comparing the pointers is
+	 * enough, but check the contents too in case some aren't. */
+	if (fname != inputfile && strcmp(fname, inputfile) != 0) {
 		OUTPCH(('('));
 		for (str = inputfile; *str != 0; str++) {
 			switch(*str) {
@@ -5071,10 +5202,11 @@ int inputlineno;
 				break;
 			}
 		}
-		OUTP((") inputfile\n"));
+		OUTPS(") inputfile\n");
 		fname = inputfile;
 	}
-	OUTP(("%d linenum\n", inputlineno));
+	outint(inputlineno);
+	OUTPS("linenum\n");
 }
 
 
@@ -5337,6 +5469,10 @@ static void
 start_page()
 
 {
+	if (Print_part == YES && Page1_offset < 0L) {
+		(void) fflush(stdout);
+		Page1_offset = ftell(stdout);
+	}
 	Pagesprinted++;
 
 	if (Score.panelsperpage < 2) {
@@ -571,9 +571,14 @@ struct MAINLL *mll_p;
 			extend(stufflist_p);
 
 			/* if special case of ending in ~ or _, don't print the
-			 * ~ or _ itself */
+			 * ~ or _ itself. The string may be shared with other
+			 * STUFFs (see intern.c), so trim a copy of it. */
 			if ((lch = last_char(stufflist_p->string)) == '~' ||
 					lch == '_') {
+				stufflist_p->string = copy_string(
+						stufflist_p->string + 2,
+						(int) stufflist_p->string[0],
+						(int) stufflist_p->string[1]);
 				stufflist_p->string[strlen(stufflist_p->string)
 						-1] = '\0';
 			}
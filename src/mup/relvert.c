@@ -49,10 +49,19 @@
 #include "structs.h"
 #include "globals.h"
 
+#ifdef HAVE_FORK
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 
 /* this fudge factor prevents roundoff error from causing overlap */
 #define FUDGE	(0.001)
 
+/* how many more mark list heads to allocate at a time in savemarkheads() */
+#define MARKHEADCHUNK	(64)
+
 /* these symbols tell certain subroutines which things to work on */
 #define	DO_OTHERS	0	/* default */
 #define	DO_PHRASE	1
@@ -62,6 +71,30 @@ struct PHRINFO {
 	struct STUFF *stuff_p;
 };
 
+/*
+ * When stacking rectangles, the relevant ones in Rectab are copied into an
+ * array of these and sorted, so that overlap can be found by binary search.
+ */
+struct STACKREC {
+	float key;		/* outer boundary: south for below, else north */
+	float other;		/* inner boundary */
+	float bound;		/* see sortstackrecs() */
+	int idx;		/* index into Rectab */
+};
+
+static struct MAINLL *nextscore P((struct MAINLL *feed_p));
+#ifdef HAVE_FORK
+static int par_relvert P((int jobs));
+static void relvert_part P((int part, int jobs, FILE *res_p));
+static void partfailed P((FILE *err_p, int code));
+static void savemarkheads P((struct MAINLL *start_p));
+static void xferunit P((struct MAINLL *start_p, int s, int save));
+static void xfermarks P((struct MARKCOORD **head_p_p,
+		struct MARKCOORD *oldhead_p, int save));
+static void xfercurve P((struct STUFF *stuff_p, int save));
+static void xfer P((char *data, int size, int save));
+static void growxferbuf P((int size));
+#endif
 static void procstaff P((struct MAINLL *mainll_p, int s)); 
 static void dostaff P((int s, int place));
 static void dogroups P((struct MAINLL *start_p, int s, int place));
@@ -90,10 +123,12 @@ static void get_misc_info P((int s, struct STUFF *stuff_p, int place,
 static int compaligntags P((const void *tag1_p, const void *tag2_p));
 static int compstuffs P((const void *tag1_p, const void *tag2_p));
 static int comp_phrases P((const void *tag1_p, const void *tag2_p));
+static int compstackrecs P((const void *sr1_p, const void *sr2_p));
 #else
 static int compaligntags P((char *tag1_p, char *tag2_p));
 static int compstuffs P((char *tag1_p, char *tag2_p));
 static int comp_phrases P((char *tag1_p, char *tag2_p));
+static int compstackrecs P((char *sr1_p, char *sr2_p));
 #endif
 static void doaligned P((struct MAINLL *start_p, int s, int place,
 		unsigned long do_which, int tag));
@@ -109,6 +144,11 @@ static void dorehears P((struct MAINLL *start_p, int s));
 static double stackit P((double west, double east, double height, double dist,
 		int place));
 static void multistackit P((int nrect, double dist, int place));
+static struct STACKREC *getstackrecs P((int num));
+static void setstackrec P((struct STACKREC *sr_p, int idx, int place));
+static void sortstackrecs P((struct STACKREC *sr_p, int num, int place));
+static int stackoverlap P((struct STACKREC *sr_p, int num, double north,
+		double south, int place));
 
 /*
  * Name:        relvert()
@@ -119,38 +159,92 @@ static void multistackit P((int nrect, double dist, int place));
  *
  * Description: This function sets all remaining relative vertical coords.
  *		It calls procstaff() once for each staff in each score to
- *		do this.
+ *		do this.  If asked to use more than one process, it tries
+ *		par_relvert() first, which gets the same results with the
+ *		staffs split among several processes.
  */
 
 void
-relvert()
+relvert(jobs)
+
+int jobs;			/* how many processes to use */
 
 {
-	struct MAINLL *mainll_p;	/* point along main linked list */
-	struct MAINLL *end_p;		/* point at end of a piece of MLL */
-	struct MAINLL *m2_p;		/* another pointer along MLL */
+	struct MAINLL *start_p;		/* FEED at the start of a score */
 	int s;				/* staff number */
-	int gotbar;			/* was a bar found in this chunk? */
 
 
 	debug(16, "relvert");
-	/*
-	 * Find each section of the main linked list, delimited by FEEDs.
-	 * For each such section, call procstaff() for each visible staff.
-	 * Keep SSVs up to date so that we always know what staffs are visible.
-	 */
-	initstructs();			/* clean out old SSV info */
 
-	/* skip anything before first FEED first */
-	for (mainll_p = Mainllhc_p; mainll_p->str != S_FEED;
-			mainll_p = mainll_p->next) {
-		if (mainll_p->str == S_SSV)
-			asgnssv(mainll_p->u.ssv_p);
+#ifdef HAVE_FORK
+	if (jobs > 1 && par_relvert(jobs) == YES) {
+		return;
 	}
+#endif
 
 	/* initialize table of rectangles */
 	init_rectab();
 
+	/* call procstaff() for each visible staff of each score */
+	for (start_p = nextscore((struct MAINLL *) 0); start_p != 0;
+				start_p = nextscore(start_p)) {
+		for (s = 1; s <= Score.staffs; s++) {
+			if (svpath(s, VISIBLE)->visible == YES)
+				procstaff(start_p, s);
+		}
+	}
+
+	free_rectab();
+}
+
+/*
+ * Name:        nextscore()
+ *
+ * Abstract:    Find the next score that has music on it.
+ *
+ * Returns:     the FEED at the start of the score, or 0 if no more
+ *
+ * Description: This function is given the FEED at the start of a score, or
+ *		0 to start from the beginning of the main linked list.  It
+ *		finds the next section of the MLL, delimited by FEEDs, that
+ *		has bars in it.  Sections with no bars are either blocks, or
+ *		the end of the MLL after a final feed, and they are skipped.
+ *		SSVs are kept up to date along the way, so that they are
+ *		right for the beginning of the score returned.
+ */
+
+static struct MAINLL *
+nextscore(feed_p)
+
+struct MAINLL *feed_p;		/* FEED at the start of current score, or 0 */
+
+{
+	struct MAINLL *mainll_p;	/* point along main linked list */
+	struct MAINLL *end_p;		/* point at end of a piece of MLL */
+	int gotbar;			/* was a bar found in this chunk? */
+
+
+	if (feed_p == 0) {
+		initstructs();			/* clean out old SSV info */
+
+		/* skip anything before first FEED first */
+		for (mainll_p = Mainllhc_p; mainll_p->str != S_FEED;
+				mainll_p = mainll_p->next) {
+			if (mainll_p->str == S_SSV)
+				asgnssv(mainll_p->u.ssv_p);
+		}
+	} else {
+		/* update SSVs to beginning of next score */
+		for (mainll_p = feed_p->next; mainll_p != 0 &&
+				mainll_p->str != S_FEED;
+				mainll_p = mainll_p->next) {
+			if (mainll_p->str == S_SSV)
+				asgnssv(mainll_p->u.ssv_p);
+		}
+		if (mainll_p == 0)
+			return (0);
+	}
+
 	for (;;) {
 		/*
 		 * Find end of this chunk.  If it has no bars in it, this must
@@ -164,40 +258,618 @@ relvert()
 			if (end_p->str == S_BAR)
 				gotbar = YES;
 		}
-		if (gotbar == NO) {
-			if (end_p == 0)
-				break;		/* end of MLL, get out */
+		if (gotbar == YES)
+			return (mainll_p);
+		if (end_p == 0)
+			return (0);	/* end of MLL */
+
+		/* update SSVs to beginning of next score */
+		for (mainll_p = mainll_p->next; mainll_p != end_p;
+					mainll_p = mainll_p->next) {
+			if (mainll_p->str == S_SSV)
+				asgnssv(mainll_p->u.ssv_p);
+		}
+	}
+}
+
+#ifdef HAVE_FORK
+static struct MARKCOORD **Markheads;	/* see savemarkheads() */
+static int Markheadsize;		/* slots allocated in Markheads */
+static char *Xferbuf;			/* one staff's results; see xfer() */
+static int Xfersize;			/* bytes allocated in Xferbuf */
+static int Xferlen;			/* bytes of results in Xferbuf */
+static int Xferpos;			/* bytes saved or loaded so far */
+
+/*
+ * Name:        par_relvert()
+ *
+ * Abstract:    Set all relative vertical coords using several processes.
+ *
+ * Returns:     YES if done, NO if it must be done the normal way
+ *
+ * Description: This function splits the staffs among child processes.
+ *		Each does every score for its staffs, calling procstaff() just
+ *		like relvert() does, with its own Rectab and its own copy of
+ *		the SSVs.  No staff depends on what was placed for any other,
+ *		so the results are the same as doing them one at a time.  The
+ *		children write their results into temporary files: for each
+ *		staff of each score, the coords that procstaff() could have
+ *		set, the phrase and tie curves, the ending and rehearsal marks
+ *		it added to the bars, any warnings, and any lyric extenders
+ *		it carried over onto the staff on the next score.  Once they
+ *		are all done, this function goes through the scores and staffs
+ *		in the usual order, reading the results back into the main
+ *		linked list, printing the warnings, and inserting the carried
+ *		over syllables.  The marks get pushed onto the bars' lists in
+ *		that order too, so the lists, and the PostScript printed from
+ *		them, come out the same.
+ */
+
+static int
+par_relvert(jobs)
+
+int jobs;			/* how many processes to use */
+
+{
+	FILE **res_p;			/* results of each part */
+	FILE **err_p;			/* error output of each part */
+	pid_t *pid;			/* process doing each part */
+	int *code;			/* exit code of each part */
+	struct MAINLL *start_p;		/* FEED at the start of a score */
+	long stats[NUMSTATS];		/* what a part counted, for -T */
+	int unit[2];			/* score number and staff of a result */
+	int scoreno;			/* score number */
+	int maxstaffs;			/* most staffs on any score */
+	int status;			/* of a child process */
+	int s;				/* staff number */
+	int j;				/* part index */
+	int n;				/* loop variable */
+
+
+	/* debugging output from the parts would come out of order */
+	if (Debuglevel != 0) {
+		return (NO);
+	}
+
+	/* the staffs are what get split up, so don't use more parts */
+	maxstaffs = 0;
+	for (start_p = nextscore((struct MAINLL *) 0); start_p != 0;
+				start_p = nextscore(start_p)) {
+		if (Score.staffs > maxstaffs)
+			maxstaffs = Score.staffs;
+	}
+	if (jobs > maxstaffs)
+		jobs = maxstaffs;
+	if (jobs < 2)
+		return (NO);
+
+	debug(16, "par_relvert jobs=%d", jobs);
+	MALLOCA(FILE *, res_p, jobs);
+	MALLOCA(FILE *, err_p, jobs);
+	MALLOCA(pid_t, pid, jobs);
+	MALLOCA(int, code, jobs);
+
+	(void) fflush(stdout);
+	(void) fflush(stderr);
+	for (j = 0; j < jobs; j++) {
+		if ((res_p[j] = tmpfile()) == (FILE *) 0
+				|| (err_p[j] = tmpfile()) == (FILE *) 0) {
+			ufatal("can't create temporary file for placement");
+		}
+		if ((pid[j] = fork()) < 0) {
+			ufatal("can't create process for placement");
+		}
 
-			/* update SSVs to beginning of next score */
-			for (m2_p = mainll_p->next; m2_p != end_p;
-						m2_p = m2_p->next) {
-				if (m2_p->str == S_SSV)
-					asgnssv(m2_p->u.ssv_p);
+		if (pid[j] == 0) {
+			/*
+			 * We are the child.  Do our staffs into our results
+			 * file.  Anything else printed goes into our error
+			 * file, for the parent to pass along if we fail.
+			 */
+			if (dup2(fileno(err_p[j]), 2) < 0) {
+				_exit(1);
+			}
+			relvert_part(j, jobs, res_p[j]);
+			if (fflush(res_p[j]) != 0 || ferror(res_p[j])) {
+				_exit(1);
 			}
+			_exit(0);
+		}
+	}
 
-			mainll_p = end_p;	/* block, skip by it */
-			continue;
+	for (j = 0; j < jobs; j++) {
+		code[j] = 1;
+		if (waitpid(pid[j], &status, 0) == pid[j]) {
+			/* a signal most likely means pfatal() aborted */
+			code[j] = WIFEXITED(status) ? WEXITSTATUS(status)
+					: MAX_ERRORS;
 		}
+		rewind(res_p[j]);
+	}
 
+	/*
+	 * Read in the results of each visible staff of each score, in the
+	 * same order relvert() would do them.  Staff s was done by part
+	 * (s - 1) % jobs.  If a part failed partway, everything before where
+	 * it failed gets read in, like the normal way would have done it,
+	 * and then we pass along its errors and exit.
+	 */
+	scoreno = 0;
+	for (start_p = nextscore((struct MAINLL *) 0); start_p != 0;
+				start_p = nextscore(start_p)) {
+		scoreno++;
 		for (s = 1; s <= Score.staffs; s++) {
-			if (svpath(s, VISIBLE)->visible == YES)
-				procstaff(mainll_p, s);
+			if (svpath(s, VISIBLE)->visible == NO)
+				continue;
+
+			j = (s - 1) % jobs;
+			while (replay_warning(res_p[j]) == YES ||
+					replay_carryover(res_p[j]) == YES)
+				;
+			if (getc(res_p[j]) != 'U' ||
+					fread((char *)unit, sizeof (unit), 1,
+					res_p[j]) != 1 ||
+					fread((char *)&Xferlen, sizeof (Xferlen),
+					1, res_p[j]) != 1) {
+				partfailed(err_p[j], code[j]);
+			}
+			if (unit[0] != scoreno || unit[1] != s)
+				pfatal("placement process did score %d staff %d rather than score %d staff %d",
+						unit[0], unit[1], scoreno, s);
+			growxferbuf(Xferlen);
+			if ((int) fread(Xferbuf, 1, Xferlen, res_p[j]) != Xferlen) {
+				partfailed(err_p[j], code[j]);
+			}
+
+			/* leave globals as procstaff() would have */
+			set_staffscale(s);
+			Xferpos = 0;
+			xferunit(start_p, s, NO);
+			if (Xferpos != Xferlen) {
+				pfatal("placement results don't match the main list");
+			}
 		}
+	}
 
-		/* update SSVs to beginning of next score */
-		for (m2_p = mainll_p->next; m2_p != end_p; m2_p = m2_p->next) {
-			if (m2_p->str == S_SSV)
-				asgnssv(m2_p->u.ssv_p);
+	/* add in what the parts counted to our own counts */
+	for (j = 0; j < jobs; j++) {
+		if (code[j] != 0 || getc(res_p[j]) != 'T' || fread((char *)stats,
+				sizeof (stats), 1, res_p[j]) != 1) {
+			partfailed(err_p[j], code[j]);
 		}
+		for (n = 0; n < NUMSTATS; n++)
+			Stat_count[n] += stats[n];
 
-		if (end_p == 0)
-			break;
-		mainll_p = end_p;
+		(void) fclose(res_p[j]);
+		(void) fclose(err_p[j]);
+	}
+
+	FREE(res_p);
+	FREE(err_p);
+	FREE(pid);
+	FREE(code);
+	return (YES);
+}
+
+/*
+ * Name:        relvert_part()
+ *
+ * Abstract:    Do one part of par_relvert() in a child process.
+ *
+ * Returns:     void
+ *
+ * Description: This function calls procstaff() for each staff of each score
+ *		that belongs to the given part.  After each, it writes a
+ *		'U' record, telling the score number and staff, followed by
+ *		what xferunit() saves.  Warnings given and syllables carried
+ *		over while doing a staff are written just before its record.
+ *		At the end, it writes a 'T' record with what it counted for
+ *		the -T report.
+ */
+
+static void
+relvert_part(part, jobs, res_p)
+
+int part;			/* which part this is, from 0 */
+int jobs;			/* how many parts there are */
+FILE *res_p;			/* write results here */
+
+{
+	struct MAINLL *start_p;		/* FEED at the start of a score */
+	long stats[NUMSTATS];		/* what we counted, for -T */
+	int unit[2];			/* score number and staff */
+	int s;				/* staff number */
+	int n;				/* loop variable */
+
+
+	(void) memcpy((char *)stats, (char *)Stat_count, sizeof (stats));
+
+	init_rectab();
+
+	unit[0] = 0;
+	for (start_p = nextscore((struct MAINLL *) 0); start_p != 0;
+				start_p = nextscore(start_p)) {
+		unit[0]++;
+		for (s = 1; s <= Score.staffs; s++) {
+			if ((s - 1) % jobs != part ||
+					svpath(s, VISIBLE)->visible == NO)
+				continue;
+
+			savemarkheads(start_p);
+			log_warnings(res_p);
+			log_carryovers(res_p);
+			procstaff(start_p, s);
+			log_warnings((FILE *) 0);
+			log_carryovers((FILE *) 0);
+
+			unit[1] = s;
+			Xferpos = 0;
+			xferunit(start_p, s, YES);
+			(void) putc('U', res_p);
+			(void) fwrite((char *)unit, sizeof (unit), 1, res_p);
+			(void) fwrite((char *)&Xferpos, sizeof (Xferpos), 1,
+					res_p);
+			(void) fwrite(Xferbuf, 1, Xferpos, res_p);
+		}
 	}
 
 	free_rectab();
+
+	for (n = 0; n < NUMSTATS; n++)
+		stats[n] = Stat_count[n] - stats[n];
+	(void) putc('T', res_p);
+	(void) fwrite((char *)stats, sizeof (stats), 1, res_p);
 }
-
+
+/*
+ * Name:        partfailed()
+ *
+ * Abstract:    Handle a part of par_relvert() that failed.
+ *
+ * Returns:     doesn't return
+ *
+ * Description: This function passes along whatever the failed part printed,
+ *		which should tell why it failed, and exits the way it did.
+ */
+
+static void
+partfailed(err_p, code)
+
+FILE *err_p;			/* error output of the part */
+int code;			/* exit code of the part */
+
+{
+	char buff[BUFSIZ];		/* for copying */
+	size_t n;			/* bytes in buff */
+
+
+	(void) fflush(stderr);
+	rewind(err_p);
+	while ((n = fread(buff, 1, sizeof (buff), err_p)) > 0) {
+		(void) fwrite(buff, 1, n, stderr);
+	}
+	(void) fflush(stderr);
+	exit(code != 0 ? code : MAX_ERRORS);
+}
+
+/*
+ * Name:        savemarkheads()
+ *
+ * Abstract:    Remember the heads of the bars' mark lists on a score.
+ *
+ * Returns:     void
+ *
+ * Description: This function saves in Markheads the heads of the ending and
+ *		rehearsal mark lists of the pseudobar and each bar on the
+ *		score, in the order xferunit() goes through them, so that
+ *		it can tell which marks procstaff() added.
+ */
+
+static void
+savemarkheads(start_p)
+
+struct MAINLL *start_p;		/* FEED at the start of this score */
+
+{
+	struct MAINLL *mainll_p;	/* point along main linked list */
+	struct BAR *bar_p;		/* a bar or pseudobar */
+	int b;				/* index into Markheads */
+
+
+	b = 0;
+	for (mainll_p = start_p->next; mainll_p != 0 &&
+			mainll_p->str != S_FEED; mainll_p = mainll_p->next) {
+
+		if (mainll_p->str == S_CLEFSIG && mainll_p == start_p->next)
+			bar_p = mainll_p->u.clefsig_p->bar_p;
+		else if (mainll_p->str == S_BAR)
+			bar_p = mainll_p->u.bar_p;
+		else
+			continue;
+		if (bar_p == 0)
+			continue;
+
+		if (b + 2 > Markheadsize) {
+			Markheadsize += MARKHEADCHUNK;
+			if (Markheads == 0) {
+				MALLOCA(struct MARKCOORD *, Markheads,
+						Markheadsize);
+			} else {
+				REALLOCA(struct MARKCOORD *, Markheads,
+						Markheadsize);
+			}
+		}
+		Markheads[b++] = bar_p->ending_p;
+		Markheads[b++] = bar_p->reh_p;
+	}
+}
+
+/*
+ * Name:        xferunit()
+ *
+ * Abstract:    Save or load the results of procstaff() for one staff.
+ *
+ * Returns:     void
+ *
+ * Description: This function goes through one staff on one score, and
+ *		either writes to the file, or reads from it into the same
+ *		places, everything that procstaff() could have set.  That
+ *		is the coords of the STAFFs and all their groups, syllables,
+ *		and STUFFs, the STUFFs' horzscale, place, and curves, and the
+ *		marks added to the bars.
+ */
+
+static void
+xferunit(start_p, s, save)
+
+struct MAINLL *start_p;		/* FEED at the start of this score */
+int s;				/* staff number */
+int save;			/* YES to write, NO to read */
+
+{
+	struct MAINLL *mainll_p;	/* point along main linked list */
+	struct STAFF *staff_p;		/* a STAFF for this staff */
+	struct BAR *bar_p;		/* a bar or pseudobar */
+	struct GRPSYL *gs_p;		/* a group or syllable */
+	struct STUFF *stuff_p;		/* a STUFF */
+	int b;				/* index into Markheads */
+	int v;				/* voice or verse index */
+
+
+	b = 0;
+	for (mainll_p = start_p->next; mainll_p != 0 &&
+			mainll_p->str != S_FEED; mainll_p = mainll_p->next) {
+
+		/* the bars are gone through the same as savemarkheads() */
+		bar_p = 0;
+		if (mainll_p->str == S_CLEFSIG && mainll_p == start_p->next)
+			bar_p = mainll_p->u.clefsig_p->bar_p;
+		else if (mainll_p->str == S_BAR)
+			bar_p = mainll_p->u.bar_p;
+		if (bar_p != 0) {
+			xfermarks(&bar_p->ending_p, save == YES ?
+					Markheads[b] : 0, save);
+			xfermarks(&bar_p->reh_p, save == YES ?
+					Markheads[b + 1] : 0, save);
+			b += 2;
+			continue;
+		}
+
+		if (mainll_p->str != S_STAFF ||
+				mainll_p->u.staff_p->staffno != s)
+			continue;
+
+		staff_p = mainll_p->u.staff_p;
+		xfer((char *)staff_p->c, sizeof (staff_p->c), save);
+		xfer((char *)&staff_p->heightbetween,
+				sizeof (staff_p->heightbetween), save);
+
+		for (v = 0; v < MAXVOICES; v++) {
+			for (gs_p = staff_p->groups_p[v]; gs_p != 0;
+					gs_p = gs_p->next) {
+				xfer((char *)gs_p->c, sizeof (gs_p->c), save);
+			}
+		}
+		for (v = 0; v < staff_p->nsyllists; v++) {
+			for (gs_p = staff_p->syls_p[v]; gs_p != 0;
+					gs_p = gs_p->next) {
+				xfer((char *)gs_p->c, sizeof (gs_p->c), save);
+			}
+		}
+
+		for (stuff_p = staff_p->stuff_p; stuff_p != 0;
+				stuff_p = stuff_p->next) {
+			xfer((char *)stuff_p->c, sizeof (stuff_p->c), save);
+			xfer((char *)&stuff_p->horzscale,
+					sizeof (stuff_p->horzscale), save);
+			xfer((char *)&stuff_p->place,
+					sizeof (stuff_p->place), save);
+			xfercurve(stuff_p, save);
+		}
+	}
+}
+
+/*
+ * Name:        xfermarks()
+ *
+ * Abstract:    Save or load the marks procstaff() added to a list.
+ *
+ * Returns:     void
+ *
+ * Description: When saving, this function writes the marks that are on the
+ *		given list in front of the old head, oldest first.  When
+ *		loading, it pushes them onto the list in that same order.
+ */
+
+static void
+xfermarks(head_p_p, oldhead_p, save)
+
+struct MARKCOORD **head_p_p;	/* the head of the list */
+struct MARKCOORD *oldhead_p;	/* when saving, head before procstaff() */
+int save;			/* YES to write, NO to read */
+
+{
+	struct MARKCOORD *mark_p;	/* point at a mark */
+	int num;			/* how many marks were added */
+	int n;				/* loop variable */
+
+
+	if (save == YES) {
+		num = 0;
+		for (mark_p = *head_p_p; mark_p != oldhead_p;
+				mark_p = mark_p->next)
+			num++;
+		xfer((char *)&num, sizeof (num), YES);
+
+		/* the newest is at the head, so write them from the end */
+		for ( ; num > 0; num--) {
+			mark_p = *head_p_p;
+			for (n = 1; n < num; n++)
+				mark_p = mark_p->next;
+			xfer((char *)&mark_p->staffno,
+					sizeof (mark_p->staffno), YES);
+			xfer((char *)&mark_p->ry, sizeof (mark_p->ry), YES);
+		}
+	} else {
+		xfer((char *)&num, sizeof (num), NO);
+		for ( ; num > 0; num--) {
+			CALLOC(MARKCOORD, mark_p, 1);
+			xfer((char *)&mark_p->staffno,
+					sizeof (mark_p->staffno), NO);
+			xfer((char *)&mark_p->ry, sizeof (mark_p->ry), NO);
+			mark_p->next = *head_p_p;
+			*head_p_p = mark_p;
+		}
+	}
+}
+
+/*
+ * Name:        xfercurve()
+ *
+ * Abstract:    Save or load a STUFF's curve.
+ *
+ * Returns:     void
+ *
+ * Description: This function writes the number of points in a STUFF's
+ *		curve list and the coords of each, or reads them and makes
+ *		a new curve list out of them, replacing any old one.
+ */
+
+static void
+xfercurve(stuff_p, save)
+
+struct STUFF *stuff_p;		/* the STUFF */
+int save;			/* YES to write, NO to read */
+
+{
+	struct CRVLIST *point_p;	/* point along the curve */
+	struct CRVLIST *prev_p;		/* previous point */
+	int num;			/* number of points */
+
+
+	if (save == YES) {
+		num = 0;
+		for (point_p = stuff_p->crvlist_p; point_p != 0;
+				point_p = point_p->next)
+			num++;
+		xfer((char *)&num, sizeof (num), YES);
+		for (point_p = stuff_p->crvlist_p; point_p != 0;
+				point_p = point_p->next) {
+			xfer((char *)&point_p->x, sizeof (point_p->x), YES);
+			xfer((char *)&point_p->y, sizeof (point_p->y), YES);
+		}
+		return;
+	}
+
+	xfer((char *)&num, sizeof (num), NO);
+
+	while (stuff_p->crvlist_p != 0) {
+		point_p = stuff_p->crvlist_p;
+		stuff_p->crvlist_p = point_p->next;
+		FREE(point_p);
+	}
+
+	prev_p = 0;
+	for ( ; num > 0; num--) {
+		CALLOC(CRVLIST, point_p, 1);
+		xfer((char *)&point_p->x, sizeof (point_p->x), NO);
+		xfer((char *)&point_p->y, sizeof (point_p->y), NO);
+		point_p->prev = prev_p;
+		if (prev_p == 0)
+			stuff_p->crvlist_p = point_p;
+		else
+			prev_p->next = point_p;
+		prev_p = point_p;
+	}
+}
+
+/*
+ * Name:        xfer()
+ *
+ * Abstract:    Save or load one item of par_relvert() results.
+ *
+ * Returns:     void
+ *
+ * Description: This function appends the given bytes to Xferbuf, or takes
+ *		them from the next place in it.  Going through Xferbuf, rather
+ *		than the file, lets each staff's results be written and read
+ *		all at once.
+ */
+
+static void
+xfer(data, size, save)
+
+char *data;			/* the item */
+int size;			/* its size in bytes */
+int save;			/* YES to write, NO to read */
+
+{
+	if (save == YES) {
+		if (Xferpos + size > Xfersize) {
+			growxferbuf(Xferpos + size);
+		}
+		(void) memcpy(Xferbuf + Xferpos, data, size);
+	} else {
+		if (Xferpos + size > Xferlen) {
+			pfatal("placement results don't match the main list");
+		}
+		(void) memcpy(data, Xferbuf + Xferpos, size);
+	}
+	Xferpos += size;
+}
+
+/*
+ * Name:        growxferbuf()
+ *
+ * Abstract:    Make Xferbuf big enough.
+ *
+ * Returns:     void
+ *
+ * Description: This function makes Xferbuf at least the given size,
+ *		keeping what is in it.
+ */
+
+static void
+growxferbuf(size)
+
+int size;			/* bytes needed */
+
+{
+	if (size <= Xfersize) {
+		return;
+	}
+	if (size < 2 * Xfersize) {
+		size = 2 * Xfersize;
+	}
+	if (Xferbuf == 0) {
+		MALLOCA(char, Xferbuf, size);
+	} else {
+		REALLOCA(char, Xferbuf, size);
+	}
+	Xfersize = size;
+}
+#endif
+
 /*
  * Name:        procstaff()
  *
@@ -3619,8 +4291,9 @@ int place;			/* above, below, or between? */
 
 {
 	float north, south;	/* trial boundaries for new rectangle */
-	int try;		/* which element of Rectab to try */
-	int overlap;		/* does our rectangle overlap existing ones? */
+	struct STACKREC *sr_p;	/* the relevant rectangles, sorted */
+	int nrel;		/* how many relevant rectangles there are */
+	int try;		/* which element of sr_p to try next */
 	int j;			/* loop variable */
 
 
@@ -3630,16 +4303,19 @@ int place;			/* above, below, or between? */
 	 * new rectangle.  If it's totally left or right of ours, it
 	 * can't.  We allow a slight overlap (FUDGE) so that round
 	 * off errors don't stop us from packing things as tightly
-	 * as possible.
+	 * as possible.  Collect the relevant ones, sorted so that we
+	 * can find overlaps without looking at them all every time.
 	 */
+	sr_p = getstackrecs(Reclim);
+	nrel = 0;
 	for (j = 0; j < Reclim; j++) {
 		if (Rectab[j].w + FUDGE > east ||
 		    Rectab[j].e < west + FUDGE) {
-			Rectab[j].relevant = NO;
-		} else {
-			Rectab[j].relevant = YES;
+			continue;
 		}
+		setstackrec(&sr_p[nrel++], j, place);
 	}
+	sortstackrecs(sr_p, nrel, place);
 
 	/*
 	 * Set up first trial position for this rectangle:  "dist" inches
@@ -3666,19 +4342,18 @@ int place;			/* above, below, or between? */
 	}
 
 	/*
-	 * Mark the "tried" field for all relevant rectangles.  This says
-	 * whether we have already tried using their boundaries for positioning
-	 * our rectangle.  Any rectangle that is closer to the staff/baseline
-	 * than we want to allow, we mark as if we have tried it already.
+	 * The outer boundaries of relevant rectangles are the positions to
+	 * try for our rectangle's inner boundary, innermost first.  Since
+	 * they are sorted, that is just working outwards through sr_p.  Skip
+	 * any that are closer to the staff/baseline than we want to allow.
 	 */
-	for (j = 0; j < Reclim; j++) {
-		if (Rectab[j].relevant == YES) {
-			if ((place == PL_BELOW && Rectab[j].s > north) ||
-			    (place != PL_BELOW && Rectab[j].n < south)) {
-				Rectab[j].tried = YES;
-			} else {
-				Rectab[j].tried = NO;
-			}
+	if (place == PL_BELOW) {
+		for (try = nrel - 1; try >= 0 && sr_p[try].key > north; try--) {
+			;
+		}
+	} else {
+		for (try = 0; try < nrel && sr_p[try].key < south; try++) {
+			;
 		}
 	}
 
@@ -3688,73 +4363,20 @@ int place;			/* above, below, or between? */
 	 * existing rectangle, break.  This has to succeed at some point, at
 	 * at the outermost rectangle position if not earlier.
 	 */
-	for (;;) {
-		overlap = NO;
-		for (j = 0; j < Reclim; j++) {
-			/* ignore ones too far east or west */
-			if (Rectab[j].relevant == NO) {
-				continue;
-			}
-
-			/* if all south or north, okay; else overlap */
-			if (Rectab[j].s + FUDGE <= north &&
-			    Rectab[j].n >= south + FUDGE) {
-				overlap = YES;
-				break;
-			}
-		}
-
-		/* if no rectangle overlapped, we found a valid place */
-		if (overlap == NO)
-			break;
-
-		/*
-		 * Something overlapped, so we have to try again.  Find the
-		 * innermost relevant outer rectangle boundary that hasn't been
-		 * tried already, to use as the next trial position for our
-		 * rectangle's inner boundary.
-		 */
-		try = -1;
-		for (j = 0; j < Reclim; j++) {
-			/* ignore ones too far east or west */
-			if (Rectab[j].relevant == NO || Rectab[j].tried == YES){
-				continue;
-			}
-
-			/*
-			 * If this is the first relevant one we haven't tried,
-			 * or if this is farther in than the innermost so far,
-			 * save it as being the new innermost so far.
-			 */
-			if (place == PL_BELOW) {
-				if (try == -1 || Rectab[j].s > Rectab[try].s) {
-					try = j;
-				}
-			} else {
-				if (try == -1 || Rectab[j].n < Rectab[try].n) {
-					try = j;
-				}
-			}
-		}
-
-		if (try == -1)
+	while (stackoverlap(sr_p, nrel, north, south, place) == YES) {
+		if (try < 0 || try >= nrel) {
 			pfatal("bug in stackit()");
+		}
 
-		/*
-		 * Mark this one as having been tried (for next time around, if
-		 * necessary).  Set new trial values for north and south of our
-		 * rectangle.
-		 */
-		Rectab[try].tried = YES;
+		/* set new trial values for north and south of our rectangle */
 		if (place == PL_BELOW) {
-			north = Rectab[try].s;
+			north = sr_p[try--].key;
 			south = north - height;
 		} else {
-			south = Rectab[try].n;
+			south = sr_p[try++].key;
 			north = south + height;
 		}
-
-	} /* end of while loop trying positions for this rectangle */
+	}
 
 	/*
 	 * We found the correct position for the new rectangle.  Enter it
@@ -3769,7 +4391,7 @@ int place;			/* above, below, or between? */
 
 	return (south);
 }
-
+
 /*
  * Name:        multistackit()
  *
@@ -3802,11 +4424,17 @@ int place;			/* above, below, or between? */
 	float north, south;	/* outermost boundaries of the new rectangles*/
 	float move;		/* how far to move for the next trial */
 	float height;		/* height of one rectangle */
-	int try;		/* which element of Rectab to try */
+	struct STACKREC *sr_p;	/* relevant old rectangles, then one list for
+				 * each new rectangle of the old ones that
+				 * could overlap it; all sorted */
+	int *numover;		/* how many are in each new rectangle's list */
+	int nrel;		/* how many relevant old rectangles there are */
+	int try;		/* which element of sr_p to try next */
 	int overlap;		/* do our rectangles overlap existing ones? */
 	int oidx, nidx;		/* loop variables for old and new rectangles */
 	int ofirst, nfirst;	/* idx to first old and new rectangles */
 	int olimit, nlimit;	/* idx beyond last old and new rectangles */
+	int n;			/* index into sr_p */
 
 
 	/*
@@ -3823,19 +4451,46 @@ int place;			/* above, below, or between? */
 	 * horizontal coords) it could possibly overlap with any of our new
 	 * rectangles.  If it's totally left or right of each of ours, it
 	 * can't.  We allow a slight overlap (FUDGE) so that round off errors
-	 * don't stop us from packing things as tightly as possible.
+	 * don't stop us from packing things as tightly as possible.  The
+	 * relevant ones go at the start of sr_p.
 	 */
+	sr_p = getstackrecs((nrect + 1) * olimit);
+	nrel = 0;
 	for (oidx = ofirst; oidx < olimit; oidx++) {
-		Rectab[oidx].relevant = NO;
 		for (nidx = nfirst; nidx < nlimit; nidx++) {
 			if (Rectab[oidx].w + FUDGE < Rectab[nidx].e &&
 			    Rectab[oidx].e > Rectab[nidx].w + FUDGE) {
-				Rectab[oidx].relevant = YES;
+				setstackrec(&sr_p[nrel++], oidx, place);
 				break;
 			}
 		}
 	}
 
+	/*
+	 * "relevant" doesn't guarantee horizontal overlap with every one of
+	 * the new rectangles, since they are of different widths.  So for
+	 * each new rectangle, make a separate list of the relevant ones that
+	 * horizontally overlap it, to be used for checking vertical overlap.
+	 * The new rectangles only ever move vertically, so these lists stay
+	 * valid while we try positions.
+	 */
+	MALLOCA(int, numover, nrect);
+	for (nidx = nfirst; nidx < nlimit; nidx++) {
+		struct STACKREC *list_p;	/* this rectangle's list */
+
+		list_p = &sr_p[(nidx - nfirst + 1) * nrel];
+		numover[nidx - nfirst] = 0;
+		for (n = 0; n < nrel; n++) {
+			oidx = sr_p[n].idx;
+			if (Rectab[oidx].w + FUDGE <= Rectab[nidx].e &&
+			    Rectab[oidx].e >= Rectab[nidx].w + FUDGE) {
+				list_p[numover[nidx - nfirst]++] = sr_p[n];
+			}
+		}
+		sortstackrecs(list_p, numover[nidx - nfirst], place);
+	}
+	sortstackrecs(sr_p, nrel, place);
+
 	/*
 	 * Set up first trial position for these rectangles:  "dist" inches
 	 * away from the center line of the staff.  For "between", it always
@@ -3871,19 +4526,17 @@ int place;			/* above, below, or between? */
 	}
 
 	/*
-	 * Mark the "tried" field for all relevant rectangles.  This says
-	 * whether we have already tried using their boundaries for positioning
-	 * our rectangles.  Any rectangle that is closer to the staff/baseline
-	 * than we want to allow, we mark as if we have tried it already.
+	 * As in stackit(), the relevant rectangles' outer boundaries are the
+	 * positions to try, working outwards through sr_p.  Skip any that are
+	 * closer to the staff/baseline than we want to allow.
 	 */
-	for (oidx = ofirst; oidx < olimit; oidx++) {
-		if (Rectab[oidx].relevant == YES) {
-			if ((place == PL_BELOW && Rectab[oidx].s > north) ||
-			    (place != PL_BELOW && Rectab[oidx].n < south)) {
-				Rectab[oidx].tried = YES;
-			} else {
-				Rectab[oidx].tried = NO;
-			}
+	if (place == PL_BELOW) {
+		for (try = nrel - 1; try >= 0 && sr_p[try].key > north; try--) {
+			;
+		}
+	} else {
+		for (try = 0; try < nrel && sr_p[try].key < south; try++) {
+			;
 		}
 	}
 
@@ -3895,30 +4548,11 @@ int place;			/* above, below, or between? */
 	 */
 	for (;;) {
 		overlap = NO;
-		for (oidx = ofirst; oidx < olimit; oidx++) {
-			/* ignore ones east or west of the new rectangles */
-			if (Rectab[oidx].relevant == NO) {
-				continue;
-			}
-
-			/*
-			 * Test for overlap with each new rectangle.  Unlike in
-			 * stackit(), we have to check all four directions,
-			 * because "relevant == YES" doesn't guarantee
-			 * vertical overlap with the same rectangle that
-			 * horizontally overlaps.  The rectangles may have
-			 * different heights.
-			 */
-			for (nidx = nfirst; nidx < nlimit; nidx++) {
-				if (Rectab[oidx].s + FUDGE <= Rectab[nidx].n &&
-				    Rectab[oidx].n >= Rectab[nidx].s + FUDGE &&
-				    Rectab[oidx].w + FUDGE <= Rectab[nidx].e &&
-				    Rectab[oidx].e >= Rectab[nidx].w + FUDGE) {
-					overlap = YES;
-					break;
-				}
-			}
-			if (overlap == YES) {
+		for (nidx = nfirst; nidx < nlimit; nidx++) {
+			if (stackoverlap(&sr_p[(nidx - nfirst + 1) * nrel],
+					numover[nidx - nfirst], Rectab[nidx].n,
+					Rectab[nidx].s, place) == YES) {
+				overlap = YES;
 				break;
 			}
 		}
@@ -3928,52 +4562,18 @@ int place;			/* above, below, or between? */
 			break;
 		}
 
-		/*
-		 * Something overlapped, so we have to try again.  Find the
-		 * innermost relevant outer rectangle boundary that hasn't been
-		 * tried already, to use as the next trial position for our
-		 * rectangles' inner boundaries.
-		 */
-		try = -1;
-		for (oidx = ofirst; oidx < olimit; oidx++) {
-			/* ignore ones that are sure not to overlap */
-			if (Rectab[oidx].relevant == NO ||
-			    Rectab[oidx].tried == YES) {
-				continue;
-			}
-
-			/*
-			 * If this is the first relevant one we haven't tried,
-			 * or if this is farther in than the innermost so far,
-			 * save it as being the new innermost so far.
-			 */
-			if (place == PL_BELOW) {
-				if (try == -1 ||
-				    Rectab[oidx].s > Rectab[try].s) {
-					try = oidx;
-				}
-			} else {
-				if (try == -1 ||
-				    Rectab[oidx].n < Rectab[try].n) {
-					try = oidx;
-				}
-			}
-		}
-
-		if (try == -1) {
+		if (try < 0 || try >= nrel) {
 			pfatal("bug in multistackit()");
 		}
 
 		/*
-		 * Mark this one as having been tried (for next time around, if
-		 * necessary).  Set new trial values for north and south of our
-		 * rectangle.
+		 * Set new trial values for north and south of our
+		 * rectangles.
 		 */
-		Rectab[try].tried = YES;
 		if (place == PL_BELOW) {
-			move = Rectab[try].s - Rectab[nfirst].n;
+			move = sr_p[try--].key - Rectab[nfirst].n;
 		} else {
-			move = Rectab[try].n - Rectab[nfirst].s;
+			move = sr_p[try++].key - Rectab[nfirst].s;
 		}
 		for (nidx = nfirst; nidx < nlimit; nidx++) {
 			Rectab[nidx].n += move;
@@ -3983,4 +4583,213 @@ int place;			/* above, below, or between? */
 		south += move;
 
 	} /* end of while loop trying positions for the rectangles */
+
+	FREE(numover);
+}
+
+/*
+ * Name:        getstackrecs()
+ *
+ * Abstract:    Get space for sorting rectangles for stackit/multistackit.
+ *
+ * Returns:     pointer to an array of at least "num" STACKRECs
+ *
+ * Description: The array is kept from one call to the next, and grown as
+ *		needed, since these functions are called for every item that
+ *		gets stacked.  Its contents are not preserved.
+ */
+
+static struct STACKREC *
+getstackrecs(num)
+
+int num;			/* how many are needed */
+
+{
+	static struct STACKREC *stackrecs;	/* the array */
+	static int stackrecs_len;		/* how many it has room for */
+
+
+	if (num > stackrecs_len) {
+		if (stackrecs != (struct STACKREC *)0) {
+			FREE(stackrecs);
+		}
+		stackrecs_len = num + num / 2 + 64;
+		MALLOC(STACKREC, stackrecs, stackrecs_len);
+	}
+	return (stackrecs);
+}
+
+/*
+ * Name:        setstackrec()
+ *
+ * Abstract:    Fill in a STACKREC for one rectangle in Rectab.
+ *
+ * Returns:     void
+ *
+ * Description: The key is the rectangle's outer boundary, the one that could
+ *		be used as the next trial position for a new rectangle's inner
+ *		boundary, and "other" is its inner boundary.  For below, outer
+ *		is south; else it is north.
+ */
+
+static void
+setstackrec(sr_p, idx, place)
+
+struct STACKREC *sr_p;		/* the one to fill in */
+int idx;			/* index into Rectab */
+int place;			/* above, below, or between? */
+
+{
+	sr_p->idx = idx;
+	if (place == PL_BELOW) {
+		sr_p->key = Rectab[idx].s;
+		sr_p->other = Rectab[idx].n;
+	} else {
+		sr_p->key = Rectab[idx].n;
+		sr_p->other = Rectab[idx].s;
+	}
+}
+
+/*
+ * Name:        sortstackrecs()
+ *
+ * Abstract:    Sort STACKRECs and set their "bound" fields.
+ *
+ * Returns:     void
+ *
+ * Description: This sorts the STACKRECs by key, smallest first.  Then for
+ *		below, it sets each one's bound to the largest "other" (north)
+ *		of it and all that come before it; else, to the smallest
+ *		"other" (south) of it and all that come after it.  Then
+ *		stackoverlap() can tell whether anything overlaps a trial
+ *		position by looking at just one of them.
+ */
+
+static void
+sortstackrecs(sr_p, num, place)
+
+struct STACKREC *sr_p;		/* the array to sort */
+int num;			/* how many are in it */
+int place;			/* above, below, or between? */
+
+{
+	int n;			/* loop variable */
+
+
+	if (num == 0) {
+		return;
+	}
+
+	qsort((char *)sr_p, num, sizeof (struct STACKREC), compstackrecs);
+
+	if (place == PL_BELOW) {
+		sr_p[0].bound = sr_p[0].other;
+		for (n = 1; n < num; n++) {
+			sr_p[n].bound = MAX(sr_p[n - 1].bound, sr_p[n].other);
+		}
+	} else {
+		sr_p[num - 1].bound = sr_p[num - 1].other;
+		for (n = num - 2; n >= 0; n--) {
+			sr_p[n].bound = MIN(sr_p[n + 1].bound, sr_p[n].other);
+		}
+	}
+}
+
+/*
+ * Name:        compstackrecs()
+ *
+ * Abstract:    Function for qsort to call to compare STACKRECs by key
+ *
+ * Returns:     positive if sr1.key > sr2.key, neg if <, 0 if ==
+ *
+ * Description: See above.
+ */
+
+static int
+compstackrecs(sr1_p, sr2_p)
+
+#ifdef __STDC__
+const void *sr1_p;
+const void *sr2_p;
+#else
+char *sr1_p;
+char *sr2_p;
+#endif
+{
+	float key1, key2;	/* keys of the STACKRECs */
+
+
+	key1 = ((struct STACKREC *)sr1_p)->key;
+	key2 = ((struct STACKREC *)sr2_p)->key;
+
+	if (key1 > key2) {
+		return (1);
+	} else if (key1 < key2) {
+		return (-1);
+	} else {
+		return (0);
+	}
+}
+
+/*
+ * Name:        stackoverlap()
+ *
+ * Abstract:    Does a trial position overlap any of a set of rectangles?
+ *
+ * Returns:     YES or NO
+ *
+ * Description: Given STACKRECs set up by sortstackrecs(), this decides
+ *		whether any of those rectangles overlap vertically with a
+ *		new rectangle at the given position, allowing for FUDGE.
+ *		For above/between, the rectangles with north far enough above
+ *		our south are found by binary search; they are all the ones
+ *		from there on, and the bound of that first one tells whether
+ *		any of them reaches below our north.  Below is the mirror image.
+ */
+
+static int
+stackoverlap(sr_p, num, north, south, place)
+
+struct STACKREC *sr_p;		/* the rectangles, sorted */
+int num;			/* how many there are */
+double north;			/* north of the trial position */
+double south;			/* south of the trial position */
+int place;			/* above, below, or between? */
+
+{
+	int lo, hi, mid;	/* for binary search */
+
+
+	lo = 0;
+	hi = num;
+	if (place == PL_BELOW) {
+		/* find how many have south far enough below our north */
+		while (lo < hi) {
+			mid = (lo + hi) / 2;
+			if (sr_p[mid].key + FUDGE <= north) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		/* do any of those have north far enough above our south? */
+		if (lo > 0 && sr_p[lo - 1].bound >= south + FUDGE) {
+			return (YES);
+		}
+	} else {
+		/* find the first one with north far enough above our south */
+		while (lo < hi) {
+			mid = (lo + hi) / 2;
+			if (sr_p[mid].key >= south + FUDGE) {
+				hi = mid;
+			} else {
+				lo = mid + 1;
+			}
+		}
+		/* do any from there on have south far enough below our north?*/
+		if (lo < num && sr_p[lo].bound + FUDGE <= north) {
+			return (YES);
+		}
+	}
+	return (NO);
 }
@@ -72,6 +72,8 @@ static void restsize P((struct GRPSYL *gs_p, float *wid_p, float *asc_p,
 		float *des_p));
 static void procsyls P((struct GRPSYL *gs_p));
 static void apply_staffscale P((void));
+static char *resize_shared P((char *string, double scale_factor,
+		char *filename, int lineno));
 static void room4subbars P((void));
 static void relxchord P((void));
 static int collision_danger P((struct GRPSYL *g1_p, struct GRPSYL *g2_p));
@@ -1658,6 +1660,8 @@ apply_staffscale()
 	 * about Ignore_staffscale in globals.c.
 	 */
 	Ignore_staffscale = NO;
+	/* SSV checkpoints saved so far ignored staffscale, so are stale now */
+	discard_ssv_ckpts();
 
 	initstructs();
 
@@ -1756,7 +1760,8 @@ apply_staffscale()
 				}
 
 				for (n = 0; n < gs_p->nwith; n++) {
-					(void)resize_string(
+					gs_p->withlist[n].string =
+						resize_shared(
 						gs_p->withlist[n].string,
 						staffscale,
 						gs_p->inputfile,
@@ -1786,7 +1791,7 @@ apply_staffscale()
 		for (stuff_p = staff_p->stuff_p; stuff_p != 0;
 				stuff_p = stuff_p->next) {
 			if (stuff_p->string != 0) {
-				(void)resize_string(
+				stuff_p->string = resize_shared(
 					stuff_p->string,
 					stuff_p->all == YES ? Score.staffscale
 							: staffscale,
@@ -1797,6 +1802,39 @@ apply_staffscale()
 	}
 }
 
+/*
+ * Name:        resize_shared()
+ *
+ * Abstract:    Resize a string that may be shared with other structures.
+ *
+ * Returns:     the resized string
+ *
+ * Description:	"With" list items and text STUFF strings are interned (see
+ *		intern.c), so one copy may be used by many groups and staffs,
+ *		which may have different staffscales.  So rather than
+ *		resizing in place, this resizes a private copy, unless the
+ *		scale is close enough to 1 that resize_string() wouldn't
+ *		change anything anyway.
+ */
+
+static char *
+resize_shared(string, scale_factor, filename, lineno)
+
+char *string;		/* the string to resize */
+double scale_factor;	/* adjust sizes in string by this factor */
+char *filename;		/* for error messages */
+int lineno;		/* for error messages */
+
+{
+	if (string == (char *) 0 || *string == '\0' ||
+			fabs(scale_factor - 1.0) < 0.01) {
+		return(string);
+	}
+
+	return(resize_string(copy_string(string + 2, (int) string[0],
+			(int) string[1]), scale_factor, filename, lineno));
+}
+
 /*
  * Name:        room4subbars()
  *
@@ -0,0 +1,477 @@
+/*
+ Copyright (c) 1995-2024  by Arkkra Enterprises.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms,
+ with or without modification, are permitted provided that
+ the following conditions are met:
+
+ 1. Redistributions of source code must retain
+ the above copyright notice, this list of conditions
+ and the following DISCLAIMER.
+
+ 2. Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and
+ the following DISCLAIMER in the documentation and/or
+ other materials provided with the distribution.
+
+ 3. Any additions, deletions, or changes to the original files
+ must be clearly indicated in accompanying documentation,
+ including the reasons for the changes,
+ and the names of those who made the modifications.
+
+	DISCLAIMER
+
+ THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS
+ OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Name:	serve.c
+ *
+ * Description:	This file contains functions for running Mup as a resident
+ *		server ("mup --serve"), for when Mup is to be run many times,
+ *		as by mupmate or a script rendering lots of small files.
+ *		The server does all the one-time initialization (font
+ *		metrics, character tables, symbol table, etc) just once,
+ *		and then reads requests. For each request, it forks a child,
+ *		which sets up its arguments, standard input, output, and
+ *		error as the request says, and then returns into main() to
+ *		carry on as if Mup had just been started that way. Since each
+ *		job is a fresh copy of the initialized server, there is no
+ *		parse or placement state to reset between jobs, and nothing
+ *		one job does can affect the next.
+ *
+ *		Requests are read either from standard input, or from
+ *		connections to a Unix domain socket whose name is given after
+ *		--serve. A request is a series of lines:
+ *
+ *			arg ARGUMENT	a command line argument; as many as
+ *					needed, in order
+ *			dir DIRECTORY	directory to run the job in
+ *			env NAME=VALUE	environment variable to set for the job
+ *			input N		followed by exactly N bytes, which are
+ *					given to the job as its standard input
+ *			timeout SECONDS	kill the job if it runs longer than
+ *					this, as when it is stuck in a loop
+ *			run		end of request; run the job
+ *
+ *		When the job finishes, the reply is
+ *
+ *			output N	followed by the N bytes the job wrote
+ *					to standard output
+ *			errors N	followed by the N bytes the job wrote
+ *					to standard error
+ *			exit CODE	or "signal NUMBER" if it was killed
+ *
+ *		Any request line that can't be understood gets an
+ *		"error MESSAGE" line in reply, and is otherwise ignored.
+ */
+
+#include "defines.h"
+#include "structs.h"
+#include "globals.h"
+
+#ifdef HAVE_FORK
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* most arguments allowed in a request */
+#define MAXSERVEARGS	(256)
+/* most environment variables allowed in a request */
+#define MAXSERVEENV	(32)
+/* longest request line */
+#define SERVELINELEN	(4096)
+/* how many connections can be waiting to be accepted */
+#define SERVEBACKLOG	(16)
+
+/* The current request */
+static char *Serve_argv[MAXSERVEARGS + 2];	/* room for name and null */
+static int Serve_argc;
+static char *Serve_env[MAXSERVEENV];
+static int Serve_envc;
+static char *Serve_dir;
+static int Serve_timeout;		/* seconds, or 0 for no limit */
+
+static int serve_conn P((FILE *in_p, FILE *out_p));
+static int get_request P((FILE *in_p, FILE *out_p, FILE *input_p));
+static char *save_string P((char *string));
+static void free_request P((void));
+static void reply_file P((FILE *out_p, char *what, FILE *file_p));
+#endif
+
+
+/* Run as a server. This only returns in a child process that is to run a
+ * job, in which case it points *argv_p to the arguments for the job
+ * and returns how many there are. The server itself exits when there
+ * are no more requests. */
+
+int
+serve(sockname, argv_p)
+
+char *sockname;		/* Unix domain socket to listen on, or null
+			 * to read requests from standard input */
+char ***argv_p;		/* the arguments Mup was run with, replaced with
+			 * those for the job */
+
+{
+#ifdef HAVE_FORK
+	struct sockaddr_un addr;
+	int listen_fd;
+	int conn_fd;
+	FILE *in_p;
+	FILE *out_p;
+	int argc;
+
+
+	debug(1, "serve");
+
+	/* Job arguments are parsed as if they came from Mup's own command
+	 * line, so the first one is the program name. */
+	Serve_argv[0] = (*argv_p)[0];
+
+	if (sockname == (char *) 0) {
+		/* Use duplicates of the standard input and output, so that
+		 * the stdio streams stay untouched for the jobs to use. */
+		if ((in_p = fdopen(dup(0), "r")) == (FILE *) 0 ||
+				(out_p = fdopen(dup(1), "w")) == (FILE *) 0) {
+			ufatal("can't set up for --serve on standard input");
+		}
+		if ((argc = serve_conn(in_p, out_p)) < 0) {
+			exit(0);
+		}
+		*argv_p = Serve_argv;
+		return(argc);
+	}
+
+	if (strlen(sockname) >= sizeof(addr.sun_path)) {
+		ufatal("socket name '%s' is too long", sockname);
+	}
+	(void) memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	(void) strcpy(addr.sun_path, sockname);
+	/* get rid of any left over from a previous server */
+	(void) unlink(sockname);
+	if ((listen_fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0
+			|| bind(listen_fd, (struct sockaddr *) &addr,
+			sizeof(addr)) != 0
+			|| listen(listen_fd, SERVEBACKLOG) != 0) {
+		ufatal("can't set up socket '%s' for --serve: %s",
+					sockname, strerror(errno));
+	}
+
+	/* Each connection is handled by its own process, so that several
+	 * clients can be served at once. */
+	for ( ; ; ) {
+		/* clean up after connections that have finished */
+		while (waitpid(-1, (int *) 0, WNOHANG) > 0) {
+			;
+		}
+
+		if ((conn_fd = accept(listen_fd, (struct sockaddr *) 0,
+					(socklen_t *) 0)) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			ufatal("accept failed on socket '%s': %s",
+					sockname, strerror(errno));
+		}
+
+		switch (fork()) {
+		case -1:
+			ufatal("can't create process for --serve connection");
+			/*NOTREACHED*/
+			break;
+		case 0:
+			(void) close(listen_fd);
+			if ((in_p = fdopen(conn_fd, "r")) == (FILE *) 0 ||
+					(out_p = fdopen(dup(conn_fd), "w"))
+					== (FILE *) 0) {
+				_exit(1);
+			}
+			if ((argc = serve_conn(in_p, out_p)) < 0) {
+				_exit(0);
+			}
+			*argv_p = Serve_argv;
+			return(argc);
+		default:
+			(void) close(conn_fd);
+			break;
+		}
+	}
+#else
+	ufatal("--serve is not supported on this system");
+	/*NOTREACHED*/
+	return(0);
+#endif
+}
+
+#ifdef HAVE_FORK
+
+/* Handle requests coming in on in_p, replying on out_p. When there are
+ * no more, return -1. In the child process made to run a job, return
+ * the number of arguments for the job, with standard input, output,
+ * and error already set up for it. */
+
+static int
+serve_conn(in_p, out_p)
+
+FILE *in_p;
+FILE *out_p;
+
+{
+	FILE *input_p;		/* standard input for job */
+	FILE *output_p;		/* standard output of job */
+	FILE *errors_p;		/* standard error of job */
+	pid_t pid;
+	int status;
+	int incpath_pipe[2];	/* job tells where include files were */
+	int e;
+
+
+	for ( ; ; ) {
+		input_p = tmpfile();
+		output_p = tmpfile();
+		errors_p = tmpfile();
+		if (input_p == (FILE *) 0 || output_p == (FILE *) 0 ||
+						errors_p == (FILE *) 0) {
+			ufatal("can't create temporary files for --serve");
+		}
+
+		if (get_request(in_p, out_p, input_p) == NO) {
+			return(-1);
+		}
+		(void) fflush(input_p);
+		(void) fflush(out_p);
+
+		if (pipe(incpath_pipe) != 0) {
+			ufatal("can't create pipe for --serve job");
+		}
+		if ((pid = fork()) < 0) {
+			ufatal("can't create process for --serve job");
+		}
+		if (pid == 0) {
+			/* We are the job. Don't use fclose on the request
+			 * streams, since that could move the file offset
+			 * they share with the server. */
+			(void) close(fileno(in_p));
+			(void) close(fileno(out_p));
+			rewind(input_p);
+			if (dup2(fileno(input_p), 0) < 0
+					|| dup2(fileno(output_p), 1) < 0
+					|| dup2(fileno(errors_p), 2) < 0) {
+				_exit(1);
+			}
+			for (e = 0; e < Serve_envc; e++) {
+				(void) putenv(Serve_env[e]);
+			}
+			if (Serve_dir != (char *) 0 && chdir(Serve_dir) != 0) {
+				ufatal("can't change directory to '%s'",
+							Serve_dir);
+			}
+			/* SIGALRM kills the job, so that will be the reply */
+			if (Serve_timeout > 0) {
+				(void) alarm((unsigned) Serve_timeout);
+			}
+			/* Tell the server where include files were found,
+			 * so later requests can go right to them */
+			(void) close(incpath_pipe[0]);
+			report_incpaths(incpath_pipe[1]);
+			return(Serve_argc);
+		}
+
+		(void) close(incpath_pipe[1]);
+		if (waitpid(pid, &status, 0) != pid) {
+			status = -1;
+		}
+		learn_incpaths(incpath_pipe[0]);
+		(void) close(incpath_pipe[0]);
+		reply_file(out_p, "output", output_p);
+		reply_file(out_p, "errors", errors_p);
+		if (WIFEXITED(status)) {
+			(void) fprintf(out_p, "exit %d\n", WEXITSTATUS(status));
+		}
+		else if (WIFSIGNALED(status)) {
+			(void) fprintf(out_p, "signal %d\n", WTERMSIG(status));
+		}
+		else {
+			(void) fprintf(out_p, "exit -1\n");
+		}
+		(void) fflush(out_p);
+
+		(void) fclose(input_p);
+		(void) fclose(output_p);
+		(void) fclose(errors_p);
+		free_request();
+	}
+}
+
+
+/* Read one request. Any input for the job is written to input_p.
+ * Returns YES when a complete request has been read, or NO if there
+ * are no more. */
+
+static int
+get_request(in_p, out_p, input_p)
+
+FILE *in_p;		/* read request from here */
+FILE *out_p;		/* report errors here */
+FILE *input_p;		/* put job's input here */
+
+{
+	char line[SERVELINELEN];
+	char *value;		/* what follows the keyword on the line */
+	size_t len;
+	long remaining;		/* bytes of input still to copy */
+	int c;
+
+
+	Serve_argc = 1;
+	while (fgets(line, sizeof(line), in_p) != (char *) 0) {
+		len = strlen(line);
+		if (len > 0 && line[len - 1] == '\n') {
+			line[--len] = '\0';
+		}
+		else if ( ! feof(in_p)) {
+			/* skip the rest of the overly long line */
+			while ((c = getc(in_p)) != EOF && c != '\n') {
+				;
+			}
+			(void) fprintf(out_p, "error request line too long\n");
+			continue;
+		}
+		if ((value = strchr(line, ' ')) != (char *) 0) {
+			*value++ = '\0';
+		}
+
+		if (strcmp(line, "run") == 0) {
+			Serve_argv[Serve_argc] = (char *) 0;
+			return(YES);
+		}
+		else if (value == (char *) 0) {
+			if (line[0] != '\0') {
+				(void) fprintf(out_p, "error unknown request '%s'\n",
+								line);
+			}
+		}
+		else if (strcmp(line, "arg") == 0) {
+			if (Serve_argc > MAXSERVEARGS) {
+				(void) fprintf(out_p, "error too many arguments\n");
+				continue;
+			}
+			Serve_argv[Serve_argc++] = save_string(value);
+		}
+		else if (strcmp(line, "env") == 0) {
+			if (Serve_envc >= MAXSERVEENV || strchr(value, '=')
+							== (char *) 0) {
+				(void) fprintf(out_p, "error bad env '%s'\n",
+								value);
+				continue;
+			}
+			Serve_env[Serve_envc++] = save_string(value);
+		}
+		else if (strcmp(line, "dir") == 0) {
+			if (Serve_dir != (char *) 0) {
+				FREE(Serve_dir);
+			}
+			Serve_dir = save_string(value);
+		}
+		else if (strcmp(line, "timeout") == 0) {
+			Serve_timeout = atoi(value);
+		}
+		else if (strcmp(line, "input") == 0) {
+			for (remaining = atol(value); remaining > 0;
+							remaining--) {
+				if ((c = getc(in_p)) == EOF) {
+					return(NO);
+				}
+				(void) putc(c, input_p);
+			}
+		}
+		else {
+			(void) fprintf(out_p, "error unknown request '%s'\n",
+								line);
+		}
+	}
+	return(NO);
+}
+
+
+/* Return a copy of the given string */
+
+static char *
+save_string(string)
+
+char *string;
+
+{
+	char *copy;
+
+	MALLOCA(char, copy, strlen(string) + 1);
+	(void) strcpy(copy, string);
+	return(copy);
+}
+
+
+/* Free everything saved for the request just done */
+
+static void
+free_request()
+
+{
+	int a;
+
+	for (a = 1; a < Serve_argc; a++) {
+		FREE(Serve_argv[a]);
+	}
+	Serve_argc = 1;
+	for (a = 0; a < Serve_envc; a++) {
+		FREE(Serve_env[a]);
+	}
+	Serve_envc = 0;
+	if (Serve_dir != (char *) 0) {
+		FREE(Serve_dir);
+		Serve_dir = (char *) 0;
+	}
+	Serve_timeout = 0;
+}
+
+
+/* Send what a job wrote to one of its output files, preceded by a line
+ * telling what it is and how many bytes there are. */
+
+static void
+reply_file(out_p, what, file_p)
+
+FILE *out_p;
+char *what;		/* "output" or "errors" */
+FILE *file_p;
+
+{
+	char buff[BUFSIZ];
+	size_t n;
+
+	(void) fseek(file_p, 0L, SEEK_END);
+	(void) fprintf(out_p, "%s %ld\n", what, ftell(file_p));
+	rewind(file_p);
+	while ((n = fread(buff, 1, sizeof(buff), file_p)) > 0) {
+		(void) fwrite(buff, 1, n, out_p);
+	}
+}
+#endif
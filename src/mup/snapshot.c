@@ -0,0 +1,820 @@
+/*
+ Copyright (c) 1995-2024  by Arkkra Enterprises.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms,
+ with or without modification, are permitted provided that
+ the following conditions are met:
+
+ 1. Redistributions of source code must retain
+ the above copyright notice, this list of conditions
+ and the following DISCLAIMER.
+
+ 2. Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and
+ the following DISCLAIMER in the documentation and/or
+ other materials provided with the distribution.
+
+ 3. Any additions, deletions, or changes to the original files
+ must be clearly indicated in accompanying documentation,
+ including the reasons for the changes,
+ and the names of those who made the modifications.
+
+	DISCLAIMER
+
+ THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS
+ OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*
+ * Name:	snapshot.c
+ *
+ * Description:	This file contains functions for writing and loading
+ *		snapshots. A snapshot is what results from parsing a file
+ *		of macro definitions and score, staff, and voice contexts,
+ *		such as a house style header shared by many songs, saved in
+ *		binary form ("mup -S snapfile header.mup"). A later run given
+ *		the snapshot with -P loads it in place of parsing the header
+ *		again, and ends up in the same state as if the header had
+ *		been its first input file. The snapshot holds:
+ *			- the macros that were defined
+ *			- the SSVs the contexts put on the main list, which
+ *			  are applied again when loaded, to get the same
+ *			  Score, Staff, and Voice values
+ *			- the beamstyles and timeunits remembered for each
+ *			  time signature (see remember_tsig_params())
+ *			- a few things the parser keeps track of, like the
+ *			  current font, and which context the header ended in
+ *		SSVs are saved as their raw bytes, followed by what their
+ *		pointers point to, so a snapshot can only be loaded by the
+ *		same version of Mup that wrote it. Things that a snapshot
+ *		doesn't hold, like music, headers and footers, keymaps,
+ *		shapes, fontfiles, and saved macros, are not allowed in its
+ *		input.
+ *
+ *		Macros defined on the command line (with -D, -m, or -M) when
+ *		the snapshot is made are recorded, but not loaded. Since the
+ *		header was parsed with them, a run with different ones may
+ *		get different results than parsing the header would have
+ *		given, if it uses ifdef on them. So loading warns about that,
+ *		and snapshot_fits() lets --prelude jobs check for it, to read
+ *		the header instead.
+ */
+
+#include <string.h>
+#include "defines.h"
+#include "structs.h"
+#include "globals.h"
+
+/* A snapshot starts with this */
+static char Snap_magic[] = "Mup snapshot\n";
+/* and ends with this */
+#define SNAP_END	(0x4d7570L)
+
+/* The file being written */
+static FILE *Snap_file_p;
+
+/* The snapshot being loaded, which has been read into memory */
+static char *Snap_buff;
+static long Snap_size;
+static long Snap_offset;	/* where the next thing will be read from */
+static char *Snap_name;		/* file it came from, for error messages */
+
+/* The SSVs in the snapshot, in order, so the time signature map can
+ * refer to them by number */
+static struct SSV **Snap_ssvs;
+static long Snap_nssvs;
+
+static void chk_snapshot P((struct MAINLL *mll_p));
+static void put_ssv P((struct MAINLL *mll_p));
+static struct MAINLL *get_ssv P((void));
+static void put_staffsets P((struct STAFFSET *list_p, int count));
+static struct STAFFSET *get_staffsets P((void));
+static void begin_load P((char *buff, long size, char *name, char *version));
+static void chk_header P((char *version));
+
+
+/* Write a snapshot of what has been parsed, to file_p if that is not null,
+ * or else to a new file called filename. Input that a snapshot can't hold
+ * is a user error, in which case nothing is written. */
+
+void
+write_snapshot(file_p, filename, version)
+
+FILE *file_p;
+char *filename;
+char *version;		/* of Mup */
+
+{
+	struct MAINLL *mll_p;
+	struct MAINLL *open_p;	/* SSV of the context the input ended in */
+	UINT32B contexts;	/* every context the input used */
+	int multiple;		/* YES if that context is for several
+				 * staffs or voices */
+	int opened;		/* YES if we opened the file */
+	int f;
+
+
+	debug(1, "write_snapshot");
+
+	open_p = snapshot_context(&contexts, &multiple);
+	if ((contexts & ~(C_SSV | C_MUSIC)) != 0) {
+		ufatal("input for a snapshot can only contain macros and score, staff, and voice contexts");
+	}
+	if (multiple == YES) {
+		ufatal("input for a snapshot can't end in a staff or voice context for more than one staff or voice");
+	}
+	for (mll_p = Mainllhc_p; mll_p != (struct MAINLL *) 0;
+						mll_p = mll_p->next) {
+		chk_snapshot(mll_p);
+	}
+	if (open_p != (struct MAINLL *) 0) {
+		chk_snapshot(open_p);
+	}
+	if (Alt_timesig_list != (char *) 0) {
+		ufatal("input for a snapshot can't set alternating time signatures");
+	}
+	for (f = 0; f < MAXFONTS; f++) {
+		if (Fontinfo[f].fontfile != (FILE *) 0) {
+			ufatal("input for a snapshot can't use fontfile");
+		}
+	}
+
+	opened = NO;
+	if (file_p == (FILE *) 0) {
+		if ((file_p = fopen(filename, "wb")) == (FILE *) 0) {
+			cant_open(filename);
+		}
+		opened = YES;
+	}
+	Snap_file_p = file_p;
+
+	/* The header says what Mup wrote this, and the sizes of things
+	 * saved as raw bytes, so that it won't be loaded by anything that
+	 * would misunderstand it. */
+	snap_putbytes(Snap_magic, (long) strlen(Snap_magic));
+	snap_putstr(version);
+	snap_putnum((long) sizeof(struct SSV));
+	snap_putnum((long) NUMFLDS);
+	snap_putnum((long) MAXSTAFFS);
+	snap_putnum((long) MAXVOICES);
+	write_cmdline_macros();
+
+	/* what the parser keeps track of */
+	snap_putnum((long) Context);
+	snap_putnum((long) Curr_font);
+	snap_putnum((long) Curr_family);
+	snap_putnum((long) Curr_size);
+	snap_putnum((long) Tsig_visibility);
+	snap_putnum((long) Tuning_used);
+	snap_putnum((long) Vcombused);
+	snap_putnum((long) Keymap_used);
+
+	write_mac_snapshot();
+
+	for (Snap_nssvs = 0, mll_p = Mainllhc_p; mll_p != (struct MAINLL *) 0;
+						mll_p = mll_p->next) {
+		Snap_nssvs++;
+	}
+	MALLOCA(struct SSV *, Snap_ssvs, Snap_nssvs + 1);
+	snap_putnum(Snap_nssvs);
+	for (Snap_nssvs = 0, mll_p = Mainllhc_p; mll_p != (struct MAINLL *) 0;
+						mll_p = mll_p->next) {
+		Snap_ssvs[Snap_nssvs++] = mll_p->u.ssv_p;
+		put_ssv(mll_p);
+	}
+	/* The SSV of the context that the input ended in goes last. It isn't
+	 * on the main list, since the context could go on after loading. */
+	if (open_p != (struct MAINLL *) 0) {
+		snap_putnum(YES);
+		put_ssv(open_p);
+	}
+	else {
+		snap_putnum(NO);
+	}
+
+	write_tsig_snapshot();
+
+	snap_putnum(SNAP_END);
+	if (fflush(file_p) == EOF || ferror(file_p)) {
+		ufatal("error writing snapshot");
+	}
+	if (opened == YES) {
+		(void) fclose(file_p);
+	}
+	FREE(Snap_ssvs);
+	Snap_file_p = (FILE *) 0;
+}
+
+
+/* Make sure something on the main list can be put in a snapshot */
+
+static void
+chk_snapshot(mll_p)
+
+struct MAINLL *mll_p;
+
+{
+	struct SSV *ssv_p;
+
+
+	if (mll_p->str != S_SSV) {
+		l_ufatal(mll_p->inputfile, mll_p->inputlineno,
+			"input for a snapshot can only contain macros and score, staff, and voice contexts");
+	}
+	ssv_p = mll_p->u.ssv_p;
+	if (ssv_p->printkeymap != (struct KEYMAP *) 0
+			|| ssv_p->labelkeymap != (struct KEYMAP *) 0
+			|| ssv_p->endingkeymap != (struct KEYMAP *) 0
+			|| ssv_p->rehearsalkeymap != (struct KEYMAP *) 0
+			|| ssv_p->defaultkeymap != (struct KEYMAP *) 0
+			|| ssv_p->withkeymap != (struct KEYMAP *) 0
+			|| ssv_p->textkeymap != (struct KEYMAP *) 0
+			|| ssv_p->lyricskeymap != (struct KEYMAP *) 0) {
+		l_ufatal(mll_p->inputfile, mll_p->inputlineno,
+			"input for a snapshot can't set keymap parameters");
+	}
+	if (ssv_p->shapes != (struct SHAPE_MAP *) 0) {
+		l_ufatal(mll_p->inputfile, mll_p->inputlineno,
+			"input for a snapshot can't set the shapes parameter");
+	}
+}
+
+
+/* Write an SSV: its raw bytes, and then what each of its pointers
+ * points to, in the order get_ssv() reads them back. */
+
+static void
+put_ssv(mll_p)
+
+struct MAINLL *mll_p;
+
+{
+	struct SSV *ssv_p;
+	struct SUBBAR_APPEARANCE *app_p;
+	struct TIMELIST *tl_p;
+	int i, j;
+
+
+	ssv_p = mll_p->u.ssv_p;
+	snap_putstr(mll_p->inputfile);
+	snap_putnum((long) mll_p->inputlineno);
+	snap_putbytes((char *) ssv_p, (long) sizeof(struct SSV));
+
+	put_staffsets(ssv_p->bracelist, ssv_p->nbrace);
+	put_staffsets(ssv_p->bracklist, ssv_p->nbrack);
+	if (ssv_p->barstlist == (struct TOP_BOT *) 0) {
+		snap_putnum(-1L);
+	}
+	else {
+		snap_putnum((long) ssv_p->nbarst);
+		snap_putbytes((char *) ssv_p->barstlist,
+			(long) (ssv_p->nbarst * sizeof(struct TOP_BOT)));
+	}
+
+	/* Several subbars can share an appearance, so for each, give the
+	 * earlier one it shares with, or -1 followed by the appearance. */
+	if (ssv_p->subbarlist == (struct SUBBAR_INSTANCE *) 0) {
+		snap_putnum(-1L);
+	}
+	else {
+		snap_putnum((long) ssv_p->nsubbar);
+		for (i = 0; i < ssv_p->nsubbar; i++) {
+			snap_putbytes((char *) &(ssv_p->subbarlist[i].count),
+				(long) sizeof(ssv_p->subbarlist[i].count));
+			app_p = ssv_p->subbarlist[i].appearance_p;
+			for (j = 0; j < i; j++) {
+				if (ssv_p->subbarlist[j].appearance_p == app_p) {
+					break;
+				}
+			}
+			if (j < i) {
+				snap_putnum((long) j);
+				continue;
+			}
+			snap_putnum(-1L);
+			snap_putbytes((char *) app_p,
+				(long) sizeof(struct SUBBAR_APPEARANCE));
+			snap_putbytes((char *) app_p->ranges_p,
+				(long) (app_p->nranges * sizeof(struct TOP_BOT)));
+		}
+	}
+
+	snap_putstr(ssv_p->timerep);
+	snap_putstr(ssv_p->acctable);
+	if (ssv_p->strinfo == (struct STRINGINFO *) 0) {
+		snap_putnum(-1L);
+	}
+	else {
+		snap_putnum((long) ssv_p->stafflines);
+		snap_putbytes((char *) ssv_p->strinfo, (long)
+			(ssv_p->stafflines * sizeof(struct STRINGINFO)));
+	}
+	snap_putstr(ssv_p->prtime_str1);
+	snap_putstr(ssv_p->prtime_str2);
+	if (ssv_p->doremi_syls == (char **) 0) {
+		snap_putnum(-1L);
+	}
+	else {
+		snap_putnum(7L);
+		for (i = 0; i < 7; i++) {
+			snap_putstr(ssv_p->doremi_syls[i]);
+		}
+	}
+	snap_putstr(ssv_p->label);
+	snap_putstr(ssv_p->label2);
+
+	/* Without sublists, subbeamstlist is the same as beamstlist */
+	if (ssv_p->beamstlist == (RATIONAL *) 0) {
+		snap_putnum(-1L);
+	}
+	else {
+		snap_putnum((long) ssv_p->nbeam);
+		snap_putbytes((char *) ssv_p->beamstlist,
+				(long) (ssv_p->nbeam * sizeof(RATIONAL)));
+	}
+	if (ssv_p->subbeamstlist == (RATIONAL *) 0) {
+		snap_putnum(-1L);
+	}
+	else if (ssv_p->subbeamstlist == ssv_p->beamstlist) {
+		snap_putnum(-2L);
+	}
+	else {
+		snap_putnum((long) ssv_p->nsubbeam);
+		snap_putbytes((char *) ssv_p->subbeamstlist,
+				(long) (ssv_p->nsubbeam * sizeof(RATIONAL)));
+	}
+
+	for (i = 0, tl_p = ssv_p->timelist_p; tl_p != (struct TIMELIST *) 0;
+						tl_p = tl_p->next) {
+		i++;
+	}
+	snap_putnum((long) i);
+	for (tl_p = ssv_p->timelist_p; tl_p != (struct TIMELIST *) 0;
+						tl_p = tl_p->next) {
+		snap_putbytes((char *) tl_p, (long) sizeof(struct TIMELIST));
+	}
+
+	snap_putstr(ssv_p->emptymeas);
+}
+
+
+/* Write a brace or bracket list */
+
+static void
+put_staffsets(list_p, count)
+
+struct STAFFSET *list_p;
+int count;
+
+{
+	int i;
+
+	if (list_p == (struct STAFFSET *) 0) {
+		snap_putnum(-1L);
+		return;
+	}
+	snap_putnum((long) count);
+	for (i = 0; i < count; i++) {
+		snap_putnum((long) list_p[i].topstaff);
+		snap_putnum((long) list_p[i].botstaff);
+		snap_putstr(list_p[i].label);
+		snap_putstr(list_p[i].label2);
+	}
+}
+
+
+/* Return YES if the given buffer holds a snapshot rather than Mup input */
+
+int
+is_snapshot(buff, size)
+
+char *buff;
+long size;
+
+{
+	return((size >= (long) strlen(Snap_magic)
+			&& strncmp(buff, Snap_magic, strlen(Snap_magic)) == 0)
+			? YES : NO);
+}
+
+
+/* Return YES if loading the given snapshot gives the same result as
+ * parsing the input it was made from would, as far as can be told:
+ * that is, if the macros defined on the command line now are the same
+ * as when it was made. */
+
+int
+snapshot_fits(buff, size, name, version)
+
+char *buff;
+long size;
+char *name;
+char *version;
+
+{
+	begin_load(buff, size, name, version);
+	return(cmdline_macros_match());
+}
+
+
+/* Load a snapshot that has been read into memory. This must be called
+ * after the parser has been initialized, but before it is run. */
+
+void
+load_snapshot(buff, size, name, version)
+
+char *buff;		/* the whole snapshot */
+long size;		/* bytes in buff */
+char *name;		/* file it came from */
+char *version;		/* of Mup */
+
+{
+	UINT32B context;	/* context the snapshot ended in */
+	struct MAINLL *open_p;	/* its SSV, if it is an SSV context */
+	struct MAINLL *mll_p;
+	long n;
+
+
+	debug(1, "load_snapshot(%s)", name);
+
+	begin_load(buff, size, name, version);
+	if (cmdline_macros_match() == NO) {
+		warning("snapshot '%s' was made with different -D, -m, or -M options", name);
+	}
+
+	context = (UINT32B) snap_getnum();
+	Curr_font = (int) snap_getnum();
+	Curr_family = (int) snap_getnum();
+	Curr_size = (int) snap_getnum();
+	Tsig_visibility = (short) snap_getnum();
+	if (snap_getnum() == YES) {
+		Tuning_used = YES;
+	}
+	if (snap_getnum() == YES) {
+		Vcombused = YES;
+	}
+	if (snap_getnum() == YES) {
+		Keymap_used = YES;
+	}
+
+	read_mac_snapshot();
+
+	/* Put the SSVs on the main list and apply them, like the parser did */
+	Snap_nssvs = snap_getnum();
+	MALLOCA(struct SSV *, Snap_ssvs, Snap_nssvs + 1);
+	for (n = 0; n < Snap_nssvs; n++) {
+		mll_p = get_ssv();
+		insertMAINLL(mll_p, Mainlltc_p);
+		Snap_ssvs[n] = mll_p->u.ssv_p;
+		asgnssv(Snap_ssvs[n]);
+	}
+	open_p = (snap_getnum() == YES ? get_ssv() : (struct MAINLL *) 0);
+
+	read_tsig_snapshot();
+
+	if (snap_getnum() != SNAP_END) {
+		snap_damaged();
+	}
+	FREE(Snap_ssvs);
+
+	/* Carry on in the context the snapshot's input ended in */
+	resume_context(context, open_p);
+}
+
+
+/* Check the header of a snapshot and get ready to read the rest */
+
+static void
+begin_load(buff, size, name, version)
+
+char *buff;
+long size;
+char *name;
+char *version;
+
+{
+	Snap_buff = buff;
+	Snap_size = size;
+	Snap_name = name;
+	if (is_snapshot(buff, size) == NO) {
+		ufatal("'%s' is not a Mup snapshot", name);
+	}
+	Snap_offset = strlen(Snap_magic);
+	chk_header(version);
+}
+
+
+/* Make sure the snapshot being loaded was written by this Mup */
+
+static void
+chk_header(version)
+
+char *version;
+
+{
+	char *snapversion;
+
+
+	snapversion = snap_getstr();
+	if (snapversion == (char *) 0 || strcmp(snapversion, version) != 0
+			|| snap_getnum() != (long) sizeof(struct SSV)
+			|| snap_getnum() != (long) NUMFLDS
+			|| snap_getnum() != (long) MAXSTAFFS
+			|| snap_getnum() != (long) MAXVOICES) {
+		ufatal("snapshot '%s' was made by a different version of Mup; it needs to be made again", Snap_name);
+	}
+	FREE(snapversion);
+}
+
+
+/* Read an SSV written by put_ssv() and return it in a new main list struct */
+
+static struct MAINLL *
+get_ssv()
+
+{
+	struct MAINLL *mll_p;
+	struct SSV *ssv_p;
+	struct SUBBAR_APPEARANCE *app_p;
+	struct TIMELIST **tl_p_p;
+	char *inputfile;
+	int inputlineno;
+	long n;
+	int i, j;
+
+
+	inputfile = snap_getstr();
+	inputlineno = (int) snap_getnum();
+	mll_p = newMAINLLstruct(S_SSV, inputlineno);
+	if (inputfile != (char *) 0) {
+		mll_p->inputfile = intern_owned(inputfile);
+	}
+	ssv_p = mll_p->u.ssv_p;
+	snap_getbytes((char *) ssv_p, (long) sizeof(struct SSV));
+
+	ssv_p->bracelist = get_staffsets();
+	ssv_p->bracklist = get_staffsets();
+	if ((n = snap_getnum()) < 0) {
+		ssv_p->barstlist = (struct TOP_BOT *) 0;
+	}
+	else {
+		MALLOC(TOP_BOT, ssv_p->barstlist, n + 1);
+		snap_getbytes((char *) ssv_p->barstlist,
+				(long) (n * sizeof(struct TOP_BOT)));
+	}
+
+	if ((n = snap_getnum()) < 0) {
+		ssv_p->subbarlist = (struct SUBBAR_INSTANCE *) 0;
+	}
+	else {
+		MALLOC(SUBBAR_INSTANCE, ssv_p->subbarlist, n + 1);
+		for (i = 0; i < n; i++) {
+			snap_getbytes((char *) &(ssv_p->subbarlist[i].count),
+				(long) sizeof(ssv_p->subbarlist[i].count));
+			if ((j = (int) snap_getnum()) >= 0) {
+				if (j >= i) {
+					snap_damaged();
+				}
+				ssv_p->subbarlist[i].appearance_p =
+					ssv_p->subbarlist[j].appearance_p;
+				continue;
+			}
+			MALLOC(SUBBAR_APPEARANCE, app_p, 1);
+			snap_getbytes((char *) app_p,
+				(long) sizeof(struct SUBBAR_APPEARANCE));
+			MALLOC(TOP_BOT, app_p->ranges_p, app_p->nranges + 1);
+			snap_getbytes((char *) app_p->ranges_p,
+				(long) (app_p->nranges * sizeof(struct TOP_BOT)));
+			ssv_p->subbarlist[i].appearance_p = app_p;
+		}
+	}
+
+	ssv_p->timerep = snap_getstr();
+	ssv_p->acctable = snap_getstr();
+	if ((n = snap_getnum()) < 0) {
+		ssv_p->strinfo = (struct STRINGINFO *) 0;
+	}
+	else {
+		MALLOC(STRINGINFO, ssv_p->strinfo, n + 1);
+		snap_getbytes((char *) ssv_p->strinfo,
+				(long) (n * sizeof(struct STRINGINFO)));
+	}
+	ssv_p->prtime_str1 = snap_getstr();
+	ssv_p->prtime_str2 = snap_getstr();
+	if ((n = snap_getnum()) < 0) {
+		ssv_p->doremi_syls = (char **) 0;
+	}
+	else {
+		CALLOCA(char *, ssv_p->doremi_syls, 7);
+		for (i = 0; i < n && i < 7; i++) {
+			ssv_p->doremi_syls[i] = snap_getstr();
+		}
+	}
+	ssv_p->label = snap_getstr();
+	ssv_p->label2 = snap_getstr();
+
+	if ((n = snap_getnum()) < 0) {
+		ssv_p->beamstlist = (RATIONAL *) 0;
+	}
+	else {
+		MALLOCA(RATIONAL, ssv_p->beamstlist, n + 1);
+		snap_getbytes((char *) ssv_p->beamstlist,
+				(long) (n * sizeof(RATIONAL)));
+	}
+	if ((n = snap_getnum()) == -1) {
+		ssv_p->subbeamstlist = (RATIONAL *) 0;
+	}
+	else if (n == -2) {
+		ssv_p->subbeamstlist = ssv_p->beamstlist;
+	}
+	else {
+		MALLOCA(RATIONAL, ssv_p->subbeamstlist, n + 1);
+		snap_getbytes((char *) ssv_p->subbeamstlist,
+				(long) (n * sizeof(RATIONAL)));
+	}
+
+	tl_p_p = &(ssv_p->timelist_p);
+	for (n = snap_getnum(); n > 0; n--) {
+		MALLOC(TIMELIST, *tl_p_p, 1);
+		snap_getbytes((char *) *tl_p_p, (long) sizeof(struct TIMELIST));
+		tl_p_p = &((*tl_p_p)->next);
+	}
+	*tl_p_p = (struct TIMELIST *) 0;
+
+	ssv_p->emptymeas = snap_getstr();
+	return(mll_p);
+}
+
+
+/* Read a brace or bracket list written by put_staffsets() */
+
+static struct STAFFSET *
+get_staffsets()
+
+{
+	struct STAFFSET *list_p;
+	long count;
+	long i;
+
+
+	if ((count = snap_getnum()) < 0) {
+		return((struct STAFFSET *) 0);
+	}
+	MALLOC(STAFFSET, list_p, count + 1);
+	for (i = 0; i < count; i++) {
+		list_p[i].topstaff = (short) snap_getnum();
+		list_p[i].botstaff = (short) snap_getnum();
+		list_p[i].label = snap_getstr();
+		list_p[i].label2 = snap_getstr();
+	}
+	return(list_p);
+}
+
+
+/* Return the number of an SSV in the snapshot being written, or -1 if it
+ * isn't in it. */
+
+long
+snap_ssv_index(ssv_p)
+
+struct SSV *ssv_p;
+
+{
+	long n;
+
+	for (n = 0; n < Snap_nssvs; n++) {
+		if (Snap_ssvs[n] == ssv_p) {
+			return(n);
+		}
+	}
+	return(-1L);
+}
+
+
+/* Return the SSV with the given number in the snapshot being loaded */
+
+struct SSV *
+snap_ssv_at(index)
+
+long index;
+
+{
+	if (index < 0 || index >= Snap_nssvs) {
+		snap_damaged();
+	}
+	return(Snap_ssvs[index]);
+}
+
+
+/* Give up on a snapshot that doesn't hold what it should */
+
+void
+snap_damaged()
+
+{
+	ufatal("snapshot '%s' is damaged", Snap_name);
+}
+
+
+/* The rest of these write and read the pieces a snapshot is made of. */
+
+void
+snap_putbytes(bytes, length)
+
+char *bytes;
+long length;
+
+{
+	if (length > 0 && fwrite(bytes, (size_t) length, 1, Snap_file_p) != 1) {
+		ufatal("error writing snapshot");
+	}
+}
+
+
+void
+snap_putnum(num)
+
+long num;
+
+{
+	snap_putbytes((char *) &num, (long) sizeof(num));
+}
+
+
+/* Write a string, which may be null. The length goes first, or -1 for
+ * a null pointer. */
+
+void
+snap_putstr(str)
+
+char *str;
+
+{
+	if (str == (char *) 0) {
+		snap_putnum(-1L);
+		return;
+	}
+	snap_putnum((long) strlen(str));
+	snap_putbytes(str, (long) strlen(str));
+}
+
+
+void
+snap_getbytes(bytes, length)
+
+char *bytes;
+long length;
+
+{
+	if (length < 0 || length > Snap_size - Snap_offset) {
+		snap_damaged();
+	}
+	(void) memcpy(bytes, Snap_buff + Snap_offset, (size_t) length);
+	Snap_offset += length;
+}
+
+
+long
+snap_getnum()
+
+{
+	long num;
+
+	snap_getbytes((char *) &num, (long) sizeof(num));
+	return(num);
+}
+
+
+/* Read a string written by snap_putstr(). It is returned in malloc-ed
+ * space, or is null if a null pointer was written. */
+
+char *
+snap_getstr()
+
+{
+	long length;
+	char *str;
+
+
+	if ((length = snap_getnum()) < 0) {
+		return((char *) 0);
+	}
+	MALLOCA(char, str, length + 1);
+	snap_getbytes(str, length);
+	str[length] = '\0';
+	return(str);
+}
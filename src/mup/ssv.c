@@ -71,6 +71,30 @@ static struct SSV Saved_voice[MAXSTAFFS][MAXVOICES];
  */
 static int Ssvs_equal = YES;
 
+/*
+ * setssvstate() is called very often, and replaying all the SSVs from the
+ * beginning of the main list each time would take time proportional to the
+ * square of the length of the song.  So as it goes, it saves checkpoints of
+ * the fixed SSVs every SSVCKPT_BARS bar lines, and later calls start from the
+ * nearest checkpoint at or before where they need to get to.  A checkpoint
+ * belongs to a BAR, and holds the state as of just before that BAR.  Only the
+ * staffs that exist are saved; the others are always in their zapped state.
+ * Anything that changes SSVs or BARs anywhere but the end of the main list,
+ * or changes how asgnssv() assigns them (Ignore_staffscale), must call
+ * discard_ssv_ckpts().
+ */
+#define SSVCKPT_BARS	(16)
+static struct SSVCKPT {
+	struct MAINLL *mll_p;	/* the BAR this is for */
+	int staffs;		/* how many staffs are saved */
+	int alloc_staffs;	/* how many staffs there is space for */
+	struct SSV score;	/* copy of Score */
+	struct SSV *staff_p;	/* copy of Staff[0] through [staffs-1] */
+	struct SSV *voice_p;	/* copy of Voice[0] through [staffs-1] */
+} *Ssvckpts;
+static int Num_ssvckpts;	/* how many of Ssvckpts are valid */
+static int Alloc_ssvckpts;	/* how many Ssvckpts are allocated */
+
 /* define the default order of stacking for marks */
 static char Defmarkorder[] = {
 	1,	/* MK_MUSSYM	*/
@@ -91,6 +115,8 @@ static char Dflt_timerep[] = { 4, TSR_SLASH, 4, TSR_END };
 static struct SSV *svpath_parm P((int s, int field));
 
 static void setorder P((int place, struct SSV *i_p, struct SSV *f_p));
+static struct SSVCKPT *find_ssv_ckpt P((struct MAINLL *mll_p));
+static void save_ssv_ckpt P((struct MAINLL *mll_p));
 
 /*
  * Name:        initstructs()
@@ -1670,7 +1696,10 @@ struct MAINLL *insert_p;	/* insert the cloned SSVs here */
  *		to just before that point, assigning SSVs.  It assigns not only
  *		the SSVs in the MLL, but also the timed SSVs hanging off
  *		barlines.  You can pass a null pointer, and then it will go
- *		through the whole MLL.
+ *		through the whole MLL.  Rather than really starting at the
+ *		beginning of the MLL, it starts from the last checkpoint at
+ *		or before the given point, if there is one, and saves more
+ *		checkpoints as it goes.
  */
 
 void
@@ -1680,28 +1709,174 @@ struct MAINLL *mainll_p;	/* place in the MLL to stop */
 
 {
 	struct MAINLL *mll_p;		/* for looping through MLL */
+	struct MAINLL *start_p;		/* where to start assigning SSVs */
 	struct TIMEDSSV *tssv_p;	/* for looping through TIMEDSSV lists*/
+	struct SSVCKPT *ckpt_p;		/* checkpoint to start from */
+	int bars;			/* bars since the last checkpoint */
 
 
+	Stat_count[ST_SSVREPLAYS]++;
+
+	/* look backwards for the nearest checkpoint */
+	ckpt_p = (struct SSVCKPT *) 0;
+	for (mll_p = (mainll_p == (struct MAINLL *) 0 ? Mainlltc_p : mainll_p);
+			mll_p != (struct MAINLL *) 0; mll_p = mll_p->prev) {
+		if (mll_p->str == S_BAR &&
+				(ckpt_p = find_ssv_ckpt(mll_p)) != 0) {
+			break;
+		}
+	}
+
 	initstructs();
-	for (mll_p = Mainllhc_p; mll_p != 0 && mll_p != mainll_p;
+	if (ckpt_p != (struct SSVCKPT *) 0) {
+		Score = ckpt_p->score;
+		(void)memcpy(Staff, ckpt_p->staff_p,
+				ckpt_p->staffs * sizeof (Staff[0]));
+		(void)memcpy(Voice, ckpt_p->voice_p,
+				ckpt_p->staffs * sizeof (Voice[0]));
+		start_p = ckpt_p->mll_p;
+	}
+	else {
+		start_p = Mainllhc_p;
+	}
+
+	bars = 0;
+	for (mll_p = start_p; mll_p != 0 && mll_p != mainll_p;
 			mll_p = mll_p->next) {
 		switch (mll_p->str) {
 		case S_SSV:
 			/* assign this normal input SSV */
 			asgnssv(mll_p->u.ssv_p);
+			Stat_count[ST_SSVASSIGNS]++;
 			break;
 		case S_BAR:
+			/* every so often, save a checkpoint */
+			if (find_ssv_ckpt(mll_p) != 0) {
+				bars = 0;
+			}
+			else if (++bars >= SSVCKPT_BARS) {
+				save_ssv_ckpt(mll_p);
+				bars = 0;
+			}
+
 			/* assign each timed SSV, if any */
 			for (tssv_p = mll_p->u.bar_p->timedssv_p; tssv_p != 0;
 					tssv_p = tssv_p->next) {
 				asgnssv(&tssv_p->ssv);
+				Stat_count[ST_SSVASSIGNS]++;
 			}
 			break;
 		}
 	}
 }
-
+
+
+/*
+ * Name:        find_ssv_ckpt()
+ *
+ * Abstract:    Find the SSV checkpoint for a BAR, if any.
+ *
+ * Returns:     pointer to the checkpoint, or 0 if none
+ *
+ * Description: This function returns the checkpoint that setssvstate() saved
+ *		for the given BAR.  The index kept in the BAR may be stale,
+ *		if checkpoints were discarded, or the BAR was copied, so it is
+ *		verified against the table.
+ */
+
+static struct SSVCKPT *
+find_ssv_ckpt(mll_p)
+
+struct MAINLL *mll_p;		/* a BAR in the main list */
+
+{
+	int idx;		/* index into Ssvckpts */
+
+
+	idx = mll_p->u.bar_p->ssvckpt - 1;
+	if (idx >= 0 && idx < Num_ssvckpts && Ssvckpts[idx].mll_p == mll_p) {
+		return(&Ssvckpts[idx]);
+	}
+	return((struct SSVCKPT *) 0);
+}
+
+
+/*
+ * Name:        save_ssv_ckpt()
+ *
+ * Abstract:    Save the fixed SSVs as a checkpoint.
+ *
+ * Returns:     void
+ *
+ * Description: This function saves the current fixed SSVs, which must be the
+ *		state as of just before the given BAR, as a checkpoint for it.
+ *		Space from checkpoints that were discarded is reused.
+ */
+
+static void
+save_ssv_ckpt(mll_p)
+
+struct MAINLL *mll_p;		/* a BAR in the main list */
+
+{
+	struct SSVCKPT *ckpt_p;	/* the new checkpoint */
+
+
+	if (Num_ssvckpts >= Alloc_ssvckpts) {
+		Alloc_ssvckpts += 64;
+		if (Ssvckpts == (struct SSVCKPT *) 0) {
+			CALLOC(SSVCKPT, Ssvckpts, Alloc_ssvckpts);
+		}
+		else {
+			REALLOC(SSVCKPT, Ssvckpts, Alloc_ssvckpts);
+			(void)memset((char *) &Ssvckpts[Num_ssvckpts], 0,
+					(Alloc_ssvckpts - Num_ssvckpts) *
+					sizeof(struct SSVCKPT));
+		}
+	}
+
+	ckpt_p = &Ssvckpts[Num_ssvckpts];
+	if (ckpt_p->alloc_staffs < Score.staffs) {
+		if (ckpt_p->alloc_staffs > 0) {
+			FREE(ckpt_p->staff_p);
+			FREE(ckpt_p->voice_p);
+		}
+		ckpt_p->alloc_staffs = Score.staffs;
+		MALLOC(SSV, ckpt_p->staff_p, Score.staffs);
+		MALLOC(SSV, ckpt_p->voice_p, Score.staffs * MAXVOICES);
+	}
+
+	ckpt_p->mll_p = mll_p;
+	ckpt_p->staffs = Score.staffs;
+	ckpt_p->score = Score;
+	(void)memcpy(ckpt_p->staff_p, Staff, Score.staffs * sizeof (Staff[0]));
+	(void)memcpy(ckpt_p->voice_p, Voice, Score.staffs * sizeof (Voice[0]));
+
+	Num_ssvckpts++;
+	mll_p->u.bar_p->ssvckpt = Num_ssvckpts;
+}
+
+
+/*
+ * Name:        discard_ssv_ckpts()
+ *
+ * Abstract:    Throw away all checkpoints saved by setssvstate().
+ *
+ * Returns:     void
+ *
+ * Description: This function must be called whenever the main list changes
+ *		in a way that could change the SSV state at some BAR that may
+ *		have a checkpoint; that is, when an SSV or BAR is added or
+ *		removed anywhere but the end of the list.
+ */
+
+void
+discard_ssv_ckpts()
+
+{
+	Num_ssvckpts = 0;
+}
+
 /*
  * Name:        savessvstate()
  *
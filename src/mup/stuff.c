@@ -1417,6 +1417,7 @@ setstuff()
 	int pedchar;			/* pedal char, in the P_LINE form */
 	int font, size;			/* of a pedal char */
 	char *string;			/* point to the pedal char */
+	char *splitstr;			/* copy of a string to be split */
 	float staffscale;		/* store it here for convenience */
 	float wid;			/* width of one side of the string */
 	int vscheme2;			/* vscheme at the end of the STUFF */
@@ -1635,8 +1636,16 @@ setstuff()
 				if (streast - endspace_width(stuff_p->string) >
 				   EFF_PG_WIDTH - eff_rightmargin(mainll_p) &&
 				   ! IS_CHORDLIKE(stuff_p->modifier)) {
+					/* split_string() changes the string
+					 * in place, and this one may be
+					 * shared (see intern.c), so split
+					 * a copy of it */
+					MALLOCA(char, splitstr,
+						strlen(stuff_p->string) + 1);
+					(void) strcpy(splitstr,
+						stuff_p->string);
 					stuff_p->string = split_string(
-						stuff_p->string, EFF_PG_WIDTH -
+						splitstr, EFF_PG_WIDTH -
 						eff_rightmargin(mainll_p) -
 						stuff_p->c[AW]);
 					streast = stuff_p->c[AW] +
@@ -1597,6 +1597,88 @@ struct MAINLL *mll_p;	/* contains SSV */
 }
 
 
+/* Write the table that maps time signatures to beamstyles and timeunits
+ * to the snapshot being written. The SSVs it points to are given by their
+ * number in the snapshot. */
+
+void
+write_tsig_snapshot()
+
+{
+	struct Sym *entry;
+	struct SSVTABLES *tables_p;
+	int i;
+	int s, v;
+
+
+	for (i = 0; i < SYMTBLSIZE; i++) {
+		for (entry = Time_map[i]; entry != (struct Sym *) 0;
+						entry = entry->next) {
+			snap_putstr(entry->symname);
+			if ((tables_p = entry->val.ssvtables_p) == 0) {
+				snap_putnum(-1L);
+				continue;
+			}
+			for (s = 0; s <= MAXSTAFFS; s++) {
+				for (v = 0; v <= MAXVOICES; v++) {
+					if (tables_p->beamstyle_table[s][v] == 0
+					&& tables_p->timeunit_table[s][v] == 0) {
+						continue;
+					}
+					snap_putnum((long) s);
+					snap_putnum((long) v);
+					snap_putnum(snap_ssv_index(
+					tables_p->beamstyle_table[s][v]));
+					snap_putnum(snap_ssv_index(
+					tables_p->timeunit_table[s][v]));
+				}
+			}
+			snap_putnum(-1L);
+		}
+	}
+	/* a null string marks the end of the table */
+	snap_putstr((char *) 0);
+}
+
+
+/* Read the table written by write_tsig_snapshot() from the snapshot
+ * being loaded. */
+
+void
+read_tsig_snapshot()
+
+{
+	struct Sym *entry;
+	char *timesig;
+	long s, v;
+	long index;
+
+
+	while ((timesig = snap_getstr()) != (char *) 0) {
+		entry = add2tbl(timesig, Time_map);
+		FREE(timesig);
+		entry->val.ssvtables_p = 0;
+		while ((s = snap_getnum()) >= 0) {
+			v = snap_getnum();
+			if (s > MAXSTAFFS || v < 0 || v > MAXVOICES) {
+				snap_damaged();
+			}
+			if (entry->val.ssvtables_p == 0) {
+				CALLOC(SSVTABLES, entry->val.ssvtables_p, 1);
+			}
+			if ((index = snap_getnum()) >= 0) {
+				entry->val.ssvtables_p->beamstyle_table[s][v]
+						= snap_ssv_at(index);
+			}
+			if ((index = snap_getnum()) >= 0) {
+				entry->val.ssvtables_p->timeunit_table[s][v]
+						= snap_ssv_at(index);
+			}
+		}
+	}
+}
+
+
 /* Save the current table that maps time signatures to beamstyles. 
  * This returns the index of the saved table, or -1 if the table was empty,
  * so we didn't need to save anything. */
@@ -322,7 +322,7 @@ int vidx;			/* voice index, 0 to MAXVOICES-1 */
 		/* allocate a separate restc so tab and tabnote don't interfere,
 		 * even though tab doesn't print rests */
 		if (ngs_p->grpcont == GC_REST) {
-			CALLOCA(float, ngs_p->restc, NUMCTYPE);
+			ngs_p->restc = new_coords();
 		}
 
 		/* notelist will be reset later; nnotes might change */
@@ -1352,7 +1352,7 @@ int sharps;			/* current key signature */
 		newnote_p = &ngs_p->notelist[n];   /* set short cut pointer */
 
 		/* allocate the array of coordinates */
-		MALLOCA(float, ngs_p->notelist[n].c, NUMCTYPE);
+		ngs_p->notelist[n].c = new_coords();
 
 		/* copy the calculated letter/accidental/octave */
 		newnote_p->letter = tnn[n].letter;
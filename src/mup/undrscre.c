@@ -77,6 +77,11 @@ static void add_syllable P((struct STAFF *staff_p, int sylplace, int verseno,
 		double begin_x, struct CHORD *chord_p));
 static void stitch_syl_into_chord P((struct CHORD *chord_p,
 		struct GRPSYL *syl_gs_p));
+
+/* If not null, each carryover syllable inserted is also written here, for
+ * replay_carryover() to insert it again. This is for processes forked to
+ * place some of the staffs, so the parent can do the same to its copy. */
+static FILE *Carrylog_p = (FILE *) 0;
 
 
 /* This function is called on lyric syllables in two cases:
@@ -1573,6 +1578,17 @@ int size;
 	float begin_x;		/* where to start carryover syllable */
 
 
+	if (Carrylog_p != (FILE *) 0) {
+		(void) putc('C', Carrylog_p);
+		(void) fwrite((char *) &mll_p, sizeof(mll_p), 1, Carrylog_p);
+		(void) fwrite((char *) &staffno, sizeof(staffno), 1, Carrylog_p);
+		(void) fwrite((char *) &sylplace, sizeof(sylplace), 1, Carrylog_p);
+		(void) fwrite((char *) &verseno, sizeof(verseno), 1, Carrylog_p);
+		(void) fwrite((char *) &font, sizeof(font), 1, Carrylog_p);
+		(void) fwrite((char *) &size, sizeof(size), 1, Carrylog_p);
+		(void) fwrite(the_syl, strlen(the_syl) + 1, 1, Carrylog_p);
+	}
+
 	/* search forward for FEED */
 	for (   ; mll_p != (struct MAINLL *) 0; mll_p = mll_p->next) {
 		if (IS_CLEFSIG_FEED(mll_p)) {
@@ -1649,6 +1665,68 @@ int size;
 }
 
 
+/* Write carryover syllables to the given file from now on, as well as
+ * inserting them, or if the file is null, stop writing them. */
+
+void
+log_carryovers(log_p)
+
+FILE *log_p;
+
+{
+	Carrylog_p = log_p;
+}
+
+
+/* If the next thing in the given file is a carryover syllable written by
+ * insert_carryover_syllable(), read it and insert it the same way, and
+ * return YES. Otherwise leave the file as it was and return NO. */
+
+int
+replay_carryover(log_p)
+
+FILE *log_p;
+
+{
+	struct MAINLL *mll_p;
+	int staffno;
+	int sylplace;
+	int verseno;
+	int font;
+	int size;
+	char the_syl[8];	/* big enough for any carryover syllable */
+	int c;
+	int n;
+
+
+	if ((c = getc(log_p)) != 'C') {
+		if (c != EOF) {
+			(void) ungetc(c, log_p);
+		}
+		return(NO);
+	}
+	if (fread((char *) &mll_p, sizeof(mll_p), 1, log_p) != 1 ||
+		fread((char *) &staffno, sizeof(staffno), 1, log_p) != 1 ||
+		fread((char *) &sylplace, sizeof(sylplace), 1, log_p) != 1 ||
+		fread((char *) &verseno, sizeof(verseno), 1, log_p) != 1 ||
+		fread((char *) &font, sizeof(font), 1, log_p) != 1 ||
+		fread((char *) &size, sizeof(size), 1, log_p) != 1) {
+		ufatal("can't read carryover syllable");
+	}
+	for (n = 0; (c = getc(log_p)) != '\0'; n++) {
+		if (c == EOF || n == sizeof(the_syl) - 1) {
+			ufatal("can't read carryover syllable");
+		}
+		the_syl[n] = c;
+	}
+	the_syl[n] = '\0';
+
+	insert_carryover_syllable(mll_p, staffno, sylplace, verseno,
+					the_syl, font, size);
+	return(YES);
+}
+
+
 /* Add a dash or underscore syllable to list of lyrics. Need to alloc new
  * space for the sylplace and syls_p arrays, copy the existing data into
  * them, adding the new syllable at the proper place (sorted by verseno),
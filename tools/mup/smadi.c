@@ -22,6 +22,16 @@ struct ALLOC_INFO * Alloc_info;
 /* How many possible entries there are. (Those at the end may be unused.) */
 int Alloc_info_slots;
 
+/* Totals per type per arena, for the summary at the end */
+#define MAXTOTALS 500
+struct TOTAL {
+	char *arena;	/* arena name, from ALLOC_INFO */
+	char *type;	/* type name, from ALLOC_INFO */
+	long calls;	/* how many allocations */
+	long bytes;	/* how many bytes were asked for */
+} Totals[MAXTOTALS];
+int Num_totals;
+
 
 /* Memory map the allocdebug file containing the information to print,
  * and set Alloc_info_slots value. */
@@ -51,6 +61,88 @@ alloc_debug_init(void)
 }
 
 
+/* Add an allocation into the per-arena, per-type totals */
+
+void
+add_total(struct ALLOC_INFO *info_p)
+
+{
+	int t;
+	long bytes;
+
+	/* The allocation macros pass the size of one element and how many
+	 * elements; they treat a count of 0 as 1. */
+	bytes = (long) info_p->size * (long) info_p->num_elem;
+	if (bytes == 0) {
+		bytes = info_p->size;
+	}
+	for (t = 0; t < Num_totals; t++) {
+		if (strcmp(Totals[t].arena, info_p->arena) == 0
+				&& strcmp(Totals[t].type, info_p->type) == 0) {
+			break;
+		}
+	}
+	if (t == Num_totals) {
+		if (Num_totals >= MAXTOTALS) {
+			/* Too many to track; just ignore the rest */
+			return;
+		}
+		Totals[t].arena = info_p->arena;
+		Totals[t].type = info_p->type;
+		Num_totals++;
+	}
+	Totals[t].calls++;
+	Totals[t].bytes += bytes;
+}
+
+
+/* Used to sort the totals by arena, then biggest first */
+
+int
+comp_total(const void *t1_p, const void *t2_p)
+
+{
+	const struct TOTAL *total1_p = t1_p;
+	const struct TOTAL *total2_p = t2_p;
+	int ret;
+
+	if ((ret = strcmp(total1_p->arena, total2_p->arena)) != 0) {
+		return(ret);
+	}
+	if (total1_p->bytes != total2_p->bytes) {
+		return(total1_p->bytes < total2_p->bytes ? 1 : -1);
+	}
+	return(strcmp(total1_p->type, total2_p->type));
+}
+
+
+/* Print bytes allocated of each type, for each arena */
+
+void
+print_totals(void)
+
+{
+	int t;
+	long arena_bytes = 0;
+
+	qsort(Totals, Num_totals, sizeof(struct TOTAL), comp_total);
+	printf("\nBytes requested by type, per arena:\n");
+	for (t = 0; t < Num_totals; t++) {
+		if (t == 0 || strcmp(Totals[t].arena, Totals[t-1].arena) != 0) {
+			printf("arena %s:\n", Totals[t].arena);
+			arena_bytes = 0;
+		}
+		printf("  %-32s %10ld bytes in %8ld calls\n", Totals[t].type,
+				Totals[t].bytes, Totals[t].calls);
+		arena_bytes += Totals[t].bytes;
+		if (t == Num_totals - 1 || strcmp(Totals[t].arena,
+					Totals[t+1].arena) != 0) {
+			printf("  %-32s %10ld bytes\n", "(total)", arena_bytes);
+		}
+	}
+}
+
+
 int
 main()
 {
@@ -112,24 +204,28 @@ main()
 		case AI_CALLOC:
 		case AI_MALLOCA:
 		case AI_CALLOCA:
-			printf("[%d] %s: size=%ld, num_elem=%ld, type %s, new_p %s, ret %p, called from %p\n", i, t,
+			printf("[%d] %s: size=%ld, num_elem=%ld, type %s, new_p %s, arena %s, ret %p, called from %p\n", i, t,
 				Alloc_info[i].size,
 				Alloc_info[i].num_elem,
 				Alloc_info[i].type,
 				Alloc_info[i].newp,
+				Alloc_info[i].arena,
 				ret_value, Alloc_info[i].call_addr);
+			add_total(&Alloc_info[i]);
 				
 			break;
 		case AI_REALLOC:
 		case AI_REALLOCA:
-			printf("[%d] %s: size=%ld, num_elem=%ld, type %s, new_p %s, arg %p, ret %p, called from %p\n", i, t,
+			printf("[%d] %s: size=%ld, num_elem=%ld, type %s, new_p %s, arena %s, arg %p, ret %p, called from %p\n", i, t,
 				Alloc_info[i].size,
 				Alloc_info[i].num_elem,
 				Alloc_info[i].type,
 				Alloc_info[i].newp,
+				Alloc_info[i].arena,
 				arg_addr,
 				ret_value,
 				Alloc_info[i].call_addr);
+			add_total(&Alloc_info[i]);
 			break;
 		case AI_FREE:
 		case AI_FREE_SKIPPED:
@@ -153,5 +249,6 @@ main()
 			break;
 		}
 	}
+	print_totals();
 	exit(0);
 }
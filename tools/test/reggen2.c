@@ -49,7 +49,11 @@
  *	-g		save "good" (0 exit code) generated files
  *	-i iterations	generate this many tests. Default is ITERATIONS
  *					(ITERATIONS is #defined below)
+ *	-j workers	with -s, run this many worker processes at once,
+ *					each with its own server
  *	-n		also save files that give non-zero exit codes
+ *	-s		run tests through a resident "mup --serve", rather
+ *					than starting sh and mup for each one
  *	-t timeout	timeout value in seconds. Default is TIMEOUT
  *					(TIMEOUT is #defined below)
  *	-p prefix	use this prefix for generated files
@@ -74,6 +78,13 @@
  * Each input is run both for PostScript and MIDI output, since those go
  * through somewhat different code, and a -x option is used a random percentage
  * of the time, since that tends to interact with many other things.
+ *
+ * With -s, most of the time goes into Mup itself, rather than into starting
+ * processes: Mup only initializes once, and each test is a fork of that.
+ * Then -j can be used to keep several CPUs busy. In that mode, an input that
+ * makes Mup crash or time out is also minimized: lines are removed for as
+ * long as the same failure still happens, and the result is saved in a file
+ * with .min added to the name, alongside the original.
  */
 
 #ifdef __TURBOC__
@@ -943,6 +954,17 @@ int num_killed, num_core_dumped, num_exited_nonzero, num_midi_nonzero, num_nans;
 int num_huge_nums;
 int num_non_midi_tests, num_midi_tests;
 
+/* for -s and -j */
+short serve_mode = NO;	/* if to run tests via "mup --serve" */
+FILE *serve_req;	/* requests to the server */
+FILE *serve_reply;	/* replies from the server */
+int serve_pid;		/* PID of the server */
+char *serve_output;	/* what the last test wrote to standard output */
+long serve_outlen;	/* how many bytes of it */
+long serve_outsize;	/* how much space is allocated for it */
+/* most tries at removing lines when minimizing */
+#define MAXMINTRIES	2000
+
 short savenonzero = NO;	/* if to save files than cause non-zero exit */
 short savegood = NO;	/* if to save files that exit 0 */
 int child;		/* PID of child process */
@@ -980,6 +1002,15 @@ void usage(char *pname);
 void run_test(int index, char *command, char *suffix, char *prefix, int timeout, int verbose);
 int exectest(char *cmd, int timeout, int verbose, int doing_midi, int *ret_p);
 void alarmhandler(int sig);
+void run_tests(int first, int step, int iterations, char *command, char *suffix, char *prefix, int timeout, int verbose);
+int bad_numbers(char *addr, long size);
+void start_server(char *command);
+void stop_server(void);
+void serve_test(char *filename, int timeout, int verbose);
+int serve_check(char *filename, char *xarg, int timeout, int verbose, int doing_midi, int *result_p);
+int serve_run(char *filename, char *xarg, int doing_midi, int timeout, int verbose);
+void read_reply(long len, int keep, int verbose);
+void minimize(char *filename, char *xarg, int doing_midi, int timeout, int result);
 void genlyrics(struct GRP *grplist_p, int staff, int staffs);
 void gensyl(int mid);
 void scramble_lines(long foffset, char repchar);
@@ -1026,7 +1057,7 @@ main(int argc, char **argv)
 	char *suffix = "> RegGen2.out";	/* end of command after file name */
 	char *prefix = "RGtest";	/* prefix for file names */
 	int verbose = 0;
-	int index;			/* loop index */
+	int workers = 1;		/* how many to run at once, with -s */
 #ifdef __DOS__
 	extern int _fmode;
 #endif
@@ -1039,7 +1070,7 @@ main(int argc, char **argv)
 #ifdef GENONLY
 	while ((a = getopt(argc, argv, "i:p:")) != EOF) {
 #else
-	while ((a = getopt(argc, argv, "dgi:np:t:v")) != EOF) {
+	while ((a = getopt(argc, argv, "dgi:j:np:st:v")) != EOF) {
 #endif
 		switch(a) {
 #ifndef GENONLY
@@ -1056,9 +1087,15 @@ main(int argc, char **argv)
 			iterations = atoi(optarg);
 			break;
 #ifndef GENONLY
+		case 'j':
+			workers = atoi(optarg);
+			break;
 		case 'n':
 			savenonzero = YES;
 			break;
+		case 's':
+			serve_mode = YES;
+			break;
 #endif
 		case 'p':
 			prefix = optarg;
@@ -1079,6 +1116,11 @@ main(int argc, char **argv)
 	if (optind != argc) {
 		usage(argv[0]);
 	}
+	/* Workers without a server would all use the same output file */
+	if (workers < 1 || (workers > 1 && serve_mode == NO)
+			|| (serve_mode == YES && strcmp(command, "mup") != 0)) {
+		usage(argv[0]);
+	}
 
 	/* seed random number generator */
 	srand(time((long *) 0));
@@ -1088,20 +1130,68 @@ main(int argc, char **argv)
 	setenv("MALLOC_PERTURB_", "29", 1);
 
 
-	/* run as many tests as specified */
-	for (index = 1; index <= iterations; index++) {
-		run_test(index, command, suffix, prefix, timeout, verbose);
-		/* clean up */
-		if (Numgrids > 0) {
-			int g;
-			for (g = 0; g < Numgrids; g++) {
-				free(Gridlist[g].str);
+#ifndef GENONLY
+	if (workers > 1) {
+		int w;
+		int fds[2];	/* pipe for workers to report counts */
+		FILE *counts_p;
+		int counts[8];
+
+		if (pipe(fds) != 0) {
+			fprintf(stderr, "can't make pipe for workers\n");
+			exit(1);
+		}
+		/* Each worker does every workers'th test, so that their
+		 * file names are all different. */
+		for (w = 0; w < workers; w++) {
+			switch (fork()) {
+			case 0:
+				close(fds[0]);
+				srand(time((long *) 0) ^ (getpid() << 8));
+				run_tests(w + 1, workers, iterations, command,
+					suffix, prefix, timeout, verbose);
+				counts_p = fdopen(fds[1], "w");
+				fprintf(counts_p, "%d %d %d %d %d %d %d %d\n",
+					num_non_midi_tests, num_midi_tests,
+					num_core_dumped, num_killed, num_nans,
+					num_huge_nums, num_exited_nonzero,
+					num_midi_nonzero);
+				fclose(counts_p);
+				exit(0);
+			case -1:
+				fprintf(stderr, "can't start worker\n");
+				exit(1);
+			default:
+				break;
 			}
-			free(Gridlist);
-			Gridlist = 0;
-			Numgrids = 0;
 		}
-		Numtags = 3;  /* _cur, _win, and _page */
+		close(fds[1]);
+
+		/* add up what they all did */
+		counts_p = fdopen(fds[0], "r");
+		while (fscanf(counts_p, "%d %d %d %d %d %d %d %d",
+				&counts[0], &counts[1], &counts[2], &counts[3],
+				&counts[4], &counts[5], &counts[6],
+				&counts[7]) == 8) {
+			num_non_midi_tests += counts[0];
+			num_midi_tests += counts[1];
+			num_core_dumped += counts[2];
+			num_killed += counts[3];
+			num_nans += counts[4];
+			num_huge_nums += counts[5];
+			num_exited_nonzero += counts[6];
+			num_midi_nonzero += counts[7];
+		}
+		fclose(counts_p);
+		while (wait((int *) 0) > 0) {
+			;
+		}
+	}
+	else
+#endif
+	{
+		run_tests(1, 1, iterations, command, suffix, prefix, timeout,
+								verbose);
 	}
 
 #ifndef GENONLY
@@ -1118,6 +1208,41 @@ main(int argc, char **argv)
 }
 
 
+/* run tests numbered first, first + step, etc, up through iterations */
+
+void
+run_tests(int first, int step, int iterations, char *command, char *suffix, char *prefix, int timeout, int verbose)
+{
+	int index;			/* loop index */
+
+
+#ifndef GENONLY
+	if (serve_mode == YES) {
+		start_server(command);
+	}
+#endif
+	for (index = first; index <= iterations; index += step) {
+		run_test(index, command, suffix, prefix, timeout, verbose);
+		/* clean up */
+		if (Numgrids > 0) {
+			int g;
+			for (g = 0; g < Numgrids; g++) {
+				free(Gridlist[g].str);
+			}
+			free(Gridlist);
+			Gridlist = 0;
+			Numgrids = 0;
+		}
+		Numtags = 3;  /* _cur, _win, and _page */
+	}
+#ifndef GENONLY
+	if (serve_mode == YES) {
+		stop_server();
+	}
+#endif
+}
+
+
 /* Generate various score level SSV things */
 
 void
@@ -3229,6 +3354,7 @@ usage(char *pname)
 	fprintf(stderr, "usage: %s [-i iterations] [-p prefix]\n", pname);
 #else
 	fprintf(stderr, "usage: %s [-d] [-i iterations] [-n] [-p prefix] [-t timeout] [-v]\n", pname);
+	fprintf(stderr, "   or: %s -s [-j workers] [-i iterations] [-n] [-p prefix] [-t timeout] [-v]\n", pname);
 #endif
 	exit(1);
 }
@@ -3258,6 +3384,11 @@ run_test(int index, char *command, char *suffix, char *prefix, int timeout, int
 	fclose(outf);
 
 #ifndef GENONLY
+	if (serve_mode == YES) {
+		serve_test(filename, timeout, verbose);
+		return;
+	}
+
 	if (sometimes(xoption)) {
 		int start, end;
 		start = myrandom(-2, 2);
@@ -3374,29 +3505,15 @@ exectest(char *cmd, int timeout, int verbose, int doing_midi, int *ret_p)
 						addr = (char *) mmap(0, info.st_size, PROT_READ,
 							MAP_SHARED, f, 0);
 						close(f);
-						n = info.st_size;
+						n = NO;
 						if (addr != 0) {
-							for (n = 0; n < info.st_size - 3; n++) {
-								if (addr[n] == 'n' &&
-										strncmp(addr+n, "nan ", 4) == 0) {
-									num_nans++;
-									code = 1;
-									break;
-								}
-								else if (isdigit(addr[n])) {
-									if (strspn(addr+n, "0123456789") > 15) {
-										num_huge_nums++;
-										code = 1;
-										break;
-									}
-								}
-							}
+							n = bad_numbers(addr, info.st_size);
 							munmap(addr, info.st_size);
 						}
 						else {
 							fprintf(stderr, "mmap failed: %s\n", strerror(errno));
 						}
-						if (n < info.st_size - 3) {
+						if (n == YES) {
 							/* treat as fail */
 							*ret_p = 1;
 							return(NO);
@@ -3434,6 +3551,343 @@ alarmhandler(int sig)
 	kill(child, SIGTERM);
 }
 
+
+/* Check PostScript output for things that look suspiciously like floating
+ * point overflows. Return YES if there are any, and count them. */
+
+int
+bad_numbers(char *addr, long size)
+{
+	long n;
+
+	for (n = 0; n < size - 3; n++) {
+		if (addr[n] == 'n' && strncmp(addr+n, "nan ", 4) == 0) {
+			num_nans++;
+			return(YES);
+		}
+		else if (isdigit(addr[n])) {
+			if (strspn(addr+n, "0123456789") > 15) {
+				num_huge_nums++;
+				return(YES);
+			}
+		}
+	}
+	return(NO);
+}
+
+
+/* start up "mup --serve" with pipes to send it requests and get replies */
+
+void
+start_server(char *command)
+{
+	int req[2];
+	int reply[2];
+
+	if (pipe(req) != 0 || pipe(reply) != 0) {
+		fprintf(stderr, "can't make pipes for server\n");
+		exit(1);
+	}
+	switch (serve_pid = fork()) {
+	case 0:
+		if (dup2(req[0], 0) < 0 || dup2(reply[1], 1) < 0) {
+			exit(1);
+		}
+		close(req[0]);
+		close(req[1]);
+		close(reply[0]);
+		close(reply[1]);
+		execlp(command, command, "--serve", (char *) 0);
+		/*FALLTHRU*/
+	case -1:
+		fprintf(stderr, "failed to start %s --serve\n", command);
+		exit(1);
+	default:
+		close(req[0]);
+		close(reply[1]);
+		serve_req = fdopen(req[1], "w");
+		serve_reply = fdopen(reply[0], "r");
+		break;
+	}
+}
+
+
+/* tell the server there are no more tests, and wait for it to finish */
+
+void
+stop_server()
+{
+	fclose(serve_req);
+	fclose(serve_reply);
+	waitpid(serve_pid, (int *) 0, 0);
+}
+
+
+/* Run a test via the server. This is like the second half of run_test(),
+ * and exectest(), except that instead of a core dump, a test that crashes
+ * shows up as being killed by a signal. If it crashes or times out, the
+ * input is minimized. */
+
+void
+serve_test(char *filename, int timeout, int verbose)
+{
+	char xarg[32];		/* -x option or empty */
+	int keep;		/* NO if the file can be removed */
+	int result;		/* exit code, or minus the signal number */
+
+
+	xarg[0] = '\0';
+	if (sometimes(xoption)) {
+		sprintf(xarg, "-x%d,%d", myrandom(-2, 2), myrandom(-2, 2));
+	}
+	keep = serve_check(filename, xarg, timeout, verbose, NO, &result);
+	num_non_midi_tests++;
+	if (result < 0) {
+		minimize(filename, xarg, NO, timeout, result);
+		return;
+	}
+
+	if (sometimes(xoption)) {
+		sprintf(xarg, "-x%d,%d", myrandom(-2, 2), myrandom(-2, 2));
+	}
+	else {
+		xarg[0] = '\0';
+	}
+	keep |= serve_check(filename, xarg, timeout, verbose, YES, &result);
+	num_midi_tests++;
+	if (result < 0) {
+		minimize(filename, xarg, YES, timeout, result);
+		return;
+	}
+	if (keep == NO) {
+		unlink(filename);
+	}
+}
+
+
+/* Run one test via the server, and count how it turned out.
+ * Return YES if the file should be kept, NO if not. */
+
+int
+serve_check(char *filename, char *xarg, int timeout, int verbose, int doing_midi, int *result_p)
+{
+	int code;
+
+	code = *result_p = serve_run(filename, xarg, doing_midi, timeout,
+								verbose);
+	if (code == -SIGALRM) {
+		if (verbose) {
+			fprintf(stderr, "\ttimed out\n");
+		}
+		num_killed++;
+		return(YES);
+	}
+	if (code < 0) {
+		if (verbose) {
+			fprintf(stderr, "\tkilled by signal %d\n", -code);
+		}
+		num_core_dumped++;
+		return(YES);
+	}
+	if (verbose) {
+		fprintf(stderr, "\texit code was %d\n", code);
+	}
+	if (code != 0) {
+		num_exited_nonzero++;
+		if (doing_midi) {
+			num_midi_nonzero++;
+		}
+	}
+	else if ( ! doing_midi && bad_numbers(serve_output, serve_outlen) == YES) {
+		return(YES);
+	}
+	if (savenonzero == YES && code != 0) {
+		return(YES);
+	}
+	if (savegood == YES && code == 0) {
+		return(YES);
+	}
+	return(NO);
+}
+
+
+/* Have the server run mup on the file. Its standard output is left
+ * in serve_output. Return the exit code, or minus the signal number
+ * if it was killed. */
+
+int
+serve_run(char *filename, char *xarg, int doing_midi, int timeout, int verbose)
+{
+	char line[BUFSIZ];
+	long len;
+
+
+	if (verbose) {
+		fprintf(stderr, "\n========= mup %s %s%s ===========\n", xarg,
+				doing_midi ? "-m /dev/null " : "", filename);
+	}
+	if (xarg[0] != '\0') {
+		fprintf(serve_req, "arg %s\n", xarg);
+	}
+	if (doing_midi) {
+		fprintf(serve_req, "arg -m\narg /dev/null\n");
+	}
+	fprintf(serve_req, "arg %s\ntimeout %d\nrun\n", filename, timeout);
+	fflush(serve_req);
+
+	serve_outlen = 0;
+	while (fgets(line, sizeof(line), serve_reply) != (char *) 0) {
+		if (sscanf(line, "output %ld", &len) == 1) {
+			read_reply(len, YES, NO);
+		}
+		else if (sscanf(line, "errors %ld", &len) == 1) {
+			read_reply(len, NO, verbose);
+		}
+		else if (sscanf(line, "exit %ld", &len) == 1) {
+			return((int) len);
+		}
+		else if (sscanf(line, "signal %ld", &len) == 1) {
+			return(- (int) len);
+		}
+		else {
+			fprintf(stderr, "server said: %s", line);
+		}
+	}
+	fprintf(stderr, "mup --serve went away\n");
+	exit(1);
+}
+
+
+/* Read len bytes of a reply. If keep, they go in serve_output, otherwise
+ * they are thrown away, or if verbose, written to stderr. */
+
+void
+read_reply(long len, int keep, int verbose)
+{
+	int c;
+
+	if (keep && len + 1 > serve_outsize) {
+		serve_outsize = len + 1;
+		if ((serve_output = realloc(serve_output, serve_outsize)) == 0) {
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+	}
+	for (  ; len > 0; len--) {
+		if ((c = getc(serve_reply)) == EOF) {
+			return;
+		}
+		if (keep) {
+			serve_output[serve_outlen++] = c;
+		}
+		else if (verbose) {
+			putc(c, stderr);
+		}
+	}
+}
+
+
+/* Given a file that made Mup crash or time out, find a smaller one that
+ * gives the same result, by removing lines for as long as that still
+ * happens, first large blocks, then smaller ones. The smallest one found
+ * is left in a file with .min added to the name. */
+
+void
+minimize(char *filename, char *xarg, int doing_midi, int timeout, int result)
+{
+	char minname[120];	/* name of the minimized file */
+	FILE *f;
+	char **lines = 0;	/* the lines of the file */
+	int numlines = 0;
+	int size = 0;		/* space allocated for lines */
+	char line[BUFSIZ];
+	char *keepmask;		/* which lines are still there */
+	int chunk;		/* how many lines to try removing at once */
+	int start;		/* first line to try removing */
+	int n;
+	int left;		/* lines still there */
+	int removed;		/* lines removed by the current try */
+	int tries = 0;
+	int progress;
+
+
+	if ((f = fopen(filename, "r")) == (FILE *) 0) {
+		return;
+	}
+	while (fgets(line, sizeof(line), f) != (char *) 0) {
+		if (numlines >= size) {
+			size += 1000;
+			lines = realloc(lines, size * sizeof(char *));
+		}
+		lines[numlines++] = strdup(line);
+	}
+	fclose(f);
+	if ((keepmask = malloc(numlines + 1)) == 0) {
+		return;
+	}
+	memset(keepmask, YES, numlines);
+	sprintf(minname, "%s.min", filename);
+
+	left = numlines;
+	for (chunk = (numlines + 1) / 2; chunk >= 1 && tries < MAXMINTRIES;
+						chunk /= 2) {
+		do {
+			progress = NO;
+			for (start = 0; start < numlines && tries < MAXMINTRIES;
+							start += chunk) {
+				/* write out the file without this chunk */
+				if ((f = fopen(minname, "w")) == (FILE *) 0) {
+					return;
+				}
+				for (removed = n = 0; n < numlines; n++) {
+					if (keepmask[n] == NO) {
+						continue;
+					}
+					if (n >= start && n < start + chunk) {
+						removed++;
+						continue;
+					}
+					fputs(lines[n], f);
+				}
+				fclose(f);
+				if (removed == 0 || removed == left) {
+					continue;
+				}
+
+				tries++;
+				if (serve_run(minname, xarg, doing_midi, timeout,
+							NO) == result) {
+					/* still fails the same way */
+					memset(keepmask + start, NO,
+						(start + chunk > numlines ?
+						numlines - start : chunk));
+					left -= removed;
+					progress = YES;
+				}
+			}
+		} while (progress == YES && tries < MAXMINTRIES);
+	}
+
+	/* leave the smallest failing one in the .min file */
+	if ((f = fopen(minname, "w")) != (FILE *) 0) {
+		for (n = 0; n < numlines; n++) {
+			if (keepmask[n] == YES) {
+				fputs(lines[n], f);
+			}
+		}
+		fclose(f);
+	}
+	fprintf(stderr, "%s: %s %d, minimized from %d to %d lines in %s\n",
+			filename, result == -SIGALRM ? "timed out, signal"
+			: "killed by signal", -result, numlines, left, minname);
+
+	for (n = 0; n < numlines; n++) {
+		free(lines[n]);
+	}
+	free(lines);
+	free(keepmask);
+}
+
 #endif
 
 
@@ -0,0 +1,467 @@
+/*
+ Copyright (c) 1995-2024  by Arkkra Enterprises.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms,
+ with or without modification, are permitted provided that
+ the following conditions are met:
+
+ 1. Redistributions of source code must retain
+ the above copyright notice, this list of conditions
+ and the following DISCLAIMER.
+
+ 2. Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and
+ the following DISCLAIMER in the documentation and/or
+ other materials provided with the distribution.
+
+ 3. Any additions, deletions, or changes to the original files
+ must be clearly indicated in accompanying documentation,
+ including the reasons for the changes,
+ and the names of those who made the modifications.
+
+	DISCLAIMER
+
+ THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS
+ OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* This program generates valid Mup input files of whatever size is wanted,
+ * for benchmarking. Unlike reggen2, which tries to generate strange input
+ * to find bugs, this tries to generate something like real music,
+ * and the same arguments always give exactly the same file, so that timings
+ * of different versions of Mup, or of songs of different sizes,
+ * can be compared. The output is written to stdout.
+ * Arguments:
+ *	-b tabstaffs	make this many of the staffs (the last ones) tablature
+ *	-c percent	% of beats on the first staff with a chord symbol
+ *	-l verses	number of lyrics verses under the first non-tab staff
+ *	-m measures	number of measures
+ *	-r seed		seed for the random number generator
+ *	-s staffs	number of staffs
+ *	-t percent	% of quarter note beats that are triplets instead
+ *	-T percent	% of notes with a tie or slur to the next one
+ *	-v voices	voices per non-tab staff (1 or 2)
+ *	-x items	number of text items to stack above each beat of the
+ *			first staff, to exercise placement of STUFF
+ * The defaults are given by the DFLT_* values below.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* default values */
+#define DFLT_STAFFS	4
+#define DFLT_VOICES	2
+#define DFLT_MEASURES	100
+#define DFLT_VERSES	2
+#define DFLT_CHORDS	50
+#define DFLT_TUPLETS	10
+#define DFLT_TIES	10
+#define DFLT_TABSTAFFS	0
+#define DFLT_SEED	1
+#define DFLT_STACKED	0
+
+/* limits on values, from what Mup allows */
+#define MAXSTAFFS	40
+#define MAXVERSES	10
+#define MAXSTACKED	100
+
+/* Rough height in inches of each staff, and of each stacked text item, used
+ * to scale big songs down so a score still fits on a page */
+#define STAFFHEIGHT	(1.1)
+#define STACKEDHEIGHT	(0.7)
+#define MAXHEIGHT	(8.0)
+
+#define YES	1
+#define NO	0
+
+/* Measures are 4/4, with time counted in 16th notes */
+#define MEASTIME	16
+#define BEATTIME	4
+
+/* Values to control what is generated */
+int staffs = DFLT_STAFFS;
+int voices = DFLT_VOICES;
+int measures = DFLT_MEASURES;
+int verses = DFLT_VERSES;
+int chords = DFLT_CHORDS;	/* % of beats with a chord symbol */
+int tuplets = DFLT_TUPLETS;	/* % of beats that are triplets */
+int ties = DFLT_TIES;		/* % of notes tied or slurred to next */
+int tabstaffs = DFLT_TABSTAFFS;
+int stacked = DFLT_STACKED;	/* text items above each beat */
+
+/* state of the random number generator */
+unsigned long Seed = DFLT_SEED;
+
+char *Chordnames[] = {
+	"C", "Dm", "Em", "F", "G", "G7", "Am", "B&", "D7", "C/E"
+};
+char *Syllables[] = {
+	"la", "do", "re", "mi", "fa", "so", "ti", "na", "oh", "sing"
+};
+/* tab strings used; these are all in the default guitar tuning */
+char *Tabstrings[] = { "a", "d", "g", "b" };
+char *Texts[] = {
+	"p", "mf", "f", "cresc.", "dim.", "rit.", "a tempo", "legato",
+	"dolce", "poco a poco"
+};
+
+#define NUMELEM(a)	(sizeof(a) / sizeof((a)[0]))
+
+void gen(void);
+void gen_voice(int staff, int voice, int tab);
+void gen_lyrics(int staff);
+void gen_chords(int staff);
+void gen_stacked(int staff);
+void picknote(int tab);
+int sometimes(int percent);
+int myrandom(int min, int max);
+int getarg(char *pname, char *arg, int min, int max);
+void usage(char *pname);
+
+
+int
+main(int argc, char **argv)
+{
+	int a;
+
+
+	for (a = 1; a < argc; a++) {
+		if (argv[a][0] != '-' || argv[a][1] == '\0' || argv[a][2] != '\0'
+						|| a + 1 >= argc) {
+			usage(argv[0]);
+		}
+		switch (argv[a++][1]) {
+		case 'b':
+			tabstaffs = getarg(argv[0], argv[a], 0, MAXSTAFFS);
+			break;
+		case 'c':
+			chords = getarg(argv[0], argv[a], 0, 100);
+			break;
+		case 'l':
+			verses = getarg(argv[0], argv[a], 0, MAXVERSES);
+			break;
+		case 'm':
+			measures = getarg(argv[0], argv[a], 1, 1000000);
+			break;
+		case 'r':
+			Seed = (unsigned long) atol(argv[a]);
+			break;
+		case 's':
+			staffs = getarg(argv[0], argv[a], 1, MAXSTAFFS);
+			break;
+		case 't':
+			tuplets = getarg(argv[0], argv[a], 0, 100);
+			break;
+		case 'T':
+			ties = getarg(argv[0], argv[a], 0, 100);
+			break;
+		case 'v':
+			voices = getarg(argv[0], argv[a], 1, 2);
+			break;
+		case 'x':
+			stacked = getarg(argv[0], argv[a], 0, MAXSTACKED);
+			break;
+		default:
+			usage(argv[0]);
+			break;
+		}
+	}
+	if (tabstaffs > staffs) {
+		tabstaffs = staffs;
+	}
+
+	gen();
+	return(0);
+}
+
+
+/* generate the whole song */
+
+void
+gen()
+{
+	int s;
+	int v;
+	int m;
+	int firstnontab;	/* 1 if there is a non-tab staff, else 0 */
+	double height;		/* estimated height of a score, in inches */
+
+
+	printf("// generated by scoregen -s %d -v %d -m %d -l %d -c %d -t %d -T %d -b %d -x %d -r %lu\n",
+			staffs, voices, measures, verses, chords, tuplets,
+			ties, tabstaffs, stacked, Seed);
+
+	printf("score\n\tstaffs=%d\n\ttime=4/4\n", staffs);
+	height = staffs * STAFFHEIGHT + stacked * STACKEDHEIGHT;
+	if (height > MAXHEIGHT) {
+		printf("\tscale=%.2f\n", MAXHEIGHT / height);
+	}
+	if (voices > 1) {
+		printf("\tvscheme=2o\n");
+	}
+	for (s = 1; s <= staffs; s++) {
+		if (s > staffs - tabstaffs) {
+			printf("staff %d\n\tstafflines=tab\n\tvscheme=1\n", s);
+		}
+		else if (s % 2 == 0) {
+			printf("staff %d\n\tclef=bass\n", s);
+		}
+	}
+	printf("\nmusic\n\n");
+
+	firstnontab = (tabstaffs < staffs ? 1 : 0);
+	for (m = 1; m <= measures; m++) {
+		for (s = 1; s <= staffs; s++) {
+			if (s > staffs - tabstaffs) {
+				gen_voice(s, 1, YES);
+			}
+			else {
+				for (v = 1; v <= voices; v++) {
+					gen_voice(s, v, NO);
+				}
+			}
+		}
+		if (firstnontab > 0 && verses > 0) {
+			gen_lyrics(firstnontab);
+		}
+		if (chords > 0) {
+			gen_chords(1);
+		}
+		if (stacked > 0) {
+			gen_stacked(1);
+		}
+		/* start a new score now and then, like real songs do */
+		printf("bar\n%s\n", (m % 32 == 0 ? "newscore" : ""));
+	}
+}
+
+
+/* generate one measure of one voice */
+
+void
+gen_voice(staff, voice, tab)
+
+int staff;
+int voice;
+int tab;	/* YES if a tablature staff */
+
+{
+	int remaining;		/* time left in the measure */
+	int duration;		/* of the current group */
+	int n;
+	int slurs;		/* YES if slurs can be used */
+
+
+	/* On the staff just above a tablature staff, "<>" would be taken
+	 * as a slide, and can't slide to the same note, so only tie there */
+	slurs = (tabstaffs > 0 && staff == staffs - tabstaffs) ? NO : YES;
+
+	printf("%d %d: ", staff, voice);
+	for (remaining = MEASTIME; remaining > 0; remaining -= duration) {
+		/* A beat at a time is made a triplet of eighth notes */
+		if (tab == NO && remaining % BEATTIME == 0
+						&& sometimes(tuplets)) {
+			duration = BEATTIME;
+			printf("{8");
+			for (n = 0; n < 3; n++) {
+				picknote(NO);
+				printf(";");
+			}
+			printf("}3;");
+			continue;
+		}
+
+		/* otherwise pick a half, quarter, or eighth note that fits */
+		do {
+			duration = 2 << myrandom(0, 2);
+		} while (duration > remaining);
+		printf("%d", MEASTIME / duration);
+		if (tab == NO && sometimes(5)) {
+			printf("r;");
+			continue;
+		}
+		picknote(tab);
+
+		/* Ties and slurs only go to a following group in the same
+		 * measure, and that one is never a rest or triplet, so to make
+		 * sure they are valid, the next group repeats this one,
+		 * which is right for a tie, and fine for a slur. */
+		if (tab == NO && remaining - duration >= 2 && sometimes(ties)) {
+			printf("%s;8;", (sometimes(50) || slurs == NO ? "~" : "<>"));
+			duration += 2;
+			continue;
+		}
+		printf(";");
+	}
+	printf("\n");
+}
+
+
+/* output one note */
+
+void
+picknote(tab)
+
+int tab;	/* YES if a tablature staff */
+
+{
+	if (tab == YES) {
+		printf("%s%d", Tabstrings[myrandom(0, NUMELEM(Tabstrings) - 1)],
+					myrandom(0, 12));
+		return;
+	}
+	printf("%c%s", "cdefgab"[myrandom(0, 6)], (sometimes(20) ? "+" : ""));
+}
+
+
+/* Generate one measure of lyrics, a syllable per beat, for each verse */
+
+void
+gen_lyrics(staff)
+
+int staff;
+
+{
+	int v;
+	int b;
+
+
+	printf("lyrics %d: 4;;;;", staff);
+	for (v = 1; v <= verses; v++) {
+		printf(" [%d] \"", v);
+		for (b = 0; b < MEASTIME / BEATTIME; b++) {
+			printf("%s", Syllables[myrandom(0, NUMELEM(Syllables) - 1)]);
+			if (b < MEASTIME / BEATTIME - 1) {
+				/* sometimes make a word of two syllables */
+				printf("%s", (sometimes(25) ? "-" : " "));
+			}
+		}
+		printf("\";");
+	}
+	printf("\n");
+}
+
+
+/* Generate chord symbols for one measure */
+
+void
+gen_chords(staff)
+
+int staff;
+
+{
+	int b;
+	int any = NO;
+
+
+	for (b = 1; b <= MEASTIME / BEATTIME; b++) {
+		if (sometimes(chords)) {
+			if (any == NO) {
+				printf("rom chord above %d:", staff);
+				any = YES;
+			}
+			printf(" %d \"%s\";", b,
+				Chordnames[myrandom(0, NUMELEM(Chordnames) - 1)]);
+		}
+	}
+	if (any == YES) {
+		printf("\n");
+	}
+}
+
+
+/* Generate "stacked" text items above each beat of one measure. Their
+ * widths vary, so each has to be placed among those already there. */
+
+void
+gen_stacked(staff)
+
+int staff;
+
+{
+	int i;
+	int b;
+
+
+	for (i = 0; i < stacked; i++) {
+		printf("%s above %d:", (i % 2 == 0 ? "ital" : "rom"), staff);
+		for (b = 1; b <= MEASTIME / BEATTIME; b++) {
+			printf(" %d \"%s\";", b,
+				Texts[myrandom(0, NUMELEM(Texts) - 1)]);
+		}
+		printf("\n");
+	}
+}
+
+
+/* return YES or NO randomly according to percentage YES */
+
+int
+sometimes(percent)
+
+int percent;
+
+{
+	return (myrandom(0, 99) < percent ? YES : NO);
+}
+
+
+/* return random number between min and max inclusive. This uses its own
+ * generator rather than rand(), so that the output is the same everywhere */
+
+int
+myrandom(min, max)
+
+int min;
+int max;
+
+{
+	Seed = (Seed * 1103515245L + 12345L) & 0xffffffffL;
+	return ((int) ((Seed >> 16) % (max - min + 1)) + min);
+}
+
+
+/* get a numeric argument, which must be between min and max inclusive */
+
+int
+getarg(pname, arg, min, max)
+
+char *pname;
+char *arg;
+int min;
+int max;
+
+{
+	int value;
+
+	value = atoi(arg);
+	if (value < min || value > max) {
+		fprintf(stderr, "%s: value %s is not in the range %d to %d\n",
+					pname, arg, min, max);
+		exit(1);
+	}
+	return(value);
+}
+
+
+void
+usage(char *pname)
+{
+	fprintf(stderr, "usage: %s [-b tabstaffs] [-c chord%%] [-l verses] [-m measures] [-r seed]\n\t[-s staffs] [-t triplet%%] [-T tie%%] [-v voices] [-x stacked]\n", pname);
+	exit(1);
+}